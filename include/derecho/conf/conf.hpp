@@ -40,6 +40,12 @@ private:
 #define CONF_DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE "DERECHO/max_p2p_request_payload_size"
 #define CONF_DERECHO_MAX_P2P_REPLY_PAYLOAD_SIZE "DERECHO/max_p2p_reply_payload_size"
 #define CONF_DERECHO_P2P_WINDOW_SIZE "DERECHO/p2p_window_size"
+#define CONF_DERECHO_P2P_LOOP_BUSY_WAIT_BEFORE_SLEEP_MS "DERECHO/p2p_loop_busy_wait_before_sleep_ms"
+#define CONF_DERECHO_RDMC_PIPELINE_DEPTH "DERECHO/rdmc_pipeline_depth"
+#define CONF_DERECHO_ENABLE_METRICS "DERECHO/enable_metrics"
+#define CONF_DERECHO_METRICS_FILE "DERECHO/metrics_file"
+#define CONF_DERECHO_METRICS_SOCKET "DERECHO/metrics_socket"
+#define CONF_DERECHO_METRICS_INTERVAL_MS "DERECHO/metrics_interval_ms"
 
 #define CONF_SUBGROUP_DEFAULT_MAX_PAYLOAD_SIZE "SUBGROUP/DEFAULT/max_payload_size"
 #define CONF_SUBGROUP_DEFAULT_MAX_REPLY_PAYLOAD_SIZE "SUBGROUP/DEFAULT/max_reply_payload_size"
@@ -47,6 +53,8 @@ private:
 #define CONF_SUBGROUP_DEFAULT_BLOCK_SIZE "SUBGROUP/DEFAULT/block_size"
 #define CONF_SUBGROUP_DEFAULT_WINDOW_SIZE "SUBGROUP/DEFAULT/window_size"
 #define CONF_SUBGROUP_DEFAULT_RDMC_SEND_ALGORITHM "SUBGROUP/DEFAULT/rdmc_send_algorithm"
+#define CONF_SUBGROUP_DEFAULT_PARALLEL_DELIVERY "SUBGROUP/DEFAULT/parallel_delivery"
+#define CONF_SUBGROUP_DEFAULT_RDMC_RACKS "SUBGROUP/DEFAULT/rdmc_racks"
 
 #define CONF_RDMA_PROVIDER "RDMA/provider"
 #define CONF_RDMA_DOMAIN "RDMA/domain"
@@ -58,6 +66,17 @@ private:
 #define CONF_PERS_MAX_LOG_ENTRY "PERS/max_log_entry"
 #define CONF_PERS_MAX_DATA_SIZE "PERS/max_data_size"
 #define CONF_PERS_PRIVATE_KEY_FILE "PERS/private_key_file"
+#define CONF_PERS_DELTA_CHECKPOINT_INTERVAL "PERS/delta_checkpoint_interval"
+#define CONF_PERS_DELTA_CHECKPOINT_BYTES "PERS/delta_checkpoint_bytes"
+#define CONF_PERS_GROUP_COMMIT "PERS/group_commit"
+#define CONF_PERS_BATCH_SIGNATURES "PERS/batch_signatures"
+#define CONF_PERS_DIRTY_TRACKING "PERS/dirty_tracking"
+#define CONF_PERS_SEGMENT_SIZE "PERS/segment_size"
+#define CONF_PERS_SEGMENT_LOG_ENTRY "PERS/segment_log_entry"
+#define CONF_PERS_COLD_PATH "PERS/cold_path"
+#define CONF_PERS_COMPRESS_COLD_SEGMENTS "PERS/compress_cold_segments"
+#define CONF_PERS_MAX_MAPPED_SEGMENTS "PERS/max_mapped_segments"
+#define CONF_PERS_LOAD_THREADS "PERS/load_threads"
 #define CONF_LOGGER_DEFAULT_LOG_NAME "LOGGER/default_log_name"
 #define CONF_LOGGER_DEFAULT_LOG_LEVEL "LOGGER/default_log_level"
     // Configuration Table:
@@ -84,6 +103,12 @@ private:
 	        {CONF_DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE, "10240"},
 	        {CONF_DERECHO_MAX_P2P_REPLY_PAYLOAD_SIZE, "10240"},
 	        {CONF_DERECHO_P2P_WINDOW_SIZE, "16"},
+	        {CONF_DERECHO_P2P_LOOP_BUSY_WAIT_BEFORE_SLEEP_MS, "1"},
+            {CONF_DERECHO_RDMC_PIPELINE_DEPTH, "1"},
+            {CONF_DERECHO_ENABLE_METRICS, "false"},
+            {CONF_DERECHO_METRICS_FILE, ""},
+            {CONF_DERECHO_METRICS_SOCKET, ""},
+            {CONF_DERECHO_METRICS_INTERVAL_MS, "1000"},
             {CONF_DERECHO_MAX_NODE_ID, "1024"},
             // [SUBGROUP/<subgroupname>]
             {CONF_SUBGROUP_DEFAULT_MAX_PAYLOAD_SIZE, "10240"},
@@ -91,6 +116,8 @@ private:
             {CONF_SUBGROUP_DEFAULT_MAX_SMC_PAYLOAD_SIZE, "10240"},
             {CONF_SUBGROUP_DEFAULT_BLOCK_SIZE, "1048576"},
             {CONF_SUBGROUP_DEFAULT_WINDOW_SIZE, "16"},
+            {CONF_SUBGROUP_DEFAULT_PARALLEL_DELIVERY, "false"},
+            {CONF_SUBGROUP_DEFAULT_RDMC_RACKS, ""},
             {CONF_DERECHO_HEARTBEAT_MS, "1"},
             // [RDMA]
             {CONF_RDMA_PROVIDER, "sockets"},
@@ -104,6 +131,17 @@ private:
             {CONF_PERS_MAX_LOG_ENTRY, "1048576"}, // 1M log entries.
             {CONF_PERS_MAX_DATA_SIZE, "549755813888"}, // 512G total data size.
             {CONF_PERS_PRIVATE_KEY_FILE, "private_key.pem"},
+            {CONF_PERS_DELTA_CHECKPOINT_INTERVAL, "0"}, // no checkpoint by number of deltas.
+            {CONF_PERS_DELTA_CHECKPOINT_BYTES, "0"}, // no checkpoint by size of deltas.
+            {CONF_PERS_GROUP_COMMIT, "false"},
+            {CONF_PERS_BATCH_SIGNATURES, "false"},
+            {CONF_PERS_DIRTY_TRACKING, "false"},
+            {CONF_PERS_SEGMENT_SIZE, "0"}, // a single-file log per object.
+            {CONF_PERS_SEGMENT_LOG_ENTRY, "65536"},
+            {CONF_PERS_COLD_PATH, ""},
+            {CONF_PERS_COMPRESS_COLD_SEGMENTS, "false"},
+            {CONF_PERS_MAX_MAPPED_SEGMENTS, "64"},
+            {CONF_PERS_LOAD_THREADS, "0"}, // one per core.
             // [LOGGER]
             {CONF_LOGGER_DEFAULT_LOG_NAME, "derecho_debug"},
             {CONF_LOGGER_DEFAULT_LOG_LEVEL, "info"}};
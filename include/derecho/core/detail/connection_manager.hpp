@@ -10,11 +10,24 @@
 
 namespace tcp {
 class tcp_connections {
+    /**
+     * Guards the sockets and socket_mutexes maps. It is always acquired
+     * before a socket's own mutex, and released once that mutex is held, so
+     * operations on different sockets (such as state transfers to several
+     * nodes) can run concurrently.
+     */
     std::mutex sockets_mutex;
 
     node_id_t my_id;
     std::unique_ptr<connection_listener> conn_listener;
     std::map<node_id_t, socket> sockets;
+    /** One mutex per socket, held while the socket is being used */
+    std::map<node_id_t, std::mutex> socket_mutexes;
+    /**
+     * Waits until no other thread is using the socket for a node, then
+     * removes it. The caller must hold sockets_mutex.
+     */
+    bool remove_socket(node_id_t node_id);
     bool add_connection(const node_id_t other_id,
                         const std::pair<ip_addr_t, uint16_t>& other_ip_and_port);
     void establish_node_connections(
@@ -99,9 +112,11 @@ public:
 
     template <class T>
     void exchange(node_id_t node_id, T local, T& remote) {
-        std::lock_guard<std::mutex> lock(sockets_mutex);
+        std::unique_lock<std::mutex> map_lock(sockets_mutex);
         const auto it = sockets.find(node_id);
         assert(it != sockets.end());
+        std::lock_guard<std::mutex> socket_lock(socket_mutexes[node_id]);
+        map_lock.unlock();
         it->second.exchange(local, remote);
     }
     /**
@@ -126,9 +141,11 @@ public:
     /**
      * Gets a locked reference to the TCP socket connected to a particular node.
      * While the caller holds the locked reference to the socket, no other
-     * tcp_connections methods can be called. This makes it safe to use this
-     * method to access sockets directly, even though they are usually managed
-     * by the other tcp_connections methods.
+     * thread can use that socket, and the calling thread must not call any
+     * other tcp_connections methods. This makes it safe to use this method to
+     * access sockets directly, even though they are usually managed by the
+     * other tcp_connections methods. Other threads can still use the sockets
+     * connected to other nodes.
      * @param node_id The ID of the desired node
      * @return A LockedReference to the TCP socket connected to that node.
      */
@@ -59,9 +59,11 @@ using persistence_callback_t = std::function<void(subgroup_id_t, persistent::ver
 using verified_callback_t = std::function<void(subgroup_id_t, persistent::version_t)>;
 /**
  * The type of the function used by MulticastGroup to notify RPCManager of a new message.
- * Matches the type signature of RPCManager::rpc_message_handler (but as a free function).
+ * Matches the type signature of RPCManager::rpc_message_handler (but as a free function),
+ * with its rpc::trailing_bytes given as a pointer and a size.
  */
-using rpc_handler_t = std::function<void(subgroup_id_t, node_id_t, persistent::version_t, uint64_t, char*, uint32_t)>;
+using rpc_handler_t = std::function<void(subgroup_id_t, node_id_t, persistent::version_t, uint64_t, char*, uint32_t,
+                                         const char*, std::size_t)>;
 
 /**
  * Bundles together a set of callback functions for message delivery events.
@@ -277,7 +277,7 @@ std::exception_ptr ExternalGroup<ReplicatedTypes...>::receive_message(
     }
     std::size_t reply_header_size = header_space();
     recv_ret reply_return = receiver_function_entry->second(
-            &rdv, received_from, buf,
+            &rdv, received_from, buf, trailing_bytes{},
             [&out_alloc, &reply_header_size](std::size_t size) {
                 return out_alloc(size + reply_header_size) + reply_header_size;
             });
@@ -382,6 +382,7 @@ void ExternalGroup<ReplicatedTypes...>::p2p_receive_loop() {
     pthread_setname_np(pthread_self(), "rpc_listener_thread");
 
     uint64_t max_payload_size = getConfUInt64(CONF_SUBGROUP_DEFAULT_MAX_PAYLOAD_SIZE);
+    const uint64_t busy_wait_before_sleep_ms = getConfUInt64(CONF_DERECHO_P2P_LOOP_BUSY_WAIT_BEFORE_SLEEP_MS);
 
     request_worker_thread = std::thread(&ExternalGroup<ReplicatedTypes...>::p2p_request_worker, this);
 
@@ -406,9 +407,9 @@ void ExternalGroup<ReplicatedTypes...>::p2p_receive_loop() {
             // check if the system has been inactive for enough time to induce sleep
             double time_elapsed_in_ms = (cur_time.tv_sec - last_time.tv_sec) * 1e3
                                         + (cur_time.tv_nsec - last_time.tv_nsec) / 1e6;
-            if(time_elapsed_in_ms > 1) {
-                using namespace std::chrono_literals;
-                std::this_thread::sleep_for(1ms);
+            if(time_elapsed_in_ms > busy_wait_before_sleep_ms) {
+                // woken up early by local requests and connection changes
+                p2p_connections->wait_for_work();
             }
         }
     }
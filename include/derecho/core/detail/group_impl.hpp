@@ -133,7 +133,11 @@ Group<ReplicatedTypes...>::Group(const UserMessageCallbacks& callbacks,
                        _view_upcalls),
           rpc_manager(view_manager, deserialization_context),
           factories(make_kind_map(factories...)) {
+    metrics::initialize();
     bool in_total_restart = view_manager.first_init();
+    preload_logs(view_manager.get_current_or_restart_view().get());
+    //The Persistent<T> fields constructed by construct_objects are restored in parallel after it
+    persistent::LogPreloader::deferRestores(true);
     //State transfer must complete before an initial view can commit, and must retry if the view is aborted
     bool initial_view_confirmed = false;
     bool restart_leader_failed = false;
@@ -152,6 +156,7 @@ Group<ReplicatedTypes...>::Group(const UserMessageCallbacks& callbacks,
         std::set<std::pair<subgroup_id_t, node_id_t>> subgroups_and_leaders_to_receive
                 = construct_objects<ReplicatedTypes...>(view_manager.get_current_or_restart_view().get(),
                                                         old_shard_leaders, in_total_restart);
+        persistent::LogPreloader::finishRestores();
         if(in_total_restart) {
             view_manager.truncate_logs();
             view_manager.send_logs();
@@ -178,6 +183,9 @@ Group<ReplicatedTypes...>::Group(const UserMessageCallbacks& callbacks,
             }
         }
     }
+    //Logs of shards this node was not assigned to after all are not needed
+    persistent::LogPreloader::deferRestores(false);
+    persistent::LogPreloader::clear();
     if(view_manager.is_starting_leader()) {
         //In restart mode, once a prepare is successful, send a commit
         //(this function does nothing if we're not doing total restart)
@@ -187,8 +195,10 @@ Group<ReplicatedTypes...>::Group(const UserMessageCallbacks& callbacks,
     //Set up the multicast groups (including RDMA initialization) and register their callbacks
     MulticastGroupCallbacks internal_callbacks{
             //RPC message handler
-            [this](subgroup_id_t subgroup, node_id_t sender, persistent::version_t version, uint64_t timestamp, char* buf, uint32_t size) {
-                rpc_manager.rpc_message_handler(subgroup, sender, version, timestamp, buf, size);
+            [this](subgroup_id_t subgroup, node_id_t sender, persistent::version_t version, uint64_t timestamp, char* buf, uint32_t size,
+                   const char* trailing, std::size_t trailing_size) {
+                rpc_manager.rpc_message_handler(subgroup, sender, version, timestamp, buf, size,
+                                                rpc::trailing_bytes{trailing, trailing_size});
             },
             //Post-next-version callback (set in ViewManager)
             nullptr,
@@ -223,6 +233,7 @@ Group<ReplicatedTypes...>::~Group() {
     // Will a node be able to come back once it leaves? if not, maybe we should
     // shut it down on leave().
     persistence_manager.shutdown(true);
+    metrics::shutdown();
 }
 
 template <typename... ReplicatedTypes>
@@ -313,6 +324,39 @@ std::set<std::pair<subgroup_id_t, node_id_t>> Group<ReplicatedTypes...>::constru
     return functional_insert(subgroups_to_receive, construct_objects<RestTypes...>(curr_view, old_shard_leaders, in_restart));
 }
 
+template <typename... ReplicatedTypes>
+void Group<ReplicatedTypes...>::preload_logs(const View& curr_view) {
+    if(!curr_view.is_adequately_provisioned) {
+        return;
+    }
+    std::vector<std::string> prefixes;
+    (collect_log_prefixes<ReplicatedTypes>(curr_view, prefixes), ...);
+    if(!prefixes.empty()) {
+        persistent::LogPreloader::preload(prefixes);
+    }
+}
+
+template <typename... ReplicatedTypes>
+template <typename T>
+void Group<ReplicatedTypes...>::collect_log_prefixes(const View& curr_view,
+                                                     std::vector<std::string>& prefixes) {
+    if constexpr(has_persistent_fields<T>::value) {
+        const subgroup_type_id_t subgroup_type_id = index_of_type<T, ReplicatedTypes...>;
+        const auto& subgroup_ids = curr_view.subgroup_ids_by_type_id.at(subgroup_type_id);
+        for(uint32_t subgroup_index = 0; subgroup_index < subgroup_ids.size(); ++subgroup_index) {
+            const auto& shard_views = curr_view.subgroup_shard_views.at(subgroup_ids[subgroup_index]);
+            for(uint32_t shard_num = 0; shard_num < shard_views.size(); ++shard_num) {
+                const std::vector<node_id_t>& members = shard_views[shard_num].members;
+                if(std::find(members.begin(), members.end(), my_id) != members.end()) {
+                    prefixes.emplace_back(persistent::PersistentRegistry::generate_prefix(
+                            std::type_index(typeid(T)), subgroup_index, shard_num));
+                    break;
+                }
+            }
+        }
+    }
+}
+
 template <typename... ReplicatedTypes>
 void Group<ReplicatedTypes...>::set_up_components() {
     //Give PersistenceManager this pointer to break the circular dependency
@@ -383,33 +427,87 @@ ShardIterator<SubgroupType> Group<ReplicatedTypes...>::get_shard_iterator(uint32
 
 template <typename... ReplicatedTypes>
 void Group<ReplicatedTypes...>::receive_objects(const std::set<std::pair<subgroup_id_t, node_id_t>>& subgroups_and_leaders) {
-    //This will receive one object from each shard leader in ascending order of subgroup ID
+    //Each shard leader sends its objects in ascending order of subgroup ID over its own
+    //socket, so the objects from different leaders can be received concurrently
+    std::map<node_id_t, std::vector<subgroup_id_t>> subgroups_by_leader;
     for(const auto& subgroup_and_leader : subgroups_and_leaders) {
-        LockedReference<std::unique_lock<std::mutex>, tcp::socket> leader_socket
-                = view_manager.get_transfer_socket(subgroup_and_leader.second);
-        ReplicatedObject* subgroup_object = objects_by_subgroup_id.at(subgroup_and_leader.first);
-        try {
-            if(subgroup_object->is_persistent()) {
-                persistent::version_t log_tail_length = subgroup_object->get_minimum_latest_persisted_version();
-                dbg_default_debug("Sending log tail length of {} for subgroup {} to node {}.",
-                                  log_tail_length, subgroup_and_leader.first, subgroup_and_leader.second);
-                leader_socket.get().write(log_tail_length);
-            }
-            dbg_default_debug("Receiving Replicated Object state for subgroup {} from node {}",
-                              subgroup_and_leader.first, subgroup_and_leader.second);
-            std::size_t buffer_size;
-            leader_socket.get().read(buffer_size);
-            std::unique_ptr<char[]> buffer = std::make_unique<char[]>(buffer_size);
-            leader_socket.get().read(buffer.get(), buffer_size);
-            subgroup_object->receive_object(buffer.get());
-        } catch(tcp::socket_error& e) {
-            //Convert socket exceptions to a more readable error message, since this will cause a crash
-            throw derecho_exception("Fatal error: Node " + std::to_string(subgroup_and_leader.second) + " failed during state transfer!");
+        subgroups_by_leader[subgroup_and_leader.second].emplace_back(subgroup_and_leader.first);
+    }
+    if(subgroups_by_leader.size() == 1) {
+        for(subgroup_id_t subgroup_id : subgroups_by_leader.begin()->second) {
+            receive_subgroup_object(subgroup_id, subgroups_by_leader.begin()->first);
+        }
+    } else if(subgroups_by_leader.size() > 1) {
+        std::vector<std::future<void>> transfers;
+        for(const auto& leader_and_subgroups : subgroups_by_leader) {
+            transfers.emplace_back(std::async(std::launch::async, [this, &leader_and_subgroups]() {
+                pthread_setname_np(pthread_self(), "state_xfer");
+                for(subgroup_id_t subgroup_id : leader_and_subgroups.second) {
+                    receive_subgroup_object(subgroup_id, leader_and_subgroups.first);
+                }
+            }));
+        }
+        //Wait for all of them, then report the first failure
+        for(auto& transfer : transfers) {
+            transfer.wait();
+        }
+        for(auto& transfer : transfers) {
+            transfer.get();
         }
     }
     dbg_default_debug("Done receiving all Replicated Objects from subgroup leaders");
 }
 
+template <typename... ReplicatedTypes>
+void Group<ReplicatedTypes...>::receive_subgroup_object(subgroup_id_t subgroup_id, node_id_t leader_id) {
+    LockedReference<std::unique_lock<std::mutex>, tcp::socket> leader_socket
+            = view_manager.get_transfer_socket(leader_id);
+    ReplicatedObject* subgroup_object = objects_by_subgroup_id.at(subgroup_id);
+    try {
+        if(subgroup_object->is_persistent()) {
+            persistent::version_t log_tail_length = subgroup_object->get_minimum_latest_persisted_version();
+            dbg_default_debug("Sending log tail length of {} for subgroup {} to node {}.",
+                              log_tail_length, subgroup_id, leader_id);
+            leader_socket.get().write(log_tail_length);
+        }
+        dbg_default_debug("Receiving Replicated Object state for subgroup {} from node {}",
+                          subgroup_id, leader_id);
+        std::size_t buffer_size;
+        leader_socket.get().read(buffer_size);
+        //Not zero-initialized, so pages are only touched as the data arrives
+        std::unique_ptr<char[]> buffer(new char[buffer_size]);
+        const auto start_time = std::chrono::steady_clock::now();
+        leader_socket.get().read(buffer.get(), buffer_size);
+        subgroup_object->receive_object(buffer.get());
+        buffer.reset();
+        std::size_t received_size = buffer_size;
+        if(subgroup_object->is_persistent()) {
+            //The object was sent without the log tails of its Persistent fields,
+            //which follow in chunks that are merged into the logs as they arrive
+            int reported_tenths = 0;
+            received_size += subgroup_object->receive_log_tails(
+                    leader_socket.get(),
+                    [&](std::size_t received, std::size_t total) {
+                        dbg_default_trace("Received {} of {} bytes of log tails for subgroup {} from node {}",
+                                          received, total, subgroup_id, leader_id);
+                        const int tenths = total > 0 ? static_cast<int>(received * 10 / total) : 10;
+                        if(tenths > reported_tenths) {
+                            reported_tenths = tenths;
+                            dbg_default_debug("Received {}% of the log tails for subgroup {} from node {}",
+                                              std::min(tenths, 10) * 10, subgroup_id, leader_id);
+                        }
+                    });
+        }
+        const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        dbg_default_info("Received {} bytes of state for subgroup {} from node {} in {:.3f} s ({:.1f} MB/s)",
+                         received_size, subgroup_id, leader_id, elapsed_s,
+                         elapsed_s > 0 ? received_size / elapsed_s / 1e6 : 0.0);
+    } catch(tcp::socket_error& e) {
+        //Convert socket exceptions to a more readable error message, since this will cause a crash
+        throw derecho_exception("Fatal error: Node " + std::to_string(leader_id) + " failed during state transfer!");
+    }
+}
+
 template <typename... ReplicatedTypes>
 void Group<ReplicatedTypes...>::report_failure(const node_id_t who) {
     view_manager.report_failure(who);
@@ -455,6 +553,11 @@ void Group<ReplicatedTypes...>::barrier_sync() {
     view_manager.barrier_sync();
 }
 
+template <typename... ReplicatedTypes>
+void Group<ReplicatedTypes...>::set_persistence_group_commit(bool enable) {
+    persistence_manager.set_group_commit(enable);
+}
+
 template <typename... ReplicatedTypes>
 void Group<ReplicatedTypes...>::debug_print_status() const {
     view_manager.debug_print_status();
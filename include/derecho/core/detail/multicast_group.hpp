@@ -1,7 +1,9 @@
 #pragma once
 
 #include <assert.h>
+#include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <list>
 #include <map>
@@ -20,6 +22,7 @@
 #include "derecho_internal.hpp"
 #include "derecho_sst.hpp"
 #include "persistence_manager.hpp"
+#include "sequence_ring.hpp"
 #include <derecho/conf/conf.hpp>
 #include <derecho/mutils-serialization/SerializationMacros.hpp>
 #include <derecho/mutils-serialization/SerializationSupport.hpp>
@@ -40,6 +43,9 @@ struct __attribute__((__packed__)) header {
     uint64_t timestamp;
     uint32_t num_nulls;
     bool cooked_send;
+    /** The generation of the RDMC group the message was sent in, which tells
+     * its messages of a previous view apart after a view change keeps it */
+    uint32_t generation;
 };
 
 /**
@@ -65,10 +71,17 @@ struct DerechoParams : public mutils::ByteRepresentable {
     unsigned int window_size;
     /** The number of milliseconds between heartbeat messages sent to detect failures. */
     unsigned int heartbeat_ms;
-    /** The algorithm to use for RDMC (binomial, chain, sequential, or tree). */
+    /** The algorithm to use for RDMC (binomial, chain, sequential, tree, or hybrid). */
     rdmc::send_algorithm rdmc_send_algorithm;
+    /** The rack of each node, by node ID, for the hybrid RDMC algorithm. */
+    std::map<uint32_t, uint32_t> rdmc_node_racks;
     /** The TCP port to use when transferring state to new members. */
     uint32_t state_transfer_port;
+    /**
+     * Whether messages are delivered to the application on a dedicated
+     * thread for the subgroup instead of the SST predicate thread.
+     */
+    bool parallel_delivery;
 
     static uint64_t compute_max_msg_size(
             const uint64_t max_payload_size,
@@ -92,11 +105,31 @@ struct DerechoParams : public mutils::ByteRepresentable {
             return rdmc::send_algorithm::SEQUENTIAL_SEND;
         } else if(rdmc_send_algorithm_string == "tree_send") {
             return rdmc::send_algorithm::TREE_SEND;
+        } else if(rdmc_send_algorithm_string == "hybrid_send") {
+            return rdmc::send_algorithm::HYBRID_SEND;
         } else {
             throw "wrong value for RDMC send algorithm: " + rdmc_send_algorithm_string + ". Check your config file.";
         }
     }
 
+    /**
+     * Parses a list of node racks in the form "node_id:rack,node_id:rack,...".
+     */
+    static std::map<uint32_t, uint32_t> node_racks_from_string(const std::string& node_racks_string) {
+        std::map<uint32_t, uint32_t> node_racks;
+        if(node_racks_string.empty()) {
+            return node_racks;
+        }
+        for(const std::string& entry : split_string(node_racks_string)) {
+            std::size_t colon = entry.find(':');
+            if(colon == std::string::npos) {
+                throw "wrong value for RDMC racks: " + node_racks_string + ". Check your config file.";
+            }
+            node_racks[std::stoul(entry.substr(0, colon))] = std::stoul(entry.substr(colon + 1));
+        }
+        return node_racks;
+    }
+
     DerechoParams(uint64_t max_payload_size,
                   uint64_t max_reply_payload_size,
                   uint64_t max_smc_payload_size,
@@ -104,14 +137,18 @@ struct DerechoParams : public mutils::ByteRepresentable {
                   unsigned int window_size,
                   unsigned int heartbeat_ms,
                   rdmc::send_algorithm rdmc_send_algorithm,
-                  uint32_t state_transfer_port)
+                  uint32_t state_transfer_port,
+                  bool parallel_delivery = false,
+                  std::map<uint32_t, uint32_t> rdmc_node_racks = {})
             : max_reply_msg_size(max_reply_payload_size + sizeof(header)),
               sst_max_msg_size(max_smc_payload_size + sizeof(header)),
               block_size(block_size),
               window_size(window_size),
               heartbeat_ms(heartbeat_ms),
               rdmc_send_algorithm(rdmc_send_algorithm),
-              state_transfer_port(state_transfer_port) {
+              rdmc_node_racks(std::move(rdmc_node_racks)),
+              state_transfer_port(state_transfer_port),
+              parallel_delivery(parallel_delivery) {
         //if this is initialized above, DerechoParams turns abstract. idk why.
         max_msg_size = compute_max_msg_size(max_payload_size, block_size,
                                             max_payload_size > max_smc_payload_size);
@@ -146,6 +183,14 @@ struct DerechoParams : public mutils::ByteRepresentable {
         uint32_t timeout_ms = getConfUInt32(CONF_DERECHO_HEARTBEAT_MS);
         const std::string& algorithm = getConfString(prefix + Conf::subgroupProfileFields[5]);
         uint32_t state_transfer_port = getConfUInt32(CONF_DERECHO_STATE_TRANSFER_PORT);
+        // parallel_delivery is optional, so existing profiles keep working without it
+        bool parallel_delivery = hasCustomizedConfKey(prefix + "parallel_delivery")
+                                 && getConfBoolean(prefix + "parallel_delivery");
+        // so is rdmc_racks, which only hybrid_send uses
+        std::map<uint32_t, uint32_t> rdmc_node_racks;
+        if(hasCustomizedConfKey(prefix + "rdmc_racks")) {
+            rdmc_node_racks = node_racks_from_string(getConfString(prefix + "rdmc_racks"));
+        }
 
         return DerechoParams{
                 max_payload_size,
@@ -156,12 +201,15 @@ struct DerechoParams : public mutils::ByteRepresentable {
                 timeout_ms,
                 DerechoParams::send_algorithm_from_string(algorithm),
                 state_transfer_port,
+                parallel_delivery,
+                rdmc_node_racks,
         };
     }
 
     DEFAULT_SERIALIZATION_SUPPORT(DerechoParams, max_msg_size, max_reply_msg_size,
                                   sst_max_msg_size, block_size, window_size,
-                                  heartbeat_ms, rdmc_send_algorithm, state_transfer_port);
+                                  heartbeat_ms, rdmc_send_algorithm, state_transfer_port,
+                                  parallel_delivery, rdmc_node_racks);
 };
 
 /**
@@ -187,6 +235,16 @@ struct MessageBuffer {
     MessageBuffer& operator=(MessageBuffer&&) = default;
 };
 
+/** Calls the application's release function for the segments of a message when destroyed. */
+struct SegmentPin {
+    std::function<void()> release;
+    ~SegmentPin() {
+        if(release) {
+            release();
+        }
+    }
+};
+
 /**
  * A structure containing an RDMC message (which consists of some bytes in a
  * registered memory region) and some associated metadata. Note that the
@@ -203,6 +261,17 @@ struct RDMCMessage {
     long long unsigned int size;
     /** The MessageBuffer that contains the message's body. */
     MessageBuffer message_buffer;
+    /** When the message was received locally, or 0 if metrics are disabled. */
+    uint64_t receive_time = 0;
+    /** For a message sent from application segments, the number of bytes of
+     * the message (header included) in message_buffer; the rest of the
+     * message is in segments. Unused when segments is empty. */
+    uint64_t buffer_size = 0;
+    /** The application's segments that follow the first buffer_size bytes of
+     * message_buffer, until they are copied in or delivered in place. */
+    std::vector<rdmc::segment> segments;
+    /** Keeps the application from reusing the segments until it is dropped. */
+    std::unique_ptr<SegmentPin> segments_pin;
 };
 
 struct SSTMessage {
@@ -214,6 +283,48 @@ struct SSTMessage {
     long long unsigned int size;
     /** Pointer to the message */
     volatile char* buf;
+    /** When the message was received locally, or 0 if metrics are disabled. */
+    uint64_t receive_time = 0;
+};
+
+/**
+ * A message whose delivery order and version have been decided by the SST
+ * predicate thread, waiting to be delivered by a subgroup's delivery worker.
+ * Exactly one of rdmc_msg and sst_msg holds the message.
+ */
+struct PendingDelivery {
+    /** The message's sequence number in the subgroup */
+    message_id_t seq_num;
+    /** The version assigned to the message */
+    persistent::version_t version;
+    /** The timestamp from the message header, in nanoseconds */
+    uint64_t msg_timestamp;
+    /** When the delivery order was decided, or 0 if metrics are disabled */
+    uint64_t stable_time;
+    std::optional<RDMCMessage> rdmc_msg;
+    std::optional<SSTMessage> sst_msg;
+};
+
+/**
+ * The delivery thread of a subgroup whose profile enables parallel_delivery,
+ * along with the queue of messages it has yet to deliver. The queue is
+ * protected by queue_mtx.
+ */
+struct DeliveryWorker {
+    std::thread thread;
+    std::mutex queue_mtx;
+    /** Notified when messages are queued or the worker should shut down */
+    std::condition_variable queue_cv;
+    std::vector<PendingDelivery> queue;
+    /**
+     * The messages decided by one delivery_trigger, before they are queued.
+     * Only the predicate thread uses it; it is kept to reuse its memory.
+     */
+    std::vector<PendingDelivery> decided;
+    /** The sequence number of the last message decided; only the predicate thread uses it */
+    message_id_t last_decided_seq_num = -1;
+    /** Set by wedge(); the worker stops after the message it is delivering */
+    std::atomic<bool> shutdown{false};
 };
 
 /**
@@ -297,18 +408,43 @@ private:
     /** Maps subgroup IDs (for subgroups this node is a member of) to an immutable
      * set of configuration options for that subgroup. */
     const std::map<subgroup_id_t, SubgroupSettings> subgroup_settings_map;
+    /** The entries of subgroup_settings_map indexed by subgroup ID, or nullptr for
+     * subgroups this node is not a member of. The send path uses these instead of
+     * looking up the map and copying the member and sender lists on every message. */
+    std::vector<const SubgroupSettings*> subgroup_settings_by_index;
+    /** The number of senders in this node's shard of each subgroup, indexed by subgroup ID */
+    std::vector<uint32_t> num_shard_senders_by_index;
+    /** The SST rows of the members of this node's shard of each subgroup, indexed by subgroup ID */
+    std::vector<std::vector<uint32_t>> shard_sst_indices_by_index;
     /** Used for synchronizing receives by RDMC and SST */
     std::vector<std::list<int32_t>> received_intervals;
-    /** Maps subgroup IDs for which this node is a sender to the RDMC group it should use to send.
-     * Constructed incrementally in create_rdmc_sst_groups(), so it can't be const.  */
-    std::map<subgroup_id_t, uint32_t> subgroup_to_rdmc_group;
+    /** An RDMC group this node is a member of */
+    struct RDMCGroup {
+        uint16_t group_number;
+        /** The members of the group, starting with its sender */
+        std::vector<node_id_t> members;
+        /** The number of view changes that kept the group */
+        uint32_t generation;
+    };
+    /** The RDMC groups this node is a member of, by subgroup ID and sender ID. The
+     * next view takes over the groups of shards that have not changed. */
+    std::map<std::pair<subgroup_id_t, node_id_t>, RDMCGroup> rdmc_groups;
+    /** False until every member has taken over the RDMC groups kept from the
+     * previous view, since a message sent on one before that would be lost */
+    std::atomic<bool> kept_rdmc_groups_released{true};
     /** Offset to add to member ranks to form RDMC group numbers. */
     uint16_t rdmc_group_num_offset;
     /** false if RDMC groups haven't been created successfully */
     bool rdmc_sst_groups_created = false;
-    /** Stores message buffers not currently in use. Protected by
-     * msg_state_mtx */
-    std::map<uint32_t, std::vector<MessageBuffer>> free_message_buffers;
+    /*
+     * The message state below is kept per subgroup, in vectors indexed by
+     * subgroup ID (entries of subgroups this node is not a member of stay
+     * empty). The entries of a subgroup are protected by that subgroup's lock
+     * in subgroup_locks, so that sends, receives and deliveries in different
+     * subgroups do not serialize on each other.
+     */
+    /** Stores message buffers not currently in use. */
+    std::vector<std::vector<MessageBuffer>> free_message_buffers;
 
     /** Index to be used the next time get_sendbuffer_ptr is called.
      * When next_message is not none, then next_message.index = future_message_index-1 */
@@ -317,35 +453,42 @@ private:
     /** next_message is the message that will be sent when send is called the next time.
      * It is std::nullopt when there is no message to send. */
     std::vector<std::optional<RDMCMessage>> next_sends;
-    std::map<uint32_t, bool> pending_sst_sends;
+    /** Whether an SST send has been started but not committed yet. This is not a
+     * std::vector<bool>, whose elements share words across subgroups. */
+    std::vector<char> pending_sst_sends;
     std::vector<uint32_t> committed_sst_index;
     std::vector<uint32_t> num_nulls_queued;
     std::vector<int32_t> first_null_index;
-    /** Messages that are ready to be sent, but must wait until the current send finishes. */
+    /** Messages that are ready to be sent, but must wait until they fit in the RDMC pipeline. */
     std::vector<std::queue<RDMCMessage>> pending_sends;
-    /** Vector of messages that are currently being sent out using RDMC, or boost::none otherwise. */
-    /** one per subgroup */
-    std::vector<std::optional<RDMCMessage>> current_sends;
-
-    /** Messages that are currently being received. */
-    std::map<std::pair<subgroup_id_t, node_id_t>, RDMCMessage> current_receives;
+    /** Messages that have been handed to RDMC but have not finished sending,
+     * oldest first. At most rdmc_pipeline_depth per subgroup. */
+    std::vector<std::deque<RDMCMessage>> current_sends;
+
+    /** Messages that are currently being received, by subgroup and then by sender ID. */
+    std::vector<std::map<node_id_t, RDMCMessage>> current_receives;
+    /** The number of this node's messages that RDMC was still sending in each
+     * subgroup when the previous view ended on a group this view kept. Their
+     * buffers are sent again, so nothing is sent in the subgroup until RDMC is
+     * done with them. */
+    std::vector<uint32_t> stale_rdmc_sends;
     /** Receiver lambdas for shards that have only one member. */
     std::map<subgroup_id_t, std::function<void(char*, size_t)>> singleton_shard_receive_handlers;
 
     /** Messages that have finished sending/receiving but aren't yet globally stable.
      * Organized by [subgroup number] -> [sequence number] -> [message] */
-    std::map<subgroup_id_t, std::map<message_id_t, RDMCMessage>> locally_stable_rdmc_messages;
+    std::vector<SequenceRing<RDMCMessage>> locally_stable_rdmc_messages;
     /** Same map as locally_stable_rdmc_messages, but for SST messages */
-    std::map<subgroup_id_t, std::map<message_id_t, SSTMessage>> locally_stable_sst_messages;
-    /** For each subgroup, the set of timestamps associated with currently-pending
-     * (not yet delivered) messages. Used to compute the stability frontier. */
-    std::map<subgroup_id_t, std::set<uint64_t>> pending_message_timestamps;
-    /** Tracks the timestamps of messages that are currently being written to persistent storage */
-    std::map<subgroup_id_t, std::map<message_id_t, uint64_t>> pending_persistence;
+    std::vector<SequenceRing<SSTMessage>> locally_stable_sst_messages;
+    /** For each subgroup, the timestamps of this node's messages that are not
+     * yet delivered (in unordered mode) or persisted (otherwise), by message
+     * index. Messages are sent in index order, so the oldest pending timestamp
+     * is the first one. Used to compute the stability frontier. */
+    std::vector<SequenceRing<uint64_t>> pending_message_timestamps;
     /** Messages that are currently being written to persistent storage */
-    std::map<subgroup_id_t, std::map<message_id_t, RDMCMessage>> non_persistent_messages;
+    std::vector<SequenceRing<RDMCMessage>> non_persistent_messages;
     /** Messages that are currently being written to persistent storage */
-    std::map<subgroup_id_t, std::map<message_id_t, SSTMessage>> non_persistent_sst_messages;
+    std::vector<SequenceRing<SSTMessage>> non_persistent_sst_messages;
 
     /** The next message ID that can be delivered in each subgroup, indexed by subgroup number. */
     std::vector<message_id_t> next_message_to_deliver;
@@ -361,14 +504,43 @@ private:
      */
     std::vector<persistent::version_t> minimum_verified_version;
 
-    std::recursive_mutex msg_state_mtx;
-    std::condition_variable_any sender_cv;
+    /**
+     * The lock of one subgroup's message state, aligned to a cache line so
+     * that threads working in neighbouring subgroups do not share one. It is
+     * recursive because message handlers that run with it held may send a
+     * null message in the same subgroup.
+     */
+    struct alignas(64) SubgroupLock {
+        std::recursive_mutex mtx;
+    };
+    /** The locks of the subgroups' message state, indexed by subgroup ID. A
+     * thread never holds the locks of two subgroups at once, except when a new
+     * view reclaims the state of the old one. */
+    std::vector<SubgroupLock> subgroup_locks;
+
+    /** Protects nothing but the sender thread's sleep; see wake_sender_thread() */
+    std::mutex sender_mtx;
+    std::condition_variable sender_cv;
+    /** Incremented whenever a subgroup may have a message ready for the sender thread */
+    std::atomic<uint64_t> sender_wakeups{0};
+
+    /**
+     * The delivery workers of the subgroups with parallel delivery enabled,
+     * indexed by subgroup number. Subgroups that are delivered on the SST
+     * predicate thread have no entry.
+     */
+    std::map<subgroup_id_t, std::unique_ptr<DeliveryWorker>> delivery_workers;
 
     /** The time, in milliseconds, that a sender can wait to send a message before it is considered failed. */
     unsigned int sender_timeout;
+    /** The number of RDMC messages this node keeps in flight in each subgroup
+     * it sends in (DERECHO/rdmc_pipeline_depth). */
+    const uint32_t rdmc_pipeline_depth;
 
     /** Indicates that the group is being destroyed. */
     std::atomic<bool> thread_shutdown{false};
+    /** When the group was wedged, or 0 if it was not or metrics are disabled. */
+    uint64_t wedge_time = 0;
     /** The background thread that sends messages with RDMC. */
     std::thread sender_thread;
 
@@ -386,8 +558,13 @@ private:
     std::list<pred_handle> delivery_pred_handles;
     std::list<pred_handle> persistence_pred_handles;
     std::list<pred_handle> sender_pred_handles;
+    /** The sst_send predicate of each subgroup, which sends wake after committing an SST message.
+     * The map is filled before any send, and each handle is only removed under its subgroup's lock. */
+    std::map<subgroup_id_t, pred_handle> sst_send_pred_handles;
 
-    std::vector<bool> last_transfer_medium;
+    /** Whether the message being sent in each subgroup goes through RDMC (1) or the SST (0).
+     * Not a std::vector<bool>, for the same reason as pending_sst_sends. */
+    std::vector<char> last_transfer_medium;
 
 
     /** A reference to the PersistenceManager that lives in Group, used to
@@ -398,11 +575,38 @@ private:
      * implements the sender thread. */
     void send_loop();
 
+    /** Wakes up the sender thread after a subgroup's state has changed in a way
+     * that may let it send a message. May be called with a subgroup lock held. */
+    void wake_sender_thread();
+
     /** Checks for failures when a sender reaches its timeout. This function
      * implements the timeout thread. */
     void check_failures_loop();
 
     bool create_rdmc_sst_groups();
+    /**
+     * Creates the callbacks of the RDMC group in which a member of this node's
+     * shard of a subgroup sends.
+     * @param subgroup_num The ID of the subgroup
+     * @param shard_rank The rank of the sender in the shard
+     * @param sender_rank The rank of the sender among the shard's senders
+     * @param generation The generation of the group, which the callbacks
+     * discard the messages of any other generation for
+     * @return the incoming message callback and the completion callback
+     */
+    std::pair<rdmc::incoming_message_callback_t, rdmc::completion_callback_t> make_rdmc_callbacks(
+            subgroup_id_t subgroup_num, uint32_t shard_rank, uint32_t sender_rank, uint32_t generation);
+    /**
+     * Takes over the RDMC groups of the previous view's group whose shard has
+     * the same members, senders and RDMC settings in this view, and destroys
+     * the others. Must be called with the locks of this group's subgroups held.
+     * @param old_group The group of the previous view, which must be wedged
+     * @param keep False to destroy all of the old groups
+     */
+    void take_over_rdmc_groups(MulticastGroup& old_group, bool keep);
+    /** Fills in the per-subgroup caches of the send path and sizes the sequence
+     * rings of the receive path; node_id_to_sst_index must be set. */
+    void index_subgroup_settings();
     void initialize_sst_row();
     void register_predicates();
 
@@ -434,26 +638,45 @@ private:
      * @param msg The message that should cause a new version to be registered
      * with PersistenceManager
      * @param subgroup_num The ID of the subgroup this message is in
+     * @param seq_num The sequence number of the message in the subgroup
      * @param version The version assigned to the message
      * @param msg_ts The timestamp of this message
      * @return true if a new version was created
      * false if the message is a null message
      */
-    bool version_message(RDMCMessage& msg, const subgroup_id_t& subgroup_num,
+    bool version_message(RDMCMessage& msg, const subgroup_id_t& subgroup_num, message_id_t seq_num,
                          const persistent::version_t& version, const uint64_t& msg_timestamp);
     /**
      * Same as the other version_message, but for the SSTMessage type.
      * @param msg The message that should cause a new version to be registered
      * with PersistenceManager
      * @param subgroup_num The ID of the subgroup this message is in
+     * @param seq_num The sequence number of the message in the subgroup
      * @param version The version assigned to the message
      * @param msg_ts The timestamp of this message
      * @return true if a new version was created
      * false if the message is a null message
      */
-    bool version_message(SSTMessage& msg, const subgroup_id_t& subgroup_num,
+    bool version_message(SSTMessage& msg, const subgroup_id_t& subgroup_num, message_id_t seq_num,
                          const persistent::version_t& version, const uint64_t& msg_timestamp);
 
+    /**
+     * Delivers the messages queued for a subgroup in order, then versions
+     * them, returns their buffers, and publishes delivered_num. This function
+     * implements the delivery worker threads.
+     * @param subgroup_num The ID of the subgroup the worker delivers for
+     */
+    void delivery_loop(subgroup_id_t subgroup_num);
+
+    /**
+     * Stops the delivery workers without draining their queues: each one
+     * finishes the message it is delivering, if any, and the messages it
+     * had yet to deliver go back to locally_stable_rdmc_messages and
+     * locally_stable_sst_messages, where the ragged-edge cleanup delivers
+     * or discards them. Called by wedge().
+     */
+    void stop_delivery_workers();
+
     uint32_t get_num_senders(const std::vector<int>& shard_senders) {
         uint32_t num = 0;
         for(const auto i : shard_senders) {
@@ -495,6 +718,10 @@ private:
     void update_min_verified_num(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
                                  uint32_t num_shard_members, DerechoSST& sst);
 
+    /** Copies the segments of a message this node sent from application
+     * memory into its buffer, after the header, and releases them. */
+    void gather_segments(RDMCMessage& msg);
+
     // Internally used to automatically send a NULL message
     void get_buffer_and_send_auto_null(subgroup_id_t subgroup_num);
     /* Get a pointer into the current buffer, to write data into it before sending
@@ -549,12 +776,35 @@ public:
 	The user function that generates the message is supplied to send */
     bool send(subgroup_id_t subgroup_num, long long unsigned int payload_size,
               const std::function<void(char* buf)>& msg_generator, bool cooked_send);
+    /**
+     * Sends a message whose payload is header_payload_size bytes written by
+     * header_generator followed by the concatenation of segments. The header
+     * goes into one of the subgroup's registered buffers, and RDMC sends the
+     * segments from application memory (directly, if they are registered with
+     * rdmc::register_memory). The segments must stay unchanged until release
+     * is called. That happens once RDMC has sent them if this node needs the
+     * message in one buffer to deliver it, which it then copies them into;
+     * once this node has delivered the message if it is an RPC call whose
+     * last argument is a single segment, which the call reads in place; and
+     * right away if the message is small enough to be copied into the SST.
+     * release must not block. If this returns false, nothing was sent and
+     * release is not called.
+     */
+    bool send_segments(subgroup_id_t subgroup_num, long long unsigned int header_payload_size,
+                       const std::function<void(char* buf)>& header_generator,
+                       const std::vector<rdmc::segment>& segments,
+                       const std::function<void()>& release, bool cooked_send);
     bool check_pending_sst_sends(subgroup_id_t subgroup_num);
 
     const uint64_t compute_global_stability_frontier(subgroup_id_t subgroup_num);
 
     /** Stops all sending and receiving in this group, in preparation for shutting it down. */
     void wedge();
+    /** Lets messages be sent on the RDMC groups this view kept from the
+     * previous one, once every member has finished setting up this view. */
+    void release_kept_rdmc_groups();
+    /** @return when the group was wedged, or 0 if it was not or metrics are disabled. */
+    uint64_t get_wedge_time() const { return wedge_time; }
     /** Debugging function; prints the current state of the SST to stdout. */
     void debug_print();
 
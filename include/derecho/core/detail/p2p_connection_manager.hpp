@@ -1,6 +1,8 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -44,16 +46,22 @@ class P2PConnectionManager {
      */
     std::vector<std::pair<std::mutex, std::unique_ptr<P2PConnection>>> p2p_connections;
     /**
-     * An array containing one Boolean value for each entry in p2p_connections
-     * that serves as a hint for whether that entry is non-null. The values are
-     * declared as char rather than bool to ensure they are each stored in
-     * exactly one byte. This can be used to check whether a connection exists
-     * without locking its mutex, but the hint can be wrong due to race
-     * conditions. Threads that write to this array should lock the
-     * corresponding mutex in p2p_connections before updating it to avoid lost
-     * updates from write conflicts.
+     * The IDs of the nodes that have an entry in p2p_connections, in ascending
+     * order. This lets probe_all() and the failure checker visit only the live
+     * connections instead of every possible node ID. The vector is never
+     * modified in place: add_connections() and remove_connections() build a
+     * new one under connections_mutex and publish it with std::atomic_store,
+     * so readers take a snapshot with std::atomic_load and iterate it without
+     * locking. A snapshot can be stale, so readers must still lock the
+     * connection's mutex and check for a null pointer.
      */
-    char* active_p2p_connections;
+    std::shared_ptr<const std::vector<node_id_t>> active_nodes;
+    /**
+     * The position in active_nodes at which the next probe_all() starts. It
+     * rotates so that a busy sender cannot starve nodes that come after it.
+     * Only the receive thread calls probe_all(), so this is not synchronized.
+     */
+    std::size_t probe_cursor;
 
     uint64_t p2p_buf_size;
     std::atomic<bool> thread_shutdown{false};
@@ -61,8 +69,33 @@ class P2PConnectionManager {
 
     void check_failures_loop();
     failure_upcall_t failure_upcall;
+    /** Serializes writers of active_nodes. */
     std::mutex connections_mutex;
 
+    /**
+     * The doorbell of the receive thread. Incoming RDMA writes are one-sided
+     * and produce no event on this node, but requests this node sends to
+     * itself and changes to the set of connections do, so they ring the
+     * doorbell and wake up a receive thread blocked in wait_for_work().
+     */
+    std::mutex doorbell_mutex;
+    std::condition_variable doorbell_cv;
+    bool doorbell_rung;
+    void ring_doorbell();
+    /**
+     * How long the next wait_for_work() blocks. Remote messages cannot ring
+     * the doorbell, so instead of blocking for the longest wait right away,
+     * an idle receive thread starts with short waits and doubles them up to
+     * max_idle_wait; a message that ends a short idle period is then seen
+     * within a few tens of microseconds. probe_all() resets it when it finds
+     * a message. Only the receive thread uses it, so it is not synchronized.
+     */
+    std::chrono::microseconds idle_wait;
+    static constexpr std::chrono::microseconds min_idle_wait{20};
+    static constexpr std::chrono::microseconds max_idle_wait{1000};
+    /** Publishes a new active_nodes list; the caller must hold connections_mutex. */
+    void publish_active_nodes(std::vector<node_id_t>&& node_ids);
+
 public:
     P2PConnectionManager(const P2PParams params);
     ~P2PConnectionManager();
@@ -72,7 +105,23 @@ public:
     void shutdown_failures_thread();
     uint64_t get_max_p2p_reply_size();
     void update_incoming_seq_num(node_id_t node_id);
+    /**
+     * Checks the live connections, starting after the one that delivered the
+     * previous message, for a new incoming message.
+     * @return The sender and buffer of the first message found; a pair with
+     * INVALID_NODE_ID if that message was a null reply that has already been
+     * consumed; or an empty optional if there is nothing to receive.
+     */
     std::optional<std::pair<node_id_t, char*>> probe_all();
+    /**
+     * Blocks the calling thread until the doorbell rings or the current idle
+     * wait expires, whichever comes first, and doubles the idle wait. The
+     * receive thread calls this instead of sleeping once it has been idle
+     * for a while. The idle wait bounds the latency of messages from remote
+     * nodes, which cannot ring the doorbell.
+     * @return true if the doorbell rang, false if the wait timed out.
+     */
+    bool wait_for_work();
     char* get_sendbuffer_ptr(node_id_t node_id, REQUEST_TYPE type);
     void send(node_id_t node_id);
     /**
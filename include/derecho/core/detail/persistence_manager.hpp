@@ -7,17 +7,22 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <errno.h>
 #include <list>
+#include <map>
+#include <mutex>
 #include <queue>
 #include <semaphore.h>
 #include <thread>
+#include <vector>
 
 #include "derecho_internal.hpp"
 #include "replicated_interface.hpp"
 #include <derecho/openssl/signature.hpp>
 #include <derecho/persistent/PersistentInterface.hpp>
 #include <derecho/utils/logger.hpp>
+#include <derecho/utils/metrics.hpp>
 
 namespace derecho {
 
@@ -38,6 +43,8 @@ public:
         RequestType operation;
         subgroup_id_t subgroup_id;
         persistent::version_t version;
+        /** When the request was posted, or 0 if metrics are disabled */
+        uint64_t post_time;
     };
 private:
     /** Thread handle */
@@ -59,6 +66,42 @@ private:
     std::queue<ThreadRequest> persistence_request_queue;
     /** A test-and-set lock guarding the persistence request queue */
     std::atomic_flag prq_lock = ATOMIC_FLAG_INIT;
+    /**
+     * True if the persistence thread should handle all the queued requests as
+     * one batch (group commit) instead of one at a time. Initialized from
+     * CONF_PERS_GROUP_COMMIT, and can be changed with set_group_commit().
+     */
+    std::atomic<bool> group_commit;
+    /** The flush of one subgroup in a group-commit batch, and its outcome */
+    struct FlushJob {
+        subgroup_id_t subgroup_id;
+        persistent::version_t requested_version;
+        persistent::version_t persisted_version;
+        bool object_has_signature;
+        bool persisted;
+        std::vector<unsigned char> signature;
+    };
+    /**
+     * Threads that flush the subgroups of a group-commit batch alongside the
+     * persistence thread. The pool is started by the first group-commit
+     * batch, with one thread fewer than the number of subgroups (bounded by
+     * the number of cores), since the persistence thread flushes too. Only
+     * the persistence thread starts and stops it.
+     */
+    std::vector<std::thread> flush_workers;
+    /** Protects flush_jobs, next_flush_job, flush_jobs_remaining and flush_shutdown */
+    std::mutex flush_mutex;
+    /** Notified when a batch is handed to the flush workers or they should shut down */
+    std::condition_variable flush_cv;
+    /** Notified when the last job of a batch finishes */
+    std::condition_variable flush_done_cv;
+    /** The batch being flushed, or null between batches */
+    std::vector<FlushJob>* flush_jobs = nullptr;
+    /** The index in flush_jobs of the next job that no thread has taken yet */
+    std::size_t next_flush_job = 0;
+    /** The number of jobs in flush_jobs that have not finished yet */
+    std::size_t flush_jobs_remaining = 0;
+    bool flush_shutdown = false;
     /**
      * The latest version that has been persisted successfully in each subgroup
      * (indexed by subgroup number). Updated each time a persistence request completes.
@@ -86,10 +129,46 @@ private:
      * also needs a reference to PersistenceManager.
      */
     ViewManager* view_manager;
-    /** Helper function that handles a single persistence request */
-    void handle_persist_request(subgroup_id_t subgroup_id, persistent::version_t version);
-    /** Helper function that handles a single verification request */
-    void handle_verify_request(subgroup_id_t subgroup_id, persistent::version_t version);
+    /**
+     * Helper function that persists a subgroup's object up to at least the
+     * requested version, without updating the SST.
+     * @param subgroup_id The subgroup to persist
+     * @param version The version requested
+     * @param signature A buffer of signature_size bytes that receives the
+     * signature over the persisted version, if the object is signed
+     * @param object_has_signature Set to true if the object is signed
+     * @return The version actually persisted
+     */
+    persistent::version_t persist_subgroup(subgroup_id_t subgroup_id, persistent::version_t version,
+                                           unsigned char* signature, bool& object_has_signature);
+    /**
+     * Takes jobs from flush_jobs until every job has been taken, flushing
+     * each one. Called with flush_mutex held by lock, which it releases
+     * during each flush.
+     */
+    void run_flush_jobs(std::unique_lock<std::mutex>& lock);
+    /** The main loop of a flush worker thread */
+    void flush_worker_loop();
+    /** Stops the flush workers and waits for them to exit. */
+    void stop_flush_workers();
+    /**
+     * Helper function that handles a single persistence request
+     * @param post_time When the request was posted, for the metrics
+     */
+    void handle_persist_request(subgroup_id_t subgroup_id, persistent::version_t version, uint64_t post_time);
+    /**
+     * Helper function that handles a batch of requests in group-commit mode.
+     * Requests of the same type and subgroup are merged into the one with the
+     * highest version; the subgroups to persist are flushed in parallel by
+     * this thread and the flush workers, and their persisted_num entries are
+     * published with a single SST update.
+     */
+    void handle_request_batch(std::queue<ThreadRequest>& requests);
+    /**
+     * Helper function that handles a single verification request
+     * @param post_time When the request was posted, for the metrics
+     */
+    void handle_verify_request(subgroup_id_t subgroup_id, persistent::version_t version, uint64_t post_time);
 public:
     /**
      * Constructor.
@@ -123,6 +202,13 @@ public:
     /** Start the persistent thread. */
     void start();
 
+    /**
+     * Switches the persistence thread between handling requests one at a time
+     * and group commit, overriding CONF_PERS_GROUP_COMMIT. The change applies
+     * from the next time the thread wakes up.
+     */
+    void set_group_commit(bool enable);
+
     /** post a persistence request */
     void post_persist_request(const subgroup_id_t& subgroup_id, const persistent::version_t& version);
 
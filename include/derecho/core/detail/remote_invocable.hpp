@@ -8,10 +8,12 @@
 
 #include <functional>
 #include <numeric>
+#include <optional>
 #include <type_traits>
 
 #include "rpc_utils.hpp"
 #include <derecho/mutils-serialization/SerializationSupport.hpp>
+#include <derecho/mutils-serialization/SerializationViews.hpp>
 #include <derecho/utils/logger.hpp>
 #include <mutils/FunctionalMap.hpp>
 #include <mutils/tuple_extras.hpp>
@@ -33,6 +35,21 @@ struct RemoteInvocable;
 template <FunctionTag, typename>
 struct RemoteInvoker;
 
+/**
+ * Whether the last parameter of a function with parameters Args is a
+ * const mutils::vector_view<char>&, whose bytes a call can carry outside its
+ * message (see trailing_bytes).
+ */
+template <typename... Args>
+constexpr bool ends_with_char_view() {
+    if constexpr(sizeof...(Args) == 0) {
+        return false;
+    } else {
+        return std::is_same<std::decay_t<std::tuple_element_t<sizeof...(Args) - 1, std::tuple<Args...>>>,
+                            mutils::vector_view<char>>::value;
+    }
+}
+
 /**
  * Provides functions to implement RPC sends for function calls to a single
  * function, identified by its compile-time "tag" or ID.
@@ -77,6 +94,14 @@ struct RemoteInvoker<Tag, std::function<Ret(Args...)>> {
         return *this;
     }
 
+    /* the same, for callers that do not have all the arguments of the function */
+    inline RemoteInvoker& get_invoker_by_tag(std::integral_constant<FunctionTag, Tag> const* const) {
+        return *this;
+    }
+
+    template <std::size_t i>
+    using arg_t = std::decay_t<std::tuple_element_t<i, std::tuple<Args...>>>;
+
     using barray = char*;
     using cbarray = const char*;
 
@@ -109,15 +134,22 @@ struct RemoteInvoker<Tag, std::function<Ret(Args...)>> {
      * invocable function targeted by this RemoteInvoker.
      * @param out_alloc A function that can allocate buffers, which will be
      * used to store the constructed message
+     * @param args_size The serialized size of the arguments, if the caller
+     * has already computed it, so they are not traversed again to size them
      * @param a The arguments to be used when calling the remote-invocable function
      */
     send_return send(const std::function<char*(int)>& out_alloc,
+                     const std::optional<std::size_t>& args_size,
                      const std::decay_t<Args>&... remote_args) {
         // auto invocation_id = mutils::long_rand();
         std::size_t invocation_id = invocation_id_sequencer++;
         invocation_id %= MAX_CONCURRENT_RPCS_PER_INVOKER;
         std::size_t size = mutils::bytes_size(invocation_id);
-        size += (mutils::bytes_size(remote_args) + ... + 0);
+        if(args_size) {
+            size += *args_size;
+        } else {
+            size += (mutils::bytes_size(remote_args) + ... + 0);
+        }
 
         char* serialized_args = out_alloc(size);
         {
@@ -135,6 +167,46 @@ struct RemoteInvoker<Tag, std::function<Ret(Args...)>> {
                            pending_results};
     }
 
+    /**
+     * Like send(), for a function whose last parameter is a
+     * const mutils::vector_view<char>&, but the message ends with the byte
+     * count of that argument instead of the argument: the caller sends its
+     * trailing_size bytes right after the message, which then reads as an
+     * ordinary call.
+     * @param trailing_size The number of bytes in the last argument
+     * @param leading_args The other arguments, converted to the parameter types
+     */
+    template <std::size_t... I>
+    send_return send_with_trailing_bytes(std::index_sequence<I...>,
+                                         const std::function<char*(int)>& out_alloc,
+                                         std::size_t trailing_size,
+                                         const arg_t<I>&... leading_args) {
+        static_assert(sizeof...(I) + 1 == sizeof...(Args) && ends_with_char_view<Args...>(),
+                      "The last parameter of the function must be a const mutils::vector_view<char>&, "
+                      "and every other argument must be given");
+        std::size_t invocation_id = invocation_id_sequencer++;
+        invocation_id %= MAX_CONCURRENT_RPCS_PER_INVOKER;
+        const std::size_t size = mutils::bytes_size(invocation_id) + (mutils::bytes_size(leading_args) + ... + 0)
+                                 + mutils::vector_view<char>::prefix_size();
+
+        char* serialized_args = out_alloc(size);
+        {
+            auto v = serialized_args + mutils::to_bytes(invocation_id, serialized_args);
+            v += serialize_one(v, leading_args...);
+            std::size_t prefix_index = 0;
+            mutils::vector_view<char>::post_prefix(mutils::post_to_buffer(prefix_index, v), trailing_size);
+            assert_always(static_cast<std::size_t>(v + prefix_index - serialized_args) == size);
+        }
+
+        results_vector[invocation_id].reset();
+        PendingResults<Ret>& pending_results = results_vector[invocation_id];
+
+        dbg_default_trace("Ready to send an RPC call message with invocation ID {} and {} trailing bytes",
+                          invocation_id, trailing_size);
+        return send_return{size, serialized_args, pending_results.get_future(),
+                           pending_results};
+    }
+
     /**
      * Specialization of receive_response for non-void functions. Stores the
      * response in the results map, or stores the exception if there was an
@@ -210,6 +282,7 @@ struct RemoteInvoker<Tag, std::function<Ret(Args...)>> {
     inline recv_ret receive_response(  //mutils::DeserializationManager* dsm,
             mutils::RemoteDeserialization_v* rdv,
             const node_id_t& nid, const char* response,
+            const trailing_bytes&,
             const std::function<char*(int)>& f) {
         constexpr std::is_same<void, Ret>* choice{nullptr};
         //        return receive_response(choice, dsm, nid, response, f);
@@ -277,6 +350,33 @@ struct RemoteInvocable<Tag, std::function<Ret(Args...)>> {
         return *this;
     }
 
+    /**
+     * Calls the function with the arguments serialized in recv_buf. If the
+     * call's last argument is in trailing instead, the message ends with its
+     * byte count, and the function gets a view of trailing in its place.
+     */
+    inline Ret deserialize_and_run(mutils::DeserializationManager* dsm, const char* recv_buf,
+                                   const trailing_bytes& trailing) {
+        if constexpr(ends_with_char_view<Args...>()) {
+            if(trailing.data != nullptr) {
+                return run_with_trailing_bytes(std::make_index_sequence<sizeof...(Args) - 1>{},
+                                               dsm, recv_buf, trailing);
+            }
+        }
+        assert_always(trailing.data == nullptr);
+        return mutils::deserialize_and_run(dsm, recv_buf, remote_invocable_function);
+    }
+
+    template <std::size_t... I>
+    inline Ret run_with_trailing_bytes(std::index_sequence<I...>, mutils::DeserializationManager* dsm,
+                                       const char* recv_buf, const trailing_bytes& trailing) {
+        using args_tuple = std::tuple<std::decay_t<Args>...>;
+        std::tuple<mutils::context_ptr<const std::tuple_element_t<I, args_tuple>>...> leading_args;
+        mutils::from_bytes_noalloc_v(dsm, recv_buf, std::get<I>(leading_args)...);
+        const mutils::vector_view<char> last_arg(trailing.data, trailing.size);
+        return remote_invocable_function(*std::get<I>(leading_args)..., last_arg);
+    }
+
     /**
      * Specialization of receive_call for non-void functions. After calling the
      * function locally, it constructs a message containing the return value to
@@ -287,11 +387,12 @@ struct RemoteInvocable<Tag, std::function<Ret(Args...)>> {
     inline recv_ret receive_call(std::false_type const* const,
                                  mutils::DeserializationManager* dsm,
                                  const node_id_t& caller, const char* _recv_buf,
+                                 const trailing_bytes& trailing,
                                  const std::function<char*(int)>& out_alloc) {
         long int invocation_id = ((long int*)_recv_buf)[0];
         auto recv_buf = _recv_buf + sizeof(long int);
         try {
-            const auto result = mutils::deserialize_and_run(dsm, recv_buf, remote_invocable_function);
+            const auto result = deserialize_and_run(dsm, recv_buf, trailing);
             const auto result_size = mutils::bytes_size(result) + sizeof(long int) + 1;
             auto out = out_alloc(result_size);
             out[0] = false;
@@ -315,10 +416,11 @@ struct RemoteInvocable<Tag, std::function<Ret(Args...)>> {
     inline recv_ret receive_call(std::true_type const* const,
                                  mutils::DeserializationManager* dsm,
                                  const node_id_t&, const char* _recv_buf,
+                                 const trailing_bytes& trailing,
                                  const std::function<char*(int)>&) {
         //TODO: Need to catch exceptions here, and possibly send them back, since void functions can still throw exceptions!
         auto recv_buf = _recv_buf + sizeof(long int);
-        mutils::deserialize_and_run(dsm, recv_buf, remote_invocable_function);
+        deserialize_and_run(dsm, recv_buf, trailing);
         return recv_ret{reply_opcode, 0, nullptr};
     }
 
@@ -329,17 +431,19 @@ struct RemoteInvocable<Tag, std::function<Ret(Args...)>> {
      * @param dsm
      * @param who The node that sent the message
      * @param recv_buf The buffer containing the received message
+     * @param trailing The last argument of the call, if recv_buf does not contain it
      * @param out_alloc A function that can allocate a buffer for the response message
      * @return
      */
     inline recv_ret receive_call(  //mutils::DeserializationManager* dsm,
             mutils::RemoteDeserialization_v* rdv,
             const node_id_t& who, const char* recv_buf,
+            const trailing_bytes& trailing,
             const std::function<char*(int)>& out_alloc) {
         constexpr std::is_same<Ret, void>* choice{nullptr};
         //      return this->receive_call(choice, dsm, who, recv_buf, out_alloc);
         mutils::DeserializationManager dsm{*rdv};
-        return this->receive_call(choice, &dsm, who, recv_buf, out_alloc);
+        return this->receive_call(choice, &dsm, who, recv_buf, trailing, out_alloc);
     }
 
     /**
@@ -549,6 +653,7 @@ struct RemoteInvocablePairs<wrapped<id, FunType>>
               RemoteInvocable<id, FunType>(class_id, instance_id, receivers, function_ptr) {}
 
     using RemoteInvoker<id, FunType>::get_invoker;
+    using RemoteInvoker<id, FunType>::get_invoker_by_tag;
     using RemoteInvocable<id, FunType>::get_handler;
 };
 
@@ -579,8 +684,10 @@ struct RemoteInvocablePairs<wrapped<id, FunType>, rest...>
 
     //Ensure the inherited functions from RemoteInvoker and RemoteInvokable are visible
     using RemoteInvoker<id, FunType>::get_invoker;
+    using RemoteInvoker<id, FunType>::get_invoker_by_tag;
     using RemoteInvocable<id, FunType>::get_handler;
     using RemoteInvocablePairs<rest...>::get_invoker;
+    using RemoteInvocablePairs<rest...>::get_invoker_by_tag;
     using RemoteInvocablePairs<rest...>::get_handler;
 };
 
@@ -603,6 +710,7 @@ struct RemoteInvokers<wrapped<Tag, FunType>> : public RemoteInvoker<Tag, FunType
             : RemoteInvoker<Tag, FunType>(class_id, instance_id, receivers) {}
 
     using RemoteInvoker<Tag, FunType>::get_invoker;
+    using RemoteInvoker<Tag, FunType>::get_invoker_by_tag;
 };
 
 /**
@@ -625,7 +733,9 @@ struct RemoteInvokers<wrapped<Tag, FunType>, RestWrapped...>
               RemoteInvokers<RestWrapped...>(class_id, instance_id, receivers) {}
 
     using RemoteInvoker<Tag, FunType>::get_invoker;
+    using RemoteInvoker<Tag, FunType>::get_invoker_by_tag;
     using RemoteInvokers<RestWrapped...>::get_invoker;
+    using RemoteInvokers<RestWrapped...>::get_invoker_by_tag;
 };
 
 /**
@@ -648,16 +758,26 @@ public:
             : RemoteInvocablePairs<WrappedFuns...>(type_id, instance_id, rvrs, fs.fun...),
               nid(nid) {}
 
-    template <FunctionTag Tag, typename... Args>
-    std::size_t get_size_for_ordered_send(Args&&... a) {
+    /**
+     * @return the serialized size of the arguments of a call; pass it to
+     * get_size_for_ordered_send and send_with_args_size so the arguments are
+     * sized only once per call.
+     */
+    template <typename... Args>
+    static std::size_t get_args_size(const Args&... a) {
+        return (0 + ... + mutils::bytes_size(a));
+    }
+
+    /**
+     * @param args_size The serialized size of the arguments, from get_args_size
+     * @return the size of the message that send() constructs for the call
+     */
+    template <FunctionTag Tag>
+    std::size_t get_size_for_ordered_send(std::size_t args_size) {
         //only used for size calculation
         long int invocation_id = 0;
-        std::size_t function_call_size = mutils::bytes_size(invocation_id);
-        {
-            function_call_size += (0 + ... + mutils::bytes_size(a));
-        }
         //Add the header_size that send() adds to the invoker's out_alloc
-        return function_call_size + remote_invocation_utilities::header_space();
+        return mutils::bytes_size(invocation_id) + args_size + remote_invocation_utilities::header_space();
     }
 
     template <FunctionTag Tag, typename... Args>
@@ -666,6 +786,12 @@ public:
         return this->get_invoker(choice, args...).returnRet();
     }
 
+    template <FunctionTag Tag>
+    auto* getReturnTypeByTag() {
+        constexpr std::integral_constant<FunctionTag, Tag>* choice{nullptr};
+        return this->get_invoker_by_tag(choice).returnRet();
+    }
+
     /**
      * Constructs a message that will remotely invoke a method of this class,
      * supplying the specified arguments, using RPC.
@@ -678,6 +804,16 @@ public:
      */
     template <FunctionTag Tag, typename... Args>
     auto send(const std::function<char*(int)>& out_alloc, Args&&... args) {
+        return send_with_args_size<Tag>(std::nullopt, out_alloc, std::forward<Args>(args)...);
+    }
+
+    /**
+     * Same as send(), with the serialized size of the arguments already
+     * computed by get_args_size (or std::nullopt to compute it here).
+     */
+    template <FunctionTag Tag, typename... Args>
+    auto send_with_args_size(const std::optional<std::size_t>& args_size,
+                             const std::function<char*(int)>& out_alloc, Args&&... args) {
         using namespace remote_invocation_utilities;
 
         constexpr std::integral_constant<FunctionTag, Tag>* choice{nullptr};
@@ -687,6 +823,7 @@ public:
                 [&out_alloc, &header_size](std::size_t size) {
                     return out_alloc(size + header_size) + header_size;
                 },
+                args_size,
                 std::forward<Args>(args)...);
 
         std::size_t payload_size = sent_return.size;
@@ -730,6 +867,41 @@ LifeTracker{[invocation_id, &map](){map.erase(invocation_id);}};
                            sent_return.pending};
     }
 
+    /**
+     * Same as send(), for a method whose last parameter is a
+     * const mutils::vector_view<char>&, given all the other arguments: the
+     * message ends with the byte count of that argument, and the caller sends
+     * its trailing_size bytes right after the message. The message size in
+     * the header includes them.
+     */
+    template <FunctionTag Tag, typename... Args>
+    auto send_with_trailing_bytes(const std::function<char*(int)>& out_alloc, std::size_t trailing_size,
+                                  Args&&... leading_args) {
+        using namespace remote_invocation_utilities;
+
+        constexpr std::integral_constant<FunctionTag, Tag>* choice{nullptr};
+        auto& invoker = this->get_invoker_by_tag(choice);
+        const auto header_size = header_space();
+        auto sent_return = invoker.send_with_trailing_bytes(
+                std::make_index_sequence<sizeof...(Args)>{},
+                [&out_alloc, &header_size](std::size_t size) {
+                    return out_alloc(size + header_size) + header_size;
+                },
+                trailing_size,
+                std::forward<Args>(leading_args)...);
+
+        char* buf = sent_return.buf - header_size;
+        populate_header(buf, sent_return.size + trailing_size, invoker.invoke_opcode, nid, 0);
+
+        using Ret = typename decltype(sent_return.results)::type;
+        struct send_return {
+            QueryResults<Ret> results;
+            PendingResults<Ret>& pending;
+        };
+        return send_return{std::move(sent_return.results),
+                           sent_return.pending};
+    }
+
     using specialized_to = IdentifyingClass;
     RemoteInvocableClass& for_class(IdentifyingClass*) {
         return *this;
@@ -817,6 +989,16 @@ public:
 
     template <FunctionTag Tag, typename... Args>
     auto send(const std::function<char*(int)>& out_alloc, Args&&... args) {
+        return send_with_args_size<Tag>(std::nullopt, out_alloc, std::forward<Args>(args)...);
+    }
+
+    /**
+     * Same as send(), with the serialized size of the arguments already
+     * computed by get_args_size (or std::nullopt to compute it here).
+     */
+    template <FunctionTag Tag, typename... Args>
+    auto send_with_args_size(const std::optional<std::size_t>& args_size,
+                             const std::function<char*(int)>& out_alloc, Args&&... args) {
         using namespace remote_invocation_utilities;
 
         constexpr std::integral_constant<FunctionTag, Tag>* choice{nullptr};
@@ -826,6 +1008,7 @@ public:
                 [&out_alloc, &header_size](std::size_t size) {
                     return out_alloc(size + header_size) + header_size;
                 },
+                args_size,
                 std::forward<Args>(args)...);
 
         std::size_t payload_size = sent_return.size;
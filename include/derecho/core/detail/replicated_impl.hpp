@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <mutex>
+#include <optional>
 #include <utility>
 
 #include "../replicated.hpp"
@@ -124,18 +125,22 @@ template <typename T>
 template <rpc::FunctionTag tag, typename... Args>
 auto Replicated<T>::ordered_send(Args&&... args) {
     if(is_valid()) {
+        //The arguments are sized once, here, and serialized in a single pass by the send below
+        const std::size_t args_size = wrapped_this->get_args_size(args...);
         size_t payload_size_for_multicast_send = wrapped_this->
-        template get_size_for_ordered_send<rpc::to_internal_tag<false>(tag)>(std::forward<Args>(args)...);
+        template get_size_for_ordered_send<rpc::to_internal_tag<false>(tag)>(args_size);
 
         using Ret = typename std::remove_pointer<decltype(wrapped_this->template getReturnType<rpc::to_internal_tag<false>(tag)>(
                 std::forward<Args>(args)...))>::type;
-        //These pointers help "return" the PendingResults/QueryResults out of the lambda
-        rpc::QueryResults<Ret>* results_ptr;
+        //These help "return" the PendingResults/QueryResults out of the lambda. The QueryResults
+        //lives on this stack frame, and the PendingResults in the RemoteInvoker's preallocated array.
+        std::optional<rpc::QueryResults<Ret>> results;
         rpc::PendingResults<Ret>* pending_ptr;
-        auto serializer = [&](char* buffer) {
+        auto serialize_rpc = [&](char* buffer) {
             //By the time this lambda runs, the current thread will be holding a read lock on view_mutex
-            const std::size_t max_payload_size = group_rpc_manager.view_manager.get_max_payload_sizes().at(subgroup_id);
-            auto send_return_struct = wrapped_this->template send<rpc::to_internal_tag<false>(tag)>(
+            const std::size_t max_payload_size = group_rpc_manager.view_manager.get_max_payload_size(subgroup_id);
+            auto send_return_struct = wrapped_this->template send_with_args_size<rpc::to_internal_tag<false>(tag)>(
+                    args_size,
                     [&buffer, &max_payload_size](size_t size) -> char* {
                         if(size <= max_payload_size) {
                             return buffer;
@@ -144,9 +149,12 @@ auto Replicated<T>::ordered_send(Args&&... args) {
                         }
                     },
                     std::forward<Args>(args)...);
-            results_ptr = new rpc::QueryResults<Ret>(std::move(send_return_struct.results));
+            results.emplace(std::move(send_return_struct.results));
             pending_ptr = &send_return_struct.pending;
         };
+        //Capturing a single reference keeps the std::function that MulticastGroup::send takes
+        //in its small-object buffer, instead of allocating it on every attempt to send
+        auto serializer = [&serialize_rpc](char* buffer) { serialize_rpc(buffer); };
 
         std::shared_lock<std::shared_timed_mutex> view_read_lock(group_rpc_manager.view_manager.view_mutex);
         group_rpc_manager.view_manager.view_change_cv.wait(view_read_lock, [&]() {
@@ -154,9 +162,53 @@ auto Replicated<T>::ordered_send(Args&&... args) {
                     ->multicast_group->send(subgroup_id, payload_size_for_multicast_send, serializer, true);
         });
         group_rpc_manager.finish_rpc_send(subgroup_id, *pending_ptr);
-        //Warning: Even though the move-constructor will clean up all the state in *results_ptr, this
-        //still leaks the memory allocated on the heap by new QueryResults<Ret>() in the serializer lambda
-        return std::move(*results_ptr);
+        return std::move(*results);
+    } else {
+        throw empty_reference_exception{"Attempted to use an empty Replicated<T>"};
+    }
+}
+
+template <typename T>
+template <rpc::FunctionTag tag, typename... Args>
+auto Replicated<T>::ordered_send_segments(const std::vector<rdmc::segment>& segments,
+                                          const std::function<void()>& release, Args&&... leading_args) {
+    if(is_valid()) {
+        std::size_t segments_size = 0;
+        for(const rdmc::segment& segment : segments) {
+            segments_size += segment.length;
+        }
+        //The message in the subgroup's buffer ends with the byte count of the segments
+        const std::size_t header_payload_size = wrapped_this->
+        template get_size_for_ordered_send<rpc::to_internal_tag<false>(tag)>(
+                wrapped_this->get_args_size(leading_args...) + mutils::vector_view<char>::prefix_size());
+
+        using Ret = typename std::remove_pointer<decltype(wrapped_this->template getReturnTypeByTag<rpc::to_internal_tag<false>(tag)>())>::type;
+        std::optional<rpc::QueryResults<Ret>> results;
+        rpc::PendingResults<Ret>* pending_ptr;
+        auto serialize_rpc = [&](char* buffer) {
+            auto send_return_struct = wrapped_this->template send_with_trailing_bytes<rpc::to_internal_tag<false>(tag)>(
+                    [&buffer, &header_payload_size](size_t size) -> char* {
+                        if(size == header_payload_size) {
+                            return buffer;
+                        } else {
+                            throw derecho_exception("The arguments of ordered_send_segments must have the types of the RPC function's parameters.");
+                        }
+                    },
+                    segments_size,
+                    std::forward<Args>(leading_args)...);
+            results.emplace(std::move(send_return_struct.results));
+            pending_ptr = &send_return_struct.pending;
+        };
+        auto serializer = [&serialize_rpc](char* buffer) { serialize_rpc(buffer); };
+
+        std::shared_lock<std::shared_timed_mutex> view_read_lock(group_rpc_manager.view_manager.view_mutex);
+        group_rpc_manager.view_manager.view_change_cv.wait(view_read_lock, [&]() {
+            return group_rpc_manager.view_manager.curr_view
+                    ->multicast_group->send_segments(subgroup_id, header_payload_size, serializer,
+                                                     segments, release, true);
+        });
+        group_rpc_manager.finish_rpc_send(subgroup_id, *pending_ptr);
+        return std::move(*results);
     } else {
         throw empty_reference_exception{"Attempted to use an empty Replicated<T>"};
     }
@@ -203,6 +255,73 @@ std::size_t Replicated<T>::receive_object(char* buffer) {
     return mutils::bytes_size(**user_object_ptr);
 }
 
+template <typename T>
+void Replicated<T>::send_log_tails(tcp::socket& receiver_socket, persistent::version_t version) const {
+    auto send_chunk = [&receiver_socket](const char* bytes, std::size_t size) {
+        receiver_socket.write(size);
+        receiver_socket.write(bytes, size);
+    };
+    std::vector<char> chunk;
+    chunk.reserve(STATE_TRANSFER_CHUNK_SIZE);
+    receiver_socket.write(persistent_registry->getLogTailsSize(version));
+    persistent_registry->postLogTails(version, [&](char const* const bytes, std::size_t size) {
+        if(!chunk.empty() && chunk.size() + size > STATE_TRANSFER_CHUNK_SIZE) {
+            send_chunk(chunk.data(), chunk.size());
+            chunk.clear();
+        }
+        if(size > STATE_TRANSFER_CHUNK_SIZE) {
+            //Send a large log entry in chunks of its own, without copying it
+            for(std::size_t offset = 0; offset < size; offset += STATE_TRANSFER_CHUNK_SIZE) {
+                send_chunk(bytes + offset, std::min(size - offset, STATE_TRANSFER_CHUNK_SIZE));
+            }
+        } else {
+            chunk.insert(chunk.end(), bytes, bytes + size);
+        }
+    });
+    if(!chunk.empty()) {
+        send_chunk(chunk.data(), chunk.size());
+    }
+    receiver_socket.write(std::size_t{0});
+}
+
+template <typename T>
+std::size_t Replicated<T>::receive_log_tails(tcp::socket& sender_socket,
+                                             const std::function<void(std::size_t, std::size_t)>& progress) {
+    std::size_t total_size;
+    sender_socket.read(total_size);
+    std::size_t received_size = 0;
+    std::vector<char> chunk;
+    std::size_t chunk_offset = 0;
+    persistent_registry->applyLogTails([&](char* buffer, std::size_t size) {
+        while(size > 0) {
+            if(chunk_offset == chunk.size()) {
+                std::size_t chunk_size;
+                sender_socket.read(chunk_size);
+                if(chunk_size == 0 || chunk_size > STATE_TRANSFER_CHUNK_SIZE) {
+                    throw derecho_exception("State transfer received a log tail chunk of " + std::to_string(chunk_size)
+                                            + " bytes in the middle of a log tail");
+                }
+                chunk.resize(chunk_size);
+                sender_socket.read(chunk.data(), chunk_size);
+                chunk_offset = 0;
+                received_size += chunk_size;
+                progress(received_size, total_size);
+            }
+            const std::size_t copy_size = std::min(size, chunk.size() - chunk_offset);
+            memcpy(buffer, chunk.data() + chunk_offset, copy_size);
+            chunk_offset += copy_size;
+            buffer += copy_size;
+            size -= copy_size;
+        }
+    });
+    std::size_t end_of_tails;
+    sender_socket.read(end_of_tails);
+    if(chunk_offset != chunk.size() || end_of_tails != 0) {
+        throw derecho_exception("State transfer received more log tail bytes than the log tails contain");
+    }
+    return received_size;
+}
+
 template <typename T>
 void Replicated<T>::make_version(persistent::version_t ver, const HLC& hlc) {
     persistent_registry->makeVersion(ver, hlc);
@@ -301,7 +420,7 @@ auto ExternalCaller<T>::p2p_send(node_id_t dest_node, Args&&... args) {
         }
         auto return_pair = wrapped_this->template send<rpc::to_internal_tag<true>(tag)>(
                 [this, &dest_node](size_t size) -> char* {
-                    const std::size_t max_payload_size = group_rpc_manager.view_manager.get_max_payload_sizes().at(subgroup_id);
+                    const std::size_t max_payload_size = group_rpc_manager.view_manager.get_max_payload_size(subgroup_id);
                     if(size <= max_payload_size) {
                         return (char*)group_rpc_manager.get_sendbuffer_ptr(dest_node,
                                                                            sst::REQUEST_TYPE::P2P_REQUEST);
@@ -6,6 +6,9 @@
 
 namespace derecho {
 
+/** The largest chunk in which the log tails of an object are sent during state transfer. */
+constexpr std::size_t STATE_TRANSFER_CHUNK_SIZE = 1 << 20;
+
 /**
  * Common interface for all types of Replicated<T>, specifying some methods for
  * state transfer and persistence. This allows non-templated Derecho components
@@ -19,6 +22,10 @@ public:
     virtual void send_object(tcp::socket& receiver_socket) const = 0;
     virtual void send_object_raw(tcp::socket& receiver_socket) const = 0;
     virtual std::size_t receive_object(char* buffer) = 0;
+    virtual void send_log_tails(tcp::socket& receiver_socket, persistent::version_t version) const = 0;
+    virtual std::size_t receive_log_tails(tcp::socket& sender_socket,
+                                          const std::function<void(std::size_t, std::size_t)>& progress)
+            = 0;
     virtual bool is_persistent() const = 0;
     virtual bool is_signed() const = 0;
     virtual void make_version(persistent::version_t ver, const HLC& hlc) = 0;
@@ -211,12 +211,15 @@ class RPCManager {
      * @param payload_size The size of the message in bytes
      * @param out_alloc A function that can allocate a buffer for the response
      * to this message.
+     * @param trailing The last argument of the call, if the message does not
+     * contain it
      * @return A pointer to the exception caused by invoking this RPC function,
      * if the message was an RPC function call and the function threw an exception.
      */
     std::exception_ptr receive_message(const Opcode& indx, const node_id_t& received_from,
                                        char const* const buf, std::size_t payload_size,
-                                       const std::function<char*(int)>& out_alloc);
+                                       const std::function<char*(int)>& out_alloc,
+                                       const trailing_bytes& trailing = trailing_bytes{});
 
     /**
      * Entry point for receiving a single RPC message for a function managed by
@@ -226,11 +229,14 @@ class RPCManager {
      * @param size The size of the buffer
      * @param out_alloc A function that can allocate a buffer for the response
      * to this message
+     * @param trailing The last argument of the call, if the message does not
+     * contain it
      * @return A pointer to the exception caused by invoking this RPC function,
      * if the message was an RPC function call and the function threw an exception.
      */
     std::exception_ptr parse_and_receive(char* buf, std::size_t size,
-                                         const std::function<char*(int)>& out_alloc);
+                                         const std::function<char*(int)>& out_alloc,
+                                         const trailing_bytes& trailing = trailing_bytes{});
 
 public:
     RPCManager(ViewManager& group_view_manager,
@@ -310,11 +316,14 @@ public:
      * @param timestamp The timestamp (in microseconds) assigned to the message
      * @param msg_buf A buffer containing the message
      * @param buffer_size The size of the message in the buffer, in bytes
+     * @param trailing The last argument of the call, if it is not in msg_buf
+     * (see Replicated::ordered_send_segments)
      */
     void rpc_message_handler(subgroup_id_t subgroup_id, node_id_t sender_id,
                              persistent::version_t version,
                              uint64_t timestamp,
-                             char* msg_buf, uint32_t buffer_size);
+                             char* msg_buf, uint32_t buffer_size,
+                             const trailing_bytes& trailing = trailing_bytes{});
 
     /**
      * Callback to be called by PersistenceManager when it has finished
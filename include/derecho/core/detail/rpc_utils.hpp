@@ -182,6 +182,16 @@ struct recv_ret {
     std::exception_ptr possible_exception;
 };
 
+/**
+ * The bytes of the last argument of an RPC call, a mutils::vector_view<char>,
+ * when the message only contains the byte count of that argument (see
+ * Replicated::ordered_send_segments). data is nullptr for an ordinary message.
+ */
+struct trailing_bytes {
+    const char* data = nullptr;
+    std::size_t size = 0;
+};
+
 /**
  * Type signature for all the RemoteInvocable::receive_* methods. This alias is
  * helpful for declaring a map of "RPC receive handlers" that are called when
@@ -189,7 +199,7 @@ struct recv_ret {
  */
 using receive_fun_t = std::function<recv_ret(
         mutils::RemoteDeserialization_v* rdv, const node_id_t&, const char* recv_buf,
-        const std::function<char*(int)>& out_alloc)>;
+        const trailing_bytes& trailing, const std::function<char*(int)>& out_alloc)>;
 
 /**
  * The type of map contained in a QueryResults::ReplyMap. The template parameter
@@ -232,6 +242,8 @@ public:
         ReplyMap(QueryResults& qr) : parent(qr){};
         ReplyMap(const ReplyMap&) = delete;
         ReplyMap(ReplyMap&& rm) : parent(rm.parent), rmap(std::move(rm.rmap)) {}
+        /** Moves the replies of another ReplyMap into one that belongs to a new parent */
+        ReplyMap(QueryResults& qr, ReplyMap&& rm) : parent(qr), rmap(std::move(rm.rmap)) {}
 
         bool valid(const node_id_t& nid) {
             assert(rmap.size() == 0 || rmap.count(nid) != 0);
@@ -295,7 +307,7 @@ public:
     /** Move constructor for QueryResults. */
     QueryResults(QueryResults&& o)
             : pending_rmap{std::move(o.pending_rmap)},
-              replies{std::move(o.replies)},
+              replies{*this, std::move(o.replies)},
               persistent_version{std::move(o.persistent_version)},
               local_persistence_done{std::move(o.local_persistence_done)},
               global_persistence_done{std::move(o.global_persistence_done)},
@@ -412,6 +424,8 @@ public:
         ReplyMap(QueryResults& qr) : parent(qr){};
         ReplyMap(const ReplyMap&) = delete;
         ReplyMap(ReplyMap&& rm) : parent(rm.parent), rmap(std::move(rm.rmap)) {}
+        /** Moves the replies of another ReplyMap into one that belongs to a new parent */
+        ReplyMap(QueryResults& qr, ReplyMap&& rm) : parent(qr), rmap(std::move(rm.rmap)) {}
 
         bool valid(const node_id_t& nid) {
             assert(rmap.size() == 0 || rmap.count(nid) != 0);
@@ -453,7 +467,7 @@ public:
               signature_done(std::move(signature_done)) {}
     QueryResults(QueryResults&& o)
             : pending_rmap{std::move(o.pending_rmap)},
-              replies{std::move(o.replies)},
+              replies{*this, std::move(o.replies)},
               persistent_version{std::move(o.persistent_version)},
               local_persistence_done{std::move(o.local_persistence_done)},
               global_persistence_done{std::move(o.global_persistence_done)},
@@ -0,0 +1,171 @@
+/**
+ * @file sequence_ring.hpp
+ */
+
+#pragma once
+
+#include "derecho_internal.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace derecho {
+
+/**
+ * A map from message sequence numbers (or indices) to values, for keys that
+ * fall within a sliding window, such as the messages of a subgroup that are
+ * locally stable but not yet delivered. The values live in a circular array
+ * indexed by the key modulo its capacity, so inserting and erasing a value
+ * does not allocate. If a new key does not fit in the window of the keys
+ * already present, the array doubles in size.
+ */
+template <typename T>
+class SequenceRing {
+private:
+    std::vector<std::optional<T>> slots;
+    /** The lowest key present; only meaningful if num_entries > 0 */
+    message_id_t lowest_key;
+    /** The highest key present; only meaningful if num_entries > 0 */
+    message_id_t highest_key;
+    std::size_t num_entries;
+
+    std::optional<T>& slot(message_id_t key) {
+        return slots[static_cast<std::size_t>(key) & (slots.size() - 1)];
+    }
+
+    /** Moves the values into a larger array in which keys lowest..highest fit. */
+    void grow(message_id_t lowest, message_id_t highest) {
+        std::size_t new_capacity = slots.size();
+        while(static_cast<std::size_t>(highest - lowest) >= new_capacity) {
+            new_capacity *= 2;
+        }
+        std::vector<std::optional<T>> new_slots(new_capacity);
+        if(num_entries > 0) {
+            for(message_id_t key = lowest_key; key <= highest_key; ++key) {
+                std::optional<T>& old_slot = slot(key);
+                if(old_slot) {
+                    new_slots[static_cast<std::size_t>(key) & (new_capacity - 1)] = std::move(old_slot);
+                }
+            }
+        }
+        slots.swap(new_slots);
+    }
+
+public:
+    /**
+     * @param capacity The number of consecutive keys to make room for; it is
+     * rounded up to a power of two.
+     */
+    explicit SequenceRing(std::size_t capacity = 16)
+            : slots(1), lowest_key(0), highest_key(0), num_entries(0) {
+        reserve(capacity);
+    }
+
+    SequenceRing(SequenceRing&&) = default;
+    SequenceRing& operator=(SequenceRing&&) = default;
+
+    /** Makes room for at least capacity consecutive keys. */
+    void reserve(std::size_t capacity) {
+        if(capacity > slots.size()) {
+            grow(0, static_cast<message_id_t>(capacity - 1));
+        }
+    }
+
+    bool empty() const { return num_entries == 0; }
+    std::size_t size() const { return num_entries; }
+    std::size_t capacity() const { return slots.size(); }
+
+    /** @return a pointer to the value with the given key, or nullptr if there is none. */
+    T* find(message_id_t key) {
+        if(num_entries == 0 || key < lowest_key || key > highest_key) {
+            return nullptr;
+        }
+        std::optional<T>& entry = slot(key);
+        return entry ? &*entry : nullptr;
+    }
+
+    /** Inserts a value with the given key, replacing any value it already has. */
+    template <typename... Args>
+    T& emplace(message_id_t key, Args&&... args) {
+        if(num_entries == 0) {
+            lowest_key = highest_key = key;
+        } else {
+            const message_id_t new_lowest = std::min(lowest_key, key);
+            const message_id_t new_highest = std::max(highest_key, key);
+            if(static_cast<std::size_t>(new_highest - new_lowest) >= slots.size()) {
+                grow(new_lowest, new_highest);
+            }
+            lowest_key = new_lowest;
+            highest_key = new_highest;
+        }
+        std::optional<T>& entry = slot(key);
+        if(!entry) {
+            ++num_entries;
+        }
+        entry.emplace(std::forward<Args>(args)...);
+        return *entry;
+    }
+
+    /** Erases the value with the given key, if there is one. */
+    bool erase(message_id_t key) {
+        if(num_entries == 0 || key < lowest_key || key > highest_key || !slot(key)) {
+            return false;
+        }
+        slot(key).reset();
+        --num_entries;
+        if(num_entries > 0 && key == lowest_key) {
+            // the keys are dense, so the next one is usually in the next slot
+            do {
+                ++lowest_key;
+            } while(!slot(lowest_key));
+        } else if(num_entries > 0 && key == highest_key) {
+            do {
+                --highest_key;
+            } while(!slot(highest_key));
+        }
+        return true;
+    }
+
+    /** @return the lowest key present. The ring must not be empty. */
+    message_id_t front_key() const {
+        assert(num_entries > 0);
+        return lowest_key;
+    }
+
+    /** @return the value with the lowest key. The ring must not be empty. */
+    T& front() {
+        assert(num_entries > 0);
+        return *slot(lowest_key);
+    }
+
+    void pop_front() {
+        erase(front_key());
+    }
+
+    /** Calls f(key, value) on every value, in order of increasing key. */
+    template <typename Func>
+    void for_each(Func&& f) {
+        if(num_entries == 0) {
+            return;
+        }
+        for(message_id_t key = lowest_key; key <= highest_key; ++key) {
+            std::optional<T>& entry = slot(key);
+            if(entry) {
+                f(key, *entry);
+            }
+        }
+    }
+
+    void clear() {
+        for(auto& entry : slots) {
+            entry.reset();
+        }
+        num_entries = 0;
+    }
+};
+
+}  // namespace derecho
@@ -376,6 +376,15 @@ private:
      * sends the state if necessary. */
     void send_objects_to_new_members(const vector_int64_2d& old_shard_leaders);
 
+    /**
+     * Sends replicated objects to other nodes, concurrently to different
+     * nodes and in ascending order of subgroup ID to each node, which is the
+     * order in which they receive them. Returns once all the objects are sent.
+     * @param subgroups_by_receiver The IDs of the subgroups to send to each
+     * node, sorted in ascending order, indexed by node ID
+     */
+    void send_subgroup_objects(const std::map<node_id_t, std::vector<subgroup_id_t>>& subgroups_by_receiver);
+
     /** Sends a single subgroup's replicated object to a new member after a view change. */
     void send_subgroup_object(subgroup_id_t subgroup_id, node_id_t new_node_id);
 
@@ -899,6 +908,8 @@ public:
     // UGLY - IMPROVE LATER
     std::map<subgroup_id_t, uint64_t> max_payload_sizes;
     std::map<subgroup_id_t, uint64_t> get_max_payload_sizes();
+    /** @return the maximum payload size of one subgroup, without copying max_payload_sizes */
+    uint64_t get_max_payload_size(subgroup_id_t subgroup_id) const;
     // max of max_payload_sizes
     uint64_t view_max_rpc_reply_payload_size = 0;
     uint32_t view_max_rpc_window_size = 0;
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <ctime>
 #include <exception>
+#include <future>
 #include <iostream>
 #include <list>
 #include <map>
@@ -26,6 +27,7 @@
 #include "subgroup_info.hpp"
 
 #include <derecho/conf/conf.hpp>
+#include <derecho/utils/metrics.hpp>
 #include <mutils-containers/KindMap.hpp>
 #include <mutils-containers/TypeMap2.hpp>
 
@@ -201,9 +203,35 @@ private:
      */
     void receive_objects(const std::set<std::pair<subgroup_id_t, node_id_t>>& subgroups_and_leaders);
 
+    /**
+     * Receives the serialized state of one subgroup's replicated object from
+     * the shard leader, and logs the size and throughput of the transfer. The
+     * whole object is received before it is deserialized.
+     * @param subgroup_id The subgroup whose object should be received
+     * @param leader_id The node ID of the shard leader sending the object
+     */
+    void receive_subgroup_object(subgroup_id_t subgroup_id, node_id_t leader_id);
+
     /** Constructor helper that wires together the component objects of Group. */
     void set_up_components();
 
+    /**
+     * Constructor helper that loads the existing logs of every shard this node
+     * is a member of in curr_view on a thread pool (see persistent::LogPreloader),
+     * so the Persistent<T> fields constructed by construct_objects can take
+     * them instead of loading them one at a time. The constructor then has
+     * their states deserialized on the same pool, once construct_objects has
+     * built the objects.
+     */
+    void preload_logs(const View& curr_view);
+
+    /**
+     * Helper for preload_logs that adds the subgroup prefix of the shard this
+     * node is a member of, in each subgroup of type T, to prefixes.
+     */
+    template <typename T>
+    void collect_log_prefixes(const View& curr_view, std::vector<std::string>& prefixes);
+
     /**
      * Base case for the construct_objects template. Note that the neat "varargs
      * trick" (defining construct_objects(...) as the base case) doesn't work
@@ -351,6 +379,12 @@ public:
     void report_failure(const node_id_t who);
     /** Waits until all members of the group have called this function. */
     void barrier_sync();
+    /**
+     * Switches this node's persistence thread between handling requests one
+     * at a time and group commit, overriding PERS/group_commit. This is meant
+     * for benchmarks that compare the two modes in one run.
+     */
+    void set_persistence_group_commit(bool enable);
     void debug_print_status() const;
 };
 
@@ -243,6 +243,26 @@ public:
     template <rpc::FunctionTag tag, typename... Args>
     auto ordered_send(Args&&... args);
 
+    /**
+     * Like ordered_send, for an RPC function whose last parameter is a
+     * const mutils::vector_view<char>&, whose bytes are the concatenation of
+     * segments. The other arguments are serialized into the message as usual,
+     * but the segments are sent by RDMC from the application's memory (without
+     * copying, where they lie in memory registered with rdmc::register_memory),
+     * and receivers see an ordinary call. This node's own call reads a single
+     * segment in place, and copies several into one buffer once RDMC has sent
+     * them. The segments must not change until release is called, which this
+     * node does once it no longer reads them, or before returning if the
+     * message is small enough to be copied into the SST.
+     * @param segments The bytes of the last argument of the RPC function
+     * @param release Called when the segments may be reused; it must not block
+     * @param leading_args The other arguments to the RPC function
+     * @return An instance of rpc::QueryResults<Ret>, as for ordered_send
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto ordered_send_segments(const std::vector<rdmc::segment>& segments,
+                               const std::function<void()>& release, Args&&... leading_args);
+
     /**
      * Submits a call to send a "raw" (byte array) message in a multicast to
      * this object's subgroup; the message will be generated by invoking msg_generator
@@ -285,6 +305,29 @@ public:
      */
     std::size_t receive_object(char* buffer);
 
+    /**
+     * Sends the log tails of this object's Persistent fields after a version
+     * over the given socket, in chunks of up to STATE_TRANSFER_CHUNK_SIZE bytes
+     * that are each preceded by their size. An empty chunk ends them. This
+     * follows send_object(), called while the earliest version to serialize
+     * was LOG_TAIL_OMITTED, so that the logs are not sent twice.
+     * @param receiver_socket
+     * @param version The version after which the log tails begin
+     */
+    void send_log_tails(tcp::socket& receiver_socket, persistent::version_t version) const;
+
+    /**
+     * Receives the log tails sent by send_log_tails() and merges them into the
+     * logs of this object's Persistent fields as they arrive, so that no more
+     * than a chunk and a log entry are held in memory at a time.
+     * @param sender_socket
+     * @param progress A function called after each chunk with the number of
+     * bytes received so far and the total number of bytes
+     * @return The number of bytes received
+     */
+    std::size_t receive_log_tails(tcp::socket& sender_socket,
+                                  const std::function<void(std::size_t, std::size_t)>& progress);
+
     const uint64_t compute_global_stability_frontier();
 
     inline const HLC getFrontier() {
@@ -6,6 +6,7 @@
 #include <mutils/mutils.hpp>
 #include <mutils/tuple_extras.hpp>
 #include <mutils/type_utils.hpp>
+#include <string_view>
 #include <tuple>
 #include <vector>
 
@@ -212,6 +213,12 @@ std::size_t bytes_size(const ByteRepresentable& b);
  */
 std::size_t bytes_size(const std::string& b);
 
+/**
+ * Same as for std::string, so that a std::string_view can stand in for a
+ * std::string parameter of an RPC function.
+ */
+std::size_t bytes_size(const std::string_view& b);
+
 template <typename... T>
 std::size_t bytes_size(const std::tuple<T...>& t);
 
@@ -357,6 +364,12 @@ std::size_t to_bytes(const ByteRepresentable& b, char* v);
  */
 std::size_t to_bytes(const std::string& b, char* v);
 
+/**
+ * Writes the characters of this std::string_view and a terminating null
+ * character to v, in the same format as a std::string
+ */
+std::size_t to_bytes(const std::string_view& b, char* v);
+
 /**
  * Calls T::from_bytes(ctx,v) when T is a ByteRepresentable.
  * uses std::memcpy() when T is a POD.
@@ -469,6 +482,8 @@ struct marshalled : public ByteRepresentable {
  * pair
  * string
  * set
+ * string_view, which deserializes to a view of the characters in the buffer
+ * (see SerializationViews.hpp for views of vectors and maps)
  */
 
 // end forward-declaring; everything past this point is implementation,
@@ -517,6 +532,15 @@ struct is_string<std::string> : std::true_type {};
 template <>
 struct is_string<const std::string> : std::true_type {};
 
+template <typename>
+struct is_string_view : std::false_type {};
+
+template <>
+struct is_string_view<std::string_view> : std::true_type {};
+
+template <>
+struct is_string_view<const std::string_view> : std::true_type {};
+
 /**
  * Constructs a buffer-consuming function that will copy its input to the
  * provided destination buffer at the specified index. The created function
@@ -535,6 +559,9 @@ post_to_buffer(std::size_t& index, char* dest_buf);
 void post_object(const std::function<void(char const* const, std::size_t)>& f,
                  const std::string& str);
 
+void post_object(const std::function<void(char const* const, std::size_t)>& f,
+                 const std::string_view& str);
+
 template <typename T, typename V>
 void post_object(const std::function<void(char const* const, std::size_t)>& f,
                  const std::pair<T, V>& pair);
@@ -619,6 +646,15 @@ context_ptr<type_check<is_string, T>>
 from_bytes_noalloc(DeserializationManager*, char const* v,
                    context_ptr<T> = context_ptr<T>{});
 
+template <typename T>
+std::unique_ptr<type_check<is_string_view, T>> from_bytes(DeserializationManager*,
+                                                          char const* v);
+
+template <typename T>
+context_ptr<type_check<is_string_view, T>>
+from_bytes_noalloc(DeserializationManager*, char const* v,
+                   context_ptr<T> = context_ptr<T>{});
+
 template <typename T>
 std::unique_ptr<type_check<is_set, T>> from_bytes(DeserializationManager* ctx,
                                                   const char* _v);
@@ -755,7 +791,9 @@ void post_object(const std::function<void(char const* const, std::size_t)>& f,
 // end post_object section
 
 // Implementation of to_bytes functions for STL types
-// To reduce code duplication, these are all implemented in terms of post_object
+// To reduce code duplication, these are all implemented in terms of post_object.
+// They return the number of bytes post_object wrote instead of calling
+// bytes_size again, so nested containers are traversed once per to_bytes.
 
 /**
  * Special to_bytes for POD types, which just uses memcpy
@@ -772,56 +810,51 @@ std::size_t to_bytes(const std::vector<bool>& vec, char* v);
 
 template <typename T>
 std::size_t to_bytes(const std::vector<T>& vec, char* v) {
-    auto size = bytes_size(vec);
     std::size_t index = 0;
     post_object(post_to_buffer(index, v), vec);
-    return size;
+    return index;
 }
 
 template <typename T>
 std::size_t to_bytes(const std::list<T>& list, char* buffer) {
-    auto size = bytes_size(list);
     std::size_t offset = 0;
     post_object(post_to_buffer(offset, buffer), list);
-    return size;
+    return offset;
 }
 
 template <typename T, typename V>
 std::size_t to_bytes(const std::pair<T, V>& pair, char* buffer) {
     std::size_t index = 0;
     post_object(post_to_buffer(index, buffer), pair);
-    return bytes_size(pair);
+    return index;
 }
 
 template <typename... T>
 std::size_t to_bytes(const std::tuple<T...>& tuple, char* buffer) {
     std::size_t index = 0;
     post_object(post_to_buffer(index, buffer), tuple);
-    return bytes_size(tuple);
+    return index;
 }
 
 template <typename T>
 std::size_t to_bytes(const std::set<T>& s, char* _v) {
     std::size_t index = 0;
-    auto size = bytes_size(s);
     post_object(post_to_buffer(index, _v), s);
-    return size;
+    return index;
 }
 
 template <typename K, typename V>
 std::size_t to_bytes(const std::map<K, V>& m, char* buffer) {
     std::size_t index = 0;
-    std::size_t size = bytes_size(m);
     post_object(post_to_buffer(index, buffer), m);
-    return size;
+    return index;
 }
 
 template <typename K, typename V>
 std::size_t to_bytes(const std::unordered_map<K, V>& m, char* buffer) {
     std::size_t index = 0;
-    std::size_t size = bytes_size(m);
     post_object(post_to_buffer(index, buffer), m);
-    return size;
+    return index;
 }
 
 // end to_bytes section
@@ -925,6 +958,23 @@ from_bytes_noalloc(DeserializationManager*, char const* v,
     return context_ptr<T>(new std::string{v});
 }
 
+// A std::string_view refers to the characters in the buffer instead of copying
+// them, so it is only valid as long as the buffer is.
+template <typename T>
+std::unique_ptr<type_check<is_string_view, T>> from_bytes(DeserializationManager*,
+                                                          char const* v) {
+    assert(v);
+    return std::make_unique<std::remove_const_t<T>>(v);
+}
+
+template <typename T>
+context_ptr<type_check<is_string_view, T>>
+from_bytes_noalloc(DeserializationManager*, char const* v,
+                   context_ptr<T>) {
+    assert(v);
+    return context_ptr<T>(new std::string_view{v});
+}
+
 template <typename T>
 std::unique_ptr<type_check<is_set, T>> from_bytes(DeserializationManager* ctx,
                                                   const char* _v) {
@@ -0,0 +1,299 @@
+#pragma once
+#include "SerializationSupport.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+namespace mutils {
+
+/**
+ * Read-only views of serialized containers. Each one has the same serialized
+ * format as the container it stands for, so it can replace that container as
+ * the parameter type of an RPC function:
+ *
+ *   std::vector<T>        ->  const vector_view<T>&
+ *   std::map<K, V>        ->  const map_view<K, V>&
+ *   std::string           ->  const std::string_view&
+ *
+ * Callers still pass the container itself, which converts implicitly. On the
+ * receiving side, deserialize_and_run binds the view directly to the message
+ * buffer, so the function reads its argument without copying it. Like any
+ * result of from_bytes_noalloc, a view (and anything obtained from it) must
+ * not be used after the function returns; copy the parts you need to keep.
+ */
+
+/**
+ * A view of a serialized std::vector<T>, for a trivially copyable T, which
+ * points at the elements in the buffer. As with from_bytes on a vector, the
+ * elements follow a 4-byte count in the buffer and may not be aligned for T,
+ * so the view never hands out a T reference or pointer: the elements are
+ * read by value, with memcpy, and data() returns their bytes.
+ */
+template <typename T>
+struct vector_view : public ByteRepresentable {
+    static_assert(std::is_trivially_copyable<T>::value && !std::is_same<T, bool>::value,
+                  "vector_view only supports trivially copyable element types other than bool");
+
+private:
+    char const* elements;
+    std::size_t count;
+
+    static T read(char const* element) {
+        T value;
+        std::memcpy(&value, element, sizeof(T));
+        return value;
+    }
+
+    static std::unique_ptr<vector_view> from_buffer(char const* v) {
+#ifdef MUTILS_DEBUG
+        v += mutils::bytes_size(type_name<std::vector<T>>());
+#endif
+        int count;
+        std::memcpy(&count, v, sizeof(count));
+        return std::make_unique<vector_view>(v + sizeof(int), count);
+    }
+
+public:
+    using value_type = T;
+
+    /** Iterates over the elements by value. */
+    class const_iterator {
+        char const* element;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = T;
+
+        explicit const_iterator(char const* element) : element(element) {}
+        T operator*() const { return read(element); }
+        const_iterator& operator++() {
+            element += sizeof(T);
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            element += sizeof(T);
+            return previous;
+        }
+        bool operator==(const const_iterator& other) const { return element == other.element; }
+        bool operator!=(const const_iterator& other) const { return element != other.element; }
+    };
+
+    /** A view of count elements of type T, stored at elements with any alignment. */
+    vector_view(char const* elements, std::size_t count) : elements(elements), count(count) {}
+    /** A view of a vector, so that callers of an RPC function can pass a std::vector<T>. */
+    vector_view(const std::vector<T>& vec) : elements((char const*)vec.data()), count(vec.size()) {}
+
+    /** @return the bytes of the elements, which may not be aligned for T */
+    char const* data() const { return elements; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const_iterator begin() const { return const_iterator(elements); }
+    const_iterator end() const { return const_iterator(elements + count * sizeof(T)); }
+    T operator[](std::size_t i) const { return read(elements + i * sizeof(T)); }
+
+    /** @return a copy of the elements, which outlives the buffer */
+    std::vector<T> to_vector() const {
+        std::vector<T> copy(count);
+        if(count > 0) {
+            std::memcpy(copy.data(), elements, count * sizeof(T));
+        }
+        return copy;
+    }
+
+    std::size_t to_bytes(char* v) const {
+        std::size_t index = 0;
+        post_object(post_to_buffer(index, v));
+        return index;
+    }
+
+    std::size_t bytes_size() const {
+        return prefix_size() + count * sizeof(T);
+    }
+
+    void post_object(const std::function<void(char const* const, std::size_t)>& f) const {
+        post_prefix(f, count);
+        f(elements, count * sizeof(T));
+    }
+
+    /** @return the size of what precedes the elements in a serialized view */
+    static std::size_t prefix_size() {
+        return sizeof(int) whenmutilsdebug(+mutils::bytes_size(type_name<std::vector<T>>()));
+    }
+
+    /**
+     * Posts what precedes the elements in a serialized view of count
+     * elements, for a sender that sends the elements separately.
+     */
+    static void post_prefix(const std::function<void(char const* const, std::size_t)>& f, std::size_t count) {
+        whenmutilsdebug(mutils::post_object(f, type_name<std::vector<T>>());)
+        int size = count;
+        f((char*)&size, sizeof(size));
+    }
+
+#ifdef MUTILS_DEBUG
+    void ensure_registered(DeserializationManager&) {}
+#endif
+
+    static std::unique_ptr<vector_view> from_bytes(DeserializationManager*, char const* v) {
+        return from_buffer(v);
+    }
+
+    static context_ptr<vector_view> from_bytes_noalloc(DeserializationManager*, char const* v) {
+        return context_ptr<vector_view>{from_buffer(v).release()};
+    }
+
+    static context_ptr<const vector_view> from_bytes_noalloc_const(DeserializationManager*, char const* v) {
+        return context_ptr<const vector_view>{from_buffer(v).release()};
+    }
+};
+
+/**
+ * A flat, read-only view of a serialized std::map<K, V> or
+ * std::unordered_map<K, V>. The entries are deserialized with
+ * from_bytes_noalloc as they are visited, so K and V should themselves be
+ * views or POD types (e.g. map_view<std::string_view, vector_view<int>>) for
+ * lookups not to copy anything. The entries have variable sizes, so a lookup
+ * is a linear scan of the buffer.
+ *
+ * A map_view constructed from a map (on the caller's side of an RPC) only
+ * serializes that map; the lookups are for views of a buffer.
+ */
+template <typename K, typename V>
+struct map_view : public ByteRepresentable {
+private:
+    using post_function_t = std::function<void(char const* const, std::size_t)>;
+
+    DeserializationManager* dsm;
+    // The serialized map, for a view of a buffer
+    char const* buffer;
+    // The map to serialize, for a view constructed from a map
+    void const* source;
+    void (*post_source)(void const*, const post_function_t&);
+    std::size_t num_entries;
+    std::size_t serialized_size;
+
+    /**
+     * Visits the entries in order, calling fun(key, value) on each one until
+     * it returns true.
+     * @return a pointer past the last entry visited
+     */
+    template <typename F>
+    char const* scan(const F& fun) const {
+        assert(buffer && "Only a map_view of a buffer can be read");
+        char const* v = buffer + sizeof(int);
+        for(std::size_t i = 0; i < num_entries; ++i) {
+            auto key = mutils::from_bytes_noalloc<const K>(dsm, v, context_ptr<const K>{});
+            v += mutils::bytes_size(*key);
+            auto value = mutils::from_bytes_noalloc<const V>(dsm, v, context_ptr<const V>{});
+            v += mutils::bytes_size(*value);
+            if(fun(*key, *value)) {
+                break;
+            }
+        }
+        return v;
+    }
+
+public:
+    /** A view of the serialized map in buffer, which must outlive the view. */
+    map_view(DeserializationManager* dsm, char const* buffer)
+            : dsm(dsm),
+              buffer(buffer),
+              source(nullptr),
+              post_source(nullptr),
+              num_entries(0),
+              serialized_size(0) {
+        int count;
+        std::memcpy(&count, buffer, sizeof(count));
+        num_entries = count;
+        serialized_size = scan([](const K&, const V&) { return false; }) - buffer;
+    }
+
+    /** A view of a map, so that callers of an RPC function can pass the map itself. */
+    template <typename Map, typename = std::enable_if_t<is_map<Map>::value || is_unordered_map<Map>::value>>
+    map_view(const Map& map)
+            : dsm(nullptr),
+              buffer(nullptr),
+              source(&map),
+              post_source([](void const* map, const post_function_t& f) {
+                  mutils::post_object(f, *static_cast<Map const*>(map));
+              }),
+              num_entries(map.size()),
+              serialized_size(mutils::bytes_size(map)) {}
+
+    std::size_t size() const { return num_entries; }
+    bool empty() const { return num_entries == 0; }
+
+    /** Calls fun(key, value) on each entry, in the order they were serialized. */
+    template <typename F>
+    void for_each(const F& fun) const {
+        scan([&fun](const K& key, const V& value) {
+            fun(key, value);
+            return false;
+        });
+    }
+
+    /**
+     * Calls fun(value) on the value of the first entry whose key compares
+     * equal to key.
+     * @return true if there was such an entry
+     */
+    template <typename Key, typename F>
+    bool find_and_run(const Key& key, const F& fun) const {
+        bool found = false;
+        scan([&](const K& entry_key, const V& value) {
+            if(entry_key == key) {
+                fun(value);
+                found = true;
+            }
+            return found;
+        });
+        return found;
+    }
+
+    template <typename Key>
+    bool contains(const Key& key) const {
+        return find_and_run(key, [](const V&) {});
+    }
+
+    std::size_t to_bytes(char* v) const {
+        std::size_t index = 0;
+        post_object(post_to_buffer(index, v));
+        return index;
+    }
+
+    std::size_t bytes_size() const { return serialized_size; }
+
+    void post_object(const post_function_t& f) const {
+        if(buffer) {
+            f(buffer, serialized_size);
+        } else {
+            post_source(source, f);
+        }
+    }
+
+#ifdef MUTILS_DEBUG
+    void ensure_registered(DeserializationManager&) {}
+#endif
+
+    static std::unique_ptr<map_view> from_bytes(DeserializationManager* dsm, char const* v) {
+        return std::make_unique<map_view>(dsm, v);
+    }
+
+    static context_ptr<map_view> from_bytes_noalloc(DeserializationManager* dsm, char const* v) {
+        return context_ptr<map_view>{new map_view(dsm, v)};
+    }
+
+    static context_ptr<const map_view> from_bytes_noalloc_const(DeserializationManager* dsm, char const* v) {
+        return context_ptr<const map_view>{new map_view(dsm, v)};
+    }
+};
+
+}  // namespace mutils
@@ -46,6 +46,7 @@ namespace persistent {
 #define PERSIST_EXP_INV_OBJNAME PERSIST_EXP(33, 0)
 #define PERSIST_EXP_REMOVE_FILE(x) PERSIST_EXP(34, (x))
 #define PERSIST_EXP_SHA256_HASH(x) PERSIST_EXP(35, (x))
+#define PERSIST_EXP_NO_RESERVATION PERSIST_EXP(36, 0)
 }
 
 #endif  //PERSISTENT_EXCEPTION_HPP
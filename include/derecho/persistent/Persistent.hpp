@@ -6,14 +6,19 @@
 #include "PersistException.hpp"
 #include "PersistNoLog.hpp"
 #include "PersistentInterface.hpp"
+#include "detail/FileCheckpointStore.hpp"
 #include "detail/FilePersistLog.hpp"
+#include "detail/LogPreloader.hpp"
 #include "detail/PersistLog.hpp"
+#include "detail/SegmentedPersistLog.hpp"
 #include <derecho/mutils-serialization/SerializationSupport.hpp>
+#include <atomic>
 #include <functional>
 #include <inttypes.h>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <pthread.h>
 #include <string>
 #include <sys/types.h>
@@ -100,6 +105,17 @@ public:
      */
     void initializeLastSignature(version_t version, const unsigned char* signature, std::size_t signature_size);
 
+    /**
+     * Initializes the PersistentRegistry's cache of the last chain digest in
+     * the log, which switches it to batched signatures. This must be called
+     * after initializeLastSignature, with the same version.
+     * @param version The version of the last digest, or INVALID_VERSION if
+     * the log is empty
+     * @param digest The last digest in the log, all zeroes for an empty log
+     * @param digest_size The size of the digest, in bytes
+     */
+    void initializeLastDigest(version_t version, const unsigned char* digest, std::size_t digest_size);
+
     /** Make a new version capturing the current state of the object. */
     void makeVersion(version_t ver, const HLC& mhlc);
 
@@ -114,6 +130,14 @@ public:
      * Adds signatures to the log up to the specified version, and returns the
      * signature for the latest version. The version specified should be the
      * result of calling getMinimumLatestVersion().
+     *
+     * If signatures are batched, each new version is instead chained into a
+     * SHA-256 digest, d(v) = H(data(v) || d(previous version)), and only the
+     * digest of the latest version is signed. Every version of the batch
+     * stores its digest and that one signature, so getSignature() and verify()
+     * keep working for any version. Since the digest chain does not depend on
+     * where the batches start, replicas that persist different batches can
+     * still verify each other's signatures.
      * @param latest_version The version to add signatures up through
      * @param signer The Signer object to use for generating signatures,
      * initialized with the appropriate private key
@@ -137,6 +161,11 @@ public:
      * Verifies the log up to the specified version against the specified
      * signature, using a Verifier that has been initialized with the
      * appropriate public key.
+     * With batched signatures, the signature is checked against the digest of
+     * the specified version, unless it is the signature of a later version
+     * that this version was signed with locally (as returned by
+     * getSignature()); then the digest chain is extended to that version
+     * first. Either way, there is a single signature verification.
      * @param version The version to verify up to
      * @param verifier The Verifier object to use for digesting and verifying
      * the log, intialized with the public key corresponding to the signature
@@ -198,6 +227,37 @@ public:
      */
     void unregisterPersistent(const std::string& obj_name);
 
+    /**
+     * Returns the number of bytes postLogTails() posts for the same version.
+     */
+    std::size_t getLogTailsSize(version_t ver);
+
+    /**
+     * Posts the log tails of all the Persistent fields after a version to a
+     * function, each one preceded by the hash of the field's name. State
+     * transfer sends them apart from the object, which is then serialized with
+     * LOG_TAIL_OMITTED, so that the receiver can merge them with
+     * applyLogTails() as they arrive.
+     * @param ver The version after which the log tails begin
+     * @param f The function to handle the serialized bytes
+     */
+    void postLogTails(version_t ver, const std::function<void(char const* const, std::size_t)>& f);
+
+    /**
+     * Merges the log tails posted by postLogTails() into the registered
+     * Persistent fields of the same names, reading them from a stream.
+     * @param read_bytes A function that fills its buffer argument with the
+     * requested number of bytes
+     * @throw PERSIST_EXP_INV_OBJNAME if there is no field for one of the tails
+     */
+    void applyLogTails(const std::function<void(char*, std::size_t)>& read_bytes);
+
+    /**
+     * @return the Persistent<T> registered under obj_name, or nullptr if there
+     * is none.
+     */
+    PersistentObject* getPersistent(const std::string& obj_name);
+
     /**
      * get temporal query frontier
      */
@@ -287,6 +347,19 @@ protected:
      * persistent log entry.
      */
     version_t m_lastSignedVersion;
+    /**
+     * The chain digest of the version m_lastSignedVersion when signatures are
+     * batched; empty if they are not.
+     */
+    std::vector<unsigned char> m_lastDigest;
+    /**
+     * Helper for sign() when signatures are batched.
+     */
+    void signBatch(version_t latest_version, openssl::Signer& signer, unsigned char* signature_buffer);
+    /**
+     * Helper for verify() when signatures are batched.
+     */
+    bool verifyBatch(version_t version, openssl::Verifier& verifier, const unsigned char* signature);
     /**
      * Set the earliest version to serialize for recovery.
      */
@@ -303,7 +376,10 @@ protected:
 // of a byte array - the DELTA, as long as the update should be persisted. Each
 // time Persistent<T> trying to make a version, it collects the DELTA and write
 // it to the log. On reloading data from persistent storage, the DELTAs in the
-// log entries are applied in order. TODO: use checkpointing to accelerate it!
+// log entries are applied in order. To bound the cost of reconstructing a
+// historical state, Persistent<T> can save a full checkpoint of T every
+// PERS/delta_checkpoint_interval deltas or PERS/delta_checkpoint_bytes bytes of
+// deltas, and replay only the deltas after the nearest checkpoint.
 //
 // There are three method included in this interface:
 // - 'finalizeCurrentDelta'     This method is called when Persistent<T> trying to
@@ -381,6 +457,11 @@ protected:
      */
     inline void initialize_log(const char* object_name, bool enable_signatures);
 
+    /** initialize the registry's last signature (and digest) from the end of
+     *  the log, so that the next call to sign() continues the chain.
+     */
+    inline void initialize_registry_signatures();
+
     /** initialize the object from log
      */
     inline void initialize_object_from_log(const std::function<std::unique_ptr<ObjectType>(void)>& object_factory,
@@ -502,8 +583,9 @@ public:
      * (const ObjectType&). Please note that due to zero copy design, this object may not be accessible anymore after
      * it returns.
      *
-     * A note for ObjectType implementing IDeltaSupport<> interface: a history state will be reconstructed from the very
-     * first log entry, making it extremely inefficient. @TODO: use cached checkpoint to accelerate it.
+     * A note for ObjectType implementing IDeltaSupport<> interface: a history state will be reconstructed by applying
+     * the deltas on top of the nearest checkpoint at or below idx, or from the very first log entry if there is no
+     * such checkpoint. See PERS/delta_checkpoint_interval and PERS/delta_checkpoint_bytes.
      *
      * @param idx   index
      * @param fun   the user function to process a const ObjectType& object
@@ -821,6 +903,19 @@ public:
      */
     virtual version_t getLastPersistedVersion() const;
 
+    /**
+     * Deserialize the latest state from the log if the constructor deferred it
+     * to LogPreloader::finishRestores(). Safe to call from several threads,
+     * which is what the accessors do on first use; only one deserializes.
+     */
+    virtual void finishRestore() override;
+
+    virtual std::size_t logTailSize(version_t ver) const override;
+
+    virtual void postLogTail(const std::function<void(char const* const, std::size_t)>& f, version_t ver) const override;
+
+    virtual void applyLogTail(const std::function<void(char*, std::size_t)>& read_bytes) override;
+
     /**
      * getIndexAtTime
      *
@@ -931,6 +1026,33 @@ public:
      */
     virtual bool getSignature(version_t ver, unsigned char* signature, version_t& prev_ver) const;
 
+    /**
+     * Update the provided Hasher with the state of T at the specified version.
+     * This is the counterpart of updateSignature when signatures are batched.
+     * @return the number of bytes added to the Hasher
+     */
+    virtual std::size_t updateHash(version_t ver, openssl::Hasher& hasher);
+
+    /**
+     * Add the provided chain digest to the specified version in the log, along
+     * with the version whose digest is signed by this version's signature.
+     * Does nothing unless signatures are batched.
+     */
+    virtual void addDigest(version_t ver, const unsigned char* digest, version_t signed_ver);
+
+    /**
+     * Retrieves the chain digest associated with the specified version.
+     * @return true if a digest was retrieved, false if there was no version in
+     * the log with the requested version number or signatures are not batched
+     */
+    virtual bool getDigest(version_t ver, unsigned char* digest, version_t& signed_ver) const;
+
+    /**
+     * @return the size, in bytes, of each chain digest in this Persistent
+     * object's log, or 0 if signatures are not batched.
+     */
+    virtual std::size_t getDigestSize() const;
+
     /**
      * Update the provided Verifier with the state of T at the specified version.
      * This is analogous to update_signature, only for verifying the log against
@@ -946,6 +1068,31 @@ protected:
     std::unique_ptr<PersistLog> m_pLog;
     // Persistence Registry
     PersistentRegistry* m_pRegistry;
+    // Checkpoints of an IDeltaSupport object, nullptr if checkpointing is disabled.
+    std::unique_ptr<FileCheckpointStore> m_pCheckpoints;
+    // Make a checkpoint every m_iCheckpointInterval deltas, 0 for never
+    uint64_t m_iCheckpointInterval = 0;
+    // Make a checkpoint every m_iCheckpointBytes bytes of deltas, 0 for never
+    uint64_t m_iCheckpointBytes = 0;
+    // Number of deltas and bytes of deltas logged since the last checkpoint
+    uint64_t m_iDeltasSinceCheckpoint = 0;
+    uint64_t m_iDeltaBytesSinceCheckpoint = 0;
+    // Log an unchanged state of a non-delta object as a reference to the
+    // latest entry, see CONF_PERS_DIRTY_TRACKING
+    bool m_bDirtyTracking = false;
+    // Whether m_pWrappedObject is still to be deserialized by finishRestore()
+    std::atomic<bool> m_bRestorePending{false};
+    // Serializes finishRestore(), which the const accessors call as well
+    mutable std::mutex m_restoreMutex;
+    // The deserialization contexts that finishRestore() deserializes with
+    mutils::RemoteDeserialization_v m_restoreContexts;
+    /**
+     * Save a checkpoint of the wrapped object, which has just been logged at
+     * version ver, if the checkpoint policy asks for it.
+     * @param delta_size the size of the delta logged at version ver
+     * @param ver the version just logged
+     */
+    void maybeCheckpoint(uint64_t delta_size, version_t ver);
     // get the static name maker.
     static _NameMaker<ObjectType, storageType>& getNameMaker(const std::string& prefix = std::string(""));
 
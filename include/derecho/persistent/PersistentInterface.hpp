@@ -3,6 +3,7 @@
 #include <functional>
 
 #include "HLC.hpp"
+#include "../openssl/hash.hpp"
 #include "../openssl/signature.hpp"
 
 namespace persistent {
@@ -56,6 +57,38 @@ public:
      * output parameters will be unmodified)
      */
     virtual bool getSignature(version_t version, unsigned char* signature, version_t& prev_signed_ver) const = 0;
+    /**
+     * Updates the provided Hasher object with the state of the Persistent
+     * object at a specific version. This is used instead of updateSignature
+     * when signatures are batched.
+     * @param version The version being hashed
+     * @param hasher The Hasher object to update with bytes from this version
+     * @return The number of bytes added to the Hasher object
+     */
+    virtual std::size_t updateHash(version_t version, openssl::Hasher& hasher) = 0;
+    /**
+     * Adds a chain digest to the Persistent object's log at the specified
+     * version number, and records the version whose digest is signed by the
+     * signature stored in this version. Does nothing unless signatures are
+     * batched.
+     * @param version The version to add the digest to
+     * @param digest A byte buffer containing the digest
+     * @param signed_ver The last version of the batch this version belongs to
+     */
+    virtual void addDigest(version_t version, const unsigned char* digest, version_t signed_ver) = 0;
+    /**
+     * Retrieves the chain digest associated with a specific version of the
+     * Persistent object, as well as the version whose digest is signed by the
+     * signature stored in this version.
+     * @param version The version to retrieve the digest for
+     * @param digest A byte buffer in which the digest will be placed
+     * @param signed_ver A reference to a version_t that will be updated with
+     * the last version of the batch this version belongs to
+     * @return True if a digest was retrieved successfully, false if there was
+     * no version matching the requested version number or signatures are not
+     * batched
+     */
+    virtual bool getDigest(version_t version, unsigned char* digest, version_t& signed_ver) const = 0;
     /**
      * Updates the provided Verifier object with the state of the Persistent
      * object at a specific version.
@@ -90,6 +123,31 @@ public:
      * @param latest_version The latest version to keep
      */
     virtual void truncate(version_t latest_version) = 0;
+    /**
+     * @return the size of the log tail that postLogTail() posts for the same
+     * version
+     */
+    virtual std::size_t logTailSize(version_t version) const = 0;
+    /**
+     * Posts the serialized log tail after a version to a function, in the
+     * format of PersistLog::post_object()
+     * @param f The function to handle the serialized bytes
+     * @param version The version after which the log tail begins
+     */
+    virtual void postLogTail(const std::function<void(char const* const, std::size_t)>& f, version_t version) const = 0;
+    /**
+     * Merges a log tail posted by postLogTail() into the log, reading it from
+     * a stream one entry at a time.
+     * @param read_bytes A function that fills its buffer argument with the
+     * requested number of bytes of the log tail
+     */
+    virtual void applyLogTail(const std::function<void(char*, std::size_t)>& read_bytes) = 0;
+    /**
+     * Deserializes the current state of the object from its log if its
+     * constructor left that to LogPreloader::finishRestores(); does nothing
+     * otherwise.
+     */
+    virtual void finishRestore() {}
     /**
      * Ensure destructors continue to work with inheritance
      */
@@ -0,0 +1,131 @@
+#ifndef FILE_CHECKPOINT_STORE_HPP
+#define FILE_CHECKPOINT_STORE_HPP
+
+#include "PersistLog.hpp"
+#include "util.hpp"
+#include <derecho/utils/logger.hpp>
+#include <functional>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace persistent {
+
+#define CKPT_FILE_SUFFIX "ckpt"
+#define CKPT_MAGIC (0x544e494f504b4843ull)  // "CHKPOINT"
+
+/**
+ * The on-disk header preceding every checkpoint in the checkpoint file.
+ * The checkpoint file is a sequence of [CheckpointHeader][object bytes] records,
+ * ordered by log index.
+ */
+struct CheckpointHeader {
+    uint64_t magic;     // CKPT_MAGIC
+    int64_t idx;        // the log index whose state is captured by this checkpoint
+    int64_t ver;        // the version of the log entry at idx
+    uint64_t size;      // size of the serialized object following this header
+    uint64_t checksum;  // FNV-1a checksum of the serialized object
+};
+
+/**
+ * FileCheckpointStore keeps full snapshots of an IDeltaSupport object beside
+ * the FilePersistLog of that object. A snapshot taken at log index i captures
+ * the state produced by applying all the deltas up to and including i, so a
+ * historical read of index j only needs to replay the deltas in (i, j] on top
+ * of the nearest checkpoint at or below j instead of the whole log.
+ *
+ * Checkpoints are only an acceleration structure: they are written without
+ * msync and checked against a checksum and the log version on every load. A
+ * missing or damaged checkpoint simply falls back to an older one, or to
+ * replaying from the beginning of the log.
+ */
+class FileCheckpointStore {
+protected:
+    struct checkpoint_entry {
+        version_t ver;
+        uint64_t ofst;  // offset of the CheckpointHeader in the file
+        uint64_t size;  // size of the serialized object
+        uint64_t checksum;
+    };
+    // name of the log
+    const std::string m_sName;
+    // full checkpoint file name
+    const std::string m_sCheckpointFile;
+    // file descriptor of the checkpoint file
+    int m_iFileDesc;
+    // the end of the last valid checkpoint in the file
+    uint64_t m_iFileSize;
+    // log index -> checkpoint
+    std::map<int64_t, checkpoint_entry> m_index;
+    // protects m_index and m_iFileSize
+    mutable std::shared_mutex m_mutex;
+
+    // scan the checkpoint file and rebuild the index, dropping a torn tail.
+    void load();
+
+    // rewrite the checkpoint file with only the checkpoints at or after idx.
+    void compact(int64_t idx);
+
+public:
+    /**
+     * Constructor
+     * @param name the name of the log this store belongs to
+     * @param dataPath the directory holding the log files
+     */
+    FileCheckpointStore(const std::string& name, const std::string& dataPath);
+
+    virtual ~FileCheckpointStore() noexcept(true);
+
+    /**
+     * Append a checkpoint of the object at log index idx.
+     * @param idx the log index whose state is captured
+     * @param ver the version of the log entry at idx
+     * @param size the size of the serialized object
+     * @param writer a function serializing the object into a buffer of 'size' bytes
+     */
+    void write(int64_t idx, version_t ver, uint64_t size, const std::function<void(char*)>& writer);
+
+    /**
+     * Load the latest valid checkpoint whose log index is in [lower_idx, upper_idx].
+     * @param lower_idx the smallest acceptable log index, normally the one just
+     *        before the earliest index in the log
+     * @param upper_idx the largest acceptable log index
+     * @param validator called with (idx, ver) of a candidate checkpoint; returns false
+     *        if the checkpoint does not match the log.
+     * @param buf receives the serialized object
+     * @return the log index of the loaded checkpoint, or INVALID_INDEX if there is none.
+     */
+    int64_t load(int64_t lower_idx, int64_t upper_idx,
+                 const std::function<bool(int64_t, version_t)>& validator,
+                 std::vector<char>& buf) const;
+
+    /**
+     * Drop all the checkpoints strictly after log index idx. This must be
+     * called when the log is truncated, since the log indexes will be reused.
+     * @param idx the latest log index left in the log
+     */
+    void truncate(int64_t idx);
+
+    /**
+     * Drop the checkpoints that cannot be used anymore once the log is trimmed
+     * to start at log index idx. The newest checkpoint before idx is kept: it
+     * is the only state the remaining deltas can be replayed on.
+     * @param idx the earliest log index left in the log, or INVALID_INDEX if
+     *        the log is empty, which keeps only the latest checkpoint.
+     */
+    void trim(int64_t idx);
+
+    /**
+     * @return the log index of the latest checkpoint, or INVALID_INDEX if there is none.
+     */
+    int64_t getLatestCheckpointIndex() const;
+
+    /**
+     * @return the number of checkpoints in the store.
+     */
+    std::size_t getNumOfCheckpoints() const;
+};
+}  // namespace persistent
+
+#endif  //FILE_CHECKPOINT_STORE_HPP
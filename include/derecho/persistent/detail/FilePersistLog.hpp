@@ -3,6 +3,7 @@
 
 #include "PersistLog.hpp"
 #include "util.hpp"
+#include <algorithm>
 #include <derecho/utils/logger.hpp>
 #include <pthread.h>
 #include <string>
@@ -18,17 +19,24 @@ namespace persistent {
 //Similarly, the size of a meta header must be page-aligned
 #define META_HEADER_SIZE (256)
 
+// Set in the flags of a meta header once they describe the log; the meta
+// files written before the flags existed have none.
+#define META_FLAG_VALID (0x1ull)
+// The entries of the log have room for signatures.
+#define META_FLAG_SIGNATURES (0x2ull)
+
 // meta header format
 union MetaHeader {
     struct {
-        int64_t head;  // the head index
-        int64_t tail;  // the tail index
-        int64_t ver;   // the latest version number.
+        int64_t head;    // the head index
+        int64_t tail;    // the tail index
+        int64_t ver;     // the latest version number.
+        uint64_t flags;  // META_FLAG_* bits, so the log can be opened before its owner
     } fields;
     uint8_t bytes[META_HEADER_SIZE];
     bool operator==(const MetaHeader& other) {
         return (this->fields.head == other.fields.head) && (this->fields.tail == other.fields.tail)
-               && (this->fields.ver == other.fields.ver);
+               && (this->fields.ver == other.fields.ver) && (this->fields.flags == other.fields.flags);
     };
 };
 
@@ -39,15 +47,25 @@ union MetaHeader {
  * 'PersistLog::signature_size' bytes pointed by 'LogEntry::ofst' are reserved for signature. If
  * 'PersistLog::signature_size' is zero, which means the signature feature is disabled, there is no signature space
  * reserved. This design avoids wasting space for applications without extremely strong security requirement.
+ * When signatures are batched, the 'PersistLog::digest_size' bytes after the signature hold the chain digest of the
+ * entry.
+ *
+ * An entry appended by 'PersistLog::commitIfChanged()' for data identical to that of the previous entry only reserves
+ * the signature and digest space, and 'LogEntry::ref_dist' tells how many entries back the data is stored. The data
+ * accessors resolve such entries transparently. Since the entry holding the data must outlive the entries referring to
+ * it, trimming never removes it while it is referenced. To keep that from pinning the whole history of a field that
+ * never changes, an entry refers at most MAX_REF_DIST entries back; the next unchanged version gets a full copy.
  */
 union LogEntry {
     struct {
         int64_t ver;              // version of the data
-        uint64_t sdlen;           // length of the data plus the signature_size (signature first data second)
+        uint64_t sdlen;           // length of the data plus the signature_size and digest_size (signature, digest, data)
         uint64_t ofst;            // offset of the data (and the signature, if exists) in the memory buffer
         uint64_t hlc_r;           // realtime component of hlc
         uint64_t hlc_l;           // logic component of hlc
         int64_t prev_signed_ver;  // previous signed version, whose signature is included in this version's signature
+        int64_t signed_ver;       // with batched signatures, the version whose digest this version's signature signs
+        uint64_t ref_dist;        // number of entries back to the entry holding the data, 0 if the entry holds its own
     } fields;
     uint8_t bytes[MAX_LOG_ENTRY_SIZE];
 };
@@ -77,8 +95,15 @@ union LogEntry {
 #define NEXT_LOG_ENTRY_PERS LOG_ENTRY_AT( \
         MAX(m_persMetaHeader.fields.tail, m_currMetaHeader.fields.head))
 #define CURR_LOG_IDX ((NUM_USED_SLOTS == 0) ? INVALID_INDEX : m_currMetaHeader.fields.tail - 1)
-#define LOG_ENTRY_DATA(e) ((void*)((uint8_t*)this->m_pData + ((e)->fields.ofst + this->signature_size) % MAX_DATA_SIZE))
+#define LOG_ENTRY_DATA(e) ((void*)((uint8_t*)this->m_pData + ((e)->fields.ofst + this->signature_size + this->digest_size) % MAX_DATA_SIZE))
 #define LOG_ENTRY_SIGNATURE(e) ((void*)((uint8_t*)this->m_pData + ((e)->fields.ofst) % MAX_DATA_SIZE))
+// the entry holding the data of the entry at idx
+#define LOG_DATA_ENTRY_AT(idx) LOG_ENTRY_AT((idx)-LOG_ENTRY_AT(idx)->fields.ref_dist)
+// The most entries back an entry can refer to for its data, so a trim can reclaim all but this many of the entries
+// before the trim point. It is lower in short logs, which would otherwise fill up with entries that cannot be trimmed.
+#define MAX_LOG_REF_DIST (64ull)
+#define MAX_REF_DIST (std::min<uint64_t>(MAX_LOG_REF_DIST, this->m_iMaxLogEntry / 4))
+#define LOG_ENTRY_DIGEST(e) ((void*)((uint8_t*)this->m_pData + ((e)->fields.ofst + this->signature_size) % MAX_DATA_SIZE))
 
 #define NEXT_DATA_OFST ((CURR_LOG_IDX == INVALID_INDEX) ? 0 : (LOG_ENTRY_AT(CURR_LOG_IDX)->fields.ofst + LOG_ENTRY_AT(CURR_LOG_IDX)->fields.sdlen))
 #define NEXT_DATA ((void*)(reinterpret_cast<uint64_t>(this->m_pData) + NEXT_DATA_OFST % MAX_DATA_SIZE))
@@ -127,6 +152,10 @@ protected:
     pthread_rwlock_t m_rwlock;
     // persistent lock
     pthread_mutex_t m_perslock;
+    // data offset of the entry reserved by reserve(), or -1 if there is none
+    int64_t m_iReservedOfst;
+    // data length of the entry reserved by reserve()
+    uint64_t m_iReservedSize;
 
 // lock macro
 #define FPL_WRLOCK                                        \
@@ -186,6 +215,9 @@ public:
     virtual void append(const void* pdata,
                         uint64_t size, version_t ver,
                         const HLC& mhlc) override;
+    virtual char* reserve(uint64_t size) override;
+    virtual void commit(version_t ver, const HLC& mhlc) override;
+    virtual bool commitIfChanged(version_t ver, const HLC& mhlc) override;
     virtual void advanceVersion(int64_t ver) override;
     virtual int64_t getLength() override;
     virtual int64_t getEarliestIndex() override;
@@ -203,6 +235,8 @@ public:
     virtual void processEntryAtVersion(version_t ver, const std::function<void(const void*, std::size_t)>& func);
     virtual void addSignature(version_t ver, const unsigned char* signature, version_t previous_signed_version);
     virtual bool getSignature(version_t ver, unsigned char* signature, version_t& previous_signed_version);
+    virtual void addDigest(version_t ver, const unsigned char* digest, version_t signed_ver);
+    virtual bool getDigest(version_t ver, unsigned char* digest, version_t& signed_ver);
     virtual void trimByIndex(int64_t eno) override;
     virtual void trim(version_t ver) override;
     virtual void trim(const HLC& hlc) override;
@@ -212,6 +246,7 @@ public:
     virtual void post_object(const std::function<void(char const* const, std::size_t)>& f,
                              version_t ver) override;
     virtual void applyLogTail(char const* v) override;
+    virtual void applyLogTail(const std::function<void(char*, std::size_t)>& read_bytes) override;
 
     template <typename TKey, typename KeyGetter>
     void trim(const TKey& key, const KeyGetter& keyGetter) {
@@ -231,7 +266,7 @@ public:
         FPL_WRLOCK;
         idx = binarySearch<TKey>(keyGetter, key, m_currMetaHeader.fields.head, m_currMetaHeader.fields.tail);
         if(idx != INVALID_INDEX) {
-            m_currMetaHeader.fields.head = (idx + 1);
+            m_currMetaHeader.fields.head = do_trim_head(idx + 1);
             FPL_PERS_LOCK;
             try {
                 // What version number should be supplied to persist in this case?
@@ -247,9 +282,8 @@ public:
                 throw e;
             }
             FPL_PERS_UNLOCK;
-            //TODO:remove delete entries from the index. This is tricky because
-            // HLC order and idex order does not agree with each other.
-            // throw PERSIST_EXP_UNIMPLEMENTED;
+            // HLC order and index order do not agree, so this scans the whole index.
+            this->hidx.retain(m_currMetaHeader.fields.head, m_currMetaHeader.fields.tail);
         } else {
             FPL_UNLOCK;
             return;
@@ -282,28 +316,41 @@ private:
      *         that no log entry is available for the requested version.
      */
     int64_t getMinimumIndexBeyondVersion(version_t ver);
+    /**
+     * get the entry whose data must be serialized with the entry at idx
+     * Note: no lock protected, use FPL_RDLOCK
+     * @PARAM idx - index of the log entry
+     * @PARAM first_idx - index of the first log entry serialized
+     * @RETURN the entry holding the data of the entry at idx if it is before
+     *         first_idx, nullptr otherwise.
+     */
+    const LogEntry* inlinedDataEntry(int64_t idx, int64_t first_idx);
     /**
      * get the byte size of log entry
      * Note: no lock protected, use FPL_RDLOCK
      * @PARAM ple - pointer to the log entry
+     * @PARAM pdata_entry - the entry whose data is serialized with it, see inlinedDataEntry()
      * @RETURN the number of bytes required for the serialized data.
      */
-    size_t byteSizeOfLogEntry(const LogEntry* ple);
+    size_t byteSizeOfLogEntry(const LogEntry* ple, const LogEntry* pdata_entry = nullptr);
     /**
      * serialize the log entry to a byte array
      * Note: no lock protected, use FPL_RDLOCK
      * @PARAM ple - the pointer to the log entry
+     * @PARAM pdata_entry - the entry whose data is serialized with it, see inlinedDataEntry()
      * @RETURN the number of bytes written to the byte array
      */
-    size_t writeLogEntryToByteArray(const LogEntry* ple, char* ba);
+    size_t writeLogEntryToByteArray(const LogEntry* ple, char* ba, const LogEntry* pdata_entry = nullptr);
     /**
      * post the log entry to a serialization function accepting a byte array
      * Note: no lock protected, use FPL_RDLOCK
      * @PARAM f - funciton
      * @PARAM ple - pointer to the log entry
+     * @PARAM pdata_entry - the entry whose data is serialized with it, see inlinedDataEntry()
      * @RETURN the number of bytes posted.
      */
-    size_t postLogEntry(const std::function<void(char const* const, std::size_t)>& f, const LogEntry* ple);
+    size_t postLogEntry(const std::function<void(char const* const, std::size_t)>& f, const LogEntry* ple,
+                        const LogEntry* pdata_entry = nullptr);
     /**
      * merge the log entry to current state.
      * Note: no lock protected, use FPL_WRLOCK
@@ -366,6 +413,41 @@ private:
      */
     void do_append_validation(const uint64_t size, const int64_t ver);
 
+    /* Same as do_append_validation, but without the version check, for
+     * reserve() which does not know the version yet.
+     * @param size: size of the data to be append in this log entry
+     */
+    void do_space_validation(const uint64_t size);
+
+    /* Throw PERSIST_EXP_NO_RESERVATION if reserve() has not been called
+     * since the last append or commit. We assume FPL_WRLOCK is acquired.
+     * @param ver: version of the new log entry
+     */
+    void do_reservation_validation(const version_t ver);
+
+    /* Append the reserved data as the next entry. We assume FPL_WRLOCK is
+     * acquired and the reservation is valid.
+     * @param ver: version of the new log entry
+     * @param mhlc: hlc clock of the new log entry
+     */
+    void do_commit(const version_t ver, const HLC& mhlc);
+
+    /* Fill the next log entry for data already in place at NEXT_DATA, and
+     * update the meta header. We assume FPL_WRLOCK is acquired.
+     * @param size: size of the data
+     * @param ver: version of the new log entry
+     * @param mhlc: hlc clock of the new log entry
+     * @param ref_dist: how many entries back the data is, if it is not at NEXT_DATA
+     */
+    void do_append_entry(const uint64_t size, const version_t ver, const HLC& mhlc, const uint64_t ref_dist = 0);
+
+    /* The index of the first entry to keep when trimming the entries before
+     * idx, which is idx unless the entry at idx refers to the data of an
+     * earlier entry. We assume FPL_WRLOCK is acquired.
+     * @param idx: the index of the first entry the caller wants to keep
+     */
+    int64_t do_trim_head(const int64_t idx);
+
 #ifndef NDEBUG
     //dbg functions
     void dbgDumpMeta() {
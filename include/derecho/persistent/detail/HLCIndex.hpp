@@ -0,0 +1,121 @@
+#ifndef HLC_INDEX_HPP
+#define HLC_INDEX_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace persistent {
+
+// index entry for the hlc index
+struct hlc_index_entry {
+    uint64_t rtc_us;
+    uint64_t logic;
+    int64_t log_idx;
+};
+
+/**
+ * HLCIndex maps the HLC timestamps of the entries in a log to their log
+ * indexes. It is a sorted array of packed (rtc_us, logic, log_idx) tuples of
+ * 24 bytes each, which replaces a std::set of HLC objects that cost about four
+ * times as much per entry. The array lives in an anonymous mapping reserved for
+ * the maximum number of log entries up front, so it never moves and only the
+ * pages that hold entries count towards the resident memory.
+ *
+ * Writers must be serialized by the owner of the index (FilePersistLog calls
+ * the modifiers with its write lock held). Lookups take no lock: an entry
+ * whose timestamp is not smaller than the last one is appended and published
+ * by the release store to the size, and the rarer updates that move existing
+ * entries (out-of-order timestamps, trimming and truncation) run inside a
+ * sequence lock that makes concurrent lookups retry.
+ *
+ * As with the std::set it replaces, an entry whose timestamp equals the
+ * timestamp of an entry already in the index is not added.
+ */
+class HLCIndex {
+    struct Slot {
+        std::atomic<uint64_t> rtc_us;
+        std::atomic<uint64_t> logic;
+        std::atomic<int64_t> log_idx;
+    };
+    // the reserved array of entries
+    Slot* m_pSlots;
+    // the number of entries the array can hold
+    std::size_t m_iCapacity;
+    // the number of entries in use, published with release semantics
+    std::atomic<std::size_t> m_iSize;
+    // sequence lock; odd while entries are being moved
+    std::atomic<uint64_t> m_iSeq;
+
+    static bool less(uint64_t r1, uint64_t l1, uint64_t r2, uint64_t l2) {
+        return r1 < r2 || (r1 == r2 && l1 < l2);
+    }
+    // the position of the first entry later than (rtc_us, logic) among the first n entries
+    std::size_t upper_bound(uint64_t rtc_us, uint64_t logic, std::size_t n) const;
+    void store(std::size_t pos, uint64_t rtc_us, uint64_t logic, int64_t log_idx);
+    void begin_write();
+    void end_write();
+    // give the pages past the first n entries back to the OS
+    void release_pages_after(std::size_t n);
+
+public:
+    HLCIndex() noexcept(true);
+    virtual ~HLCIndex() noexcept(true);
+    HLCIndex(const HLCIndex&) = delete;
+    HLCIndex& operator=(const HLCIndex&) = delete;
+
+    /**
+     * Reserve room for a number of entries. This must be called before the
+     * first insertion.
+     * @param capacity The maximum number of entries, i.e. the maximum number
+     *        of entries in the log.
+     */
+    void reserve(std::size_t capacity);
+
+    /**
+     * Add an entry. Called by the writer only.
+     * @return false if an entry with the same timestamp is already indexed.
+     * @throw PERSIST_EXP_NOSPACE_LOG if the index is full.
+     */
+    bool insert(uint64_t rtc_us, uint64_t logic, int64_t log_idx);
+
+    /**
+     * Drop the entries whose log index is outside [min_idx, max_idx), which
+     * have been trimmed or truncated from the log. Called by the writer only.
+     */
+    void retain(int64_t min_idx, int64_t max_idx);
+
+    /**
+     * Replace the content of the index, e.g. with the entries of a log loaded
+     * from disk. Called by the writer only.
+     * @param entries The entries in log order; they are sorted here if their
+     *        timestamps are not monotonic.
+     */
+    void rebuild(std::vector<hlc_index_entry>& entries);
+
+    /**
+     * Find the latest entry at or before a timestamp. Safe to call
+     * concurrently with the writer.
+     * @return the log index of the entry, or INVALID_INDEX if all entries are
+     *         later than the timestamp.
+     */
+    int64_t lookup(uint64_t rtc_us, uint64_t logic) const;
+
+    /** @return the number of entries. */
+    std::size_t size() const {
+        return m_iSize.load(std::memory_order_acquire);
+    }
+
+    /** @return the number of bytes used by the entries. */
+    std::size_t getMemoryUsage() const {
+        return size() * sizeof(Slot);
+    }
+
+    /** @return a copy of the entries in timestamp order. */
+    std::vector<hlc_index_entry> snapshot() const;
+};
+
+}  // namespace persistent
+
+#endif  // HLC_INDEX_HPP
@@ -0,0 +1,113 @@
+#ifndef LOG_PRELOADER_HPP
+#define LOG_PRELOADER_HPP
+
+#include "PersistLog.hpp"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace persistent {
+
+class PersistentRegistry;
+
+/**
+ * LogPreloader opens the existing file-based logs of a node before the objects
+ * that own them are constructed. Loading a log reads its meta header and
+ * rebuilds its HLC index from every entry, and the Persistent<T> constructor
+ * does it one field at a time while the Group constructs its Replicated<T>
+ * objects. preload() does it for every log of the given subgroup shards on a
+ * pool of PERS/load_threads threads, and also faults in the data of the latest
+ * entry of each log, which is what the constructor deserializes the object
+ * from. The Persistent<T> constructor then takes its log from the preloader
+ * instead of loading it again. A log is preloaded with the signature setting
+ * recorded in its meta header by the Persistent<T> that wrote it.
+ *
+ * Deserializing the latest state of an object, and replaying its deltas, can
+ * take longer than loading its log, and only the Persistent<T> constructor
+ * knows the type to deserialize. While deferRestores(true) is in effect, a
+ * Persistent<T> constructed with a PersistentRegistry takes its log but leaves
+ * its state to finishRestores(), which restores every such object on the same
+ * thread pool; an object read before that is restored on the spot.
+ *
+ * All the members are static, since a log is claimed by name from within the
+ * user's object factories.
+ */
+class LogPreloader {
+public:
+    /** The result of loading one log. */
+    struct LoadReport {
+        std::string name;
+        // the number of entries in the log
+        int64_t num_entries;
+        double load_ms;
+    };
+
+    /**
+     * Load, on a thread pool, every log in the persistent file path whose name
+     * starts with one of the given prefixes, and keep them until they are
+     * claimed by take(). Logs that fail to load are skipped; their owners will
+     * load them again and get the error.
+     * @param prefixes The subgroup prefixes (see PersistentRegistry::generate_prefix)
+     * of the logs to load. Logs whose meta header does not record their
+     * signature setting, because they were last written by an older version,
+     * are left to their owners.
+     * @return the number of logs loaded
+     */
+    static std::size_t preload(const std::vector<std::string>& prefixes);
+
+    /**
+     * Claim a log loaded by preload().
+     * @return the log, or nullptr if it was not preloaded or it was preloaded
+     * with a different signature setting.
+     */
+    static std::unique_ptr<PersistLog> take(const std::string& name, bool enable_signatures);
+
+    /** Drop the preloaded logs that were not claimed. */
+    static void clear();
+
+    /** @return the reports of the logs loaded by the last call to preload(). */
+    static std::vector<LoadReport> getLoadReports();
+
+    /**
+     * Start or stop deferring the restore of the Persistent<T> objects
+     * constructed with a PersistentRegistry to finishRestores().
+     */
+    static void deferRestores(bool defer);
+
+    static bool isDeferringRestores();
+
+    /**
+     * Record that the Persistent<T> registered in registry under name has not
+     * restored its state yet; called by its constructor.
+     */
+    static void addDeferredRestore(PersistentRegistry* registry, const std::string& name);
+
+    /** Forget a deferred restore; called when the Persistent<T> is destroyed first. */
+    static void cancelDeferredRestore(PersistentRegistry* registry, const std::string& name);
+
+    /**
+     * Restore the state of every Persistent<T> recorded by addDeferredRestore()
+     * on a pool of PERS/load_threads threads. If any of them fails, the first
+     * exception is rethrown once the others are done.
+     */
+    static void finishRestores();
+
+private:
+    struct PreloadedLog {
+        bool enable_signatures;
+        std::unique_ptr<PersistLog> log;
+    };
+    static std::mutex preloaded_logs_mutex;
+    static std::map<std::string, PreloadedLog> preloaded_logs;
+    static std::vector<LoadReport> load_reports;
+    static std::atomic<bool> deferring_restores;
+    static std::vector<std::pair<PersistentRegistry*, std::string>> deferred_restores;
+};
+
+}  // namespace persistent
+
+#endif  //LOG_PRELOADER_HPP
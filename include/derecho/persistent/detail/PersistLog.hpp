@@ -8,6 +8,7 @@
 #include "../HLC.hpp"
 #include "../PersistException.hpp"
 #include "../PersistentInterface.hpp"
+#include "HLCIndex.hpp"
 #include <functional>
 #include <inttypes.h>
 #include <map>
@@ -26,31 +27,13 @@ enum StorageType {
 
 constexpr version_t INVALID_VERSION = -1L;
 constexpr int64_t INVALID_INDEX = INT64_MAX;
-
-// index entry for the hlc index
-struct hlc_index_entry {
-    HLC hlc;
-    int64_t log_idx;
-    //default constructor
-    hlc_index_entry() : log_idx(-1) {
-    }
-    // constructor with hlc and index.
-    hlc_index_entry(const HLC& _hlc, const int64_t& _log_idx) : hlc(_hlc), log_idx(_log_idx) {
-    }
-    // constructor with time stamp and index.
-    hlc_index_entry(const uint64_t& r, const uint64_t& l, const int64_t& _log_idx) : hlc(r, l), log_idx(_log_idx) {
-    }
-    //copy constructor
-    hlc_index_entry(const struct hlc_index_entry& _entry) : hlc(_entry.hlc), log_idx(_entry.log_idx) {
-    }
-};
-// comparator for the hlc index
-struct hlc_index_entry_comp {
-    bool operator()(const struct hlc_index_entry& e1,
-                    const struct hlc_index_entry& e2) const {
-        return e1.hlc < e2.hlc;
-    }
-};
+/**
+ * Passed as the version to bytes_size(), to_bytes() or post_object() of a log,
+ * it serializes an empty log tail that has no latest version either, so that
+ * applying it leaves the log as it is. This is used when the log tail is sent
+ * separately, as in state transfer.
+ */
+constexpr version_t LOG_TAIL_OMITTED = INT64_MAX;
 
 /**
  * Persistent log interface.
@@ -66,8 +49,14 @@ public:
      * on the configured private key. It is 0 if signatures are disabled.
      */
     const uint32_t signature_size;
+    /**
+     * The size, in bytes, of the chain digest kept next to the signature of
+     * each entry when signatures are batched (PERS/batch_signatures). It is 0
+     * if signatures are disabled or not batched.
+     */
+    const uint32_t digest_size;
     // HLCIndex
-    std::set<hlc_index_entry, hlc_index_entry_comp> hidx;
+    HLCIndex hidx;
 #ifndef NDEBUG
     void dump_hidx();
 #endif  //NDEBUG
@@ -97,6 +86,42 @@ public:
                         const HLC& mhlc)
             = 0;
 
+    /**
+     * Reserve space for the data of the next entry, so that it can be
+     * serialized directly into the log instead of being copied by append().
+     * The entry is not part of the log until commit() is called, and a second
+     * call to reserve() before commit() discards the first reservation. Like
+     * append(), this must only be called by the writer of the log.
+     * @param size - length of the data
+     * @return a pointer to 'size' contiguous bytes for the data
+     * @throw PERSIST_EXP_NOSPACE_LOG or PERSIST_EXP_NOSPACE_DATA if the log is full.
+     */
+    virtual char* reserve(uint64_t size) = 0;
+
+    /**
+     * Append the entry whose data has been written to the space returned by
+     * the last call to reserve().
+     * @param ver - version of the data, as in append()
+     * @param mhlc - the hlc clock of the data, as in append()
+     * @throw PERSIST_EXP_NO_RESERVATION if there is no reservation.
+     */
+    virtual void commit(version_t ver, const HLC& mhlc) = 0;
+
+    /**
+     * Like commit(), but if the reserved data is identical to the data of the
+     * latest entry, append an entry that refers to that data instead of
+     * holding a copy. Such an entry takes no data space except for its
+     * signature, and getEntry(), getEntryByIndex() and processEntryAtVersion()
+     * return the data it refers to, so readers and signatures see the same
+     * bytes as if the copy had been logged.
+     * @param ver - version of the data, as in append()
+     * @param mhlc - the hlc clock of the data, as in append()
+     * @return true if the data was logged, false if the entry refers to the
+     *         data of the latest entry.
+     * @throw PERSIST_EXP_NO_RESERVATION if there is no reservation.
+     */
+    virtual bool commitIfChanged(version_t ver, const HLC& mhlc) = 0;
+
     /**
      * Advance the version number without appendding a log. This is useful
      * to create gap between versions.
@@ -146,6 +171,33 @@ public:
     // Get a version specified by hlc
     virtual const void* getEntry(const HLC& hlc) = 0;
 
+    /**
+     * Marks the start of a read through the pointers returned by
+     * getEntryByIndex() and getEntry(), which must be called before them and
+     * followed by endRead() once they are no longer used. A log that unmaps
+     * the memory of its entries, like SegmentedPersistLog, keeps what it
+     * unmaps in the meantime mapped until then. Does nothing by default.
+     */
+    virtual void beginRead() {}
+
+    /** Marks the end of a read started with beginRead(). */
+    virtual void endRead() {}
+
+    /** Calls beginRead() on a log when constructed, and endRead() when destroyed. */
+    class ReadGuard {
+        PersistLog& log;
+
+    public:
+        explicit ReadGuard(PersistLog& log) : log(log) {
+            log.beginRead();
+        }
+        ~ReadGuard() {
+            log.endRead();
+        }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    };
+
     /**
      * process the entry at exactly version @ver
      * if such a version does not exist, nothing will happen.
@@ -189,6 +241,32 @@ public:
     virtual bool getSignature(version_t ver, unsigned char* signature,
                               version_t& prev_signed_ver) = 0;
 
+    /**
+     * Add a chain digest to a specific version; does nothing if signatures are
+     * not batched.
+     * @param ver - version
+     * @param digest - the digest of the log up to this version, digest_size bytes
+     * @param signed_ver - the version whose digest is signed by the signature
+     * stored in this version, i.e. the last version of its batch
+     */
+    virtual void addDigest(version_t ver, const unsigned char* digest,
+                           version_t signed_ver) = 0;
+
+    /**
+     * Retrieve the chain digest of a specified version, assuming signatures
+     * are batched.
+     * @param ver - version
+     * @param digest - A byte buffer into which the digest will be copied. Must
+     * be at least digest_size bytes.
+     * @param signed_ver - A variable which will be updated to equal the version
+     * whose digest is signed by the signature stored in this version
+     * @return true if a digest was successfully retrieved, false if there was
+     * no version in the log with the requested version number or signatures
+     * are not batched.
+     */
+    virtual bool getDigest(version_t ver, unsigned char* digest,
+                           version_t& signed_ver) = 0;
+
     /**
      * Trim the log till entry number eno, inclusively.
      * For exmaple, there is a log: [7,8,9,4,5,6]. After trim(3), it becomes [5,6]
@@ -234,12 +312,21 @@ public:
             = 0;
 
     /**
-     * Check/Merge the LogTail to the existing log.
+     * Check/Merge the LogTail to the existing log. A log tail whose latest
+     * version is INVALID_VERSION does not change the latest version of the log.
      * @PARAM dsm - deserialization manager
      * @PARAM v - serialized log bytes to be apllied
      */
     virtual void applyLogTail(char const* v) = 0;
 
+    /**
+     * Check/Merge a LogTail that is read from a stream, one entry at a time,
+     * so only the entry being merged is held in memory.
+     * @PARAM read_bytes - a function that fills its buffer argument with the
+     *   requested number of bytes of the serialized log tail
+     */
+    virtual void applyLogTail(const std::function<void(char*, std::size_t)>& read_bytes) = 0;
+
     /**
      * Truncate the log strictly newer than 'ver'.
      * @param ver - all log entry strictly after ver will be truncated.
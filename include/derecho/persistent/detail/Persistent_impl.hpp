@@ -80,7 +80,16 @@ inline void Persistent<ObjectType, storageType>::initialize_log(const char* obje
     switch(storageType) {
         // file system
         case ST_FILE:
-            this->m_pLog = std::make_unique<FilePersistLog>(object_name, enable_signatures);
+            // the log may have been loaded already, along with the other logs of the node
+            this->m_pLog = LogPreloader::take(object_name, enable_signatures);
+            if(this->m_pLog != nullptr) {
+                break;
+            }
+            if(derecho::getConfUInt64(CONF_PERS_SEGMENT_SIZE) > 0) {
+                this->m_pLog = std::make_unique<SegmentedPersistLog>(object_name, enable_signatures);
+            } else {
+                this->m_pLog = std::make_unique<FilePersistLog>(object_name, enable_signatures);
+            }
             if(this->m_pLog == nullptr) {
                 throw PERSIST_EXP_NEW_FAILED_UNKNOWN;
             }
@@ -98,6 +107,17 @@ inline void Persistent<ObjectType, storageType>::initialize_log(const char* obje
         default:
             throw PERSIST_EXP_STORAGE_TYPE_UNKNOWN(storageType);
     }
+    // STEP 2: initialize checkpoint store for delta objects
+    if constexpr(std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value) {
+        this->m_iCheckpointInterval = derecho::getConfUInt64(CONF_PERS_DELTA_CHECKPOINT_INTERVAL);
+        this->m_iCheckpointBytes = derecho::getConfUInt64(CONF_PERS_DELTA_CHECKPOINT_BYTES);
+        if(this->m_iCheckpointInterval > 0 || this->m_iCheckpointBytes > 0) {
+            this->m_pCheckpoints = std::make_unique<FileCheckpointStore>(
+                    object_name, (storageType == ST_MEM) ? getPersRamdiskPath() : getPersFilePath());
+        }
+    } else {
+        this->m_bDirtyTracking = derecho::getConfBoolean(CONF_PERS_DIRTY_TRACKING);
+    }
 }
 
 template <typename ObjectType,
@@ -112,6 +132,29 @@ inline void Persistent<ObjectType, storageType>::initialize_object_from_log(cons
     }
 }
 
+template <typename ObjectType,
+          StorageType storageType>
+inline void Persistent<ObjectType, storageType>::initialize_registry_signatures() {
+    version_t latest_version = getLatestVersion();
+    std::unique_ptr<unsigned char[]> latest_signature;
+    if(latest_version != INVALID_VERSION) {
+        version_t prev_ver;  //Unused out-parameter
+        latest_signature = std::make_unique<unsigned char[]>(this->m_pLog->signature_size);
+        getSignature(latest_version, latest_signature.get(), prev_ver);
+    }
+    this->m_pRegistry->initializeLastSignature(latest_version, latest_signature.get(), this->m_pLog->signature_size);
+    if(this->m_pLog->digest_size > 0) {
+        // Batched signatures continue the digest chain rather than the signature chain
+        std::unique_ptr<unsigned char[]> latest_digest = std::make_unique<unsigned char[]>(this->m_pLog->digest_size);
+        memset(latest_digest.get(), 0, this->m_pLog->digest_size);
+        if(latest_version != INVALID_VERSION) {
+            version_t signed_ver;  //Unused out-parameter
+            getDigest(latest_version, latest_digest.get(), signed_ver);
+        }
+        this->m_pRegistry->initializeLastDigest(latest_version, latest_digest.get(), this->m_pLog->digest_size);
+    }
+}
+
 template <typename ObjectType,
           StorageType storageType>
 Persistent<ObjectType, storageType>::Persistent(
@@ -127,19 +170,21 @@ Persistent<ObjectType, storageType>::Persistent(
                            : object_name,
                    enable_signatures);
     // Initialize object
-    initialize_object_from_log(object_factory, &dm);
+    if(persistent_registry && LogPreloader::isDeferringRestores() && this->getNumOfVersions() > 0) {
+        // the objects of all the shards of a Group are restored together
+        m_bRestorePending = true;
+        m_restoreContexts = dm.registered_v;
+    } else {
+        initialize_object_from_log(object_factory, &dm);
+    }
     if(persistent_registry) {
         // Register with PersistentRegistry
         persistent_registry->registerPersistent(this->m_pLog->m_sName, this);
-        // Set up PersistentRegistry's last signed version
-        version_t latest_version = getLatestVersion();
-        std::unique_ptr<unsigned char[]> latest_signature;
-        if(latest_version != INVALID_VERSION) {
-            version_t prev_ver;  //Unused out-parameter
-            latest_signature = std::make_unique<unsigned char[]>(this->m_pLog->signature_size);
-            getSignature(latest_version, latest_signature.get(), prev_ver);
+        if(m_bRestorePending) {
+            LogPreloader::addDeferredRestore(persistent_registry, this->m_pLog->m_sName);
         }
-        persistent_registry->initializeLastSignature(latest_version, latest_signature.get(), this->m_pLog->signature_size);
+        // Set up PersistentRegistry's last signed version
+        initialize_registry_signatures();
     }
 }
 
@@ -149,6 +194,14 @@ Persistent<ObjectType, storageType>::Persistent(Persistent&& other) {
     this->m_pWrappedObject = std::move(other.m_pWrappedObject);
     this->m_pLog = std::move(other.m_pLog);
     this->m_pRegistry = other.m_pRegistry;
+    this->m_pCheckpoints = std::move(other.m_pCheckpoints);
+    this->m_iCheckpointInterval = other.m_iCheckpointInterval;
+    this->m_iCheckpointBytes = other.m_iCheckpointBytes;
+    this->m_iDeltasSinceCheckpoint = other.m_iDeltasSinceCheckpoint;
+    this->m_iDeltaBytesSinceCheckpoint = other.m_iDeltaBytesSinceCheckpoint;
+    this->m_bDirtyTracking = other.m_bDirtyTracking;
+    this->m_bRestorePending = other.m_bRestorePending.exchange(false);
+    this->m_restoreContexts = std::move(other.m_restoreContexts);
     if(this->m_pRegistry != nullptr) {
         // this will override the previous registry entry
         this->m_pRegistry->registerPersistent(this->m_pLog->m_sName, this);
@@ -177,6 +230,8 @@ Persistent<ObjectType, storageType>::Persistent(
     // Register with PersistentRegistry
     if(this->m_pRegistry) {
         this->m_pRegistry->registerPersistent(this->m_pLog->m_sName, this);
+        // Continue the signature (or digest) chain from the received log
+        initialize_registry_signatures();
     }
 }
 
@@ -192,31 +247,56 @@ Persistent<ObjectType, storageType>::~Persistent() noexcept(true) {
     // unregister the version creator and persist callback,
     // if the Persistent<T> is added to the pool dynamically.
     if(m_pRegistry && m_pLog) {
+        if(m_bRestorePending) {
+            LogPreloader::cancelDeferredRestore(m_pRegistry, m_pLog->m_sName);
+        }
         m_pRegistry->unregisterPersistent(m_pLog->m_sName);
     }
 };
 
+template <typename ObjectType,
+          StorageType storageType>
+void Persistent<ObjectType, storageType>::finishRestore() {
+    if(!m_bRestorePending) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_restoreMutex);
+    // another thread may have restored the object while this one waited
+    if(!m_bRestorePending) {
+        return;
+    }
+    mutils::DeserializationManager dm(m_restoreContexts);
+    this->m_pWrappedObject = this->getByIndex(this->getLatestIndex(), &dm);
+    m_bRestorePending = false;
+}
+
 template <typename ObjectType,
           StorageType storageType>
 ObjectType& Persistent<ObjectType, storageType>::operator*() {
+    finishRestore();
     return *this->m_pWrappedObject;
 }
 
 template <typename ObjectType,
           StorageType storageType>
 const ObjectType& Persistent<ObjectType, storageType>::operator*() const {
+    // a deferred restore is not a visible change of the object, and
+    // finishRestore() is synchronized
+    const_cast<Persistent*>(this)->finishRestore();
     return *this->m_pWrappedObject;
 }
 
 template <typename ObjectType,
           StorageType storageType>
 ObjectType* Persistent<ObjectType, storageType>::operator->() {
+    finishRestore();
     return this->m_pWrappedObject.get();
 }
 
 template <typename ObjectType,
           StorageType storageType>
 const ObjectType& Persistent<ObjectType, storageType>::getConstRef() const {
+    const_cast<Persistent*>(this)->finishRestore();
     return *this->m_pWrappedObject;
 }
 
@@ -236,6 +316,8 @@ auto Persistent<ObjectType, storageType>::getByIndex(
     if constexpr(std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value) {
         return fun(*this->getByIndex(idx, dm));
     } else {
+        // the entry is read in place, so the log must keep it mapped until fun returns
+        PersistLog::ReadGuard read_guard(*this->m_pLog);
         // return mutils::deserialize_and_run<ObjectType>(dm, (char*)this->m_pLog->getEntryByIndex(idx), fun);
         return mutils::deserialize_and_run(dm, (char*)this->m_pLog->getEntryByIndex(idx), fun);
     }
@@ -246,6 +328,7 @@ template <typename ObjectType,
 template <typename DeltaType, typename Func>
 std::enable_if_t<std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value, std::result_of_t<Func(const DeltaType&)>>
 Persistent<ObjectType, storageType>::getDeltaByIndex(int64_t idx, const Func& fun, mutils::DeserializationManager* dm) const {
+    PersistLog::ReadGuard read_guard(*this->m_pLog);
     return mutils::deserialize_and_run(dm, (char*)this->m_pLog->getEntryByIndex(idx), fun);
 }
 
@@ -255,16 +338,41 @@ std::unique_ptr<ObjectType> Persistent<ObjectType, storageType>::getByIndex(
         int64_t idx,
         mutils::DeserializationManager* dm) const {
     if constexpr(std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value) {
-        // ObjectType* ot = new ObjectType{};
-        std::unique_ptr<ObjectType> p = ObjectType::create(dm);
-        // TODO: accelerate this by checkpointing
-        for(int64_t i = this->m_pLog->getEarliestIndex(); i <= idx; i++) {
+        std::unique_ptr<ObjectType> p;
+        int64_t start_idx = this->m_pLog->getEarliestIndex();
+        // start from the nearest checkpoint at or below idx, if there is one.
+        // The one just before the earliest entry is still usable after a trim.
+        if(this->m_pCheckpoints != nullptr) {
+            std::vector<char> ckpt;
+            const version_t earliest_ver = this->m_pLog->getEarliestVersion();
+            int64_t ckpt_idx = this->m_pCheckpoints->load(
+                    start_idx - 1, idx,
+                    [this, start_idx, earliest_ver](int64_t candidate_idx, version_t candidate_ver) {
+                        if(candidate_idx < start_idx) {
+                            return candidate_ver < earliest_ver;
+                        }
+                        return this->m_pLog->getVersionIndex(candidate_ver, true) == candidate_idx;
+                    },
+                    ckpt);
+            if(ckpt_idx != INVALID_INDEX) {
+                dbg_default_trace("{0} getByIndex({1}) starts from the checkpoint at index {2}.",
+                                  this->m_pLog->m_sName, idx, ckpt_idx);
+                p = mutils::from_bytes<ObjectType>(dm, ckpt.data());
+                start_idx = ckpt_idx + 1;
+            }
+        }
+        if(p == nullptr) {
+            p = ObjectType::create(dm);
+        }
+        PersistLog::ReadGuard read_guard(*this->m_pLog);
+        for(int64_t i = start_idx; i <= idx; i++) {
             const char* entry_data = (const char*)this->m_pLog->getEntryByIndex(i);
             p->applyDelta(entry_data);
         }
 
         return p;
     } else {
+        PersistLog::ReadGuard read_guard(*this->m_pLog);
         return mutils::from_bytes<ObjectType>(dm, (const char*)this->m_pLog->getEntryByIndex(idx));
     }
 }
@@ -275,6 +383,7 @@ template <typename DeltaType>
 std::enable_if_t<std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value, std::unique_ptr<DeltaType>> Persistent<ObjectType, storageType>::getDeltaByIndex(
         int64_t idx,
         mutils::DeserializationManager* dm) const {
+    PersistLog::ReadGuard read_guard(*this->m_pLog);
     return mutils::from_bytes<DeltaType>(dm, (char const*)this->m_pLog->getEntryByIndex(idx));
 }
 
@@ -285,6 +394,7 @@ auto Persistent<ObjectType, storageType>::get(
         version_t ver,
         const Func& fun,
         mutils::DeserializationManager* dm) const {
+    PersistLog::ReadGuard read_guard(*this->m_pLog);
     char* pdat = (char*)this->m_pLog->getEntry(ver);
     if(pdat == nullptr) {
         throw PERSIST_EXP_INV_VERSION;
@@ -302,6 +412,7 @@ template <typename ObjectType,
 template <typename DeltaType, typename Func>
 std::enable_if_t<std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value, std::result_of_t<Func(const DeltaType&)>>
 Persistent<ObjectType, storageType>::getDelta(const version_t ver, const Func& fun, mutils::DeserializationManager* dm) const {
+    PersistLog::ReadGuard read_guard(*this->m_pLog);
     char* pdat = (char*)this->m_pLog->getEntry(ver, true);
     if(pdat == nullptr) {
         throw PERSIST_EXP_INV_VERSION;
@@ -322,6 +433,7 @@ std::unique_ptr<ObjectType> Persistent<ObjectType, storageType>::get(
     if constexpr(std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value) {
         return getByIndex(idx, dm);
     } else {
+        PersistLog::ReadGuard read_guard(*this->m_pLog);
         return mutils::from_bytes<ObjectType>(dm, (const char*)this->m_pLog->getEntryByIndex(idx));
     }
 }
@@ -337,6 +449,7 @@ std::enable_if_t<std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value,
         throw PERSIST_EXP_INV_VERSION;
     }
 
+    PersistLog::ReadGuard read_guard(*this->m_pLog);
     return mutils::from_bytes<DeltaType>(dm, (const char*)this->m_pLog->getEntryByIndex(idx));
 }
 
@@ -353,14 +466,46 @@ template <typename ObjectType,
 void Persistent<ObjectType, storageType>::trim(version_t ver) {
     dbg_default_trace("trim.");
     this->m_pLog->trim(ver);
+    if(this->m_pCheckpoints != nullptr) {
+        // Keeps the checkpoint replay starts from. INVALID_INDEX is larger
+        // than any index, so an empty log keeps only the latest checkpoint.
+        this->m_pCheckpoints->trim(this->m_pLog->getEarliestIndex());
+    }
     dbg_default_trace("trim...done");
 }
 
+template <typename ObjectType,
+          StorageType storageType>
+std::size_t Persistent<ObjectType, storageType>::logTailSize(version_t ver) const {
+    return this->m_pLog->bytes_size(ver);
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+void Persistent<ObjectType, storageType>::postLogTail(const std::function<void(char const* const, std::size_t)>& f,
+                                                      version_t ver) const {
+    this->m_pLog->post_object(f, ver);
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+void Persistent<ObjectType, storageType>::applyLogTail(const std::function<void(char*, std::size_t)>& read_bytes) {
+    this->m_pLog->applyLogTail(read_bytes);
+    if(this->m_pRegistry) {
+        // Continue the signature (or digest) chain from the merged log
+        initialize_registry_signatures();
+    }
+}
+
 template <typename ObjectType,
           StorageType storageType>
 void Persistent<ObjectType, storageType>::truncate(const version_t ver) {
     dbg_default_trace("truncate.");
     this->m_pLog->truncate(ver);
+    if(this->m_pCheckpoints != nullptr) {
+        int64_t latest_idx = this->m_pLog->getLatestIndex();
+        this->m_pCheckpoints->truncate((latest_idx == INVALID_INDEX) ? -1 : latest_idx);
+    }
     dbg_default_trace("truncate...done");
 }
 
@@ -383,6 +528,7 @@ auto Persistent<ObjectType, storageType>::get(
         }
         return getByIndex(idx, fun, dm);
     } else {
+        PersistLog::ReadGuard read_guard(*this->m_pLog);
         char* pdat = (char*)this->m_pLog->getEntry(hlc);
         if(pdat == nullptr) {
             throw PERSIST_EXP_INV_HLC;
@@ -407,6 +553,7 @@ std::unique_ptr<ObjectType> Persistent<ObjectType, storageType>::get(
         }
         return getByIndex(idx, dm);
     } else {
+        PersistLog::ReadGuard read_guard(*this->m_pLog);
         char const* pdat = (char const*)this->m_pLog->getEntry(hlc);
         if(pdat == nullptr) {
             throw PERSIST_EXP_INV_HLC;
@@ -462,24 +609,60 @@ template <typename ObjectType,
 void Persistent<ObjectType, storageType>::set(ObjectType& v, version_t ver, const HLC& mhlc) {
     dbg_default_trace("append to log with ver({}),hlc({},{})", ver, mhlc.m_rtc_us, mhlc.m_logic);
     if constexpr(std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value) {
+        uint64_t delta_size = 0;
         v.finalizeCurrentDelta([&](char const* const buf, size_t len) {
             this->m_pLog->append((const void* const)buf, len, ver, mhlc);
+            delta_size = len;
         });
+        // Only the wrapped object is guaranteed to have the state of the log.
+        if(this->m_pCheckpoints != nullptr && &v == this->m_pWrappedObject.get()) {
+            maybeCheckpoint(delta_size, ver);
+        }
     } else {
-        // ObjectType does not support Delta, logging the whole current state.
+        // ObjectType does not support Delta, logging the whole current state,
+        // which is serialized in place in the log.
         auto size = mutils::bytes_size(v);
-        char* buf = new char[size];
-        bzero(buf, size);
-        mutils::to_bytes(v, buf);
-        this->m_pLog->append((void*)buf, size, ver, mhlc);
-        delete[] buf;
+        char* buf = this->m_pLog->reserve(size);
+        auto written = mutils::to_bytes(v, buf);
+        if(written < size) {
+            // the space may hold stale data, which would end up in the signature
+            bzero(buf + written, size - written);
+        }
+        if(this->m_bDirtyTracking) {
+            // an unchanged state only records a reference to the latest entry
+            this->m_pLog->commitIfChanged(ver, mhlc);
+        } else {
+            this->m_pLog->commit(ver, mhlc);
+        }
     }
 }
 
+template <typename ObjectType,
+          StorageType storageType>
+void Persistent<ObjectType, storageType>::maybeCheckpoint(uint64_t delta_size, version_t ver) {
+    this->m_iDeltasSinceCheckpoint++;
+    this->m_iDeltaBytesSinceCheckpoint += delta_size;
+    if(!((this->m_iCheckpointInterval > 0 && this->m_iDeltasSinceCheckpoint >= this->m_iCheckpointInterval)
+         || (this->m_iCheckpointBytes > 0 && this->m_iDeltaBytesSinceCheckpoint >= this->m_iCheckpointBytes))) {
+        return;
+    }
+    int64_t idx = this->m_pLog->getLatestIndex();
+    if(idx == INVALID_INDEX || this->m_pLog->getLatestVersion() != ver) {
+        // nothing was logged for this version.
+        return;
+    }
+    const ObjectType& obj = *this->m_pWrappedObject;
+    this->m_pCheckpoints->write(idx, ver, mutils::bytes_size(obj),
+                                [&obj](char* buf) { mutils::to_bytes(obj, buf); });
+    this->m_iDeltasSinceCheckpoint = 0;
+    this->m_iDeltaBytesSinceCheckpoint = 0;
+}
+
 template <typename ObjectType,
           StorageType storageType>
 void Persistent<ObjectType, storageType>::version(version_t ver, const HLC& mhlc) {
     dbg_default_trace("In Persistent<T>: make version (ver={}, hlc={}us.{})", ver, mhlc.m_rtc_us, mhlc.m_logic);
+    finishRestore();
     this->set(*this->m_pWrappedObject, ver, mhlc);
 }
 
@@ -504,6 +687,7 @@ template <typename ObjectType,
           StorageType storageType>
 void Persistent<ObjectType, storageType>::version(const version_t ver) {
     dbg_default_trace("In Persistent<T>: make version {}.", ver);
+    finishRestore();
     this->set(*this->m_pWrappedObject, ver);
 }
 
@@ -538,6 +722,37 @@ std::size_t Persistent<ObjectType, storageType>::getSignatureSize() const {
     return this->m_pLog->signature_size;
 }
 
+template <typename ObjectType,
+          StorageType storageType>
+std::size_t Persistent<ObjectType, storageType>::updateHash(version_t ver, openssl::Hasher& hasher) {
+    std::size_t bytes_added = 0;
+    this->m_pLog->processEntryAtVersion(ver, [&hasher, &bytes_added](const void* data, std::size_t size) {
+        if(size > 0) {
+            hasher.add_bytes(data, size);
+        }
+        bytes_added = size;
+    });
+    return bytes_added;
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+void Persistent<ObjectType, storageType>::addDigest(version_t ver, const unsigned char* digest, version_t signed_ver) {
+    this->m_pLog->addDigest(ver, digest, signed_ver);
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+bool Persistent<ObjectType, storageType>::getDigest(version_t ver, unsigned char* digest, version_t& signed_ver) const {
+    return this->m_pLog->getDigest(ver, digest, signed_ver);
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+std::size_t Persistent<ObjectType, storageType>::getDigestSize() const {
+    return this->m_pLog->digest_size;
+}
+
 template <typename ObjectType,
           StorageType storageType>
 void Persistent<ObjectType, storageType>::updateVerifier(version_t ver, openssl::Verifier& verifier) {
@@ -572,7 +787,7 @@ std::size_t Persistent<ObjectType, storageType>::to_bytes(char* ret) const {
     sz += mutils::to_bytes(this->m_pLog->m_sName, ret + sz);
     // wrapped object
     dbg_default_trace("{0}[{1}] wrapped_object starts at {2}", this->m_pLog->m_sName, __func__, sz);
-    sz += mutils::to_bytes(*this->m_pWrappedObject, ret + sz);
+    sz += mutils::to_bytes(this->getConstRef(), ret + sz);
     // flag to indicate whether the log has signatures
     dbg_default_trace("{0}[{1}] signatures_enabled starts at {2}", this->m_pLog->m_sName, __func__, sz);
     const bool signatures_enabled = this->m_pLog->signature_size > 0;
@@ -586,7 +801,7 @@ std::size_t Persistent<ObjectType, storageType>::to_bytes(char* ret) const {
 template <typename ObjectType,
           StorageType storageType>
 std::size_t Persistent<ObjectType, storageType>::bytes_size() const {
-    return mutils::bytes_size(this->m_pLog->m_sName) + mutils::bytes_size(*this->m_pWrappedObject) + this->m_pLog->bytes_size(PersistentRegistry::getEarliestVersionToSerialize());
+    return mutils::bytes_size(this->m_pLog->m_sName) + mutils::bytes_size(this->getConstRef()) + this->m_pLog->bytes_size(PersistentRegistry::getEarliestVersionToSerialize());
 }
 
 template <typename ObjectType,
@@ -594,7 +809,7 @@ template <typename ObjectType,
 void Persistent<ObjectType, storageType>::post_object(const std::function<void(char const* const, std::size_t)>& f)
         const {
     mutils::post_object(f, this->m_pLog->m_sName);
-    mutils::post_object(f, *this->m_pWrappedObject);
+    mutils::post_object(f, this->getConstRef());
     mutils::post_object(f, (this->m_pLog->signature_size > 0));
     this->m_pLog->post_object(f, PersistentRegistry::getEarliestVersionToSerialize());
 }
@@ -0,0 +1,299 @@
+#ifndef SEGMENTED_PERSIST_LOG_HPP
+#define SEGMENTED_PERSIST_LOG_HPP
+
+#include "FilePersistLog.hpp"
+#include "PersistLog.hpp"
+#include "util.hpp"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+namespace persistent {
+
+#define SEGMENT_FILE_SUFFIX "seg"
+//The size of a segment header, which must be page-aligned
+#define SEGMENT_HEADER_SIZE (4096)
+#define SEGMENT_MAGIC (0x544e454d47455344ull)
+//The data size of a segment if PERS/segment_size is 0. Persistent<T> only
+//creates a SegmentedPersistLog if it is not, so this only applies to a
+//SegmentedPersistLog created directly.
+#define DEFAULT_SEGMENT_SIZE (1ull << 26)
+
+// segment header format
+union SegmentHeader {
+    struct {
+        uint64_t magic;
+        int64_t first_index;      // the log index of the first entry in the segment
+        uint64_t entry_capacity;  // the number of log entries the segment can hold
+        uint64_t data_capacity;   // the number of data bytes the segment can hold
+    } fields;
+    uint8_t bytes[SEGMENT_HEADER_SIZE];
+};
+
+/**
+ * SegmentedPersistLog is a PersistLog kept in a sequence of fixed-size segment
+ * files instead of the two preallocated ring buffers of FilePersistLog, so the
+ * history it holds is not bounded by PERS/max_data_size and it does not reserve
+ * address space for it.
+ *
+ * A segment file <name>.<number>.seg holds a SegmentHeader, an array of
+ * segment_log_entry LogEntry slots and segment_size bytes of data, in which the
+ * 'ofst' of an entry is relative to the segment. Entries are appended to the
+ * last segment, the only one mapped for writing; when it is full, it is flushed
+ * and write-protected, and a new segment is started. The other segments are
+ * only mapped, read-only, when they are read. If more than
+ * PERS/max_mapped_segments of them are mapped, the next append or trim unmaps
+ * the least recently read ones. A segment that is unmapped, or trimmed, while a
+ * read started with beginRead() is in progress stays mapped until no read is,
+ * so a pointer returned by a getter after beginRead() stays valid until the
+ * matching endRead(). The meta file has the same format as the one of FilePersistLog, so the
+ * global log indexes in it work the same way.
+ *
+ * Once every entry of a segment has been trimmed, the segment is moved to
+ * PERS/cold_path (compressed if PERS/compress_cold_segments is set) or deleted
+ * if no cold path is configured. At startup, the HLC index of every segment is
+ * read in parallel.
+ */
+class SegmentedPersistLog : public PersistLog {
+protected:
+    struct Segment {
+        // the number in the file name, which increases with first_index
+        uint64_t number;
+        std::string file;
+        int64_t first_index;
+        // the version of the entry at first_index, or INVALID_VERSION if the segment is empty
+        version_t first_version;
+        uint64_t entry_capacity;
+        uint64_t data_capacity;
+        // the file descriptor of the segment being appended to, -1 for the others
+        int fd;
+        // the mapping of the segment, nullptr until a segment sealed before startup is read
+        std::atomic<uint8_t*> base;
+        bool writable;
+        // when the segment was last read, in ticks of m_iMapClock
+        std::atomic<uint64_t> last_used{0};
+
+        uint64_t file_size() const {
+            return SEGMENT_HEADER_SIZE + entry_capacity * sizeof(LogEntry) + data_capacity;
+        }
+        LogEntry* entries() const {
+            return reinterpret_cast<LogEntry*>(base.load(std::memory_order_acquire) + SEGMENT_HEADER_SIZE);
+        }
+        uint8_t* data() const {
+            return base.load(std::memory_order_acquire) + SEGMENT_HEADER_SIZE + entry_capacity * sizeof(LogEntry);
+        }
+    };
+
+    // the current meta header
+    MetaHeader m_currMetaHeader;
+    // the persisted meta header
+    MetaHeader m_persMetaHeader;
+    // path of the data files
+    const std::string m_sDataPath;
+    // full meta file name
+    const std::string m_sMetaFile;
+    // where segments go once they are trimmed, empty to delete them
+    const std::string m_sColdPath;
+    // data bytes per segment
+    const uint64_t m_iSegmentSize;
+    // log entries per segment
+    const uint64_t m_iSegmentEntries;
+    // max number of live log entries
+    const uint64_t m_iMaxLogEntry;
+    // whether to compress the segments moved to m_sColdPath
+    const bool m_bCompressCold;
+    // how many read-only segments may stay mapped, 0 for no limit
+    const uint64_t m_iMaxMappedSegments;
+
+    // the segments in log order; the last one is the one being appended to
+    std::deque<std::unique_ptr<Segment>> m_segments;
+    // the number of the next segment
+    uint64_t m_iNextSegmentNumber;
+
+    // read/write lock; the FPL_* lock macros of FilePersistLog work on it
+    pthread_rwlock_t m_rwlock;
+    // persistent lock
+    pthread_mutex_t m_perslock;
+    // serializes mapping sealed segments, which readers do with the read lock
+    std::mutex m_mapLock;
+    // the number of read-only segments that are mapped
+    std::atomic<uint64_t> m_iNumMapped;
+    // incremented on every read of a segment, to find the least recently read ones
+    std::atomic<uint64_t> m_iMapClock;
+    // the number of reads between beginRead() and endRead()
+    std::atomic<uint64_t> m_iReaders{0};
+    // the mappings unmapped while reads were in progress, with their sizes;
+    // they are released once there are none, protected by m_mapLock
+    std::vector<std::pair<uint8_t*, uint64_t>> m_retiredMappings;
+    // data offset (in the last segment) of the entry reserved by reserve(), or -1 if there is none
+    int64_t m_iReservedOfst;
+    // data length of the entry reserved by reserve()
+    uint64_t m_iReservedSize;
+
+    // load the log from files. This method may through exceptions if read from
+    // file failed.
+    virtual void load();
+
+    // reset the logs. This will remove the existing persisted data.
+    virtual void reset();
+
+    // Persistent the Metadata header, we assume
+    // FPL_PERS_LOCK is acquired.
+    virtual void persistMetaHeaderAtomically(MetaHeader*);
+
+public:
+    //Constructor
+    SegmentedPersistLog(const std::string& name, const std::string& dataPath, bool enableSignatures);
+    SegmentedPersistLog(const std::string& name, bool enableSignatures) : SegmentedPersistLog(name, getPersFilePath(), enableSignatures){};
+    //Destructor
+    virtual ~SegmentedPersistLog() noexcept(true);
+
+    //Derived from PersistLog
+    virtual void append(const void* pdata,
+                        uint64_t size, version_t ver,
+                        const HLC& mhlc) override;
+    virtual char* reserve(uint64_t size) override;
+    virtual void commit(version_t ver, const HLC& mhlc) override;
+    virtual bool commitIfChanged(version_t ver, const HLC& mhlc) override;
+    virtual void advanceVersion(int64_t ver) override;
+    virtual int64_t getLength() override;
+    virtual int64_t getEarliestIndex() override;
+    virtual int64_t getLatestIndex() override;
+    virtual int64_t getVersionIndex(version_t ver, bool exact) override;
+    virtual int64_t getHLCIndex(const HLC& hlc) override;
+    virtual version_t getEarliestVersion() override;
+    virtual version_t getLatestVersion() override;
+    virtual version_t getLastPersistedVersion() override;
+    virtual const void* getEntryByIndex(int64_t eno) override;
+    virtual const void* getEntry(version_t ver, bool exact = false) override;
+    virtual const void* getEntry(const HLC& hlc) override;
+    virtual version_t persist(version_t ver,
+                              bool preLocked = false) override;
+    virtual void beginRead() override;
+    virtual void endRead() override;
+    virtual void processEntryAtVersion(version_t ver, const std::function<void(const void*, std::size_t)>& func) override;
+    virtual void addSignature(version_t ver, const unsigned char* signature, version_t previous_signed_version) override;
+    virtual bool getSignature(version_t ver, unsigned char* signature, version_t& previous_signed_version) override;
+    virtual void addDigest(version_t ver, const unsigned char* digest, version_t signed_ver) override;
+    virtual bool getDigest(version_t ver, unsigned char* digest, version_t& signed_ver) override;
+    virtual void trimByIndex(int64_t eno) override;
+    virtual void trim(version_t ver) override;
+    virtual void trim(const HLC& hlc) override;
+    virtual void truncate(version_t ver) override;
+    virtual size_t bytes_size(version_t ver) override;
+    virtual size_t to_bytes(char* buf, version_t ver) override;
+    virtual void post_object(const std::function<void(char const* const, std::size_t)>& f,
+                             version_t ver) override;
+    virtual void applyLogTail(char const* v) override;
+    virtual void applyLogTail(const std::function<void(char*, std::size_t)>& read_bytes) override;
+
+    /** @return the number of segments holding live entries, for monitoring. */
+    std::size_t getNumSegments();
+    /** @return the number of read-only segments that are mapped, for monitoring. */
+    std::size_t getNumMappedSegments() const { return m_iNumMapped; }
+
+private:
+    /** @return the number of live entries; no lock protected, use FPL_RDLOCK */
+    int64_t numUsedSlots() const {
+        return m_currMetaHeader.fields.tail - m_currMetaHeader.fields.head;
+    }
+    /** @return the index of the latest entry, or INVALID_INDEX if the log is empty */
+    int64_t currLogIdx() const {
+        return numUsedSlots() == 0 ? INVALID_INDEX : m_currMetaHeader.fields.tail - 1;
+    }
+
+    /**
+     * Get the segment holding the entry at idx, which must be in the log.
+     * Note: no lock protected, use FPL_RDLOCK
+     */
+    Segment* segmentOf(int64_t idx);
+    /** Map a sealed segment read-only if it is not mapped yet, and mark it as recently read. */
+    void mapSegment(Segment* seg);
+    /**
+     * Unmap a read-only segment, if it is mapped. If reads are in progress,
+     * the mapping is only retired, and released by the last of them.
+     */
+    void unmapSegment(Segment* seg);
+    /**
+     * Unmap the least recently read sealed segments while more than
+     * m_iMaxMappedSegments are mapped. Readers map segments with the read
+     * lock, so this waits for FPL_WRLOCK, which we assume is acquired.
+     */
+    void unmapColdSegments();
+    /** Get the entry at idx and the segment holding it; use FPL_RDLOCK */
+    LogEntry* entryAt(int64_t idx, Segment** pseg = nullptr);
+    /** Get the data, after the signature and digest, of the entry at idx; use FPL_RDLOCK */
+    void* dataAt(int64_t idx);
+    /** Get the signature space of the entry at idx; use FPL_RDLOCK */
+    uint8_t* signatureAt(int64_t idx, Segment** pseg = nullptr);
+    /** Get the length of the data of the entry at idx; use FPL_RDLOCK */
+    uint64_t dataSizeAt(int64_t idx);
+    /**
+     * Write to the mapping of a segment, which goes through the file if the
+     * segment is sealed and therefore mapped read-only.
+     */
+    void writeToSegment(Segment* seg, void* dst, const void* src, std::size_t len);
+
+    /**
+     * Binary search for the latest entry whose version is at most ver.
+     * Note: no lock protected, use FPL_RDLOCK
+     * @return its index, or INVALID_INDEX if every entry is newer than ver.
+     */
+    int64_t searchVersion(version_t ver);
+
+    /** The offset of the free data in the last segment; use FPL_RDLOCK */
+    uint64_t nextDataOfst();
+    /**
+     * Make sure the last segment has room for one more entry with 'size'
+     * bytes of data (plus signature and digest), starting a new segment if it
+     * does not. We assume FPL_WRLOCK is acquired.
+     */
+    void ensureSpace(uint64_t size);
+    /** Create a new segment starting at the tail. We assume FPL_WRLOCK is acquired. */
+    void startSegment(uint64_t data_size);
+    /** Flush the last segment and write-protect its mapping. */
+    void sealSegment(Segment* seg);
+    /** Remove a segment from the hot directory, moving it to the cold directory if there is one. */
+    void archiveSegment(const std::string& file);
+    /**
+     * Detach the segments that only hold trimmed entries, except the last one.
+     * We assume FPL_WRLOCK is acquired.
+     * @return the files of the detached segments, to be archived without the lock.
+     */
+    std::vector<std::string> detachTrimmedSegments();
+
+    /* Validate the log before we append; see FilePersistLog::do_append_validation */
+    void do_append_validation(const uint64_t size, const int64_t ver);
+    /* Throw PERSIST_EXP_NO_RESERVATION if reserve() has not been called
+     * since the last append or commit. We assume FPL_WRLOCK is acquired. */
+    void do_reservation_validation(const version_t ver);
+    /* Append the reserved data as the next entry. We assume FPL_WRLOCK is acquired. */
+    void do_commit(const version_t ver, const HLC& mhlc);
+    /* Fill the next log entry for data already in place at the free data of
+     * the last segment, and update the meta header. We assume FPL_WRLOCK is
+     * acquired and ensureSpace() has been called. */
+    void do_append_entry(const uint64_t size, const version_t ver, const HLC& mhlc, const uint64_t ref_dist = 0);
+    /* The index of the first entry to keep when trimming the entries before
+     * idx; see FilePersistLog::do_trim_head. We assume FPL_WRLOCK is acquired. */
+    int64_t do_trim_head(const int64_t idx);
+    /* Trim the entries up to idx, inclusively, which must be in the log. We
+     * assume FPL_PERS_LOCK and FPL_WRLOCK are acquired.
+     * @return the files of the segments left with trimmed entries only, to be
+     * archived after the locks are released. */
+    std::vector<std::string> do_trim(int64_t idx);
+
+    // see the FilePersistLog members of the same names
+    int64_t getMinimumIndexBeyondVersion(version_t ver);
+    int64_t inlinedDataIndex(int64_t idx, int64_t first_idx);
+    size_t byteSizeOfLogEntry(int64_t idx, int64_t data_idx);
+    size_t writeLogEntryToByteArray(int64_t idx, char* ba, int64_t data_idx);
+    size_t postLogEntry(const std::function<void(char const* const, std::size_t)>& f, int64_t idx, int64_t data_idx);
+    size_t mergeLogEntryFromByteArray(const char* ba);
+};
+}  // namespace persistent
+
+#endif  //SEGMENTED_PERSIST_LOG_HPP
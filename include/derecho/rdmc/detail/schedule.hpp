@@ -2,6 +2,8 @@
 #define SCHEDULE_HPP
 
 #include <cmath>
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <vector>
 
@@ -104,4 +106,42 @@ public:
     size_t get_total_steps(size_t num_blocks) const;
 };
 
+/**
+ * A schedule for members spread over racks whose uplinks are oversubscribed.
+ * The first member of each rack is its leader. The leaders run a binomial
+ * pipeline among themselves, so that each block enters each rack once, and
+ * each leader forwards every block it gets down a chain through the other
+ * members of its rack. A leader alternates between the two: binomial steps
+ * are the even steps and chain steps are the odd ones.
+ */
+class hybrid_schedule : public schedule {
+private:
+    // The member indices of each rack in increasing order. Racks are ordered
+    // by their leaders, so rack 0 is the sender's.
+    vector<vector<uint32_t>> rack_members;
+    uint32_t my_rack;
+    // Position in the rack's chain; 0 for the leader
+    uint32_t my_position;
+    size_t max_rack_size;
+    // The binomial pipeline among the leaders, from the point of view of this
+    // rack's leader. Null if there is only one rack.
+    std::unique_ptr<binomial_schedule> leader_schedule;
+
+    size_t get_leader_steps(size_t num_blocks) const;
+    optional<size_t> get_forwarded_block(size_t num_blocks, size_t step) const;
+
+public:
+    /**
+     * @param member_racks The rack of each member, by member index. Racks can
+     * be labelled with any numbers.
+     */
+    hybrid_schedule(uint32_t members, uint32_t index, const vector<uint32_t>& member_racks);
+
+    vector<uint32_t> get_connections() const;
+    optional<block_transfer> get_outgoing_transfer(size_t num_blocks, size_t send_step) const;
+    optional<block_transfer> get_incoming_transfer(size_t num_blocks, size_t receive_step) const;
+    optional<block_transfer> get_first_block(size_t num_blocks) const;
+    size_t get_total_steps(size_t num_blocks) const;
+};
+
 #endif /* SCHEDULE_HPP */
@@ -14,6 +14,7 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <queue>
 #include <set>
 #include <vector>
 
@@ -24,6 +25,14 @@ using std::unique_ptr;
 using std::vector;
 using std::optional;
 
+// A segment of a scatter-gather message, with the registered memory region
+// that contains it, or null if it is not in one
+struct message_segment {
+    char* buffer;
+    size_t length;
+    std::shared_ptr<rdma::memory_region> mr;
+};
+
 class group {
 protected:
     const vector<uint32_t> members;  // first element is the sender
@@ -59,6 +68,9 @@ public:
     virtual void send_message(std::shared_ptr<rdma::memory_region> message_mr,
                               size_t offset, size_t length)
             = 0;
+    virtual void send_message(vector<message_segment> segments) = 0;
+    /** Replaces the callbacks once any callback that is running returns. */
+    void rebind(incoming_message_callback_t upcall, completion_callback_t callback);
 };
 
 class polling_group : public group {
@@ -77,6 +89,28 @@ private:
     bool sending = false;  // Whether a block send is in progress
     size_t send_step = 0;  // Number of blocks sent/stalls so far
 
+    // Messages passed to send_message() while an earlier one was still being
+    // sent, oldest first. The root starts the next one as soon as it has sent
+    // its last block of the current one, so that its first blocks flow to the
+    // receivers that are done while the others finish the previous message.
+    struct outgoing_message {
+        std::shared_ptr<rdma::memory_region> mr;
+        size_t offset;
+        size_t length;
+        // The segments of a scatter-gather message, which has no mr
+        vector<message_segment> segments;
+    };
+    std::queue<outgoing_message> queued_sends;
+
+    // The segments of the scatter-gather message being sent, and the memory
+    // region and offset each of its blocks is sent from. Both are empty when
+    // the message being sent is in mr.
+    vector<message_segment> message_segments;
+    vector<std::pair<rdma::memory_region*, size_t>> block_sources;
+    // Holds the blocks of scatter-gather messages that are not inside one
+    // registered segment; it is reused by every message, and only grows.
+    std::shared_ptr<rdma::memory_region> staging_mr;
+
     // Total number of blocks received and the number of chunks
     // received for ecah block, respectively.
     size_t num_received_blocks = 0;
@@ -111,9 +145,13 @@ public:
 
     virtual void send_message(std::shared_ptr<rdma::memory_region> message_mr,
                               size_t offset, size_t length);
+    virtual void send_message(vector<message_segment> segments);
 
 private:
     void post_recv(schedule::block_transfer transfer);
+    void start_message(std::shared_ptr<rdma::memory_region> message_mr,
+                       size_t offset, size_t length);
+    void start_message(vector<message_segment> segments);
     void send_next_block();
     void complete_message();
     void prepare_for_next_message();
@@ -29,7 +29,8 @@ enum send_algorithm {
     BINOMIAL_SEND = 1,
     CHAIN_SEND = 2,
     SEQUENTIAL_SEND = 3,
-    TREE_SEND = 4
+    TREE_SEND = 4,
+    HYBRID_SEND = 5
 };
 
 struct receive_destination {
@@ -37,6 +38,12 @@ struct receive_destination {
     size_t offset;
 };
 
+/** One piece of a message passed to the scatter-gather send. */
+struct segment {
+    char* buffer;
+    size_t length;
+};
+
 typedef std::function<receive_destination(size_t size)>
         incoming_message_callback_t;
 typedef std::function<void(char* buffer, size_t size)> completion_callback_t;
@@ -63,19 +70,71 @@ void shutdown();
  * message in this group
  * @param failure_callback The function to call when RDMC detects a failure in
  * this group. It will be called with the suspected failed node's ID.
+ * @param node_racks The rack of each member, by node ID, used by HYBRID_SEND.
+ * Members that are not in the map are each in a rack of their own.
  * @return True if group creation succeeds, false if it fails.
  */
 bool create_group(uint16_t group_number, std::vector<uint32_t> members,
                   size_t block_size, send_algorithm algorithm,
                   incoming_message_callback_t incoming_receive,
                   completion_callback_t send_callback,
-                  failure_callback_t failure_callback)
+                  failure_callback_t failure_callback,
+                  const std::map<uint32_t, uint32_t>& node_racks = {})
         __attribute__((warn_unused_result));
+/**
+ * Replaces the callbacks of an existing group, waiting for any of its
+ * callbacks that is running to return. Messages that are already being
+ * received, or that were queued to send, complete into the new callbacks.
+ * @param group_number The number of the group
+ * @param incoming_receive The new incoming message callback
+ * @param send_callback The new completion callback
+ * @return True if the group exists, false if it does not.
+ */
+bool rebind_group(uint16_t group_number,
+                  incoming_message_callback_t incoming_receive,
+                  completion_callback_t send_callback);
 void destroy_group(uint16_t group_number);
 
+/**
+ * Sends a message in a group in which this node is the sender (the first
+ * member). If a message is still being sent, the new one is queued and started
+ * as soon as this node has sent its last block of the previous one; messages
+ * complete in the order they were sent.
+ * @return True if the group exists, false otherwise.
+ */
 bool send(uint16_t group_number, std::shared_ptr<rdma::memory_region> mr,
           size_t offset, size_t length) __attribute__((warn_unused_result));
 
+/**
+ * Sends a message made of the concatenation of segments, without first
+ * copying them into one buffer. Every block that lies entirely inside a
+ * segment registered with register_memory is sent directly from that
+ * segment; the others (those that span several segments or contain
+ * unregistered memory, such as a small header) are copied into a staging
+ * buffer that the group registers once and reuses. Receivers get the message
+ * in one buffer, as with the other send. The segments must not be changed or
+ * freed until the message completes, and the sender's completion callback
+ * gets the buffer of the first segment. Queued and completed in order with
+ * the other send.
+ * @return True if the group exists, false otherwise.
+ */
+bool send(uint16_t group_number, const std::vector<segment>& segments)
+        __attribute__((warn_unused_result));
+
+/**
+ * Registers a buffer with the NIC once, so that the scatter-gather send can
+ * send the segments inside it directly. Registration is expensive, so it is
+ * cached: registering the same buffer again returns the cached region.
+ * @return the memory region for the buffer
+ */
+std::shared_ptr<rdma::memory_region> register_memory(char* buffer, size_t size);
+
+/**
+ * Removes a buffer from the registration cache. It stays registered until
+ * the messages being sent from it complete.
+ */
+void deregister_memory(char* buffer);
+
 // Convenience function to obtain the addresses of other nodes that might be
 // part of group communication.
 // void query_addresses(std::map<uint32_t, std::string>& addresses,
@@ -1,39 +1,98 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <optional>
-#include <list>
-#include <map>
+#include <cstdint>
+#include <memory>
 #include <mutex>
-#include <thread>
+#include <optional>
+#include <utility>
 #include <vector>
 
 namespace sst {
 namespace util {
+/**
+ * PollingData hands the completion entries read by the polling thread to the
+ * threads that posted the writes. Each such thread has a mailbox: a
+ * fixed-capacity ring whose only producer is the polling thread and whose only
+ * consumer is the thread itself, so neither side takes a lock. A thread gets
+ * its mailbox on its first call to get_index() and keeps it until it exits;
+ * the index of the mailbox is the ce_idx it puts in its sender contexts.
+ * All other member functions act on the mailbox of the calling thread.
+ */
 class PollingData {
-    // static std::vector<std::list<std::pair<int32_t, int32_t>>> completion_entries;
-    // static std::map<std::thread::id, uint32_t> tid_to_index;
-    // static std::vector<bool> if_waiting;
-    // static std::condition_variable poll_cv;
-    // static std::mutex poll_mutex;
-    // static bool check_waiting();
-
-    std::vector<std::list<std::pair<int32_t, int32_t>>> completion_entries;
-    std::map<std::thread::id, uint32_t> tid_to_index;
-    std::vector<bool> if_waiting;
+public:
+    /** The maximum number of threads that can hold a mailbox at the same time. */
+    static constexpr uint32_t MAX_MAILBOXES = 256;
+    /** The maximum number of completion entries waiting in a mailbox. */
+    static constexpr uint32_t MAILBOX_CAPACITY = 1024;
+    /** The number of times a waiting thread polls its mailbox before it sleeps. */
+    static constexpr uint32_t SPIN_COUNT = 4096;
+
+private:
+    struct CompletionMailbox {
+        // the next entry to read, written by the consumer
+        alignas(64) std::atomic<uint32_t> head{0};
+        // the next entry to write, written by the producer
+        alignas(64) std::atomic<uint32_t> tail{0};
+        // the futex word: 1 while the consumer is about to sleep or sleeping
+        std::atomic<uint32_t> sleeping{0};
+        // whether the owner is waiting for completions, see set_waiting()
+        std::atomic<bool> waiting{false};
+        std::array<std::pair<int32_t, int32_t>, MAILBOX_CAPACITY> entries;
+    };
+
+    // the mailboxes by index; an entry is set once and never moves
+    std::array<std::atomic<CompletionMailbox*>, MAX_MAILBOXES> mailboxes{};
+    // owns the mailboxes, which are reused after their threads exit
+    std::vector<std::unique_ptr<CompletionMailbox>> mailbox_storage;
+    std::vector<uint32_t> free_indices;
+    std::mutex registration_mutex;
+
+    // the number of threads between set_waiting() and reset_waiting()
+    std::atomic<uint32_t> num_waiting{0};
     std::condition_variable poll_cv;
     std::mutex poll_mutex;
-    bool check_waiting();
+
+    uint32_t acquire_index();
+    void release_index(uint32_t index);
+    CompletionMailbox& my_mailbox();
+    static std::optional<std::pair<int32_t, int32_t>> take_entry(CompletionMailbox& mailbox);
+
+    friend struct MailboxLease;
+
 public:
+    /**
+     * Called by the polling thread only. Delivers a completion entry to the
+     * mailbox with the given index, waking its owner if it is sleeping. An
+     * entry for an unknown or full mailbox is dropped.
+     */
     void insert_completion_entry(uint32_t index, std::pair<int32_t, int32_t> ce);
 
-    std::optional<std::pair<int32_t, int32_t>> get_completion_entry(const std::thread::id id);
+    /** Takes the next completion entry of the calling thread, if there is one. */
+    std::optional<std::pair<int32_t, int32_t>> get_completion_entry();
+
+    /**
+     * Waits for the next completion entry of the calling thread. The thread
+     * polls its mailbox SPIN_COUNT times, then sleeps until an entry arrives.
+     * @param deadline The time to give up at.
+     * @return the entry, or an empty optional if none arrived before the deadline.
+     */
+    std::optional<std::pair<int32_t, int32_t>> wait_for_completion_entry(
+            const std::chrono::steady_clock::time_point& deadline);
 
-    uint32_t get_index(const std::thread::id id);
+    /**
+     * @return the index of the calling thread's mailbox, which is assigned on
+     * the first call.
+     * @throws std::runtime_error if MAX_MAILBOXES threads already have one.
+     */
+    uint32_t get_index();
 
-    void set_waiting(const std::thread::id id);
+    void set_waiting();
 
-    void reset_waiting(const std::thread::id id);
+    void reset_waiting();
 
     void wait_for_requests();
 };
@@ -8,6 +8,7 @@
 
 #include <chrono>
 #include <condition_variable>
+#include <cstring>
 #include <memory>
 #include <mutex>
 #include <pthread.h>
@@ -19,6 +20,7 @@
 #include "poll_utils.hpp"
 #include "../predicates.hpp"
 #include "../sst.hpp"
+#include <derecho/utils/metrics.hpp>
 
 namespace sst {
 
@@ -50,12 +52,85 @@ void SST<DerivedSST>::start_predicate_evaluation() {
     thread_start_cv.notify_all();
 }
 
+template <typename DerivedSST>
+bool SST<DerivedSST>::refresh_predicate_inputs(typename Predicates<DerivedSST>::PredicateEntry& entry) {
+    if(entry.inputs.empty()) {
+        return true;
+    }
+    std::size_t snapshot_size = 0;
+    for(const PredicateInput& input : entry.inputs) {
+        snapshot_size += input.length;
+    }
+    snapshot_size *= num_members;
+    bool changed = !entry.snapshot_valid;
+    if(entry.input_snapshot.size() != snapshot_size) {
+        entry.input_snapshot.resize(snapshot_size);
+        changed = true;
+    }
+    // Remote writes land without notifying this thread, so compare the bytes themselves
+    char* snapshot = entry.input_snapshot.data();
+    for(unsigned int row = 0; row < num_members; ++row) {
+        const char* row_base = const_cast<char*>(rows) + row * rowLen;
+        for(const PredicateInput& input : entry.inputs) {
+            if(changed || memcmp(snapshot, row_base + input.offset, input.length) != 0) {
+                memcpy(snapshot, row_base + input.offset, input.length);
+                changed = true;
+            }
+            snapshot += input.length;
+        }
+    }
+    entry.snapshot_valid = true;
+    return changed;
+}
+
+template <typename DerivedSST>
+bool SST<DerivedSST>::evaluate_predicate(typename Predicates<DerivedSST>::PredicateEntry& entry) {
+    // A recurrent predicate that just fired may have changed its own state, so it is checked again
+    bool inputs_changed = refresh_predicate_inputs(entry);
+    // Local state that the predicate reads can be changed by other threads, which then wake it
+    bool woken = entry.woken.exchange(false);
+    if(!inputs_changed && !woken && !(entry.type == PredicateType::RECURRENT && entry.last_state)) {
+        entry.num_skipped++;
+        // transition predicates keep their previous state, so they cannot fire
+        return false;
+    }
+    // Only read the clock when metrics are enabled
+    const uint64_t start_time = derecho::metrics::start_time();
+    bool result = entry.predicate(*derived_this);
+    if(start_time != 0) {
+        entry.evaluation_ns += get_time() - start_time;
+    }
+    entry.num_evaluations++;
+    bool last_state = entry.last_state;
+    entry.last_state = result;
+    if(entry.type == PredicateType::TRANSITION) {
+        return result && !last_state;
+    }
+    return result;
+}
+
+template <typename DerivedSST>
+void SST<DerivedSST>::run_trigger(typename Predicates<DerivedSST>::PredicateEntry& entry,
+                                  std::unique_lock<std::mutex>& predicates_lock) {
+    // Copy the trigger pointer locally, so it can continue running without
+    // segfaulting even if this predicate gets deleted when we unlock predicates_lock
+    std::shared_ptr<typename Predicates<DerivedSST>::trig> trigger(entry.trigger);
+    const uint64_t start_time = derecho::metrics::start_time();
+    predicates_lock.unlock();
+    (*trigger)(*derived_this);
+    predicates_lock.lock();
+    if(start_time != 0) {
+        entry.trigger_ns += get_time() - start_time;
+    }
+    entry.num_fired++;
+}
+
 /**
  * This function is run in a detached background thread to detect predicate
  * events. It continuously evaluates predicates one by one, and runs the
- * trigger functions for each predicate that fires. In addition, it
- * continuously evaluates named functions one by one, and updates the local
- * row's observed values of those functions.
+ * trigger functions for each predicate that fires. Predicates that declared
+ * their inputs are skipped when those inputs have not changed, and removed
+ * predicates are compacted away at the end of each pass.
  */
 template <typename DerivedSST>
 void SST<DerivedSST>::detect() {
@@ -69,58 +144,43 @@ void SST<DerivedSST>::detect() {
 
     while(!thread_shutdown) {
         bool predicate_fired = false;
+        const uint64_t pass_start_time = derecho::metrics::start_time();
         // Take the predicate lock before reading the predicate lists
         std::unique_lock<std::mutex> predicates_lock(predicates.predicate_mutex);
 
-        // one time predicates need to be evaluated only until they become true
-        for(auto& pred : predicates.one_time_predicates) {
-            if(pred != nullptr && (pred->first(*derived_this) == true)) {
+        // One time predicates need to be evaluated only until they become true.
+        // Entries are never erased while the lock is released, so the iterators stay valid.
+        for(auto& entry : predicates.one_time_predicates) {
+            if(entry->alive && evaluate_predicate(*entry)) {
                 predicate_fired = true;
-                // Copy the trigger pointer locally, so it can continue running without
-                // segfaulting even if this predicate gets deleted when we unlock predicates_lock
-                std::shared_ptr<typename Predicates<DerivedSST>::trig> trigger(pred->second);
-                predicates_lock.unlock();
-                (*trigger)(*derived_this);
-                predicates_lock.lock();
+                run_trigger(*entry, predicates_lock);
                 // erase the predicate as it was just found to be true
-                pred.reset();
+                predicates.retire(*entry);
             }
         }
 
         // recurrent predicates are evaluated each time they are found to be true
-        for(auto& pred : predicates.recurrent_predicates) {
-            if(pred != nullptr && (pred->first(*derived_this) == true)) {
+        for(auto& entry : predicates.recurrent_predicates) {
+            if(entry->alive && evaluate_predicate(*entry)) {
                 predicate_fired = true;
-                std::shared_ptr<typename Predicates<DerivedSST>::trig> trigger(pred->second);
-                predicates_lock.unlock();
-                (*trigger)(*derived_this);
-                predicates_lock.lock();
+                run_trigger(*entry, predicates_lock);
             }
         }
 
         // transition predicates are only evaluated when they change from false to true
-        // We need to use iterators here because we need to iterate over two lists in parallel
-        auto pred_it = predicates.transition_predicates.begin();
-        auto pred_state_it = predicates.transition_predicate_states.begin();
-        while(pred_it != predicates.transition_predicates.end()) {
-            if(*pred_it != nullptr) {
-                //*pred_state_it is the previous state of the predicate at *pred_it
-                bool curr_pred_state = (*pred_it)->first(*derived_this);
-                if(curr_pred_state == true && *pred_state_it == false) {
-                    predicate_fired = true;
-                    std::shared_ptr<typename Predicates<DerivedSST>::trig> trigger(
-                            (*pred_it)->second);
-                    predicates_lock.unlock();
-                    (*trigger)(*derived_this);
-                    predicates_lock.lock();
-                }
-                *pred_state_it = curr_pred_state;
-
-                ++pred_it;
-                ++pred_state_it;
+        for(auto& entry : predicates.transition_predicates) {
+            if(entry->alive && evaluate_predicate(*entry)) {
+                predicate_fired = true;
+                run_trigger(*entry, predicates_lock);
             }
         }
 
+        if(predicates.num_dead > 0) {
+            predicates.compact();
+        }
+        derecho::metrics::record_since(derecho::metrics::Metric::PREDICATE_LOOP_NS,
+                                       derecho::metrics::NO_SUBGROUP, pass_start_time);
+
         if(predicate_fired) {
             // update last time
             clock_gettime(CLOCK_REALTIME, &last_time);
@@ -136,7 +196,6 @@ void SST<DerivedSST>::detect() {
                 predicates_lock.lock();
             }
         }
-        //Still to do: Clean up deleted predicates
     }
 }
 
@@ -160,11 +219,10 @@ void SST<DerivedSST>::put_with_completion(const std::vector<uint32_t> receiver_r
     unsigned int num_writes_posted = 0;
     std::vector<bool> posted_write_to(num_members, false);
 
-    const auto tid = std::this_thread::get_id();
     // get id first
-    uint32_t ce_idx = util::polling_data.get_index(tid);
+    uint32_t ce_idx = util::polling_data.get_index();
 
-    util::polling_data.set_waiting(tid);
+    util::polling_data.set_waiting();
 #ifdef USE_VERBS_API
     verbs_sender_ctxt sctxt[receiver_ranks.size()];
 #else
@@ -188,30 +246,12 @@ void SST<DerivedSST>::put_with_completion(const std::vector<uint32_t> receiver_r
 
     std::vector<uint32_t> failed_node_indexes;
 
-    unsigned long start_time_msec;
-    unsigned long cur_time_msec;
-    struct timeval cur_time;
-
     // wait for completions for a while but eventually give up on it
-    gettimeofday(&cur_time, NULL);
-    start_time_msec = (cur_time.tv_sec * 1000) + (cur_time.tv_usec / 1000);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(poll_cq_timeout_ms);
 
     // poll for a single completion for each write request submitted
     for(unsigned int index = 0; index < num_writes_posted; ++index) {
-        std::optional<std::pair<int32_t, int32_t>> ce;
-
-        while(true) {
-            // check if polling result is available
-            ce = util::polling_data.get_completion_entry(tid);
-            if(ce) {
-                break;
-            }
-            gettimeofday(&cur_time, NULL);
-            cur_time_msec = (cur_time.tv_sec * 1000) + (cur_time.tv_usec / 1000);
-            if((cur_time_msec - start_time_msec) >= poll_cq_timeout_ms) {
-                break;
-            }
-        }
+        std::optional<std::pair<int32_t, int32_t>> ce = util::polling_data.wait_for_completion_entry(deadline);
         // if waiting for a completion entry timed out
         if(!ce) {
             // mark all nodes that have not yet responded as failed
@@ -236,7 +276,7 @@ void SST<DerivedSST>::put_with_completion(const std::vector<uint32_t> receiver_r
         }
     }
 
-    util::polling_data.reset_waiting(tid);
+    util::polling_data.reset_waiting();
 
     for(auto index : failed_node_indexes) {
         freeze(index);
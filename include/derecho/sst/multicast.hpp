@@ -133,7 +133,7 @@ public:
         }
     }
 
-    // In ORDERED MODE, we should hold the lock on msg_state_mtx
+    // In ORDERED MODE, we should hold the lock on the subgroup's message state
     uint32_t commit_send(uint32_t ready_to_be_sent = 1) {
         return sst->index[my_row][index_offset] += ready_to_be_sent;
     }
@@ -1,10 +1,15 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <string>
 #include <utility>
+#include <vector>
 
 
 namespace sst {
@@ -24,56 +29,145 @@ enum class PredicateType {
     TRANSITION
 };
 
+/**
+ * A range of bytes that a predicate reads, at the same offset in every row of
+ * the SST. Offsets are relative to the start of a row, which is the same as
+ * the offset from SST::getBaseAddress() of the field's entry in row 0.
+ */
+struct PredicateInput {
+    std::size_t offset;
+    std::size_t length;
+};
+
+/** Evaluation statistics of a single predicate, as reported by Predicates::get_stats(). */
+struct PredicateStats {
+    std::string name;
+    PredicateType type;
+    /** The number of times the predicate function was called */
+    uint64_t num_evaluations;
+    /** The number of passes that skipped the predicate because its inputs had not changed */
+    uint64_t num_skipped;
+    /** The number of times the trigger was run */
+    uint64_t num_fired;
+    /** Total time spent in the predicate function, in nanoseconds, while metrics were enabled */
+    uint64_t evaluation_ns;
+    /** Total time spent in the trigger, in nanoseconds, while metrics were enabled */
+    uint64_t trigger_ns;
+};
+
 template <class DerivedSST>
 class Predicates {
     using pred = std::function<bool(const DerivedSST&)>;
     using trig = std::function<void(DerivedSST&)>;
-    using pred_list = std::list<std::unique_ptr<std::pair<pred, std::shared_ptr<trig>>>>;
+
+    /**
+     * A registered (predicate, trigger) pair and its bookkeeping. Predicates
+     * that declare their inputs are only evaluated when the bytes in those
+     * inputs differ from the copy in input_snapshot, which the SST refreshes
+     * right before each evaluation. All fields except alive are protected by
+     * predicate_mutex.
+     */
+    struct PredicateEntry {
+        pred predicate;
+        std::shared_ptr<trig> trigger;
+        PredicateType type;
+        std::string name;
+        std::vector<PredicateInput> inputs;
+        std::vector<char> input_snapshot;
+        bool snapshot_valid = false;
+        /** The result of the previous evaluation */
+        bool last_state = false;
+        /** Cleared when the predicate is removed; dead entries are compacted away by the SST */
+        std::atomic<bool> alive{true};
+        /** Set by wake() to evaluate the predicate on the next pass even if its inputs did not change */
+        std::atomic<bool> woken{false};
+        uint64_t num_evaluations = 0;
+        uint64_t num_skipped = 0;
+        uint64_t num_fired = 0;
+        uint64_t evaluation_ns = 0;
+        uint64_t trigger_ns = 0;
+    };
+    using pred_list = std::list<std::shared_ptr<PredicateEntry>>;
     /** Predicate list for one-time predicates. */
     pred_list one_time_predicates;
     /** Predicate list for recurrent predicates */
     pred_list recurrent_predicates;
     /** Predicate list for transition predicates */
     pred_list transition_predicates;
-    /** Contains one entry for every predicate in `transition_predicates`, in parallel. */
-    std::list<bool> transition_predicate_states;
+    /** The number of entries in the lists that have been removed but not yet compacted. */
+    std::size_t num_dead = 0;
     // SST needs to read these predicate lists directly
     friend class SST<DerivedSST>;
 
     std::mutex predicate_mutex;
 
+    /** Marks an entry as removed; the caller must hold predicate_mutex. */
+    void retire(PredicateEntry& entry) {
+        if(entry.alive.exchange(false)) {
+            num_dead++;
+        }
+    }
+
+    /** Erases removed entries from the predicate lists; the caller must hold predicate_mutex. */
+    void compact() {
+        auto is_dead = [](const std::shared_ptr<PredicateEntry>& entry) { return !entry->alive; };
+        one_time_predicates.remove_if(is_dead);
+        recurrent_predicates.remove_if(is_dead);
+        transition_predicates.remove_if(is_dead);
+        num_dead = 0;
+    }
+
 public:
     class pred_handle {
-        bool valid;
-        typename pred_list::iterator iter;
+        std::weak_ptr<PredicateEntry> entry;
         PredicateType type;
         friend class Predicates;
 
     public:
-        pred_handle() : valid(false), type(PredicateType::ONE_TIME) {}
-        pred_handle(typename pred_list::iterator iter, PredicateType type)
-                : valid{true}, iter{iter}, type{type} {}
+        pred_handle() : type(PredicateType::ONE_TIME) {}
+        pred_handle(std::weak_ptr<PredicateEntry> entry, PredicateType type)
+                : entry{std::move(entry)}, type{type} {}
         pred_handle(pred_handle&) = delete;
         pred_handle(pred_handle&& other)
-                : pred_handle(std::move(other.iter), other.type) {
-            other.valid = false;
+                : pred_handle(std::move(other.entry), other.type) {
+            other.entry.reset();
         }
         pred_handle& operator=(pred_handle&) = delete;
         pred_handle& operator=(pred_handle&& other) {
-            iter = std::move(other.iter);
+            entry = std::move(other.entry);
             type = other.type;
-            valid = true;
-            other.valid = false;
+            other.entry.reset();
             return *this;
         }
         bool is_valid() const {
-            return valid && (*iter);
+            auto locked_entry = entry.lock();
+            return locked_entry && locked_entry->alive;
         }
     };
 
     /** Inserts a single (predicate, trigger) pair to the appropriate predicate list. */
     pred_handle insert(pred predicate, trig trigger,
-                       PredicateType type = PredicateType::ONE_TIME);
+                       PredicateType type = PredicateType::ONE_TIME) {
+        return insert(predicate, trigger, type, "", {});
+    }
+
+    /**
+     * Inserts a single (predicate, trigger) pair that only needs to be
+     * evaluated when the SST entries it reads change.
+     * @param predicate The predicate to insert.
+     * @param trigger The trigger to execute when the predicate is true.
+     * @param type The type of predicate being inserted
+     * @param name A name for the predicate in get_stats()
+     * @param inputs The SST entries that the predicate and the trigger read.
+     * If this is not empty, the predicate is skipped on every pass in which
+     * none of these bytes changed in any row, unless it is a recurrent
+     * predicate that was true on its last evaluation. It must then depend
+     * only on these entries, on state that only its own trigger modifies,
+     * and on local state whose writers call wake() after changing it.
+     * An empty list means the predicate is evaluated on every pass.
+     */
+    pred_handle insert(pred predicate, trig trigger, PredicateType type,
+                       const std::string& name, const std::vector<PredicateInput>& inputs);
 
     /** Inserts a predicate with a list of triggers (which will be run in
      * sequence) to the appropriate predicate list. */
@@ -89,59 +183,86 @@ public:
     /** Removes a (predicate, trigger) pair previously registered with insert(). */
     void remove(pred_handle& pred);
 
+    /**
+     * Makes the SST evaluate a predicate on its next pass even if none of its
+     * inputs changed, for predicates that also read local state. This takes
+     * no lock, and does nothing if the predicate has been removed.
+     */
+    void wake(const pred_handle& pred) {
+        auto entry = pred.entry.lock();
+        if(entry) {
+            entry->woken = true;
+        }
+    }
+
     /** Deletes all predicates, including evolvers and their triggers. */
     void clear();
+
+    /** @return the evaluation statistics of every predicate that has not been removed. */
+    std::vector<PredicateStats> get_stats();
 };
 
 /**
  * This is a convenience method for when the predicate has only one trigger; it
  * automatically chooses the right list based on the predicate type. To insert
- * a predicate with multiple triggers, use std::list::insert() directly on the
- * appropriate predicate list member.
- * @param predicate The predicate to insert.
- * @param trigger The trigger to execute when the predicate is true.
- * @param type The type of predicate being inserted; default is
- * PredicateType::ONE_TIME
+ * a predicate with multiple triggers, use the overload that takes a list of
+ * triggers.
  */
 template <class DerivedSST>
-auto Predicates<DerivedSST>::insert(pred predicate, trig trigger, PredicateType type) -> pred_handle {
+auto Predicates<DerivedSST>::insert(pred predicate, trig trigger, PredicateType type,
+                                    const std::string& name, const std::vector<PredicateInput>& inputs) -> pred_handle {
+    auto entry = std::make_shared<PredicateEntry>();
+    entry->predicate = predicate;
+    entry->trigger = std::make_shared<trig>(trigger);
+    entry->type = type;
+    entry->name = name;
+    entry->inputs = inputs;
     std::lock_guard<std::mutex> lock(predicate_mutex);
     if(type == PredicateType::ONE_TIME) {
-        one_time_predicates.push_back(std::make_unique<std::pair<pred, std::shared_ptr<trig>>>(
-                predicate, std::make_shared<trig>(trigger)));
-        return pred_handle(--one_time_predicates.end(), type);
+        one_time_predicates.push_back(entry);
     } else if(type == PredicateType::RECURRENT) {
-        recurrent_predicates.push_back(std::make_unique<std::pair<pred, std::shared_ptr<trig>>>(
-                predicate, std::make_shared<trig>(trigger)));
-        return pred_handle(--recurrent_predicates.end(), type);
+        recurrent_predicates.push_back(entry);
     } else {
-        transition_predicates.push_back(std::make_unique<std::pair<pred, std::shared_ptr<trig>>>(
-                predicate, std::make_shared<trig>(trigger)));
-        transition_predicate_states.push_back(false);
-        return pred_handle(--transition_predicates.end(), type);
+        transition_predicates.push_back(entry);
     }
+    return pred_handle(entry, type);
 }
 
 template <class DerivedSST>
 void Predicates<DerivedSST>::remove(pred_handle& handle) {
     std::lock_guard<std::mutex> lock(predicate_mutex);
-    if(!handle.is_valid()) {
-        return;
+    auto entry = handle.entry.lock();
+    if(entry) {
+        retire(*entry);
     }
-    handle.iter->reset();
-    handle.valid = false;
+    handle.entry.reset();
 }
 
 template <class DerivedSST>
 void Predicates<DerivedSST>::clear() {
     std::lock_guard<std::mutex> lock(predicate_mutex);
-    using ptr_to_pred = std::unique_ptr<std::pair<pred, std::shared_ptr<trig>>>;
-    std::for_each(one_time_predicates.begin(), one_time_predicates.end(),
-                  [](ptr_to_pred& ptr) { ptr.reset(); });
-    std::for_each(recurrent_predicates.begin(), recurrent_predicates.end(),
-                  [](ptr_to_pred& ptr) { ptr.reset(); });
-    std::for_each(transition_predicates.begin(), transition_predicates.end(),
-                  [](ptr_to_pred& ptr) { ptr.reset(); });
+    for(pred_list* list : {&one_time_predicates, &recurrent_predicates, &transition_predicates}) {
+        for(auto& entry : *list) {
+            retire(*entry);
+        }
+    }
+}
+
+template <class DerivedSST>
+std::vector<PredicateStats> Predicates<DerivedSST>::get_stats() {
+    std::lock_guard<std::mutex> lock(predicate_mutex);
+    std::vector<PredicateStats> stats;
+    for(pred_list* list : {&one_time_predicates, &recurrent_predicates, &transition_predicates}) {
+        for(auto& entry : *list) {
+            if(!entry->alive) {
+                continue;
+            }
+            stats.push_back(PredicateStats{entry->name, entry->type,
+                                           entry->num_evaluations, entry->num_skipped, entry->num_fired,
+                                           entry->evaluation_ns, entry->trigger_ns});
+        }
+    }
+    return stats;
 }
 
 } /* namespace sst */
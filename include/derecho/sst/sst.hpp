@@ -179,6 +179,25 @@ private:
     std::atomic<bool> thread_shutdown;
 
     void detect();
+    /**
+     * Compares the inputs a predicate declared with the snapshot taken before
+     * its previous evaluation, and refreshes the snapshot if they differ.
+     * Must be called with the predicate lock held.
+     * @return true if the predicate has to be evaluated again
+     */
+    bool refresh_predicate_inputs(typename Predicates<DerivedSST>::PredicateEntry& entry);
+    /**
+     * Evaluates a predicate unless its inputs are unchanged, updating its
+     * statistics. Must be called with the predicate lock held.
+     * @return the value of the predicate, or false if it was skipped
+     */
+    bool evaluate_predicate(typename Predicates<DerivedSST>::PredicateEntry& entry);
+    /**
+     * Runs a predicate's trigger with the predicate lock released, and
+     * records how long it took.
+     */
+    void run_trigger(typename Predicates<DerivedSST>::PredicateEntry& entry,
+                     std::unique_lock<std::mutex>& predicates_lock);
 
 public:
     Predicates<DerivedSST> predicates;
@@ -0,0 +1,158 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "time.h"
+
+namespace derecho {
+namespace metrics {
+
+/**
+ * The quantities recorded along the ordered-multicast pipeline. The ones
+ * ending in _NS are durations in nanoseconds; the others are sizes.
+ */
+enum class Metric : uint32_t {
+    // time a sender waited in MulticastGroup::send() for a free send buffer
+    SEND_BUFFER_WAIT_NS,
+    // size of the messages sent through the SST (one sample per message)
+    SST_SEND_BYTES,
+    // size of the messages sent through RDMC (one sample per message)
+    RDMC_SEND_BYTES,
+    // time from the local receipt of a message to the point it can be delivered in order
+    RECEIVE_TO_STABLE_NS,
+    // time from then until its delivery upcall returns
+    STABLE_TO_DELIVER_NS,
+    // time from the persistence request posted after delivery until the version is persisted locally
+    DELIVER_TO_PERSIST_NS,
+    // time from the verification request posted once a version is persisted by the shard until it is verified
+    PERSIST_TO_VERIFY_NS,
+    // time the SST predicate thread spends in one pass over the predicates
+    PREDICATE_LOOP_NS,
+    // number of requests in the PersistenceManager queue, sampled when a request is posted
+    PERSISTENCE_QUEUE_DEPTH,
+    // time spent in RPCManager::rpc_message_handler for an ordered RPC message
+    RPC_HANDLER_NS,
+    // time from the wedge of a view to the installation of the next one, on each member that stays
+    VIEW_CHANGE_NS,
+    NUM_METRICS
+};
+
+/** The subgroup number recorded for the metrics that are not about a subgroup. */
+constexpr uint32_t NO_SUBGROUP = UINT32_MAX;
+/**
+ * Subgroups with numbers at or above this one are recorded together, under
+ * subgroup number MAX_TRACKED_SUBGROUPS.
+ */
+constexpr uint32_t MAX_TRACKED_SUBGROUPS = 64;
+/** Samples are counted in power-of-two buckets: bucket i holds the values v with 2^(i-1) <= v < 2^i. */
+constexpr uint32_t NUM_BUCKETS = 64;
+
+/** The merged samples of one metric in one subgroup. */
+struct Summary {
+    Metric metric;
+    uint32_t subgroup;
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    std::array<uint64_t, NUM_BUCKETS> buckets;
+
+    double mean() const { return count == 0 ? 0.0 : static_cast<double>(sum) / count; }
+    /**
+     * @param p a percentile in [0, 100]
+     * @return an upper bound of the p-th percentile, which is the upper bound
+     * of the bucket holding it, or max if that is lower.
+     */
+    uint64_t percentile(double p) const;
+};
+
+using export_callback_t = std::function<void(const std::vector<Summary>&)>;
+
+namespace detail {
+extern std::atomic<bool> metrics_enabled;
+void record(Metric metric, uint32_t subgroup, uint64_t value);
+}  // namespace detail
+
+/** @return true if metrics are being recorded. */
+inline bool enabled() {
+    return detail::metrics_enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @return the current time in nanoseconds, for the start of a duration, or 0
+ * if metrics are disabled so the disabled path does not read the clock.
+ */
+inline uint64_t start_time() {
+    return enabled() ? get_time() : 0;
+}
+
+/**
+ * Record a sample. Each thread keeps its own histograms, which only it
+ * writes, so this takes no lock; they are merged when a snapshot is taken.
+ */
+inline void record(Metric metric, uint32_t subgroup, uint64_t value) {
+    if(enabled()) {
+        detail::record(metric, subgroup, value);
+    }
+}
+
+/** Record the time elapsed since start_ns, which was returned by start_time(). */
+inline void record_since(Metric metric, uint32_t subgroup, uint64_t start_ns) {
+    if(enabled() && start_ns != 0) {
+        detail::record(metric, subgroup, get_time() - start_ns);
+    }
+}
+
+/** Turn recording on or off. The exporter is not affected. */
+void set_enabled(bool enable);
+
+/**
+ * Merge the histograms of every thread.
+ * @return a Summary for every metric and subgroup with at least one sample,
+ * ordered by metric, then subgroup.
+ */
+std::vector<Summary> snapshot();
+
+/** Drop all the samples recorded so far. */
+void reset();
+
+/**
+ * Set a function to call with a snapshot every DERECHO/metrics_interval_ms,
+ * on the exporter thread. Pass nullptr to remove it.
+ */
+void set_export_callback(const export_callback_t& callback);
+
+/** @return the name of a metric, as used in the text format. */
+const char* metric_name(Metric metric);
+
+/**
+ * Format a snapshot as text, one line per Summary:
+ * <metric> <subgroup|-> count=<n> mean=<v> p50=<v> p99=<v> max=<v>
+ */
+std::string to_string(const std::vector<Summary>& summaries);
+
+/**
+ * If DERECHO/enable_metrics is set, start recording and start the exporter
+ * thread, which hands a snapshot to the export callback and writes it to
+ * DERECHO/metrics_file every DERECHO/metrics_interval_ms, and answers each
+ * connection to the Unix socket DERECHO/metrics_socket with a snapshot. Every
+ * Group calls it on construction; the calls are counted, and only the first
+ * one has an effect.
+ */
+void initialize();
+
+/**
+ * Undo a call to initialize(); the last one stops recording and stops the
+ * exporter thread. The samples recorded so far stay available to snapshot().
+ */
+void shutdown();
+
+}  // namespace metrics
+}  // namespace derecho
+
+#endif  // METRICS_HPP
@@ -121,10 +121,9 @@ int main() {
                 int num_nodes = sst.get_num_rows();
                 resources* res;
                 double times[num_nodes];
-                const auto tid = std::this_thread::get_id();
                 // get id first
-                uint32_t id = util::polling_data.get_index(tid);
-                util::polling_data.set_waiting(tid);
+                uint32_t id = util::polling_data.get_index();
+                util::polling_data.set_waiting();
 
                 // read the other nodes' time
                 for(int i = 0; i < num_nodes; ++i) {
@@ -141,9 +140,9 @@ int main() {
                     }
                 }
                 for(int i = 0; i < num_nodes; ++i) {
-                    util::polling_data.get_completion_entry(tid);
+                    util::polling_data.get_completion_entry();
                 }
-                util::polling_data.reset_waiting(tid);
+                util::polling_data.reset_waiting();
 
                 double sum = 0.0;
                 // compute the average
@@ -27,7 +27,7 @@ void initialize(int node_rank, const map<uint32_t, std::pair<string, uint16_t>>
 #endif
 }
 
-void wait_for_completion(std::thread::id tid) {
+void wait_for_completion() {
     std::optional<std::pair<int32_t, int32_t>> ce;
 
     unsigned long start_time_msec;
@@ -40,7 +40,7 @@ void wait_for_completion(std::thread::id tid) {
 
     while(true) {
         // check if polling result is available
-        ce = util::polling_data.get_completion_entry(tid);
+        ce = util::polling_data.get_completion_entry();
         if(ce) {
             break;
         }
@@ -93,11 +93,10 @@ int main() {
     resources_two_sided *res = new resources_two_sided(r_index, read_buf, write_buf, sizeof(int), sizeof(int), r_index);
 #endif
 
-    const auto tid = std::this_thread::get_id();
     // get id first
-    uint32_t id = util::polling_data.get_index(tid);
+    uint32_t id = util::polling_data.get_index();
 
-    util::polling_data.set_waiting(tid);
+    util::polling_data.set_waiting();
 #ifdef USE_VERBS_API
     struct verbs_sender_ctxt sctxt;
 #else
@@ -115,12 +114,12 @@ int main() {
 
         a = 1;
         res->post_two_sided_send(sizeof(int));
-        util::polling_data.set_waiting(tid);
+        util::polling_data.set_waiting();
         res->post_two_sided_receive(&sctxt, sizeof(int));
  
         cout << "Receive buffer posted" << endl;
-        wait_for_completion(tid);
-        util::polling_data.reset_waiting(tid);
+        wait_for_completion();
+        util::polling_data.reset_waiting();
         cout << "Data received" << endl;
  
         while(b == 0) {
@@ -128,11 +127,11 @@ int main() {
     }
 
     else {
-        util::polling_data.set_waiting(tid);
+        util::polling_data.set_waiting();
         res->post_two_sided_receive(&sctxt, sizeof(int));
         cout << "Receive buffer posted" << endl;
-        wait_for_completion(tid);
-        util::polling_data.reset_waiting(tid);
+        wait_for_completion();
+        util::polling_data.reset_waiting();
         cout << "Data received" << endl;
         while(b == 0) {
         }
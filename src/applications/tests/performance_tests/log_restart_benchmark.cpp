@@ -0,0 +1,184 @@
+/**
+ * @file log_restart_benchmark.cpp
+ *
+ * This program measures how long a group with large persistent logs takes to
+ * come back up after a total restart. Based on log_restart_test, it creates a
+ * group in which every node is a member of num_subgroups subgroups, each with
+ * an object of NUM_FIELDS Persistent<T> fields, so each node has
+ * num_subgroups * NUM_FIELDS logs.
+ *
+ * Run it on every node with num_updates > 0 to fill the logs: each node sends
+ * num_updates updates to every subgroup, each of which appends one entry to
+ * every field, and the group shuts down once they are persisted. Then run it
+ * again on every node with num_updates = 0 to measure the restart. Both runs
+ * report the time from the start of the Group constructor to the first view
+ * and how long the logs took to load (see PERS/load_threads). Upon completion,
+ * the results are appended to file data_log_restart on the node of rank 0.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <derecho/core/derecho.hpp>
+
+#include "bytes_object.hpp"
+#include "log_results.hpp"
+
+using std::cout;
+using std::endl;
+using namespace persistent;
+using namespace std::chrono;
+
+/* The number of Persistent<T> fields in each subgroup's object */
+#define NUM_FIELDS 4
+
+class RestartThing : public mutils::ByteRepresentable, public derecho::PersistsFields {
+    Persistent<test::Bytes> field0;
+    Persistent<test::Bytes> field1;
+    Persistent<test::Bytes> field2;
+    Persistent<test::Bytes> field3;
+
+public:
+    // deserialization constructor
+    RestartThing(Persistent<test::Bytes>& f0, Persistent<test::Bytes>& f1,
+                 Persistent<test::Bytes>& f2, Persistent<test::Bytes>& f3)
+            : field0(std::move(f0)), field1(std::move(f1)), field2(std::move(f2)), field3(std::move(f3)) {}
+    // default constructor; the fields are named after the subgroup, so the preloader finds them
+    RestartThing(PersistentRegistry* pr)
+            : field0(std::make_unique<test::Bytes>, nullptr, pr),
+              field1(std::make_unique<test::Bytes>, nullptr, pr),
+              field2(std::make_unique<test::Bytes>, nullptr, pr),
+              field3(std::make_unique<test::Bytes>, nullptr, pr) {}
+
+    void update(const test::Bytes& bytes) {
+        *field0 = bytes;
+        *field1 = bytes;
+        *field2 = bytes;
+        *field3 = bytes;
+    }
+
+    REGISTER_RPC_FUNCTIONS(RestartThing, ORDERED_TARGETS(update));
+    DEFAULT_SERIALIZATION_SUPPORT(RestartThing, field0, field1, field2, field3);
+};
+
+struct exp_result {
+    uint32_t num_nodes;
+    uint32_t num_subgroups;
+    uint32_t num_updates;
+    std::size_t num_logs;
+    int64_t num_entries;
+    double max_load_ms;
+    double total_load_ms;
+    double time_to_view_ms;
+
+    void print(std::ofstream& fout) {
+        fout << num_nodes << " " << num_subgroups << " " << num_updates << " "
+             << num_logs << " " << num_entries << " " << max_load_ms << " "
+             << total_load_ms << " " << time_to_view_ms << endl;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    pthread_setname_np(pthread_self(), "restart_bench");
+    int dashdash_pos = argc - 1;
+    while(dashdash_pos > 0) {
+        if(strcmp(argv[dashdash_pos], "--") == 0) {
+            break;
+        }
+        dashdash_pos--;
+    }
+
+    if((argc - dashdash_pos) < 4) {
+        cout << "Insufficient number of command line arguments" << endl;
+        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] num_nodes num_subgroups num_updates" << endl;
+        cout << "Run it with num_updates > 0 to fill the logs, then with num_updates = 0 to time the restart." << endl;
+        return -1;
+    }
+
+    derecho::Conf::initialize(argc, argv);
+    const uint32_t num_nodes = std::stoi(argv[dashdash_pos + 1]);
+    const uint32_t num_subgroups = std::stoi(argv[dashdash_pos + 2]);
+    const uint32_t num_updates = std::stoi(argv[dashdash_pos + 3]);
+    const std::size_t rpc_header_size = sizeof(std::size_t) + sizeof(std::size_t)
+                                        + derecho::remote_invocation_utilities::header_space();
+    const std::size_t update_size = std::min<std::size_t>(
+            1024, derecho::getConfUInt64(CONF_SUBGROUP_DEFAULT_MAX_PAYLOAD_SIZE) - rpc_header_size);
+
+    // Each subgroup is done when the last of the num_nodes * num_updates updates is persisted
+    std::mutex versions_mutex;
+    std::map<derecho::subgroup_id_t, uint64_t> num_delivered;
+    std::map<derecho::subgroup_id_t, persistent::version_t> last_versions;
+    std::atomic<uint32_t> num_subgroups_done = 0;
+    auto stability_callback = [&](derecho::subgroup_id_t subgroup, uint32_t, long long int,
+                                  std::optional<std::pair<char*, long long int>>, persistent::version_t ver) {
+        std::lock_guard<std::mutex> lock(versions_mutex);
+        if(++num_delivered[subgroup] == static_cast<uint64_t>(num_nodes) * num_updates) {
+            last_versions[subgroup] = ver;
+        }
+    };
+    auto persistence_callback = [&](derecho::subgroup_id_t subgroup, persistent::version_t ver) {
+        std::lock_guard<std::mutex> lock(versions_mutex);
+        auto last_version = last_versions.find(subgroup);
+        if(last_version != last_versions.end() && ver >= last_version->second) {
+            last_versions.erase(last_version);
+            num_subgroups_done++;
+        }
+    };
+    derecho::UserMessageCallbacks callback_set{stability_callback, nullptr, persistence_callback};
+
+    derecho::SubgroupInfo subgroup_info(derecho::DefaultSubgroupAllocator(
+            {{std::type_index(typeid(RestartThing)),
+              derecho::identical_subgroups_policy(num_subgroups, derecho::fixed_even_shards(1, num_nodes))}}));
+    auto restart_thing_factory = [](PersistentRegistry* pr, derecho::subgroup_id_t) {
+        return std::make_unique<RestartThing>(pr);
+    };
+
+    auto start_time = steady_clock::now();
+    derecho::Group<RestartThing> group(callback_set, subgroup_info, {}, std::vector<derecho::view_upcall_t>{},
+                                       restart_thing_factory);
+    auto view_time = steady_clock::now();
+    const double time_to_view_ms = duration_cast<microseconds>(view_time - start_time).count() / 1000.0;
+
+    std::vector<LogPreloader::LoadReport> reports = LogPreloader::getLoadReports();
+    int64_t num_entries = 0;
+    double max_load_ms = 0.0;
+    double total_load_ms = 0.0;
+    for(const auto& report : reports) {
+        num_entries += report.num_entries;
+        max_load_ms = std::max(max_load_ms, report.load_ms);
+        total_load_ms += report.load_ms;
+    }
+    cout << "Time to first view: " << time_to_view_ms << " ms" << endl;
+    cout << "Preloaded " << reports.size() << " of " << num_subgroups * NUM_FIELDS << " logs with "
+         << num_entries << " entries; slowest log " << max_load_ms << " ms, all logs "
+         << total_load_ms << " ms of loading" << endl;
+
+    if(num_updates > 0) {
+        std::vector<char> buf(update_size, 'a');
+        test::Bytes bytes(buf.data(), update_size);
+        for(uint32_t i = 0; i < num_updates; ++i) {
+            for(uint32_t subgroup_index = 0; subgroup_index < num_subgroups; ++subgroup_index) {
+                group.get_subgroup<RestartThing>(subgroup_index).ordered_send<RPC_NAME(update)>(bytes);
+            }
+        }
+        while(num_subgroups_done < num_subgroups) {
+        }
+        cout << "Filled the logs with " << num_updates * num_nodes << " updates per subgroup" << endl;
+    }
+
+    if(group.get_my_rank() == 0) {
+        log_results(exp_result{num_nodes, num_subgroups, num_updates, reports.size(), num_entries,
+                               max_load_ms, total_load_ms, time_to_view_ms},
+                    "data_log_restart");
+    }
+    group.barrier_sync();
+    group.leave();
+    return 0;
+}
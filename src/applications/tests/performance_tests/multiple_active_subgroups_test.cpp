@@ -4,6 +4,7 @@
 #include <map>
 #include <memory>
 #include <optional>
+#include <thread>
 #include <time.h>
 #include <vector>
 
@@ -24,6 +25,7 @@ struct exp_result {
     uint32_t window_size;
     uint32_t num_messages;
     uint32_t num_subgroups;
+    bool parallel_senders;
     double bw;
 
     void print(std::ofstream& fout) {
@@ -31,24 +33,36 @@ struct exp_result {
              << max_msg_size << " " << window_size << " "
              << num_messages << " "
              << num_subgroups << " "
+             << parallel_senders << " "
              << bw << endl;
     }
 };
 
 int main(int argc, char* argv[]) {
-    if(argc < 4 || (argc > 4 && strcmp("--", argv[argc - 4]))) {
+    int dashdash_pos = argc - 1;
+    while(dashdash_pos > 0) {
+        if(strcmp(argv[dashdash_pos], "--") == 0) {
+            break;
+        }
+        dashdash_pos--;
+    }
+
+    if((argc - dashdash_pos) < 4) {
         cout << "Invalid command line arguments." << endl;
         cout << "Usage:" << argv[0]
-             << "[ derecho-config-list -- ] num_nodes, num_subgroups, num_messages"
+             << "[ derecho-config-list -- ] num_nodes, num_subgroups, num_messages [parallel_senders (0 - one thread sends in all subgroups, 1 - one thread per subgroup)]"
              << endl;
         return 1;
     }
     pthread_setname_np(pthread_self(), "main");
 
     // initialize the special arguments for this test
-    const uint num_nodes = std::stoi(argv[argc - 3]);
-    const uint num_subgroups = std::stoi(argv[argc - 2]);
-    const uint num_messages = std::stoi(argv[argc - 1]);
+    const uint num_nodes = std::stoi(argv[dashdash_pos + 1]);
+    const uint num_subgroups = std::stoi(argv[dashdash_pos + 2]);
+    const uint num_messages = std::stoi(argv[dashdash_pos + 3]);
+    // With one sending thread per subgroup, the aggregate bandwidth should grow
+    // with the number of subgroups as long as the subgroups don't share a bottleneck
+    const bool parallel_senders = (argc - dashdash_pos) > 4 && std::stoi(argv[dashdash_pos + 4]) != 0;
 
     // Read configurations from the command line options as well as the default config file
     Conf::initialize(argc, argv);
@@ -110,6 +124,20 @@ int main(int argc, char* argv[]) {
         for(uint i = 0; i < num_subgroups; ++i) {
             raw_subgroups.emplace_back(group.get_subgroup<RawObject>(i));
         }
+        if(parallel_senders) {
+            std::vector<std::thread> sender_threads;
+            for(uint j = 0; j < num_subgroups; ++j) {
+                sender_threads.emplace_back([&, j]() {
+                    for(uint i = 0; i < num_messages; ++i) {
+                        raw_subgroups[j].get().send(max_msg_size, [](char* buf) {});
+                    }
+                });
+            }
+            for(auto& sender_thread : sender_threads) {
+                sender_thread.join();
+            }
+            return;
+        }
         for(uint i = 0; i < num_messages; ++i) {
             for(uint j = 0; j < num_subgroups; ++j) {
                 raw_subgroups[j].get().send(max_msg_size, [](char* buf) {});
@@ -135,10 +163,13 @@ int main(int argc, char* argv[]) {
     double avg_bw = aggregate_bandwidth(members_order, members_order[node_rank], bw);
     // log the result at the leader node
     if(node_rank == 0) {
+        cout << "Aggregate bandwidth: " << avg_bw << " GB/s, "
+             << avg_bw / num_subgroups << " GB/s per subgroup" << endl;
         log_results(exp_result{num_nodes, max_msg_size,
                                getConfUInt32(CONF_SUBGROUP_DEFAULT_WINDOW_SIZE),
                                num_messages,
                                num_subgroups,
+                               parallel_senders,
                                avg_bw},
                     "data_multiple_active_subgroups");
     }
@@ -0,0 +1,217 @@
+/*
+ * This test measures how long a call to Replicated<T>::ordered_send takes to
+ * return, in microseconds, and how many heap allocations it makes, as a
+ * function of
+ * 1. the number of nodes
+ * 2. the number of senders (all sending, half nodes sending, one sending)
+ * 3. number of messages sent per sender
+ * The RPC function takes a single integer and has no return value, so the
+ * numbers show the cost of the send path itself rather than of serialization.
+ * Allocations are counted by replacing the global operator new, and only while
+ * the sending thread is inside ordered_send. The first window_size sends of
+ * each sender are a warm-up and are not measured.
+ * Upon completion, the results are appended to file data_ordered_send_latency on the
+ * highest-ranked node, which is always a sender
+ */
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "aggregate_latency.hpp"
+#include "log_results.hpp"
+#include "partial_senders_allocator.hpp"
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/derecho.hpp>
+
+using std::cout;
+using std::endl;
+using namespace std::chrono;
+
+// allocation counting, enabled per thread
+static thread_local bool count_allocations = false;
+static thread_local uint64_t num_allocations = 0;
+
+void* operator new(std::size_t size) {
+    if(count_allocations) {
+        ++num_allocations;
+    }
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if(ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+/**
+ * RPC Object with a single function that accepts an integer
+ */
+class TestObject {
+public:
+    void put(const uint64_t& value) {
+    }
+
+    REGISTER_RPC_FUNCTIONS(TestObject, ORDERED_TARGETS(put));
+};
+
+struct exp_result {
+    int num_nodes;
+    uint32_t num_senders_selector;
+    unsigned int window_size;
+    uint32_t num_messages;
+    double latency;
+    double stddev;
+    double allocations_per_send;
+
+    void print(std::ofstream& fout) {
+        fout << num_nodes << " " << num_senders_selector << " "
+             << window_size << " " << num_messages << " "
+             << latency << " " << stddev << " "
+             << allocations_per_send << endl;
+    }
+};
+
+#define DEFAULT_PROC_NAME "ordered_send_lat_test"
+
+int main(int argc, char* argv[]) {
+    int dashdash_pos = argc - 1;
+    while(dashdash_pos > 0) {
+        if(strcmp(argv[dashdash_pos], "--") == 0) {
+            break;
+        }
+        dashdash_pos--;
+    }
+
+    if((argc - dashdash_pos) < 4) {
+        cout << "Insufficient number of command line arguments" << endl;
+        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] num_nodes, num_senders_selector (0 - all senders, 1 - half senders, 2 - one sender), num_messages [proc_name]" << endl;
+        std::cout << "Note: proc_name sets the process's name as displayed in ps and pkill commands, default is " DEFAULT_PROC_NAME << std::endl;
+        return -1;
+    }
+
+    const int num_nodes = std::stoi(argv[dashdash_pos + 1]);
+    const uint32_t num_senders_selector = std::stoi(argv[dashdash_pos + 2]);
+    const uint32_t num_messages = std::stoi(argv[dashdash_pos + 3]);
+
+    if((argc - dashdash_pos) > 4) {
+        pthread_setname_np(pthread_self(), argv[dashdash_pos + 4]);
+    } else {
+        pthread_setname_np(pthread_self(), DEFAULT_PROC_NAME);
+    }
+
+    // Read configurations from the command line options as well as the default config file
+    derecho::Conf::initialize(argc, argv);
+    const uint32_t window_size = derecho::getConfUInt32(CONF_SUBGROUP_DEFAULT_WINDOW_SIZE);
+
+    const PartialSendMode senders_mode = num_senders_selector == 0
+                                                 ? PartialSendMode::ALL_SENDERS
+                                                 : (num_senders_selector == 1
+                                                            ? PartialSendMode::HALF_SENDERS
+                                                            : PartialSendMode::ONE_SENDER);
+    uint32_t num_senders = num_nodes;
+    if(senders_mode == PartialSendMode::HALF_SENDERS) {
+        num_senders = num_nodes / 2;
+    } else if(senders_mode == PartialSendMode::ONE_SENDER) {
+        num_senders = 1;
+    }
+    const uint64_t total_num_messages = static_cast<uint64_t>(num_senders) * (window_size + num_messages);
+
+    // variable 'done' tracks the end of the test
+    std::atomic<bool> done = false;
+    auto stability_callback = [&done, total_num_messages, num_delivered = 0ull](
+                                      uint32_t subgroup, uint32_t sender_id, long long int index,
+                                      std::optional<std::pair<char*, long long int>> data,
+                                      persistent::version_t ver) mutable {
+        if(++num_delivered == total_num_messages) {
+            done = true;
+        }
+    };
+
+    derecho::SubgroupInfo subgroup_info(PartialSendersAllocator(num_nodes, senders_mode));
+    auto test_object_factory = [](persistent::PersistentRegistry*, derecho::subgroup_id_t) {
+        return std::make_unique<TestObject>();
+    };
+    derecho::Group<TestObject> group(derecho::UserMessageCallbacks{stability_callback}, subgroup_info, {},
+                                     std::vector<derecho::view_upcall_t>{}, test_object_factory);
+    cout << "All nodes joined." << endl;
+
+    auto group_members = group.get_members();
+    const uint32_t my_rank = group.get_my_rank();
+    const uint32_t my_id = group_members[my_rank];
+
+    bool is_sending = true;
+    if((senders_mode == PartialSendMode::HALF_SENDERS) && (my_rank <= static_cast<uint32_t>(num_nodes - 1) / 2)) {
+        is_sending = false;
+    }
+    if((senders_mode == PartialSendMode::ONE_SENDER) && (my_rank != static_cast<uint32_t>(num_nodes - 1))) {
+        is_sending = false;
+    }
+
+    std::vector<double> latencies_us;
+    uint64_t measured_allocations = 0;
+    if(is_sending) {
+        derecho::Replicated<TestObject>& handle = group.get_subgroup<TestObject>();
+        latencies_us.reserve(num_messages);
+        for(uint64_t i = 0; i < window_size + num_messages; ++i) {
+            const bool measured = i >= window_size;
+            auto start_time = steady_clock::now();
+            num_allocations = 0;
+            count_allocations = true;
+            handle.ordered_send<RPC_NAME(put)>(i);
+            count_allocations = false;
+            auto end_time = steady_clock::now();
+            if(measured) {
+                measured_allocations += num_allocations;
+                latencies_us.push_back(duration_cast<nanoseconds>(end_time - start_time).count() / 1000.0);
+            }
+        }
+    }
+
+    // wait for the test to finish
+    while(!done) {
+    }
+
+    double avg_latency, avg_std_dev;
+    double allocations_per_send = 0.0;
+    if(is_sending) {
+        double total_time = 0.0;
+        for(double latency : latencies_us) {
+            total_time += latency;
+        }
+        const double average_time = total_time / num_messages;
+        double sum_of_square = 0.0;
+        for(double latency : latencies_us) {
+            sum_of_square += (latency - average_time) * (latency - average_time);
+        }
+        const double std_dev = num_messages > 1 ? sqrt(sum_of_square / (num_messages - 1)) : 0.0;
+        allocations_per_send = static_cast<double>(measured_allocations) / num_messages;
+        cout << "ordered_send latency: " << average_time << " us, "
+             << allocations_per_send << " heap allocations per send" << endl;
+        std::tie(avg_latency, avg_std_dev) = aggregate_latency(group_members, my_id, average_time, std_dev);
+    } else {
+        // if not a sender, then pass 0 as the latency (not counted)
+        std::tie(avg_latency, avg_std_dev) = aggregate_latency(group_members, my_id, 0.0, 0.0);
+    }
+
+    // log the result at the highest-ranked node, whose allocation count is reported
+    if(my_rank == static_cast<uint32_t>(num_nodes - 1)) {
+        log_results(exp_result{num_nodes, num_senders_selector, window_size, num_messages,
+                               avg_latency, avg_std_dev, allocations_per_send},
+                    "data_ordered_send_latency");
+    }
+    group.barrier_sync();
+    group.leave();
+}
@@ -41,12 +41,13 @@ struct persistent_bw_result {
     int num_senders_selector;
     int message_payload_size;
     int num_msgs;
+    bool group_commit;
     double persist_bw;
 
     void print(std::ofstream& fout) {
         fout << num_nodes << " " << num_senders_selector << " "
              << message_payload_size << " " << num_msgs << " "
-             << persist_bw << std::endl;
+             << group_commit << " " << persist_bw << std::endl;
     }
 };
 
@@ -105,7 +106,10 @@ int main(int argc, char* argv[]) {
             total_num_messages = num_msgs;
             break;
     }
-    // variable 'done' tracks the end of the test
+    // The test runs one round without group commit and one with it, in the same group.
+    // round_end is the number of messages delivered by the end of the current round.
+    std::atomic<long> round_end = total_num_messages;
+    // variable 'done' tracks the end of a round
     volatile bool done = false;
 
     // last_version and its flag is shared between the stability callback and persistence callback.
@@ -116,15 +120,15 @@ int main(int argc, char* argv[]) {
     auto stability_callback = [&last_version,
                                &last_version_set,
                                &send_complete_time,
-                               total_num_messages,
-                               num_delivered = 0u](uint32_t subgroup,
+                               &round_end,
+                               num_delivered = 0l](uint32_t subgroup,
                                                    uint32_t sender_id,
                                                    long long int index,
                                                    std::optional<std::pair<char*, long long int>> data,
                                                    persistent::version_t ver) mutable {
         //Count the total number of messages delivered
         ++num_delivered;
-        if(num_delivered == total_num_messages) {
+        if(num_delivered == round_end) {
             send_complete_time = std::chrono::steady_clock::now();
             last_version = ver;
             last_version_set = true;
@@ -132,7 +136,7 @@ int main(int argc, char* argv[]) {
     };
 
     auto persistence_callback = [&](derecho::subgroup_id_t subgroup, persistent::version_t ver) {
-        if(last_version_set && ver == last_version) {
+        if(last_version_set && ver >= last_version && !done) {
             persist_complete_time = std::chrono::steady_clock::now();
             done = true;
         }
@@ -164,49 +168,66 @@ int main(int argc, char* argv[]) {
     memset(bbuf, 0, msg_size);
     test::Bytes bs(bbuf, msg_size);
 
-    // Start the experiment timer
-    begin_time = std::chrono::steady_clock::now();
-    if(is_sending) {
-        derecho::Replicated<ByteArrayObject>& handle = group.get_subgroup<ByteArrayObject>();
-        for(int i = 0; i < num_msgs; i++) {
-            handle.ordered_send<RPC_NAME(change_pers_bytes)>(bs);
-        }
+    auto members = group.get_members();
+    double avg_persist_bw[2];
+    for(int round = 0; round < 2; round++) {
+        const bool group_commit = (round == 1);
+        group.set_persistence_group_commit(group_commit);
+        round_end = total_num_messages * (round + 1);
+        last_version_set = false;
+        done = false;
+        // Don't let any node start sending before every node is ready for the round
+        group.barrier_sync();
+
+        // Start the experiment timer
+        begin_time = std::chrono::steady_clock::now();
+        if(is_sending) {
+            derecho::Replicated<ByteArrayObject>& handle = group.get_subgroup<ByteArrayObject>();
+            for(int i = 0; i < num_msgs; i++) {
+                handle.ordered_send<RPC_NAME(change_pers_bytes)>(bs);
+            }
 #if defined(_PERFORMANCE_DEBUG)
-        (*handle.user_object_ptr)->pers_bytes.print_performance_stat();
+            (*handle.user_object_ptr)->pers_bytes.print_performance_stat();
 #endif  //_PERFORMANCE_DEBUG
-    }
+        }
 
-    while(!done) {
+        while(!done) {
+        }
+        int64_t send_nanosec = duration_cast<nanoseconds>(send_complete_time - begin_time).count();
+        double send_millisec = static_cast<double>(send_nanosec) / 1000000;
+        int64_t persist_nanosec = duration_cast<nanoseconds>(persist_complete_time - begin_time).count();
+        double persist_millisec = static_cast<double>(persist_nanosec) / 1000000;
+
+        //Calculate bandwidth
+        //Bytes / nanosecond just happens to be equivalent to GigaBytes / second (in "decimal" GB)
+        //Note that total_num_messages already incorporates multiplying by the number of senders
+        double send_thp_gbps = (static_cast<double>(total_num_messages) * msg_size) / send_nanosec;
+        double send_thp_ops = (static_cast<double>(total_num_messages) * 1000000000) / send_nanosec;
+        std::cout << "group_commit: " << std::boolalpha << group_commit << std::endl;
+        std::cout << "(send)timespan: " << send_millisec << " milliseconds." << std::endl;
+        std::cout << "(send)throughput: " << send_thp_gbps << "GB/s." << std::endl;
+        std::cout << "(send)throughput: " << send_thp_ops << "ops." << std::endl;
+
+        double thp_gbps = (static_cast<double>(total_num_messages) * msg_size) / persist_nanosec;
+        double thp_ops = (static_cast<double>(total_num_messages) * 1000000000) / persist_nanosec;
+        std::cout << "(pers)timespan: " << persist_millisec << " millisecond." << std::endl;
+        std::cout << "(pers)throughput: " << thp_gbps << "GB/s." << std::endl;
+        std::cout << "(pers)throughput: " << thp_ops << "ops." << std::endl;
+        std::cout << std::flush;
+
+        //aggregate_bandwidth only supports one value, so aggregate the more important persistence value
+        avg_persist_bw[round] = aggregate_bandwidth(members, members[node_rank], thp_gbps);
+
+        if(node_rank == 0) {
+            log_results(persistent_bw_result{num_of_nodes, static_cast<std::underlying_type_t<PartialSendMode>>(sender_selector),
+                                             msg_size, num_msgs, group_commit, avg_persist_bw[round]},
+                        "data_persistent_bw");
+        }
     }
-    int64_t send_nanosec = duration_cast<nanoseconds>(send_complete_time - begin_time).count();
-    double send_millisec = static_cast<double>(send_nanosec) / 1000000;
-    int64_t persist_nanosec = duration_cast<nanoseconds>(persist_complete_time - begin_time).count();
-    double persist_millisec = static_cast<double>(persist_nanosec) / 1000000;
-
-    //Calculate bandwidth
-    //Bytes / nanosecond just happens to be equivalent to GigaBytes / second (in "decimal" GB)
-    //Note that total_num_messages already incorporates multiplying by the number of senders
-    double send_thp_gbps = (static_cast<double>(total_num_messages) * msg_size) / send_nanosec;
-    double send_thp_ops = (static_cast<double>(total_num_messages) * 1000000000) / send_nanosec;
-    std::cout << "(send)timespan: " << send_millisec << " milliseconds." << std::endl;
-    std::cout << "(send)throughput: " << send_thp_gbps << "GB/s." << std::endl;
-    std::cout << "(send)throughput: " << send_thp_ops << "ops." << std::endl;
-
-    double thp_gbps = (static_cast<double>(total_num_messages) * msg_size) / persist_nanosec;
-    double thp_ops = (static_cast<double>(total_num_messages) * 1000000000) / persist_nanosec;
-    std::cout << "(pers)timespan: " << persist_millisec << " millisecond." << std::endl;
-    std::cout << "(pers)throughput: " << thp_gbps << "GB/s." << std::endl;
-    std::cout << "(pers)throughput: " << thp_ops << "ops." << std::endl;
-    std::cout << std::flush;
-
-    //aggregate_bandwidth only supports one value, so aggregate the more important persistence value
-    auto members = group.get_members();
-    double avg_persist_bw = aggregate_bandwidth(members, members[node_rank], thp_gbps);
-
     if(node_rank == 0) {
-        log_results(persistent_bw_result{num_of_nodes, static_cast<std::underlying_type_t<PartialSendMode>>(sender_selector),
-                                         msg_size, num_msgs, avg_persist_bw},
-                    "data_persistent_bw");
+        std::cout << "(pers)average throughput without group commit: " << avg_persist_bw[0] << "GB/s, with group commit: "
+                  << avg_persist_bw[1] << "GB/s (" << std::showpos << (avg_persist_bw[1] - avg_persist_bw[0]) / avg_persist_bw[0] * 100
+                  << std::noshowpos << "%)." << std::endl;
     }
 
     group.barrier_sync();
@@ -53,13 +53,15 @@ struct exp_result {
     long long unsigned int max_msg_size;
     unsigned int window_size;
     uint num_messages;
+    bool group_commit;
     double latency;
     double stddev;
 
     void print(std::ofstream& fout) {
         fout << num_nodes << " " << num_senders_selector << " "
              << max_msg_size << " " << window_size << " "
-             << num_messages << " " << latency << " " << stddev << endl;
+             << num_messages << " " << group_commit << " "
+             << latency << " " << stddev << endl;
     }
 };
 
@@ -100,8 +102,10 @@ int main(int argc, char* argv[]) {
 
     bool is_sending = true;
     uint32_t node_rank = -1;
+    // The test runs one round without group commit and one with it, in the same group.
+    const uint32_t num_rounds = 2;
     // message_pers_ts_us[] is the time when a message with version 'ver' is persisted.
-    uint64_t* message_pers_ts_us = (uint64_t*)malloc(sizeof(uint64_t) * num_msgs * num_of_nodes);
+    uint64_t* message_pers_ts_us = (uint64_t*)malloc(sizeof(uint64_t) * num_rounds * num_msgs * num_of_nodes);
     if(message_pers_ts_us == NULL) {
         std::cerr << "allocate memory error!" << std::endl;
         return -1;
@@ -109,7 +113,7 @@ int main(int argc, char* argv[]) {
     // the total span:
     struct timespec t_begin;
     // is only for local
-    uint64_t* local_message_ts_us = (uint64_t*)malloc(sizeof(uint64_t) * num_msgs);
+    uint64_t* local_message_ts_us = (uint64_t*)malloc(sizeof(uint64_t) * num_rounds * num_msgs);
     long total_num_messages;
     uint32_t num_sender = 0;
     switch(sender_selector) {
@@ -125,7 +129,9 @@ int main(int argc, char* argv[]) {
     }
     total_num_messages = num_sender * num_msgs;
 
-    // variable 'done' tracks the end of the test
+    // round_end is the number of messages delivered by the end of the current round
+    std::atomic<long> round_end = total_num_messages;
+    // variable 'done' tracks the end of a round
     volatile bool done = false;
 
     // last_version and its flag is shared between the stability callback and persistence callback.
@@ -135,15 +141,15 @@ int main(int argc, char* argv[]) {
 
     auto stability_callback = [&last_version,
                                &last_version_set,
-                               total_num_messages,
-                               num_delivered = 0u](uint32_t subgroup,
+                               &round_end,
+                               num_delivered = 0l](uint32_t subgroup,
                                                    uint32_t sender_id,
                                                    long long int index,
                                                    std::optional<std::pair<char*, long long int>> data,
                                                    persistent::version_t ver) mutable {
         //Count the total number of messages delivered
         ++num_delivered;
-        if(num_delivered == total_num_messages) {
+        if(num_delivered == round_end) {
             last_version = ver;
             last_version_set = true;
         }
@@ -161,7 +167,7 @@ int main(int argc, char* argv[]) {
             message_pers_ts_us[pers_ver++] = tsus;
         }
 
-        if(last_version_set && ver == last_version) {
+        if(last_version_set && ver == last_version && !done) {
             if(is_sending) {
                 for(uint32_t i = 0; i < num_msgs; i++) {
                     // std::cout << "[" << i << "]" << local_message_ts_us[i] << " "
@@ -203,64 +209,11 @@ int main(int argc, char* argv[]) {
 
     std::cout << "my rank is:" << node_rank << ", and I'm sending: " << std::boolalpha << is_sending << std::endl;
 
-    clock_gettime(CLOCK_REALTIME, &t_begin);
-
     derecho::Replicated<ByteArrayObject>& handle = group.get_subgroup<ByteArrayObject>();
 
-    if(is_sending) {
-        char* bbuf = new char[msg_size];
-        bzero(bbuf, msg_size);
-        Bytes bs(bbuf, msg_size);
-
-        try {
-            struct timespec start, cur;
-            clock_gettime(CLOCK_REALTIME, &start);
-
-            for(uint32_t i = 0; i < num_msgs; i++) {
-                do {
-                    pthread_yield();
-                    clock_gettime(CLOCK_REALTIME, &cur);
-                } while(DELTA_T_US(start, cur) < i * (double)si_us);
-                {
-                    local_message_ts_us[i] = cur.tv_sec * 1e6 + cur.tv_nsec / 1e3;
-                    handle.ordered_send<RPC_NAME(change_pers_bytes)>(bs);
-                }
-            }
-
-        } catch(uint64_t exp) {
-            std::cout << "Exception caught:0x" << std::hex << exp << std::endl;
-            return -1;
-        }
-    }
-
-    while(!done) {
-    }
-
-    std::cout << "Done!" << std::endl;
-
-    double avg_latency, avg_std_dev;
-    // the if loop selects the senders
-    if(sender_selector == PartialSendMode::ALL_SENDERS|| (sender_selector == PartialSendMode::HALF_SENDERS && (int)(node_rank) > (num_of_nodes - 1) / 2) || (sender_selector == PartialSendMode::ONE_SENDER && (int)(node_rank) == num_of_nodes - 1)) {
-        double total_time = 0;
-        double sum_of_square = 0.0;
-        double average_time = 0.0;
-        for(uint i = 0; i < num_msgs; ++i) {
-            total_time += (int64_t)(message_pers_ts_us[num_sender * i + node_rank]) - (int64_t)(local_message_ts_us[i]);
-        }
-        // average latency in nano seconds
-        average_time = (total_time / num_msgs);
-        std::cout << "average time: " << average_time << std::endl;
-        // calculate the standard deviation
-        for(uint i = 0; i < num_msgs; ++i) {
-            sum_of_square += (double)((double)message_pers_ts_us[num_sender * i + node_rank] - (double)local_message_ts_us[i] - average_time) * ((double)message_pers_ts_us[num_sender * i + node_rank] - (double)local_message_ts_us[i] - average_time);
-        }
-        double std_dev = sqrt(sum_of_square / (num_msgs - 1));
-        // aggregate latency values from all senders
-        std::tie(avg_latency, avg_std_dev) = aggregate_latency(group_members, my_id, (average_time / 1000.0), (std_dev / 1000.0));
-    } else {
-        // if not a sender, then pass 0 as the latency (not counted)
-        std::tie(avg_latency, avg_std_dev) = aggregate_latency(group_members, my_id, 0.0, 0.0);
-    }
+    char* bbuf = new char[msg_size];
+    bzero(bbuf, msg_size);
+    Bytes bs(bbuf, msg_size);
 
     unsigned int num_senders_selector = 0;
     if (sender_selector == PartialSendMode::HALF_SENDERS){
@@ -270,12 +223,84 @@ int main(int argc, char* argv[]) {
         num_senders_selector = 2;
     }
 
-    // log the result at the leader node
+    double round_latency[num_rounds];
+    for(uint32_t round = 0; round < num_rounds; round++) {
+        const bool group_commit = (round == 1);
+        group.set_persistence_group_commit(group_commit);
+        round_end = total_num_messages * (round + 1);
+        last_version_set = false;
+        done = false;
+        // Don't let any node start sending before every node is ready for the round
+        group.barrier_sync();
+
+        clock_gettime(CLOCK_REALTIME, &t_begin);
+        // the first message of this round, among the messages this node sends
+        const uint32_t first_msg = round * num_msgs;
+
+        if(is_sending) {
+            try {
+                struct timespec start, cur;
+                clock_gettime(CLOCK_REALTIME, &start);
+
+                for(uint32_t i = 0; i < num_msgs; i++) {
+                    do {
+                        pthread_yield();
+                        clock_gettime(CLOCK_REALTIME, &cur);
+                    } while(DELTA_T_US(start, cur) < i * (double)si_us);
+                    {
+                        local_message_ts_us[first_msg + i] = cur.tv_sec * 1e6 + cur.tv_nsec / 1e3;
+                        handle.ordered_send<RPC_NAME(change_pers_bytes)>(bs);
+                    }
+                }
+
+            } catch(uint64_t exp) {
+                std::cout << "Exception caught:0x" << std::hex << exp << std::endl;
+                return -1;
+            }
+        }
+
+        while(!done) {
+        }
+
+        std::cout << "Done with group_commit=" << std::boolalpha << group_commit << "!" << std::endl;
+
+        double avg_latency, avg_std_dev;
+        // the if loop selects the senders
+        if(sender_selector == PartialSendMode::ALL_SENDERS|| (sender_selector == PartialSendMode::HALF_SENDERS && (int)(node_rank) > (num_of_nodes - 1) / 2) || (sender_selector == PartialSendMode::ONE_SENDER && (int)(node_rank) == num_of_nodes - 1)) {
+            double total_time = 0;
+            double sum_of_square = 0.0;
+            double average_time = 0.0;
+            for(uint i = first_msg; i < first_msg + num_msgs; ++i) {
+                total_time += (int64_t)(message_pers_ts_us[num_sender * i + node_rank]) - (int64_t)(local_message_ts_us[i]);
+            }
+            // average latency in nano seconds
+            average_time = (total_time / num_msgs);
+            std::cout << "average time: " << average_time << std::endl;
+            // calculate the standard deviation
+            for(uint i = first_msg; i < first_msg + num_msgs; ++i) {
+                sum_of_square += (double)((double)message_pers_ts_us[num_sender * i + node_rank] - (double)local_message_ts_us[i] - average_time) * ((double)message_pers_ts_us[num_sender * i + node_rank] - (double)local_message_ts_us[i] - average_time);
+            }
+            double std_dev = sqrt(sum_of_square / (num_msgs - 1));
+            // aggregate latency values from all senders
+            std::tie(avg_latency, avg_std_dev) = aggregate_latency(group_members, my_id, (average_time / 1000.0), (std_dev / 1000.0));
+        } else {
+            // if not a sender, then pass 0 as the latency (not counted)
+            std::tie(avg_latency, avg_std_dev) = aggregate_latency(group_members, my_id, 0.0, 0.0);
+        }
+        round_latency[round] = avg_latency;
+
+        // log the result at the leader node
+        if(node_rank == 0) {
+            log_results(exp_result{num_of_nodes, num_senders_selector, msg_size,
+                                   derecho::getConfUInt32(CONF_SUBGROUP_DEFAULT_WINDOW_SIZE), num_msgs,
+                                   group_commit, avg_latency, avg_std_dev},
+                        "data_latency");
+        }
+    }
     if(node_rank == 0) {
-        log_results(exp_result{num_of_nodes, num_senders_selector, msg_size,
-                               derecho::getConfUInt32(CONF_SUBGROUP_DEFAULT_WINDOW_SIZE), num_msgs,
-                               avg_latency, avg_std_dev},
-                    "data_latency");
+        std::cout << "average latency without group commit: " << round_latency[0] << ", with group commit: "
+                  << round_latency[1] << " (" << std::showpos << (round_latency[1] - round_latency[0]) / round_latency[0] * 100
+                  << std::noshowpos << "%)" << std::endl;
     }
     group.barrier_sync();
     group.leave();
@@ -0,0 +1,168 @@
+/*
+ * This test measures the round-trip latency of SST::put_with_completion, i.e.
+ * the time from posting a write of one SST field to every other node until the
+ * completions of all the writes have reached the calling thread, as a function of
+ * 1. the number of nodes
+ * 2. the number of threads calling put_with_completion concurrently on each node
+ * 3. the number of round trips per thread
+ * It uses the SST directly, without a Derecho group, over the RDMA provider
+ * in the configuration (e.g. provider = tcp). Start it on every node with the
+ * same arguments except my_rank. Each node in the comma-separated node list is
+ * given as ip or ip:port, where the port defaults to sst_port.
+ * Upon completion, the results are appended to file data_put_with_completion
+ * on the node of rank 0.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "log_results.hpp"
+#include <derecho/conf/conf.hpp>
+#include <derecho/sst/sst.hpp>
+
+using std::cout;
+using std::endl;
+using namespace sst;
+using namespace std::chrono;
+
+class CompletionSST : public SST<CompletionSST> {
+public:
+    CompletionSST(const std::vector<uint32_t>& members, uint32_t my_rank)
+            : SST<CompletionSST>(this, SSTParams{members, my_rank}) {
+        SSTInit(heartbeat);
+    }
+    SSTField<bool> heartbeat;
+};
+
+struct exp_result {
+    uint32_t num_nodes;
+    uint32_t num_threads;
+    uint32_t num_round_trips;
+    double average_latency_us;
+    double p99_latency_us;
+    double round_trips_per_sec;
+
+    void print(std::ofstream& fout) {
+        fout << num_nodes << " " << num_threads << " " << num_round_trips << " "
+             << average_latency_us << " " << p99_latency_us << " "
+             << round_trips_per_sec << endl;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    int dashdash_pos = argc - 1;
+    while(dashdash_pos > 0) {
+        if(strcmp(argv[dashdash_pos], "--") == 0) {
+            break;
+        }
+        dashdash_pos--;
+    }
+
+    if((argc - dashdash_pos) < 4) {
+        cout << "Insufficient number of command line arguments" << endl;
+        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] num_nodes my_rank node_list [num_threads] [num_round_trips]" << endl;
+        cout << "node_list is a comma-separated list of ip[:port], one per node in rank order" << endl;
+        return -1;
+    }
+
+    derecho::Conf::initialize(argc, argv);
+    const uint32_t num_nodes = std::stoi(argv[dashdash_pos + 1]);
+    const uint32_t my_rank = std::stoi(argv[dashdash_pos + 2]);
+    const uint32_t num_threads = (argc - dashdash_pos) > 4 ? std::stoi(argv[dashdash_pos + 4]) : 1;
+    const uint32_t num_round_trips = (argc - dashdash_pos) > 5 ? std::stoi(argv[dashdash_pos + 5]) : 10000;
+    const uint16_t default_port = derecho::getConfUInt16(CONF_DERECHO_SST_PORT);
+
+    std::map<uint32_t, std::pair<ip_addr_t, uint16_t>> ip_addrs_and_ports;
+    std::istringstream node_list(argv[dashdash_pos + 3]);
+    std::string node;
+    for(uint32_t rank = 0; std::getline(node_list, node, ','); ++rank) {
+        const auto colon = node.find(':');
+        if(colon == std::string::npos) {
+            ip_addrs_and_ports[rank] = {node, default_port};
+        } else {
+            ip_addrs_and_ports[rank] = {node.substr(0, colon),
+                                        static_cast<uint16_t>(std::stoi(node.substr(colon + 1)))};
+        }
+    }
+    if(ip_addrs_and_ports.size() != num_nodes || my_rank >= num_nodes) {
+        cout << "The node list must have num_nodes entries, and my_rank must be less than num_nodes" << endl;
+        return -1;
+    }
+
+#ifdef USE_VERBS_API
+    verbs_initialize(ip_addrs_and_ports, {}, my_rank);
+#else
+    lf_initialize(ip_addrs_and_ports, {}, my_rank);
+#endif
+
+    std::vector<uint32_t> members(num_nodes);
+    for(uint32_t i = 0; i < num_nodes; ++i) {
+        members[i] = i;
+    }
+    CompletionSST sst(members, my_rank);
+    sst.heartbeat[my_rank] = true;
+
+    auto barrier = [&]() {
+        for(uint32_t i = 0; i < num_nodes; ++i) {
+            if(i != my_rank) {
+                sync(i);
+            }
+        }
+    };
+    barrier();
+
+    // every thread keeps its own latencies, in microseconds
+    std::vector<std::vector<double>> latencies_us(num_threads);
+    auto round_trips = [&](uint32_t thread_index) {
+        std::vector<double>& latencies = latencies_us[thread_index];
+        latencies.reserve(num_round_trips);
+        for(uint32_t i = 0; i < num_round_trips; ++i) {
+            auto start_time = steady_clock::now();
+            sst.put_with_completion(sst.heartbeat);
+            auto end_time = steady_clock::now();
+            latencies.push_back(duration_cast<nanoseconds>(end_time - start_time).count() / 1000.0);
+        }
+    };
+
+    auto start_time = steady_clock::now();
+    std::vector<std::thread> threads;
+    for(uint32_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back(round_trips, t);
+    }
+    for(auto& thread : threads) {
+        thread.join();
+    }
+    auto end_time = steady_clock::now();
+
+    std::vector<double> all_latencies;
+    for(const auto& latencies : latencies_us) {
+        all_latencies.insert(all_latencies.end(), latencies.begin(), latencies.end());
+    }
+    std::sort(all_latencies.begin(), all_latencies.end());
+    double total_latency = 0.0;
+    for(double latency : all_latencies) {
+        total_latency += latency;
+    }
+    const double average_latency = total_latency / all_latencies.size();
+    const double p99_latency = all_latencies[std::min(all_latencies.size() - 1, all_latencies.size() * 99 / 100)];
+    const double seconds = duration_cast<nanoseconds>(end_time - start_time).count() / 1e9;
+    const double throughput = all_latencies.size() / seconds;
+    cout << "put_with_completion round trip with " << num_threads << " threads: average "
+         << average_latency << " us, p99 " << p99_latency << " us, "
+         << throughput << " round trips/s" << endl;
+
+    if(my_rank == 0) {
+        log_results(exp_result{num_nodes, num_threads, num_round_trips,
+                               average_latency, p99_latency, throughput},
+                    "data_put_with_completion");
+    }
+    // wait for the other nodes to finish their writes before tearing down
+    barrier();
+    return 0;
+}
@@ -0,0 +1,396 @@
+/*
+ * This program simulates an RDMC multicast offline, without a cluster, to help
+ * choose block_size and rdmc_send_algorithm for a subgroup profile. It drives
+ * the schedules of src/rdmc/schedule.cpp through get_outgoing_transfer() and
+ * get_incoming_transfer() the way polling_group does:
+ * 1. each member sends one block at a time, in the order of its send steps,
+ *    and only once it has received the block;
+ * 2. each receiver expects its blocks in the order of its receive steps, and
+ *    tells the sender of the next one that it is ready after receiving the
+ *    previous one (the ready-for-block message takes the link's latency);
+ * 3. a block takes block_size / bandwidth + latency to reach the receiver, and
+ *    the sender's next send starts when it has completed.
+ * Every link has the same bandwidth and latency unless it is listed in
+ * slow_links, as from-to:Gbps, e.g. 0-1:1,3-2:5 (use - for none).
+ * The optional racks list gives the rack of every member in rank order, e.g.
+ * 0,0,0,1,1,1. It is required by hybrid_send, links between racks get the
+ * given cross-rack bandwidth, and the number of blocks sent between racks is
+ * reported. The simulation does not model contention between links that
+ * share an uplink.
+ * For every combination of algorithm and block size, it prints the total
+ * number of steps of the schedule, the time until the last member is done and
+ * the resulting bandwidth; for a single combination it also prints the
+ * completion time of every member and the utilization of every link.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <derecho/rdmc/detail/schedule.hpp>
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+struct link_params {
+    double gbps;
+    double latency_us;
+};
+
+struct simulation_result {
+    size_t num_blocks;
+    size_t total_steps;
+    // the time at which each member had all the blocks and sent all of its own
+    vector<double> completion_us;
+    // the time each link spent transmitting blocks, by (from, to)
+    std::map<std::pair<uint32_t, uint32_t>, double> link_busy_us;
+    // the number of blocks sent between members in different racks
+    size_t cross_rack_blocks;
+    // false if the schedule stopped making progress before every member was done
+    bool complete;
+};
+
+unique_ptr<schedule> make_schedule(const string& algorithm, uint32_t num_members, uint32_t member_index,
+                                   const vector<uint32_t>& member_racks) {
+    if(algorithm == "binomial_send") {
+        return std::make_unique<binomial_schedule>(num_members, member_index);
+    } else if(algorithm == "chain_send") {
+        return std::make_unique<chain_schedule>(num_members, member_index);
+    } else if(algorithm == "sequential_send") {
+        return std::make_unique<sequential_schedule>(num_members, member_index);
+    } else if(algorithm == "tree_send") {
+        return std::make_unique<tree_schedule>(num_members, member_index);
+    } else if(algorithm == "hybrid_send" && member_racks.size() == num_members) {
+        return std::make_unique<hybrid_schedule>(num_members, member_index, member_racks);
+    }
+    return nullptr;
+}
+
+class schedule_simulator {
+    enum event_type {
+        BLOCK_ARRIVAL,
+        SEND_COMPLETION,
+        READY_FOR_BLOCK
+    };
+    struct event {
+        double time_us;
+        uint64_t sequence;
+        event_type type;
+        uint32_t node;
+        uint32_t peer;
+        size_t block_number;
+        bool operator>(const event& other) const {
+            return time_us != other.time_us ? time_us > other.time_us : sequence > other.sequence;
+        }
+    };
+    struct member {
+        unique_ptr<schedule> transfer_schedule;
+        vector<schedule::block_transfer> outgoing;
+        vector<schedule::block_transfer> incoming;
+        size_t next_send = 0;
+        size_t next_receive = 0;
+        bool sending = false;
+        vector<bool> received_blocks;
+        size_t num_received_blocks = 0;
+        std::set<uint32_t> receivers_ready;
+        double completion_us = -1;
+    };
+
+    const size_t message_size;
+    const size_t block_size;
+    const size_t num_blocks;
+    const link_params default_link;
+    const std::map<std::pair<uint32_t, uint32_t>, link_params>& special_links;
+    const vector<uint32_t>& member_racks;
+    vector<member> members;
+    std::priority_queue<event, vector<event>, std::greater<event>> events;
+    uint64_t next_sequence = 0;
+    double now_us = 0;
+    simulation_result result;
+
+    const link_params& get_link(uint32_t from, uint32_t to) const {
+        auto it = special_links.find({from, to});
+        return it != special_links.end() ? it->second : default_link;
+    }
+    void post(double time_us, event_type type, uint32_t node, uint32_t peer, size_t block_number = 0) {
+        events.push(event{time_us, next_sequence++, type, node, peer, block_number});
+    }
+    void send_ready_for_block(uint32_t node) {
+        member& m = members[node];
+        if(m.next_receive < m.incoming.size()) {
+            uint32_t sender = m.incoming[m.next_receive].target;
+            post(now_us + get_link(node, sender).latency_us, READY_FOR_BLOCK, sender, node);
+        }
+    }
+    void send_next_block(uint32_t node) {
+        member& m = members[node];
+        if(m.sending || m.next_send == m.outgoing.size()) {
+            return;
+        }
+        const schedule::block_transfer& transfer = m.outgoing[m.next_send];
+        if(node > 0 && !m.received_blocks[transfer.block_number]) {
+            return;
+        }
+        if(m.receivers_ready.erase(transfer.target) == 0) {
+            return;
+        }
+        m.sending = true;
+        ++m.next_send;
+
+        size_t bytes = std::min(block_size, message_size - transfer.block_number * block_size);
+        const link_params& link = get_link(node, transfer.target);
+        double transmission_us = bytes * 8 / (link.gbps * 1e3);
+        result.link_busy_us[{node, transfer.target}] += transmission_us;
+        if(!member_racks.empty() && member_racks[node] != member_racks[transfer.target]) {
+            ++result.cross_rack_blocks;
+        }
+        double arrival_us = now_us + transmission_us + link.latency_us;
+        post(arrival_us, BLOCK_ARRIVAL, transfer.target, node, transfer.block_number);
+        post(arrival_us, SEND_COMPLETION, node, transfer.target);
+    }
+    void check_completion(uint32_t node) {
+        member& m = members[node];
+        if(m.completion_us < 0 && !m.sending && m.next_send == m.outgoing.size()
+           && (node == 0 || m.num_received_blocks == num_blocks)) {
+            m.completion_us = now_us;
+        }
+    }
+
+public:
+    schedule_simulator(const string& algorithm, uint32_t num_members,
+                       size_t message_size, size_t block_size,
+                       const link_params& default_link,
+                       const std::map<std::pair<uint32_t, uint32_t>, link_params>& special_links,
+                       const vector<uint32_t>& member_racks)
+            : message_size(message_size),
+              block_size(block_size),
+              num_blocks((message_size - 1) / block_size + 1),
+              default_link(default_link),
+              special_links(special_links),
+              member_racks(member_racks),
+              members(num_members) {
+        result.num_blocks = num_blocks;
+        result.total_steps = 0;
+        result.cross_rack_blocks = 0;
+        for(uint32_t i = 0; i < num_members; ++i) {
+            member& m = members[i];
+            m.transfer_schedule = make_schedule(algorithm, num_members, i, member_racks);
+            const size_t total_steps = m.transfer_schedule->get_total_steps(num_blocks);
+            result.total_steps = std::max(result.total_steps, total_steps);
+            for(size_t step = 0; step < total_steps; ++step) {
+                auto transfer = m.transfer_schedule->get_outgoing_transfer(num_blocks, step);
+                if(transfer) {
+                    m.outgoing.push_back(*transfer);
+                }
+            }
+            m.received_blocks.resize(num_blocks);
+            if(i == 0) {
+                continue;
+            }
+            // Like polling_group::receive_block, the first block comes first
+            // and is skipped when it turns up in the receive steps
+            auto first = m.transfer_schedule->get_first_block(num_blocks);
+            first->block_number = std::min(first->block_number, num_blocks - 1);
+            m.incoming.push_back(*first);
+            for(size_t step = 0; step < total_steps; ++step) {
+                auto transfer = m.transfer_schedule->get_incoming_transfer(num_blocks, step);
+                if(transfer && transfer->block_number != first->block_number) {
+                    m.incoming.push_back(*transfer);
+                }
+            }
+        }
+    }
+
+    simulation_result run() {
+        for(uint32_t i = 1; i < members.size(); ++i) {
+            send_ready_for_block(i);
+        }
+        while(!events.empty()) {
+            event e = events.top();
+            events.pop();
+            now_us = e.time_us;
+            member& m = members[e.node];
+            switch(e.type) {
+                case BLOCK_ARRIVAL:
+                    if(!m.received_blocks[e.block_number]) {
+                        m.received_blocks[e.block_number] = true;
+                        ++m.num_received_blocks;
+                    }
+                    ++m.next_receive;
+                    send_ready_for_block(e.node);
+                    if(!m.sending) {
+                        send_next_block(e.node);
+                    }
+                    break;
+                case SEND_COMPLETION:
+                    m.sending = false;
+                    send_next_block(e.node);
+                    break;
+                case READY_FOR_BLOCK:
+                    m.receivers_ready.insert(e.peer);
+                    send_next_block(e.node);
+                    break;
+            }
+            check_completion(e.node);
+        }
+        result.complete = true;
+        for(const member& m : members) {
+            result.completion_us.push_back(m.completion_us);
+            result.complete = result.complete && m.completion_us >= 0;
+        }
+        return result;
+    }
+};
+
+vector<string> split(const string& list, char delimiter) {
+    vector<string> items;
+    std::istringstream stream(list);
+    string item;
+    while(std::getline(stream, item, delimiter)) {
+        if(!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 5) {
+        cout << "USAGE: " << argv[0] << " algorithms num_members message_size block_sizes [bandwidth_gbps] [latency_us] [slow_links] [racks] [cross_rack_gbps]" << endl;
+        cout << "algorithms is a comma-separated list of binomial_send, chain_send, sequential_send, tree_send and hybrid_send, or all" << endl;
+        cout << "block_sizes is a comma-separated list of sizes in bytes" << endl;
+        cout << "slow_links is a comma-separated list of from-to:Gbps, or -" << endl;
+        cout << "racks is a comma-separated list of the rack of each member" << endl;
+        return -1;
+    }
+
+    vector<uint32_t> member_racks;
+    if(argc > 8) {
+        for(const string& rack : split(argv[8], ',')) {
+            member_racks.push_back(std::stoi(rack));
+        }
+    }
+    vector<string> algorithms = split(argv[1], ',');
+    if(algorithms.size() == 1 && algorithms[0] == "all") {
+        algorithms = {"binomial_send", "chain_send", "sequential_send", "tree_send"};
+        if(!member_racks.empty()) {
+            algorithms.push_back("hybrid_send");
+        }
+    }
+    const uint32_t num_members = std::stoi(argv[2]);
+    const size_t message_size = std::stoull(argv[3]);
+    vector<size_t> block_sizes;
+    for(const string& block_size : split(argv[4], ',')) {
+        block_sizes.push_back(std::stoull(block_size));
+    }
+    link_params default_link{argc > 5 ? std::stod(argv[5]) : 10.0,
+                             argc > 6 ? std::stod(argv[6]) : 20.0};
+    std::map<std::pair<uint32_t, uint32_t>, link_params> special_links;
+    if(argc > 7 && strcmp(argv[7], "-") != 0) {
+        for(const string& link : split(argv[7], ',')) {
+            uint32_t from, to;
+            double gbps;
+            if(sscanf(link.c_str(), "%u-%u:%lf", &from, &to, &gbps) != 3) {
+                cout << "Invalid slow link " << link << endl;
+                return -1;
+            }
+            special_links[{from, to}] = link_params{gbps, default_link.latency_us};
+        }
+    }
+    if(argc > 9 && member_racks.size() == num_members) {
+        const link_params cross_rack_link{std::stod(argv[9]), default_link.latency_us};
+        for(uint32_t from = 0; from < num_members; ++from) {
+            for(uint32_t to = 0; to < num_members; ++to) {
+                if(member_racks[from] != member_racks[to]) {
+                    special_links.emplace(std::make_pair(from, to), cross_rack_link);
+                }
+            }
+        }
+    }
+
+    if(num_members < 2 || message_size == 0) {
+        cout << "There must be at least 2 members and a non-empty message" << endl;
+        return -1;
+    }
+    if(!member_racks.empty() && member_racks.size() != num_members) {
+        cout << "The racks list must have num_members entries" << endl;
+        return -1;
+    }
+    for(const string& algorithm : algorithms) {
+        if(!make_schedule(algorithm, num_members, 0, member_racks)) {
+            cout << "Unknown algorithm " << algorithm << endl;
+            return -1;
+        }
+    }
+    for(size_t block_size : block_sizes) {
+        if(block_size == 0 || (message_size - 1) / block_size + 1 > std::numeric_limits<uint16_t>::max()) {
+            cout << "Block size " << block_size << " would split the message into 0 or too many blocks" << endl;
+            return -1;
+        }
+    }
+
+    cout << "algorithm, block size, blocks, total steps, completion time (us), mean receiver completion time (us), bandwidth (Gb/s)";
+    if(!member_racks.empty()) {
+        cout << ", cross-rack blocks";
+    }
+    cout << endl;
+    cout << std::fixed << std::setprecision(2);
+    // A stalled schedule is a bug, so it makes the simulator fail, e.g. under ctest
+    bool all_complete = true;
+    for(const string& algorithm : algorithms) {
+        for(size_t block_size : block_sizes) {
+            schedule_simulator simulator(algorithm, num_members, message_size, block_size,
+                                         default_link, special_links, member_racks);
+            simulation_result result = simulator.run();
+            if(!result.complete) {
+                cout << algorithm << ", " << block_size << ", " << result.num_blocks << ", "
+                     << result.total_steps << ", stalled before every member was done" << endl;
+                all_complete = false;
+                continue;
+            }
+            const double completion_us = *std::max_element(result.completion_us.begin(),
+                                                           result.completion_us.end());
+            double total_receiver_us = 0;
+            for(uint32_t i = 1; i < num_members; ++i) {
+                total_receiver_us += result.completion_us[i];
+            }
+            cout << algorithm << ", " << block_size << ", " << result.num_blocks << ", "
+                 << result.total_steps << ", " << completion_us << ", "
+                 << total_receiver_us / (num_members - 1) << ", "
+                 << message_size * 8 / (completion_us * 1e3);
+            if(!member_racks.empty()) {
+                cout << ", " << result.cross_rack_blocks;
+            }
+            cout << endl;
+
+            if(algorithms.size() == 1 && block_sizes.size() == 1) {
+                cout << endl
+                     << "member, completion time (us)" << endl;
+                for(uint32_t i = 0; i < num_members; ++i) {
+                    cout << i << ", " << result.completion_us[i] << endl;
+                }
+                cout << endl
+                     << "link, busy time (us), utilization (%)" << endl;
+                for(const auto& [link, busy_us] : result.link_busy_us) {
+                    cout << link.first << "->" << link.second << ", " << busy_us << ", "
+                         << 100 * busy_us / completion_us << endl;
+                }
+            }
+        }
+    }
+    return all_complete ? 0 : 1;
+}
@@ -41,12 +41,14 @@ struct signed_bw_result {
     int num_senders_selector;
     int message_payload_size;
     int num_msgs;
+    bool batch_signatures;
     double persisted_bw;
     double verified_bw;
 
     void print(std::ofstream& fout) {
         fout << num_nodes << " " << num_senders_selector << " "
              << message_payload_size << " " << num_msgs << " "
+             << batch_signatures << " "
              << persisted_bw << " " << verified_bw << std::endl;
     }
 };
@@ -225,7 +227,8 @@ int main(int argc, char* argv[]) {
 
     if(node_rank == 0) {
         log_results(signed_bw_result{num_of_nodes, static_cast<std::underlying_type_t<PartialSendMode>>(sender_selector),
-                                     msg_size, num_msgs, avg_pers_bw, avg_verified_bw},
+                                     msg_size, num_msgs, derecho::getConfBoolean(CONF_PERS_BATCH_SIGNATURES),
+                                     avg_pers_bw, avg_verified_bw},
                     "data_signed_bw");
     }
 
@@ -0,0 +1,183 @@
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+#include "aggregate_bandwidth.hpp"
+#include "log_results.hpp"
+#include <derecho/core/derecho.hpp>
+
+using std::cout;
+using std::endl;
+using std::map;
+using std::vector;
+
+using namespace derecho;
+
+/*
+ * Like multiple_active_subgroups_test, but the delivery handler of subgroup 0
+ * spins for slow_handler_us microseconds per message. Run it once with
+ * SUBGROUP/DEFAULT/parallel_delivery set to false and once with it set to true
+ * to see how much a slow handler in one subgroup holds back the others.
+ */
+
+struct exp_result {
+    uint32_t num_nodes;
+    long long unsigned int max_msg_size;
+    uint32_t window_size;
+    uint32_t num_messages;
+    uint32_t num_subgroups;
+    uint32_t slow_handler_us;
+    bool parallel_delivery;
+    double fast_bw;
+    double total_bw;
+
+    void print(std::ofstream& fout) {
+        fout << num_nodes << " "
+             << max_msg_size << " " << window_size << " "
+             << num_messages << " "
+             << num_subgroups << " "
+             << slow_handler_us << " "
+             << parallel_delivery << " "
+             << fast_bw << " "
+             << total_bw << endl;
+    }
+};
+
+static long long int nanoseconds_between(const struct timespec& start, const struct timespec& end) {
+    return (end.tv_sec - start.tv_sec) * (long long int)1e9 + (end.tv_nsec - start.tv_nsec);
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 5 || (argc > 5 && strcmp("--", argv[argc - 5]))) {
+        cout << "Invalid command line arguments." << endl;
+        cout << "Usage:" << argv[0]
+             << "[ derecho-config-list -- ] num_nodes, num_subgroups, num_messages, slow_handler_us"
+             << endl;
+        return 1;
+    }
+    pthread_setname_np(pthread_self(), "main");
+
+    // initialize the special arguments for this test
+    const uint num_nodes = std::stoi(argv[argc - 4]);
+    const uint num_subgroups = std::stoi(argv[argc - 3]);
+    const uint num_messages = std::stoi(argv[argc - 2]);
+    const uint slow_handler_us = std::stoi(argv[argc - 1]);
+    if(num_subgroups < 2) {
+        cout << "At least two subgroups are needed: one slow and one or more fast ones." << endl;
+        return 1;
+    }
+
+    // Read configurations from the command line options as well as the default config file
+    Conf::initialize(argc, argv);
+
+    // With parallel delivery the callback runs concurrently for different subgroups
+    std::unique_ptr<std::atomic<uint32_t>[]> num_delivered(new std::atomic<uint32_t>[num_subgroups]);
+    for(uint i = 0; i < num_subgroups; ++i) {
+        num_delivered[i] = 0;
+    }
+    std::vector<struct timespec> finish_times(num_subgroups);
+    std::atomic<uint32_t> num_subgroups_done{0};
+    auto stability_callback = [&](uint32_t subgroup, uint32_t sender_id,
+                                  long long int index,
+                                  std::optional<std::pair<char*, long long int>> data,
+                                  persistent::version_t ver) {
+        if(subgroup == 0) {
+            struct timespec start, now;
+            clock_gettime(CLOCK_REALTIME, &start);
+            do {
+                clock_gettime(CLOCK_REALTIME, &now);
+            } while(nanoseconds_between(start, now) < slow_handler_us * 1000ll);
+        }
+        if(++num_delivered[subgroup] == num_messages * num_nodes) {
+            clock_gettime(CLOCK_REALTIME, &finish_times[subgroup]);
+            ++num_subgroups_done;
+        }
+    };
+
+    auto membership_function = [num_subgroups, num_nodes](
+                                       const std::vector<std::type_index>& subgroup_type_order,
+                                       const std::unique_ptr<View>& prev_view, View& curr_view) {
+        subgroup_shard_layout_t subgroup_vector(num_subgroups);
+        auto num_members = curr_view.members.size();
+        // wait for all nodes to join the group
+        if(num_members < num_nodes) {
+            throw subgroup_provisioning_exception();
+        }
+        for(uint i = 0; i < num_subgroups; ++i) {
+            subgroup_vector[i].emplace_back(curr_view.make_subview(curr_view.members));
+        }
+        curr_view.next_unassigned_rank = curr_view.members.size();
+        //Since we know there is only one subgroup type, just put a single entry in the map
+        derecho::subgroup_allocation_map_t subgroup_allocation;
+        subgroup_allocation.emplace(std::type_index(typeid(RawObject)), std::move(subgroup_vector));
+        return subgroup_allocation;
+    };
+
+    //Wrap the membership function in a SubgroupInfo
+    SubgroupInfo raw_groups(membership_function);
+
+    // join the group
+    Group<RawObject> group(UserMessageCallbacks{stability_callback},
+                           raw_groups, {}, std::vector<view_upcall_t>{},
+                           &raw_object_factory);
+
+    cout << "Finished constructing/joining Group" << endl;
+    auto members_order = group.get_members();
+    uint32_t node_rank = group.get_my_rank();
+
+    long long unsigned int max_msg_size = getConfUInt64(CONF_SUBGROUP_DEFAULT_MAX_PAYLOAD_SIZE);
+
+    // one sender thread per subgroup, so a full window in the slow subgroup
+    // does not hold back the sends in the others
+    struct timespec start_time;
+    clock_gettime(CLOCK_REALTIME, &start_time);
+    std::vector<std::thread> sender_threads;
+    for(uint j = 0; j < num_subgroups; ++j) {
+        sender_threads.emplace_back([&, j]() {
+            Replicated<RawObject>& raw_subgroup = group.get_subgroup<RawObject>(j);
+            for(uint i = 0; i < num_messages; ++i) {
+                raw_subgroup.send(max_msg_size, [](char* buf) {});
+            }
+        });
+    }
+    for(auto& sender_thread : sender_threads) {
+        sender_thread.join();
+    }
+    // wait for the test to finish
+    while(num_subgroups_done < num_subgroups) {
+    }
+
+    // the fast subgroups are done when the last of them is done
+    long long int fast_nanoseconds = 0;
+    for(uint j = 1; j < num_subgroups; ++j) {
+        fast_nanoseconds = std::max(fast_nanoseconds, nanoseconds_between(start_time, finish_times[j]));
+    }
+    long long int total_nanoseconds = std::max(fast_nanoseconds, nanoseconds_between(start_time, finish_times[0]));
+    double fast_bw = (max_msg_size * num_messages * (num_subgroups - 1) * num_nodes + 0.0) / fast_nanoseconds;
+    double total_bw = (max_msg_size * num_messages * num_subgroups * num_nodes + 0.0) / total_nanoseconds;
+    // aggregate bandwidth from all nodes
+    std::pair<double, double> avg_bw = aggregate_bandwidth(members_order, members_order[node_rank],
+                                                           std::make_pair(fast_bw, total_bw));
+    // log the result at the leader node
+    if(node_rank == 0) {
+        log_results(exp_result{num_nodes, max_msg_size,
+                               getConfUInt32(CONF_SUBGROUP_DEFAULT_WINDOW_SIZE),
+                               num_messages,
+                               num_subgroups,
+                               slow_handler_us,
+                               getConfBoolean(CONF_SUBGROUP_DEFAULT_PARALLEL_DELIVERY),
+                               avg_bw.first,
+                               avg_bw.second},
+                    "data_slow_subgroup_delivery");
+    }
+
+    group.barrier_sync();
+    group.leave();
+}
@@ -0,0 +1,422 @@
+/**
+ * @file scalability_harness.cpp
+ *
+ * Runs scalability_node on a single host, with one process per Derecho node,
+ * over a sweep of group sizes, subgroup counts, message sizes and window
+ * sizes, so throughput and latency regressions can be caught without a
+ * cluster. For each point of the sweep it generates a derecho.cfg for every
+ * node in <work_dir>/run_<n>/node_<id> (distinct ports, local_ip = 127.0.0.1,
+ * the libfabric tcp provider on the loopback interface by default), starts the
+ * nodes there, and collects the bandwidth and latency that they aggregate
+ * through the SST. The results are appended to a CSV file as each run
+ * finishes, and the JSON file is rewritten with every run so far.
+ *
+ * The output of each node is kept in output.log in its directory. The harness
+ * exits with a non-zero status if any run failed or timed out.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <getopt.h>
+#include <iostream>
+#include <limits.h>
+#include <signal.h>
+#include <sstream>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+/* The ports used by one node: gms, state transfer, sst, rdmc and external */
+#define PORTS_PER_NODE 5
+/* Consecutive runs use different ports, so a run is not slowed down by the sockets of the previous one */
+#define PORT_BLOCKS 64
+#define MAX_NODES 20
+
+struct HarnessOptions {
+    std::vector<uint32_t> group_sizes{2, 3, 4};
+    std::vector<uint32_t> subgroup_counts{1};
+    std::vector<uint64_t> message_sizes{1024, 102400};
+    std::vector<uint32_t> window_sizes{16};
+    uint32_t num_messages = 1000;
+    std::string node_binary = "./scalability_node";
+    std::string work_dir = "scalability_runs";
+    std::string csv_file = "scalability_results.csv";
+    std::string json_file = "scalability_results.json";
+    std::string provider = "tcp";
+    std::string domain = "lo";
+    uint32_t base_port = 30000;
+    uint64_t max_smc_payload_size = 10240;
+    uint64_t block_size = 1048576;
+    uint32_t timeout_s = 120;
+};
+
+struct RunResult {
+    uint32_t num_nodes;
+    uint32_t num_subgroups;
+    uint64_t message_size;
+    uint32_t window_size;
+    uint32_t num_messages;
+    std::string status;
+    double bandwidth_gbps;
+    double latency_us;
+    double elapsed_s;
+};
+
+template <typename T>
+std::vector<T> parse_list(const char* arg) {
+    std::vector<T> values;
+    std::stringstream ss(arg);
+    std::string item;
+    while(std::getline(ss, item, ',')) {
+        if(!item.empty()) {
+            values.push_back(static_cast<T>(std::stoull(item)));
+        }
+    }
+    return values;
+}
+
+void print_usage(const char* prog, const HarnessOptions& defaults) {
+    cout << "USAGE: " << prog << " [options]" << endl
+         << "Sweep options take comma-separated lists:" << endl
+         << "  --nodes <n,...>            group sizes (default 2,3,4; at most " << MAX_NODES << ")" << endl
+         << "  --subgroups <n,...>        numbers of subgroups (default 1)" << endl
+         << "  --message-sizes <n,...>    message sizes in bytes (default 1024,102400)" << endl
+         << "  --windows <n,...>          window sizes (default 16)" << endl
+         << "Other options:" << endl
+         << "  --messages <n>             messages per sender per subgroup (default " << defaults.num_messages << ")" << endl
+         << "  --node-binary <path>       scalability_node executable (default " << defaults.node_binary << ")" << endl
+         << "  --work-dir <dir>           where the node directories are created (default " << defaults.work_dir << ")" << endl
+         << "  --csv <file>               CSV output (default " << defaults.csv_file << ")" << endl
+         << "  --json <file>              JSON output (default " << defaults.json_file << ")" << endl
+         << "  --provider <name>          libfabric provider (default " << defaults.provider << ")" << endl
+         << "  --domain <name>            libfabric domain (default " << defaults.domain << ")" << endl
+         << "  --base-port <port>         first port to use (default " << defaults.base_port << ")" << endl
+         << "  --smc-size <n>             max_smc_payload_size; larger messages go through RDMC (default "
+         << defaults.max_smc_payload_size << ")" << endl
+         << "  --block-size <n>           RDMC block size (default " << defaults.block_size << ")" << endl
+         << "  --timeout <seconds>        time limit of each run (default " << defaults.timeout_s << ")" << endl;
+}
+
+bool make_dirs(const std::string& path) {
+    std::string partial;
+    std::stringstream ss(path);
+    std::string item;
+    if(!path.empty() && path[0] == '/') {
+        partial = "/";
+    }
+    while(std::getline(ss, item, '/')) {
+        if(item.empty()) {
+            continue;
+        }
+        partial += item + "/";
+        if(mkdir(partial.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void write_config(const std::string& file, const HarnessOptions& options, uint32_t node_id,
+                  uint32_t num_nodes, uint32_t first_port, uint64_t message_size, uint32_t window_size) {
+    const uint32_t leader_port = first_port;
+    const uint32_t node_port = first_port + node_id * PORTS_PER_NODE;
+    std::ofstream cfg(file, std::ofstream::trunc);
+    cfg << "[DERECHO]" << endl
+        << "leader_ip = 127.0.0.1" << endl
+        << "leader_gms_port = " << leader_port << endl
+        << "leader_external_port = " << leader_port + 4 << endl
+        << "restart_leaders = 127.0.0.1" << endl
+        << "restart_leader_ports = " << leader_port << endl
+        << "local_id = " << node_id << endl
+        << "local_ip = 127.0.0.1" << endl
+        << "gms_port = " << node_port << endl
+        << "state_transfer_port = " << node_port + 1 << endl
+        << "sst_port = " << node_port + 2 << endl
+        << "rdmc_port = " << node_port + 3 << endl
+        << "external_port = " << node_port + 4 << endl
+        << "max_node_id = " << std::max<uint32_t>(num_nodes, 32) << endl
+        << "heartbeat_ms = 1" << endl
+        << "sst_poll_cq_timeout_ms = 100" << endl
+        << "disable_partitioning_safety = true" << endl
+        << endl
+        << "[SUBGROUP/DEFAULT]" << endl
+        << "max_payload_size = " << message_size << endl
+        << "max_reply_payload_size = " << message_size << endl
+        << "max_smc_payload_size = " << std::min(message_size, options.max_smc_payload_size) << endl
+        << "block_size = " << options.block_size << endl
+        << "window_size = " << window_size << endl
+        << "rdmc_send_algorithm = binomial_send" << endl
+        << endl
+        << "[RDMA]" << endl
+        << "provider = " << options.provider << endl
+        << "domain = " << options.domain << endl
+        << "tx_depth = 256" << endl
+        << "rx_depth = 256" << endl
+        << endl
+        << "[PERS]" << endl
+        << "file_path = .plog" << endl
+        << "reset = true" << endl
+        << endl
+        << "[LOGGER]" << endl
+        << "default_log_level = warn" << endl;
+}
+
+/**
+ * Start a node process in node_dir.
+ * @return the pid of the node, or a negative value if it could not be forked.
+ */
+pid_t start_node(const std::string& node_binary, const std::string& node_dir, const std::vector<std::string>& args) {
+    pid_t pid = fork();
+    if(pid != 0) {
+        return pid;
+    }
+    // child: run the node in its directory, with its output in output.log
+    if(chdir(node_dir.c_str()) != 0) {
+        _exit(127);
+    }
+    int log_fd = open("output.log", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(log_fd >= 0) {
+        dup2(log_fd, STDOUT_FILENO);
+        dup2(log_fd, STDERR_FILENO);
+        close(log_fd);
+    }
+    setenv("DERECHO_CONF_FILE", "derecho.cfg", 1);
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(node_binary.c_str()));
+    for(const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    execv(node_binary.c_str(), argv.data());
+    _exit(127);
+}
+
+/** Kill and reap the nodes that are still running, setting their pids to 0. */
+void kill_nodes(std::vector<pid_t>& pids) {
+    for(pid_t& pid : pids) {
+        if(pid > 0) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+            pid = 0;
+        }
+    }
+}
+
+RunResult run_once(const HarnessOptions& options, uint32_t run_number, uint32_t num_nodes, uint32_t num_subgroups,
+                   uint64_t message_size, uint32_t window_size) {
+    RunResult result{num_nodes, num_subgroups, message_size, window_size, options.num_messages, "ok", 0.0, 0.0, 0.0};
+    const std::string run_dir = options.work_dir + "/run_" + std::to_string(run_number);
+    const uint32_t first_port = options.base_port + (run_number % PORT_BLOCKS) * MAX_NODES * PORTS_PER_NODE;
+    const std::string result_file = "result.txt";
+    const std::vector<std::string> args{std::to_string(num_nodes), std::to_string(num_subgroups),
+                                        std::to_string(options.num_messages), result_file};
+
+    std::vector<pid_t> pids;
+    const auto start_time = std::chrono::steady_clock::now();
+    for(uint32_t node_id = 0; node_id < num_nodes; node_id++) {
+        const std::string node_dir = run_dir + "/node_" + std::to_string(node_id);
+        if(!make_dirs(node_dir)) {
+            cerr << "Cannot create " << node_dir << endl;
+            result.status = "failed";
+            break;
+        }
+        unlink((node_dir + "/" + result_file).c_str());
+        write_config(node_dir + "/derecho.cfg", options, node_id, num_nodes, first_port, message_size, window_size);
+        const pid_t pid = start_node(options.node_binary, node_dir, args);
+        if(pid < 0) {
+            cerr << "Cannot start node " << node_id << ": " << strerror(errno) << endl;
+            result.status = "failed";
+            break;
+        }
+        pids.push_back(pid);
+        if(node_id == 0) {
+            // let the leader start listening before the others try to join
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        }
+    }
+
+    // a partial group would never finish, so do not leave the nodes that did start waiting for the others
+    if(result.status != "ok") {
+        kill_nodes(pids);
+    }
+
+    // wait for the nodes, killing them all at the deadline
+    const auto deadline = start_time + std::chrono::seconds(options.timeout_s);
+    std::size_t num_running = std::count_if(pids.begin(), pids.end(), [](pid_t pid) { return pid > 0; });
+    while(num_running > 0) {
+        for(pid_t& pid : pids) {
+            if(pid <= 0) {
+                continue;
+            }
+            int wstatus;
+            if(waitpid(pid, &wstatus, WNOHANG) == pid) {
+                if(!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0) {
+                    result.status = "failed";
+                }
+                pid = 0;
+                num_running--;
+            }
+        }
+        if(num_running == 0) {
+            break;
+        }
+        if(std::chrono::steady_clock::now() > deadline) {
+            result.status = "timeout";
+            kill_nodes(pids);
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    result.elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    if(result.status == "ok") {
+        std::ifstream fin(run_dir + "/node_0/" + result_file);
+        if(!(fin >> result.bandwidth_gbps >> result.latency_us)) {
+            result.status = "failed";
+        }
+    }
+    return result;
+}
+
+void write_json(const std::string& file, const std::vector<RunResult>& results) {
+    std::ofstream fout(file, std::ofstream::trunc);
+    fout << "[" << endl;
+    for(std::size_t i = 0; i < results.size(); i++) {
+        const RunResult& r = results[i];
+        fout << "  {\"nodes\": " << r.num_nodes << ", \"subgroups\": " << r.num_subgroups
+             << ", \"message_size\": " << r.message_size << ", \"window_size\": " << r.window_size
+             << ", \"messages\": " << r.num_messages << ", \"status\": \"" << r.status
+             << "\", \"bandwidth_gbps\": " << r.bandwidth_gbps << ", \"latency_us\": " << r.latency_us
+             << ", \"elapsed_s\": " << r.elapsed_s << "}" << (i + 1 < results.size() ? "," : "") << endl;
+    }
+    fout << "]" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    HarnessOptions options;
+    const HarnessOptions defaults;
+    static struct option long_options[] = {
+            {"nodes", required_argument, 0, 'n'},
+            {"subgroups", required_argument, 0, 's'},
+            {"message-sizes", required_argument, 0, 'm'},
+            {"windows", required_argument, 0, 'w'},
+            {"messages", required_argument, 0, 'c'},
+            {"node-binary", required_argument, 0, 'b'},
+            {"work-dir", required_argument, 0, 'd'},
+            {"csv", required_argument, 0, 'v'},
+            {"json", required_argument, 0, 'j'},
+            {"provider", required_argument, 0, 'p'},
+            {"domain", required_argument, 0, 'o'},
+            {"base-port", required_argument, 0, 'P'},
+            {"smc-size", required_argument, 0, 'S'},
+            {"block-size", required_argument, 0, 'B'},
+            {"timeout", required_argument, 0, 't'},
+            {"help", no_argument, 0, 'h'},
+            {0, 0, 0, 0}};
+    int c;
+    while((c = getopt_long(argc, argv, "h", long_options, nullptr)) != -1) {
+        switch(c) {
+            case 'n':
+                options.group_sizes = parse_list<uint32_t>(optarg);
+                break;
+            case 's':
+                options.subgroup_counts = parse_list<uint32_t>(optarg);
+                break;
+            case 'm':
+                options.message_sizes = parse_list<uint64_t>(optarg);
+                break;
+            case 'w':
+                options.window_sizes = parse_list<uint32_t>(optarg);
+                break;
+            case 'c':
+                options.num_messages = std::stoul(optarg);
+                break;
+            case 'b':
+                options.node_binary = optarg;
+                break;
+            case 'd':
+                options.work_dir = optarg;
+                break;
+            case 'v':
+                options.csv_file = optarg;
+                break;
+            case 'j':
+                options.json_file = optarg;
+                break;
+            case 'p':
+                options.provider = optarg;
+                break;
+            case 'o':
+                options.domain = optarg;
+                break;
+            case 'P':
+                options.base_port = std::stoul(optarg);
+                break;
+            case 'S':
+                options.max_smc_payload_size = std::stoull(optarg);
+                break;
+            case 'B':
+                options.block_size = std::stoull(optarg);
+                break;
+            case 't':
+                options.timeout_s = std::stoul(optarg);
+                break;
+            default:
+                print_usage(argv[0], defaults);
+                return c == 'h' ? 0 : -1;
+        }
+    }
+    for(uint32_t num_nodes : options.group_sizes) {
+        if(num_nodes < 1 || num_nodes > MAX_NODES) {
+            cerr << "Group sizes must be between 1 and " << MAX_NODES << endl;
+            return -1;
+        }
+    }
+    if(options.base_port + PORT_BLOCKS * MAX_NODES * PORTS_PER_NODE > 65535) {
+        cerr << "The base port is too high" << endl;
+        return -1;
+    }
+    // the nodes run in their own directories
+    char resolved[PATH_MAX];
+    if(realpath(options.node_binary.c_str(), resolved) == nullptr || access(resolved, X_OK) != 0) {
+        cerr << "Cannot find the node executable " << options.node_binary << "; use --node-binary" << endl;
+        return -1;
+    }
+    options.node_binary = resolved;
+
+    std::ofstream csv(options.csv_file, std::ofstream::trunc);
+    csv << "nodes,subgroups,message_size,window_size,messages,status,bandwidth_gbps,latency_us,elapsed_s" << endl;
+    std::vector<RunResult> results;
+    uint32_t run_number = 0;
+    bool all_ok = true;
+    for(uint32_t num_nodes : options.group_sizes) {
+        for(uint32_t num_subgroups : options.subgroup_counts) {
+            for(uint64_t message_size : options.message_sizes) {
+                for(uint32_t window_size : options.window_sizes) {
+                    cout << "Run " << run_number << ": " << num_nodes << " nodes, " << num_subgroups << " subgroups, "
+                         << message_size << " byte messages, window " << window_size << "... " << std::flush;
+                    RunResult r = run_once(options, run_number++, num_nodes, num_subgroups, message_size, window_size);
+                    cout << r.status << " " << r.bandwidth_gbps << " GB/s " << r.latency_us << " us" << endl;
+                    all_ok &= (r.status == "ok");
+                    csv << r.num_nodes << "," << r.num_subgroups << "," << r.message_size << "," << r.window_size << ","
+                        << r.num_messages << "," << r.status << "," << r.bandwidth_gbps << "," << r.latency_us << ","
+                        << r.elapsed_s << endl;
+                    results.push_back(r);
+                    write_json(options.json_file, results);
+                }
+            }
+        }
+    }
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+/**
+ * @file scalability_node.cpp
+ *
+ * One node of a scalability_harness run. Every node is a member and a sender
+ * of each of num_subgroups raw subgroups, and sends num_messages messages of
+ * SUBGROUP/DEFAULT/max_payload_size bytes to every subgroup in ordered mode.
+ * Each node measures the bandwidth it sees and the latency of its own
+ * messages, from the time a message is written to its send buffer to the time
+ * it is delivered back to the sender. The two are averaged over all the nodes
+ * with aggregate_bandwidth, and the node of rank 0 writes them to result_file
+ * as one line: <bandwidth in GB/s> <mean latency in microseconds>.
+ *
+ * It can be run by hand like the performance tests, but it is meant to be
+ * started by scalability_harness with a generated configuration.
+ */
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <derecho/core/derecho.hpp>
+#include <derecho/utils/time.h>
+
+#include "aggregate_bandwidth.hpp"
+
+using std::cout;
+using std::endl;
+
+using namespace derecho;
+
+int main(int argc, char* argv[]) {
+    int dashdash_pos = argc - 1;
+    while(dashdash_pos > 0) {
+        if(strcmp(argv[dashdash_pos], "--") == 0) {
+            break;
+        }
+        dashdash_pos--;
+    }
+
+    if((argc - dashdash_pos) < 5) {
+        cout << "Invalid command line arguments." << endl;
+        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] num_nodes num_subgroups num_messages result_file" << endl;
+        return -1;
+    }
+    pthread_setname_np(pthread_self(), "scale_node");
+
+    const uint32_t num_nodes = std::stoi(argv[dashdash_pos + 1]);
+    const uint32_t num_subgroups = std::stoi(argv[dashdash_pos + 2]);
+    const uint32_t num_messages = std::stoi(argv[dashdash_pos + 3]);
+    const std::string result_file = argv[dashdash_pos + 4];
+
+    Conf::initialize(argc, argv);
+    const node_id_t my_id = getConfUInt32(CONF_DERECHO_LOCAL_ID);
+    // every message carries its send time, so it must have room for it
+    const long long unsigned int msg_size = std::max<long long unsigned int>(
+            getConfUInt64(CONF_SUBGROUP_DEFAULT_MAX_PAYLOAD_SIZE), sizeof(uint64_t));
+
+    volatile bool done = false;
+    uint64_t total_latency_ns = 0;
+    uint64_t num_own_messages = 0;
+    auto stability_callback = [&, num_delivered = 0ull](uint32_t subgroup, uint32_t sender_id,
+                                                        long long int index,
+                                                        std::optional<std::pair<char*, long long int>> data,
+                                                        persistent::version_t ver) mutable {
+        if(sender_id == my_id && data) {
+            uint64_t send_time;
+            memcpy(&send_time, data->first, sizeof(send_time));
+            total_latency_ns += get_time() - send_time;
+            num_own_messages++;
+        }
+        if(++num_delivered == static_cast<unsigned long long>(num_messages) * num_subgroups * num_nodes) {
+            done = true;
+        }
+    };
+
+    auto membership_function = [num_subgroups, num_nodes](
+                                       const std::vector<std::type_index>& subgroup_type_order,
+                                       const std::unique_ptr<View>& prev_view, View& curr_view) {
+        subgroup_shard_layout_t subgroup_vector(num_subgroups);
+        // wait for all nodes to join the group
+        if(curr_view.members.size() < num_nodes) {
+            throw subgroup_provisioning_exception();
+        }
+        for(uint32_t i = 0; i < num_subgroups; ++i) {
+            subgroup_vector[i].emplace_back(curr_view.make_subview(curr_view.members));
+        }
+        curr_view.next_unassigned_rank = curr_view.members.size();
+        derecho::subgroup_allocation_map_t subgroup_allocation;
+        subgroup_allocation.emplace(std::type_index(typeid(RawObject)), std::move(subgroup_vector));
+        return subgroup_allocation;
+    };
+
+    Group<RawObject> group(UserMessageCallbacks{stability_callback},
+                           SubgroupInfo(membership_function), {}, std::vector<view_upcall_t>{},
+                           &raw_object_factory);
+    cout << "Finished constructing/joining Group" << endl;
+    auto members_order = group.get_members();
+    const uint32_t node_rank = group.get_my_rank();
+
+    std::vector<std::reference_wrapper<Replicated<RawObject>>> raw_subgroups;
+    for(uint32_t i = 0; i < num_subgroups; ++i) {
+        raw_subgroups.emplace_back(group.get_subgroup<RawObject>(i));
+    }
+    const uint64_t start_time = get_time();
+    for(uint32_t i = 0; i < num_messages; ++i) {
+        for(uint32_t j = 0; j < num_subgroups; ++j) {
+            raw_subgroups[j].get().send(msg_size, [](char* buf) {
+                const uint64_t send_time = get_time();
+                memcpy(buf, &send_time, sizeof(send_time));
+            });
+        }
+    }
+    while(!done) {
+    }
+    const uint64_t nanoseconds_elapsed = get_time() - start_time;
+
+    const double bw = (msg_size * num_messages * num_subgroups * num_nodes + 0.0) / nanoseconds_elapsed;
+    const double latency_us = num_own_messages == 0 ? 0.0 : total_latency_ns / 1000.0 / num_own_messages;
+    auto [avg_bw, avg_latency_us] = aggregate_bandwidth(members_order, members_order[node_rank], {bw, latency_us});
+    if(node_rank == 0) {
+        cout << "Aggregate bandwidth: " << avg_bw << " GB/s, mean latency: " << avg_latency_us << " us" << endl;
+        std::ofstream fout(result_file, std::ofstream::trunc);
+        fout << avg_bw << " " << avg_latency_us << endl;
+    }
+
+    group.barrier_sync();
+    group.leave();
+}
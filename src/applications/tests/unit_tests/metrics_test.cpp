@@ -0,0 +1,189 @@
+/**
+ * @file metrics_test.cpp
+ *
+ * Checks the bucket bounds returned by metrics::Summary::percentile, that
+ * metrics::snapshot() merges the samples of running threads with those of
+ * threads that have exited, and that the last metrics::shutdown() stops
+ * recording.
+ */
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <derecho/utils/metrics.hpp>
+
+using namespace derecho::metrics;
+
+static int failures = 0;
+
+#define CHECK(condition)                                                           \
+    if(!(condition)) {                                                             \
+        std::cout << "FAILED at line " << __LINE__ << ": " << #condition << std::endl; \
+        failures++;                                                                \
+    }
+
+/** @return the Summary of metric in subgroup from a snapshot, or one with a count of 0. */
+Summary find_summary(const std::vector<Summary>& summaries, Metric metric, uint32_t subgroup) {
+    for(const Summary& summary : summaries) {
+        if(summary.metric == metric && summary.subgroup == subgroup) {
+            return summary;
+        }
+    }
+    Summary none{metric, subgroup, 0, 0, 0, {}};
+    none.buckets.fill(0);
+    return none;
+}
+
+/**
+ * Builds Summaries by hand, so the expected bucket of every sample is known:
+ * bucket 0 holds 0, and bucket i holds [2^(i-1), 2^i - 1].
+ */
+void test_percentile_bounds() {
+    Summary summary{Metric::SST_SEND_BYTES, 0, 0, 0, 0, {}};
+    summary.buckets.fill(0);
+    CHECK(summary.percentile(50) == 0);
+
+    // 10 zeros, 80 samples in [64, 127] and 10 in [1024, 2047]
+    summary.buckets[0] = 10;
+    summary.buckets[7] = 80;
+    summary.buckets[11] = 10;
+    summary.count = 100;
+    summary.max = 2000;
+    CHECK(summary.percentile(0) == 0);
+    CHECK(summary.percentile(10) == 0);
+    CHECK(summary.percentile(11) == 127);
+    CHECK(summary.percentile(50) == 127);
+    CHECK(summary.percentile(90) == 127);
+    CHECK(summary.percentile(91) == 2000);
+    CHECK(summary.percentile(100) == 2000);
+
+    // the bound of the bucket is lowered to max when max is below it
+    summary.buckets.fill(0);
+    summary.buckets[3] = 4;
+    summary.count = 4;
+    summary.max = 5;
+    CHECK(summary.percentile(50) == 5);
+
+    // the last bucket has no upper bound but max
+    summary.buckets.fill(0);
+    summary.buckets[NUM_BUCKETS - 1] = 1;
+    summary.count = 1;
+    summary.max = UINT64_MAX - 1;
+    CHECK(summary.percentile(99) == UINT64_MAX - 1);
+}
+
+/** Records values whose buckets are known, and reads them back through snapshot(). */
+void test_recorded_buckets() {
+    reset();
+    set_enabled(true);
+    for(uint64_t value : std::vector<uint64_t>{0, 1, 2, 3, 4, 1023, 1024, UINT64_MAX}) {
+        record(Metric::RDMC_SEND_BYTES, 1, value);
+    }
+    set_enabled(false);
+    record(Metric::RDMC_SEND_BYTES, 1, 5);
+    const Summary summary = find_summary(snapshot(), Metric::RDMC_SEND_BYTES, 1);
+    CHECK(summary.count == 8);
+    CHECK(summary.max == UINT64_MAX);
+    CHECK(summary.buckets[0] == 1);
+    CHECK(summary.buckets[1] == 1);
+    CHECK(summary.buckets[2] == 2);
+    CHECK(summary.buckets[3] == 1);
+    CHECK(summary.buckets[10] == 1);
+    CHECK(summary.buckets[11] == 1);
+    CHECK(summary.buckets[NUM_BUCKETS - 1] == 1);
+}
+
+/**
+ * Half of the threads record and exit, and the other half record and wait
+ * until the snapshot is taken, so it sees both retired and running threads.
+ * Subgroup numbers past MAX_TRACKED_SUBGROUPS are merged together.
+ */
+void test_merge_across_threads() {
+    constexpr int num_threads = 8;
+    constexpr uint64_t samples_per_thread = 1000;
+    reset();
+    set_enabled(true);
+    std::mutex mutex;
+    std::condition_variable cv;
+    int num_recorded = 0;
+    bool snapshot_taken = false;
+    std::vector<std::thread> threads;
+    for(int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t]() {
+            for(uint64_t i = 1; i <= samples_per_thread; i++) {
+                record(Metric::RPC_HANDLER_NS, 2, i);
+                record(Metric::STABLE_TO_DELIVER_NS, MAX_TRACKED_SUBGROUPS + t, 1);
+            }
+            record(Metric::PREDICATE_LOOP_NS, NO_SUBGROUP, t);
+            std::unique_lock<std::mutex> lock(mutex);
+            num_recorded++;
+            cv.notify_all();
+            if(t % 2 == 1) {
+                cv.wait(lock, [&]() { return snapshot_taken; });
+            }
+        });
+    }
+    std::vector<Summary> summaries;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return num_recorded == num_threads; });
+    }
+    for(int t = 0; t < num_threads; t += 2) {
+        threads[t].join();
+    }
+    summaries = snapshot();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        snapshot_taken = true;
+        cv.notify_all();
+    }
+    for(int t = 1; t < num_threads; t += 2) {
+        threads[t].join();
+    }
+    set_enabled(false);
+
+    const Summary rpc = find_summary(summaries, Metric::RPC_HANDLER_NS, 2);
+    CHECK(rpc.count == num_threads * samples_per_thread);
+    CHECK(rpc.sum == num_threads * samples_per_thread * (samples_per_thread + 1) / 2);
+    CHECK(rpc.max == samples_per_thread);
+    uint64_t bucket_total = 0;
+    for(uint64_t bucket : rpc.buckets) {
+        bucket_total += bucket;
+    }
+    CHECK(bucket_total == rpc.count);
+    const Summary overflow = find_summary(summaries, Metric::STABLE_TO_DELIVER_NS, MAX_TRACKED_SUBGROUPS);
+    CHECK(overflow.count == num_threads * samples_per_thread);
+    const Summary loop = find_summary(summaries, Metric::PREDICATE_LOOP_NS, NO_SUBGROUP);
+    CHECK(loop.count == num_threads);
+    CHECK(loop.max == num_threads - 1);
+    // once every thread has exited, a snapshot reads the same samples from the retired ones
+    const Summary retired = find_summary(snapshot(), Metric::RPC_HANDLER_NS, 2);
+    CHECK(retired.count == rpc.count);
+    CHECK(retired.sum == rpc.sum);
+    CHECK(retired.buckets == rpc.buckets);
+    reset();
+    CHECK(snapshot().empty());
+}
+
+/** Recording turned on by hand is turned off by the last shutdown(). */
+void test_shutdown_disables() {
+    initialize();
+    initialize();
+    set_enabled(true);
+    shutdown();
+    CHECK(enabled());
+    shutdown();
+    CHECK(!enabled());
+}
+
+int main() {
+    test_percentile_bounds();
+    test_recorded_buckets();
+    test_merge_across_threads();
+    test_shutdown_disables();
+    std::cout << (failures == 0 ? "All tests passed" : "Some tests failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
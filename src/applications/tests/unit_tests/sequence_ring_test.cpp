@@ -0,0 +1,150 @@
+/**
+ * @file sequence_ring_test.cpp
+ *
+ * Checks SequenceRing against std::map with a long random sequence of
+ * inserts, erases and front removals over a sliding window of keys, then
+ * compares the two containers on a delivery-like workload (insert in sequence
+ * order, remove from the front), printing the heap allocations and the time
+ * per message for each.
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+
+#include <derecho/core/detail/sequence_ring.hpp>
+
+using derecho::message_id_t;
+using derecho::SequenceRing;
+
+static int failures = 0;
+
+#define CHECK(condition)                                                           \
+    if(!(condition)) {                                                             \
+        std::cout << "FAILED at line " << __LINE__ << ": " << #condition << std::endl; \
+        failures++;                                                                \
+    }
+
+static std::size_t num_allocations = 0;
+
+void* operator new(std::size_t size) {
+    ++num_allocations;
+    if(void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+/**
+ * Applies the same random operations to a SequenceRing and a std::map. The
+ * keys are drawn from a window of 40 that slides forward over time, and the
+ * ring starts out small, so it has to grow and wrap around.
+ */
+void test_against_map(unsigned int seed, int num_operations) {
+    std::mt19937 random(seed);
+    SequenceRing<std::unique_ptr<int>> ring(4);
+    std::map<message_id_t, int> expected;
+    message_id_t window_start = 0;
+    for(int i = 0; i < num_operations; ++i) {
+        const unsigned int operation = random() % 4;
+        const message_id_t key = window_start + random() % 40;
+        if(operation < 2) {
+            ring.emplace(key, std::make_unique<int>(key * 3 + i));
+            expected[key] = key * 3 + i;
+        } else if(operation == 2) {
+            CHECK(ring.erase(key) == (expected.erase(key) > 0));
+        } else if(!expected.empty()) {
+            CHECK(ring.front_key() == expected.begin()->first);
+            CHECK(*ring.front() == expected.begin()->second);
+            ring.pop_front();
+            expected.erase(expected.begin());
+        }
+        CHECK(ring.size() == expected.size());
+        CHECK(ring.empty() == expected.empty());
+        std::unique_ptr<int>* found = ring.find(key);
+        auto expected_entry = expected.find(key);
+        CHECK((found != nullptr) == (expected_entry != expected.end()));
+        if(found && expected_entry != expected.end()) {
+            CHECK(**found == expected_entry->second);
+        }
+        if(failures > 0) {
+            return;
+        }
+        if(i % 100 == 0) {
+            ++window_start;
+        }
+    }
+    auto expected_entry = expected.begin();
+    ring.for_each([&](message_id_t key, std::unique_ptr<int>& value) {
+        CHECK(expected_entry != expected.end());
+        if(expected_entry != expected.end()) {
+            CHECK(key == expected_entry->first);
+            CHECK(*value == expected_entry->second);
+            ++expected_entry;
+        }
+    });
+    CHECK(expected_entry == expected.end());
+    ring.clear();
+    CHECK(ring.empty());
+    CHECK(ring.find(window_start) == nullptr);
+}
+
+/** Stands in for the RDMCMessage/SSTMessage values held by MulticastGroup. */
+struct Message {
+    message_id_t index;
+    char* buf;
+    uint64_t size;
+};
+
+/**
+ * Keeps window messages outstanding, inserting each new one in sequence order
+ * and delivering the oldest, the way locally_stable_sst_messages is used.
+ */
+template <typename Insert, typename Deliver>
+void report(const char* name, int num_messages, int window, Insert&& insert, Deliver&& deliver) {
+    const std::size_t allocations_before = num_allocations;
+    const auto start = std::chrono::steady_clock::now();
+    for(message_id_t seq = 0; seq < num_messages; ++seq) {
+        insert(seq);
+        if(seq >= window) {
+            deliver();
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << name << ": " << static_cast<double>(num_allocations - allocations_before) / num_messages
+              << " allocations/message, " << ns / num_messages << " ns/message" << std::endl;
+}
+
+void compare_with_map(int num_messages, int window) {
+    std::map<message_id_t, Message> map;
+    report("std::map", num_messages, window,
+           [&](message_id_t seq) { map.emplace(seq, Message{seq, nullptr, 0}); },
+           [&]() { map.erase(map.begin()); });
+    SequenceRing<Message> ring;
+    report("SequenceRing", num_messages, window,
+           [&](message_id_t seq) { ring.emplace(seq, Message{seq, nullptr, 0}); },
+           [&]() { ring.pop_front(); });
+}
+
+int main() {
+    for(unsigned int seed = 1; seed <= 5 && failures == 0; ++seed) {
+        test_against_map(seed, 400000);
+    }
+    if(failures == 0) {
+        compare_with_map(1000000, 64);
+    }
+    std::cout << (failures == 0 ? "All tests passed" : "Some tests failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
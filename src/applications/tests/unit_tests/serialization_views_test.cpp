@@ -0,0 +1,169 @@
+/**
+ * @file serialization_views_test.cpp
+ *
+ * Checks that std::string_view, vector_view and map_view serialize exactly
+ * like the containers they stand for, and that deserialize_and_run binds them
+ * to the buffer without copying, the way it does for the arguments of an RPC
+ * function. Also checks that an RPC call whose last vector_view<char> argument
+ * is sent outside its message (see Replicated::ordered_send_segments) reads
+ * that argument in place.
+ */
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <derecho/core/detail/remote_invocable.hpp>
+#include <derecho/mutils-serialization/SerializationSupport.hpp>
+#include <derecho/mutils-serialization/SerializationViews.hpp>
+
+using mutils::map_view;
+using mutils::vector_view;
+
+static int failures = 0;
+
+#define CHECK(condition)                                                           \
+    if(!(condition)) {                                                             \
+        std::cout << "FAILED at line " << __LINE__ << ": " << #condition << std::endl; \
+        failures++;                                                                \
+    }
+
+template <typename Container, typename View>
+std::vector<char> serialize_as(const Container& container) {
+    const View view(container);
+    std::vector<char> buffer(mutils::bytes_size(view));
+    CHECK(mutils::to_bytes(view, buffer.data()) == buffer.size());
+    return buffer;
+}
+
+template <typename T>
+std::vector<char> serialize(const T& t) {
+    std::vector<char> buffer(mutils::bytes_size(t));
+    CHECK(mutils::to_bytes(t, buffer.data()) == buffer.size());
+    return buffer;
+}
+
+int main() {
+    mutils::DeserializationManager dsm{{}};
+
+    // The views have the same format as the containers
+    const std::string name = "a string argument";
+    const std::vector<uint64_t> numbers{1, 2, 3, 5, 8, 13, 21};
+    const std::map<std::string, std::vector<int>> lists{{"empty", {}}, {"one", {1}}, {"three", {1, 2, 3}}};
+    const std::unordered_map<int, std::string> names{{1, "one"}, {2, "two"}};
+    CHECK((serialize_as<std::string, std::string_view>(name) == serialize(name)));
+    CHECK((serialize_as<std::vector<uint64_t>, vector_view<uint64_t>>(numbers) == serialize(numbers)));
+    CHECK((serialize_as<decltype(lists), map_view<std::string_view, vector_view<int>>>(lists) == serialize(lists)));
+    CHECK((serialize_as<decltype(names), map_view<int, std::string_view>>(names) == serialize(names)));
+
+    // deserialize_and_run binds the views to the buffer
+    std::vector<char> buffer(mutils::bytes_size(name) + mutils::bytes_size(numbers) + mutils::bytes_size(lists));
+    std::size_t offset = mutils::to_bytes(name, buffer.data());
+    offset += mutils::to_bytes(numbers, buffer.data() + offset);
+    offset += mutils::to_bytes(lists, buffer.data() + offset);
+    CHECK(offset == buffer.size());
+    const char* start = buffer.data();
+    const char* end = start + buffer.size();
+    std::function<int(const std::string_view&, const vector_view<uint64_t>&,
+                      const map_view<std::string_view, vector_view<int>>&)>
+            handler = [&](const std::string_view& s, const vector_view<uint64_t>& v,
+                          const map_view<std::string_view, vector_view<int>>& m) {
+                CHECK(s == name);
+                CHECK(s.data() >= start && s.data() < end);
+                CHECK(v.to_vector() == numbers);
+                CHECK(v.data() >= start && v.data() < end);
+                // the string before it leaves the elements unaligned, so they are read with memcpy
+                CHECK(reinterpret_cast<uintptr_t>(v.data()) % alignof(uint64_t) != 0);
+                CHECK(v.size() == numbers.size() && v[6] == 21);
+                uint64_t sum = 0;
+                for(uint64_t number : v) {
+                    sum += number;
+                }
+                CHECK(sum == 53);
+                CHECK(m.size() == lists.size());
+                CHECK(m.contains("one"));
+                CHECK(!m.contains("two"));
+                bool found = m.find_and_run("three", [&](const vector_view<int>& three) {
+                    CHECK(three.size() == 3 && three[2] == 3);
+                    CHECK(three.data() >= start && three.data() < end);
+                });
+                CHECK(found);
+                std::size_t num_entries = 0;
+                m.for_each([&](std::string_view key, const vector_view<int>& value) {
+                    CHECK(lists.at(std::string(key)) == value.to_vector());
+                    num_entries++;
+                });
+                CHECK(num_entries == lists.size());
+                // a view of a buffer serializes back to the same bytes
+                CHECK(serialize(m) == serialize(lists));
+                return 42;
+            };
+    CHECK(mutils::deserialize_and_run(&dsm, buffer.data(), handler) == 42);
+
+    // The owning containers can still be deserialized from the views' bytes
+    auto copy = mutils::from_bytes<std::map<std::string, std::vector<int>>>(
+            &dsm, serialize_as<decltype(lists), map_view<std::string_view, vector_view<int>>>(lists).data());
+    CHECK(*copy == lists);
+
+    // A sender that sends the elements separately writes only the prefix
+    std::vector<char> prefixed(vector_view<uint64_t>::prefix_size() + numbers.size() * sizeof(uint64_t));
+    std::size_t prefix_index = 0;
+    vector_view<uint64_t>::post_prefix(mutils::post_to_buffer(prefix_index, prefixed.data()), numbers.size());
+    CHECK(prefix_index == vector_view<uint64_t>::prefix_size());
+    std::memcpy(prefixed.data() + prefix_index, numbers.data(), numbers.size() * sizeof(uint64_t));
+    CHECK(prefixed == serialize(numbers));
+
+    // An RPC call whose last argument is sent after its message reads it where it is
+    using namespace derecho::rpc;
+    std::map<Opcode, receive_fun_t> receivers;
+    mutils::RemoteDeserialization_v rdv;
+    const std::vector<char> segment(1000, 'x');
+    using put_t = std::function<std::size_t(const std::string_view&, const vector_view<char>&)>;
+    put_t put = [&](const std::string_view& key, const vector_view<char>& bytes) {
+        CHECK(key == name);
+        CHECK(bytes.data() == segment.data() && bytes.size() == segment.size());
+        return key.size() + bytes.size();
+    };
+    RemoteInvocable<1, put_t> invocable(0, 0, receivers, put);
+    RemoteInvoker<1, put_t> invoker(0, 0, receivers);
+    std::vector<char> message;
+    invoker.send_with_trailing_bytes(
+            std::make_index_sequence<1>{},
+            [&message](int size) {
+                message.resize(size);
+                return message.data();
+            },
+            segment.size(), std::string_view(name));
+    std::vector<char> reply;
+    const auto alloc_reply = [&reply](int size) {
+        reply.resize(size);
+        return reply.data();
+    };
+    receivers.at(invocable.invoke_opcode)(&rdv, 0, message.data(), trailing_bytes{segment.data(), segment.size()}, alloc_reply);
+    // the reply is an exception flag, the invocation ID and the result
+    CHECK(reply.size() == 1 + sizeof(long int) + sizeof(std::size_t) && reply[0] == false);
+    std::size_t result;
+    std::memcpy(&result, reply.data() + 1 + sizeof(long int), sizeof(result));
+    CHECK(result == name.size() + segment.size());
+
+    // and with the segment copied after the message, it is an ordinary call
+    message.insert(message.end(), segment.begin(), segment.end());
+    put = [&](const std::string_view& key, const vector_view<char>& bytes) {
+        CHECK(bytes.data() == message.data() + message.size() - segment.size());
+        CHECK(bytes.to_vector() == segment);
+        return key.size() + bytes.size();
+    };
+    RemoteInvocable<2, put_t> gathered_invocable(0, 0, receivers, put);
+    receivers.at(gathered_invocable.invoke_opcode)(&rdv, 0, message.data(), trailing_bytes{}, alloc_reply);
+    std::memcpy(&result, reply.data() + 1 + sizeof(long int), sizeof(result));
+    CHECK(reply[0] == false && result == name.size() + segment.size());
+
+    if(failures == 0) {
+        std::cout << "All checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -51,6 +51,12 @@ struct option Conf::long_options[] = {
 	    MAKE_LONG_OPT_ENTRY(CONF_DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE),
 	    MAKE_LONG_OPT_ENTRY(CONF_DERECHO_MAX_P2P_REPLY_PAYLOAD_SIZE),
 	    MAKE_LONG_OPT_ENTRY(CONF_DERECHO_P2P_WINDOW_SIZE),
+        MAKE_LONG_OPT_ENTRY(CONF_DERECHO_P2P_LOOP_BUSY_WAIT_BEFORE_SLEEP_MS),
+        MAKE_LONG_OPT_ENTRY(CONF_DERECHO_RDMC_PIPELINE_DEPTH),
+        MAKE_LONG_OPT_ENTRY(CONF_DERECHO_ENABLE_METRICS),
+        MAKE_LONG_OPT_ENTRY(CONF_DERECHO_METRICS_FILE),
+        MAKE_LONG_OPT_ENTRY(CONF_DERECHO_METRICS_SOCKET),
+        MAKE_LONG_OPT_ENTRY(CONF_DERECHO_METRICS_INTERVAL_MS),
         MAKE_LONG_OPT_ENTRY(CONF_DERECHO_MAX_NODE_ID),
         // [SUBGROUP/<subgroup name>]
         MAKE_LONG_OPT_ENTRY(CONF_SUBGROUP_DEFAULT_RDMC_SEND_ALGORITHM),
@@ -59,6 +65,8 @@ struct option Conf::long_options[] = {
         MAKE_LONG_OPT_ENTRY(CONF_SUBGROUP_DEFAULT_MAX_SMC_PAYLOAD_SIZE),
         MAKE_LONG_OPT_ENTRY(CONF_SUBGROUP_DEFAULT_BLOCK_SIZE),
         MAKE_LONG_OPT_ENTRY(CONF_SUBGROUP_DEFAULT_WINDOW_SIZE),
+        MAKE_LONG_OPT_ENTRY(CONF_SUBGROUP_DEFAULT_PARALLEL_DELIVERY),
+        MAKE_LONG_OPT_ENTRY(CONF_SUBGROUP_DEFAULT_RDMC_RACKS),
         // [RDMA]
         MAKE_LONG_OPT_ENTRY(CONF_RDMA_PROVIDER),
         MAKE_LONG_OPT_ENTRY(CONF_RDMA_DOMAIN),
@@ -71,6 +79,17 @@ struct option Conf::long_options[] = {
         MAKE_LONG_OPT_ENTRY(CONF_PERS_MAX_LOG_ENTRY),
         MAKE_LONG_OPT_ENTRY(CONF_PERS_MAX_DATA_SIZE),
         MAKE_LONG_OPT_ENTRY(CONF_PERS_PRIVATE_KEY_FILE),
+        MAKE_LONG_OPT_ENTRY(CONF_PERS_DELTA_CHECKPOINT_INTERVAL),
+        MAKE_LONG_OPT_ENTRY(CONF_PERS_DELTA_CHECKPOINT_BYTES),
+        MAKE_LONG_OPT_ENTRY(CONF_PERS_GROUP_COMMIT),
+        MAKE_LONG_OPT_ENTRY(CONF_PERS_BATCH_SIGNATURES),
+        MAKE_LONG_OPT_ENTRY(CONF_PERS_DIRTY_TRACKING),
+        MAKE_LONG_OPT_ENTRY(CONF_PERS_SEGMENT_SIZE),
+        MAKE_LONG_OPT_ENTRY(CONF_PERS_SEGMENT_LOG_ENTRY),
+        MAKE_LONG_OPT_ENTRY(CONF_PERS_COLD_PATH),
+        MAKE_LONG_OPT_ENTRY(CONF_PERS_COMPRESS_COLD_SEGMENTS),
+        MAKE_LONG_OPT_ENTRY(CONF_PERS_MAX_MAPPED_SEGMENTS),
+        MAKE_LONG_OPT_ENTRY(CONF_PERS_LOAD_THREADS),
         {0, 0, 0, 0}};
 
 void Conf::initialize(int argc, char* argv[], const char* conf_file) {
@@ -170,7 +189,7 @@ std::vector<std::string> split_string(const std::string& str, const std::string&
     std::size_t lastpos = 0;
     std::size_t nextpos = 0;
     while((nextpos = str.find(delimiter, lastpos)) != std::string::npos) {
-        result.emplace_back(str.substr(lastpos, nextpos));
+        result.emplace_back(str.substr(lastpos, nextpos - lastpos));
         lastpos = nextpos + delimiter.length();
     }
     result.emplace_back(str.substr(lastpos));
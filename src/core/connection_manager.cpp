@@ -91,17 +91,34 @@ tcp_connections::tcp_connections(node_id_t my_id,
     }
 }
 
+bool tcp_connections::remove_socket(node_id_t node_id) {
+    auto mutex_it = socket_mutexes.find(node_id);
+    if(mutex_it != socket_mutexes.end()) {
+        // Nobody can lock it again without sockets_mutex, so once this
+        // returns, no other thread is using the socket
+        { std::lock_guard<std::mutex> wait_for_users(mutex_it->second); }
+        socket_mutexes.erase(mutex_it);
+    }
+    return (sockets.erase(node_id) > 0);
+}
+
 void tcp_connections::destroy() {
     std::lock_guard<std::mutex> lock(sockets_mutex);
+    for(auto& p : socket_mutexes) {
+        std::lock_guard<std::mutex> wait_for_users(p.second);
+    }
+    socket_mutexes.clear();
     sockets.clear();
     conn_listener.reset();
 }
 
 void tcp_connections::write(node_id_t node_id, char const* buffer,
                             size_t size) {
-    std::lock_guard<std::mutex> lock(sockets_mutex);
+    std::unique_lock<std::mutex> map_lock(sockets_mutex);
     const auto it = sockets.find(node_id);
     assert(it != sockets.end());
+    std::lock_guard<std::mutex> socket_lock(socket_mutexes[node_id]);
+    map_lock.unlock();
     it->second.write(buffer, size);
 }
 
@@ -111,15 +128,18 @@ void tcp_connections::write_all(char const* buffer, size_t size) {
         if(p.first == my_id) {
             continue;
         }
+        std::lock_guard<std::mutex> socket_lock(socket_mutexes[p.first]);
         p.second.write(buffer, size);
     }
 }
 
 void tcp_connections::read(node_id_t node_id, char* buffer,
                            size_t size) {
-    std::lock_guard<std::mutex> lock(sockets_mutex);
+    std::unique_lock<std::mutex> map_lock(sockets_mutex);
     const auto it = sockets.find(node_id);
     assert(it != sockets.end());
+    std::lock_guard<std::mutex> socket_lock(socket_mutexes[node_id]);
+    map_lock.unlock();
     it->second.read(buffer, size);
 }
 
@@ -134,7 +154,7 @@ bool tcp_connections::add_node(node_id_t new_id, const std::pair<ip_addr_t, uint
 
 bool tcp_connections::delete_node(node_id_t remove_id) {
     std::lock_guard<std::mutex> lock(sockets_mutex);
-    return (sockets.erase(remove_id) > 0);
+    return remove_socket(remove_id);
 }
 
 bool tcp_connections::contains_node(node_id_t node_id) {
@@ -145,6 +165,7 @@ bool tcp_connections::contains_node(node_id_t node_id) {
 int32_t tcp_connections::probe_all() {
     std::lock_guard<std::mutex> lock(sockets_mutex);
     for(auto& p : sockets) {
+        std::lock_guard<std::mutex> socket_lock(socket_mutexes[p.first]);
         bool new_data_available = p.second.probe();
         if(new_data_available == true) {
             return p.first;
@@ -164,7 +185,9 @@ void tcp_connections::filter_to(const std::vector<node_id_t>& live_nodes_list) {
                                sorted_nodes_list.end(),
                                socket_map_iter->first)) {
             //If the node ID is not in the list, delete the socket
-            socket_map_iter = sockets.erase(socket_map_iter);
+            node_id_t removed_id = socket_map_iter->first;
+            socket_map_iter++;
+            remove_socket(removed_id);
         } else {
             socket_map_iter++;
         }
@@ -172,6 +195,7 @@ void tcp_connections::filter_to(const std::vector<node_id_t>& live_nodes_list) {
 }
 
 derecho::LockedReference<std::unique_lock<std::mutex>, socket> tcp_connections::get_socket(node_id_t node_id) {
-    return derecho::LockedReference<std::unique_lock<std::mutex>, socket>(sockets.at(node_id), sockets_mutex);
+    std::lock_guard<std::mutex> map_lock(sockets_mutex);
+    return derecho::LockedReference<std::unique_lock<std::mutex>, socket>(sockets.at(node_id), socket_mutexes[node_id]);
 }
 }  // namespace tcp
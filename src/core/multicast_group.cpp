@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <iterator>
 #include <limits>
 #include <thread>
 
@@ -9,6 +10,7 @@
 #include <derecho/persistent/Persistent.hpp>
 #include <derecho/rdmc/detail/util.hpp>
 #include <derecho/utils/logger.hpp>
+#include <derecho/utils/metrics.hpp>
 #include <derecho/utils/time.h>
 
 namespace derecho {
@@ -45,17 +47,28 @@ MulticastGroup::MulticastGroup(
           subgroup_settings_map(subgroup_settings_by_id),
           received_intervals(sst->num_received.size(), {-1, -1}),
           rdmc_group_num_offset(0),
+          free_message_buffers(total_num_subgroups),
           future_message_indices(total_num_subgroups, 0),
           next_sends(total_num_subgroups),
+          pending_sst_sends(total_num_subgroups, false),
           committed_sst_index(total_num_subgroups, -1),
           num_nulls_queued(total_num_subgroups, 0),
           first_null_index(total_num_subgroups, -1),
           pending_sends(total_num_subgroups),
           current_sends(total_num_subgroups),
+          current_receives(total_num_subgroups),
+          stale_rdmc_sends(total_num_subgroups, 0),
+          locally_stable_rdmc_messages(total_num_subgroups),
+          locally_stable_sst_messages(total_num_subgroups),
+          pending_message_timestamps(total_num_subgroups),
+          non_persistent_messages(total_num_subgroups),
+          non_persistent_sst_messages(total_num_subgroups),
           next_message_to_deliver(total_num_subgroups),
           minimum_persisted_version(total_num_subgroups, persistent::INVALID_VERSION),
           minimum_verified_version(total_num_subgroups, persistent::INVALID_VERSION),
+          subgroup_locks(total_num_subgroups),
           sender_timeout(sender_timeout),
+          rdmc_pipeline_depth(std::max(getConfUInt32(CONF_DERECHO_RDMC_PIPELINE_DEPTH), 1u)),
           sst(sst),
           sst_multicast_group_ptrs(total_num_subgroups),
           last_transfer_medium(total_num_subgroups),
@@ -63,6 +76,7 @@ MulticastGroup::MulticastGroup(
     for(uint i = 0; i < num_members; ++i) {
         node_id_to_sst_index[members[i]] = i;
     }
+    index_subgroup_settings();
 
     for(const auto p : subgroup_settings_by_id) {
         subgroup_id_t id = p.first;
@@ -108,17 +122,28 @@ MulticastGroup::MulticastGroup(
           subgroup_settings_map(subgroup_settings_by_id),
           received_intervals(sst->num_received.size(), {-1, -1}),
           rdmc_group_num_offset(old_group.rdmc_group_num_offset + old_group.num_members),
+          free_message_buffers(total_num_subgroups),
           future_message_indices(total_num_subgroups, 0),
           next_sends(total_num_subgroups),
+          pending_sst_sends(total_num_subgroups, false),
           committed_sst_index(total_num_subgroups, -1),
           num_nulls_queued(total_num_subgroups, 0),
           first_null_index(total_num_subgroups, -1),
           pending_sends(total_num_subgroups),
           current_sends(total_num_subgroups),
+          current_receives(total_num_subgroups),
+          stale_rdmc_sends(total_num_subgroups, 0),
+          locally_stable_rdmc_messages(total_num_subgroups),
+          locally_stable_sst_messages(total_num_subgroups),
+          pending_message_timestamps(total_num_subgroups),
+          non_persistent_messages(total_num_subgroups),
+          non_persistent_sst_messages(total_num_subgroups),
           next_message_to_deliver(total_num_subgroups),
           minimum_persisted_version(total_num_subgroups, persistent::INVALID_VERSION),
           minimum_verified_version(total_num_subgroups, persistent::INVALID_VERSION),
+          subgroup_locks(total_num_subgroups),
           sender_timeout(old_group.sender_timeout),
+          rdmc_pipeline_depth(old_group.rdmc_pipeline_depth),
           sst(sst),
           sst_multicast_group_ptrs(total_num_subgroups),
           last_transfer_medium(total_num_subgroups),
@@ -132,6 +157,7 @@ MulticastGroup::MulticastGroup(
     for(uint i = 0; i < num_members; ++i) {
         node_id_to_sst_index[members[i]] = i;
     }
+    index_subgroup_settings();
 
     // Convience function that takes a msg from the old group and
     // produces one suitable for this group.
@@ -149,68 +175,103 @@ MulticastGroup::MulticastGroup(
         return std::move(msg);
     };
 
-    for(const auto p : subgroup_settings_by_id) {
-        subgroup_id_t id = p.first;
-        const SubgroupSettings& settings = p.second;
-        auto num_shard_members = settings.members.size();
-        while(free_message_buffers[id].size() < settings.profile.window_size * num_shard_members) {
-            free_message_buffers[id].emplace_back(settings.profile.max_msg_size);
+    bool no_member_failed = true;
+    if(already_failed.size()) {
+        for(uint i = 0; i < num_members; ++i) {
+            if(already_failed[i]) {
+                no_member_failed = false;
+                break;
+            }
         }
     }
 
-    // Reclaim RDMCMessageBuffers from the old group, and supplement them with
-    // additional if the group has grown.
-    std::lock_guard<std::recursive_mutex> lock(old_group.msg_state_mtx);
+    // Keep the RDMC groups of the shards that have not changed. Their
+    // callbacks may run as soon as they are taken over, so hold the locks of
+    // this group's subgroups until its state has been set up.
+    std::vector<std::unique_lock<std::recursive_mutex>> new_group_locks;
+    for(auto& subgroup_lock : subgroup_locks) {
+        new_group_locks.emplace_back(subgroup_lock.mtx);
+    }
+    take_over_rdmc_groups(old_group, !already_failed.size() || no_member_failed);
+
+    // Reclaim RDMCMessageBuffers from the old group, which are already
+    // registered, and only allocate new ones for the shards that have grown
+    // once all of them have been reclaimed. The old group is wedged, but take
+    // all of its subgroup locks (in subgroup order) in case a straggling
+    // upcall still touches its state.
+    std::vector<std::unique_lock<std::recursive_mutex>> old_group_locks;
+    for(auto& subgroup_lock : old_group.subgroup_locks) {
+        old_group_locks.emplace_back(subgroup_lock.mtx);
+    }
+    const subgroup_id_t old_num_subgroups = old_group.subgroup_locks.size();
     for(const auto p : subgroup_settings_by_id) {
         const subgroup_id_t subgroup_num = p.first;
-        const SubgroupSettings& settings = p.second;
-        auto num_shard_members = settings.members.size();
-        // for later: don't move extra message buffers
-        free_message_buffers[subgroup_num].swap(old_group.free_message_buffers[subgroup_num]);
-        while(free_message_buffers[subgroup_num].size() < settings.profile.window_size * num_shard_members) {
-            free_message_buffers[subgroup_num].emplace_back(settings.profile.max_msg_size);
+        if(subgroup_num < old_num_subgroups) {
+            free_message_buffers[subgroup_num].swap(old_group.free_message_buffers[subgroup_num]);
         }
     }
 
-    for(auto& msg : old_group.current_receives) {
-        free_message_buffers[msg.first.first].push_back(std::move(msg.second.message_buffer));
+    for(subgroup_id_t subgroup_num = 0; subgroup_num < old_num_subgroups; ++subgroup_num) {
+        if(subgroup_num < total_num_subgroups) {
+            for(auto& msg : old_group.current_receives[subgroup_num]) {
+                // RDMC is still receiving into the buffer on a kept group
+                if(rdmc_groups.count({subgroup_num, msg.first})) {
+                    current_receives[subgroup_num].emplace(msg.first, std::move(msg.second));
+                } else {
+                    free_message_buffers[subgroup_num].push_back(std::move(msg.second.message_buffer));
+                }
+            }
+        }
+        old_group.current_receives[subgroup_num].clear();
     }
-    old_group.current_receives.clear();
 
     // Assume that any locally stable messages failed. If we were the sender
     // than re-attempt, otherwise discard. TODO: Presumably the ragged edge
     // cleanup will want the chance to deliver some of these.
-    for(auto& p : old_group.locally_stable_rdmc_messages) {
-        if(p.second.size() == 0) {
-            continue;
-        }
-
-        for(auto& q : p.second) {
-            if(q.second.sender_id == members[member_index]) {
-                pending_sends[p.first].push(convert_msg(q.second, p.first));
+    for(subgroup_id_t subgroup_num = 0; subgroup_num < old_num_subgroups && subgroup_num < total_num_subgroups;
+        ++subgroup_num) {
+        old_group.locally_stable_rdmc_messages[subgroup_num].for_each([&](message_id_t, RDMCMessage& msg) {
+            if(msg.sender_id == members[member_index]) {
+                pending_sends[subgroup_num].push(convert_msg(msg, subgroup_num));
             } else {
-                free_message_buffers[p.first].push_back(std::move(q.second.message_buffer));
+                free_message_buffers[subgroup_num].push_back(std::move(msg.message_buffer));
             }
-        }
+        });
+    }
+    for(auto& messages : old_group.locally_stable_rdmc_messages) {
+        messages.clear();
     }
-    old_group.locally_stable_rdmc_messages.clear();
 
     for(const auto p : subgroup_settings_by_id) {
         subgroup_id_t id = p.first;
         const SubgroupSettings& settings = p.second;
-        auto num_shard_members = settings.members.size();
-        while(free_message_buffers[id].size() < settings.profile.window_size * num_shard_members) {
+        const std::size_t num_buffers = settings.profile.window_size * settings.members.size();
+        while(free_message_buffers[id].size() < num_buffers) {
             free_message_buffers[id].emplace_back(settings.profile.max_msg_size);
         }
+        // Release the buffers a shard that has shrunk no longer needs
+        if(free_message_buffers[id].size() > num_buffers) {
+            free_message_buffers[id].erase(free_message_buffers[id].begin() + num_buffers,
+                                           free_message_buffers[id].end());
+        }
     }
 
-    old_group.locally_stable_sst_messages.clear();
+    for(auto& messages : old_group.locally_stable_sst_messages) {
+        messages.clear();
+    }
 
     // Any messages that were being sent should be re-attempted.
     for(const auto& p : subgroup_settings_by_id) {
         auto subgroup_num = p.first;
-        if(old_group.current_sends.size() > subgroup_num && old_group.current_sends[subgroup_num]) {
-            pending_sends[subgroup_num].push(convert_msg(*old_group.current_sends[subgroup_num], subgroup_num));
+        if(old_group.current_sends.size() > subgroup_num) {
+            // On a kept group, RDMC finishes sending these before anything else
+            if(rdmc_groups.count({subgroup_num, members[member_index]})) {
+                stale_rdmc_sends[subgroup_num] = old_group.current_sends[subgroup_num].size();
+            }
+            for(auto& msg : old_group.current_sends[subgroup_num]) {
+                pending_sends[subgroup_num].push(convert_msg(msg, subgroup_num));
+            }
+            old_group.current_sends[subgroup_num].clear();
         }
 
         if(old_group.pending_sends.size() > subgroup_num) {
@@ -224,28 +285,21 @@ MulticastGroup::MulticastGroup(
             next_sends[subgroup_num] = convert_msg(*old_group.next_sends[subgroup_num], subgroup_num);
         }
 
-        for(auto& entry : old_group.non_persistent_messages[subgroup_num]) {
-            non_persistent_messages[subgroup_num].emplace(entry.first,
-                                                          convert_msg(entry.second, subgroup_num));
+        if(subgroup_num < old_num_subgroups) {
+            old_group.non_persistent_messages[subgroup_num].for_each([&](message_id_t seq_num, RDMCMessage& msg) {
+                non_persistent_messages[subgroup_num].emplace(seq_num, convert_msg(msg, subgroup_num));
+            });
+            old_group.non_persistent_messages[subgroup_num].clear();
+            old_group.non_persistent_sst_messages[subgroup_num].for_each([&](message_id_t seq_num, SSTMessage& msg) {
+                non_persistent_sst_messages[subgroup_num].emplace(seq_num, convert_sst_msg(msg, subgroup_num));
+            });
+            old_group.non_persistent_sst_messages[subgroup_num].clear();
         }
-        old_group.non_persistent_messages.clear();
-        for(auto& entry : old_group.non_persistent_sst_messages[subgroup_num]) {
-            non_persistent_sst_messages[subgroup_num].emplace(entry.first,
-                                                              convert_sst_msg(entry.second, subgroup_num));
-        }
-        old_group.non_persistent_sst_messages.clear();
     }
+    old_group_locks.clear();
 
     initialize_sst_row();
-    bool no_member_failed = true;
-    if(already_failed.size()) {
-        for(uint i = 0; i < num_members; ++i) {
-            if(already_failed[i]) {
-                no_member_failed = false;
-                break;
-            }
-        }
-    }
+    new_group_locks.clear();
     if(!already_failed.size() || no_member_failed) {
         // if groups are created successfully, rdmc_sst_groups_created will be set to true
         rdmc_sst_groups_created = create_rdmc_sst_groups();
@@ -255,6 +309,23 @@ MulticastGroup::MulticastGroup(
     timeout_thread = std::thread(&MulticastGroup::check_failures_loop, this);
 }
 
+void MulticastGroup::index_subgroup_settings() {
+    subgroup_settings_by_index.assign(total_num_subgroups, nullptr);
+    num_shard_senders_by_index.assign(total_num_subgroups, 0);
+    shard_sst_indices_by_index.assign(total_num_subgroups, {});
+    for(const auto& p : subgroup_settings_map) {
+        subgroup_settings_by_index[p.first] = &p.second;
+        num_shard_senders_by_index[p.first] = get_num_senders(p.second.senders);
+        shard_sst_indices_by_index[p.first] = get_shard_sst_indices(p.first);
+        // A sender can run at most window_size messages ahead of delivery, so
+        // the undelivered sequence numbers normally fit in this window
+        const std::size_t seq_num_window = (p.second.profile.window_size + 1) * p.second.members.size();
+        locally_stable_rdmc_messages[p.first].reserve(seq_num_window);
+        locally_stable_sst_messages[p.first].reserve(seq_num_window);
+        pending_message_timestamps[p.first].reserve(p.second.profile.window_size);
+    }
+}
+
 bool MulticastGroup::create_rdmc_sst_groups() {
     for(const auto& p : subgroup_settings_map) {
         uint32_t subgroup_num = p.first;
@@ -262,7 +333,6 @@ bool MulticastGroup::create_rdmc_sst_groups() {
         const std::vector<node_id_t>& shard_members = subgroup_settings.members;
         std::size_t num_shard_members = shard_members.size();
         std::vector<int> shard_senders = subgroup_settings.senders;
-        uint32_t num_shard_senders = get_num_senders(shard_senders);
         auto shard_sst_indices = get_shard_sst_indices(subgroup_num);
 
         sst_multicast_group_ptrs[subgroup_num] = std::make_unique<sst::multicast_group<DerechoSST>>(
@@ -277,121 +347,20 @@ bool MulticastGroup::create_rdmc_sst_groups() {
                 }
                 sender_rank++;
                 node_id_t node_id = shard_members[shard_rank];
-                // When RDMC receives a message, it should store it in
-                // locally_stable_rdmc_messages and update the received count
-                rdmc::completion_callback_t rdmc_receive_handler;
-                rdmc_receive_handler = [this, subgroup_num, shard_rank, sender_rank,
-                                        subgroup_settings, node_id,
-                                        num_shard_senders,
-                                        shard_sst_indices](char* data, size_t size) {
-                    assert(this->sst);
-                    std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
-                    header* h = (header*)data;
-                    const int32_t index = h->index;
-                    message_id_t sequence_number = index * num_shard_senders + sender_rank;
-
-                    dbg_default_trace("Locally received message in subgroup {}, sender rank {}, index {}",
-                                      subgroup_num, shard_rank, index);
-                    // Move message from current_receives to locally_stable_rdmc_messages.
-                    if(node_id == members[member_index]) {
-                        assert(current_sends[subgroup_num]);
-                        locally_stable_rdmc_messages[subgroup_num][sequence_number] = std::move(*current_sends[subgroup_num]);
-                        current_sends[subgroup_num] = std::nullopt;
-                    } else {
-                        auto it = current_receives.find({subgroup_num, node_id});
-                        assert(it != current_receives.end());
-                        auto& msg = it->second;
-                        msg.index = index;
-                        // We set the size in this receive handler instead of in the incoming_message_handler
-                        msg.size = size;
-                        locally_stable_rdmc_messages[subgroup_num].emplace(sequence_number, std::move(msg));
-                        current_receives.erase(it);
-                    }
 
-                    auto new_num_received = resolve_num_received(index, subgroup_settings.num_received_offset + sender_rank);
-                    // NULL Send Scheme
-                    // only if I am a sender in the subgroup and the subgroup is not in UNORDERED mode
-                    if(subgroup_settings.sender_rank >= 0 && subgroup_settings.mode != Mode::UNORDERED) {
-                        if(subgroup_settings.sender_rank < (int)sender_rank) {
-                            while(future_message_indices[subgroup_num] <= new_num_received) {
-                                get_buffer_and_send_auto_null(subgroup_num);
-                            }
-                        } else if(subgroup_settings.sender_rank > (int)sender_rank) {
-                            while(future_message_indices[subgroup_num] < new_num_received) {
-                                get_buffer_and_send_auto_null(subgroup_num);
-                            }
-                        }
-                    }
+                // don't create rdmc group if there's only one member in the shard
+                if(num_shard_members <= 1) {
+                    singleton_shard_receive_handlers[subgroup_num]
+                            = make_rdmc_callbacks(subgroup_num, shard_rank, sender_rank, 0).second;
+                    continue;
+                }
 
-                    // deliver immediately if in UNORDERED mode
-                    if(subgroup_settings.mode == Mode::UNORDERED) {
-                        // issue stability upcalls for the recently sequenced messages
-                        for(int i = sst->num_received[member_index][subgroup_settings.num_received_offset + sender_rank] + 1;
-                            i <= new_num_received; ++i) {
-                            message_id_t seq_num = i * num_shard_senders + sender_rank;
-                            if(!locally_stable_sst_messages[subgroup_num].empty()
-                               && locally_stable_sst_messages[subgroup_num].begin()->first == seq_num) {
-                                auto& msg = locally_stable_sst_messages[subgroup_num].begin()->second;
-                                char* buf = const_cast<char*>(msg.buf);
-                                header* h = (header*)(buf);
-                                // no delivery callback for a NULL message
-                                if(msg.size > h->header_size && callbacks.global_stability_callback) {
-                                    callbacks.global_stability_callback(subgroup_num, msg.sender_id,
-                                                                        msg.index,
-                                                                        {{buf + h->header_size, msg.size - h->header_size}},
-                                                                        persistent::INVALID_VERSION);
-                                }
-                                if(node_id == members[member_index]) {
-                                    pending_message_timestamps[subgroup_num].erase(h->timestamp);
-                                }
-                                locally_stable_sst_messages[subgroup_num].erase(locally_stable_sst_messages[subgroup_num].begin());
-                            } else {
-                                assert(!locally_stable_rdmc_messages[subgroup_num].empty());
-                                auto it2 = locally_stable_rdmc_messages[subgroup_num].begin();
-                                assert(it2->first == seq_num);
-                                auto& msg = it2->second;
-                                char* buf = msg.message_buffer.buffer.get();
-                                header* h = (header*)(buf);
-                                // no delivery for a NULL message
-                                if(msg.size > h->header_size && callbacks.global_stability_callback) {
-                                    callbacks.global_stability_callback(subgroup_num, msg.sender_id,
-                                                                        msg.index,
-                                                                        {{buf + h->header_size, msg.size - h->header_size}},
-                                                                        persistent::INVALID_VERSION);
-                                }
-                                free_message_buffers[subgroup_num].push_back(std::move(msg.message_buffer));
-                                if(node_id == members[member_index]) {
-                                    pending_message_timestamps[subgroup_num].erase(h->timestamp);
-                                }
-                                locally_stable_rdmc_messages[subgroup_num].erase(it2);
-                            }
-                        }
-                    }
-                    if(new_num_received > sst->num_received[member_index][subgroup_settings.num_received_offset + sender_rank]) {
-                        sst->num_received[member_index][subgroup_settings.num_received_offset + sender_rank] = new_num_received;
-                        // std::atomic_signal_fence(std::memory_order_acq_rel);
-                        auto* min_ptr = std::min_element(&sst->num_received[member_index][subgroup_settings.num_received_offset],
-                                                         &sst->num_received[member_index][subgroup_settings.num_received_offset + num_shard_senders]);
-                        uint min_index = std::distance(&sst->num_received[member_index][subgroup_settings.num_received_offset], min_ptr);
-                        auto new_seq_num = (*min_ptr + 1) * num_shard_senders + min_index - 1;
-                        if(static_cast<message_id_t>(new_seq_num) > sst->seq_num[member_index][subgroup_num]) {
-                            dbg_default_trace("Updating seq_num for subgroup {} to {}", subgroup_num, new_seq_num);
-                            sst->seq_num[member_index][subgroup_num] = new_seq_num;
-                            sst->put(shard_sst_indices,
-                                     sst->seq_num, subgroup_num);
-                        }
-                        sst->put(shard_sst_indices,
-                                 sst->num_received,
-                                 subgroup_settings.num_received_offset + sender_rank);
-                    }
-                };
-                // Capture rdmc_receive_handler by copy! The reference to it won't be valid after this constructor ends!
-                auto receive_handler_plus_notify =
-                        [this, rdmc_receive_handler](char* data, size_t size) {
-                            rdmc_receive_handler(data, size);
-                            // signal background writer thread
-                            sender_cv.notify_all();
-                        };
+                // A group kept from the previous view still takes up a number,
+                // so that all members number the new groups the same way
+                if(rdmc_groups.count({subgroup_num, node_id})) {
+                    rdmc_group_num_offset++;
+                    continue;
+                }
 
                 // Create a "rotated" vector of members in which the currently selected shard member (shard_rank) is first
                 std::vector<uint32_t> rotated_shard_members(shard_members.size());
@@ -399,56 +368,240 @@ bool MulticastGroup::create_rdmc_sst_groups() {
                     rotated_shard_members[k] = shard_members[(shard_rank + k) % num_shard_members];
                 }
 
-                // don't create rdmc group if there's only one member in the shard
-                if(num_shard_members <= 1) {
-                    singleton_shard_receive_handlers[subgroup_num] = receive_handler_plus_notify;
-                    continue;
+                auto rdmc_callbacks = make_rdmc_callbacks(subgroup_num, shard_rank, sender_rank, 0);
+                if(!rdmc::create_group(
+                           rdmc_group_num_offset, rotated_shard_members, subgroup_settings.profile.block_size, subgroup_settings.profile.rdmc_send_algorithm,
+                           rdmc_callbacks.first, rdmc_callbacks.second, [](std::optional<uint32_t>) {},
+                           subgroup_settings.profile.rdmc_node_racks)) {
+                    return false;
                 }
+                rdmc_groups[{subgroup_num, node_id}] = RDMCGroup{rdmc_group_num_offset, rotated_shard_members, 0};
+                rdmc_group_num_offset++;
+            }
+        }
+    }
+    return true;
+}
 
-                if(node_id == members[member_index]) {
-                    //Create a group in which this node is the sender, and only self-receives happen
-                    if(!rdmc::create_group(
-                               rdmc_group_num_offset, rotated_shard_members, subgroup_settings.profile.block_size, subgroup_settings.profile.rdmc_send_algorithm,
-                               [](size_t length) -> rdmc::receive_destination {
-                                   assert_always(false);
-                                   return {nullptr, 0};
-                               },
-                               receive_handler_plus_notify,
-                               [](std::optional<uint32_t>) {})) {
-                        return false;
+std::pair<rdmc::incoming_message_callback_t, rdmc::completion_callback_t> MulticastGroup::make_rdmc_callbacks(
+        subgroup_id_t subgroup_num, uint32_t shard_rank, uint32_t sender_rank, uint32_t generation) {
+    const SubgroupSettings& subgroup_settings = subgroup_settings_map.at(subgroup_num);
+    const node_id_t node_id = subgroup_settings.members[shard_rank];
+    const uint32_t num_shard_senders = get_num_senders(subgroup_settings.senders);
+    auto shard_sst_indices = get_shard_sst_indices(subgroup_num);
+
+    // When RDMC receives a message, it should store it in
+    // locally_stable_rdmc_messages and update the received count
+    rdmc::completion_callback_t rdmc_receive_handler;
+    rdmc_receive_handler = [this, subgroup_num, shard_rank, sender_rank,
+                            subgroup_settings, node_id,
+                            num_shard_senders, generation,
+                            shard_sst_indices](char* data, size_t size) {
+        assert(this->sst);
+        std::lock_guard<std::recursive_mutex> lock(subgroup_locks[subgroup_num].mtx);
+        header* h = (header*)data;
+        // A message of the previous view on a group this view kept, which its
+        // sender sends again if it was not delivered
+        if(h->generation != generation) {
+            if(node_id == members[member_index]) {
+                assert(stale_rdmc_sends[subgroup_num] > 0);
+                stale_rdmc_sends[subgroup_num]--;
+            } else {
+                auto it = current_receives[subgroup_num].find(node_id);
+                assert(it != current_receives[subgroup_num].end());
+                free_message_buffers[subgroup_num].push_back(std::move(it->second.message_buffer));
+                current_receives[subgroup_num].erase(it);
+            }
+            return;
+        }
+        const int32_t index = h->index;
+        message_id_t sequence_number = index * num_shard_senders + sender_rank;
+
+        dbg_default_trace("Locally received message in subgroup {}, sender rank {}, index {}",
+                          subgroup_num, shard_rank, index);
+        // Move message from current_receives to locally_stable_rdmc_messages.
+        if(node_id == members[member_index]) {
+            // RDMC completes a sender's messages in the order they were sent
+            assert(!current_sends[subgroup_num].empty());
+            assert(current_sends[subgroup_num].front().index == index);
+            RDMCMessage& sent_msg = current_sends[subgroup_num].front();
+            // RDMC is done with the segments, which delivery only reads in place
+            // for an RPC call whose last argument is the one segment
+            if(!sent_msg.segments.empty()
+               && (sent_msg.segments.size() > 1 || subgroup_settings.mode == Mode::UNORDERED
+                   || !((header*)sent_msg.message_buffer.buffer.get())->cooked_send)) {
+                gather_segments(sent_msg);
+            }
+            sent_msg.receive_time = metrics::start_time();
+            locally_stable_rdmc_messages[subgroup_num].emplace(sequence_number, std::move(sent_msg));
+            current_sends[subgroup_num].pop_front();
+        } else {
+            auto it = current_receives[subgroup_num].find(node_id);
+            assert(it != current_receives[subgroup_num].end());
+            auto& msg = it->second;
+            msg.index = index;
+            // We set the size in this receive handler instead of in the incoming_message_handler
+            msg.size = size;
+            msg.receive_time = metrics::start_time();
+            locally_stable_rdmc_messages[subgroup_num].emplace(sequence_number, std::move(msg));
+            current_receives[subgroup_num].erase(it);
+        }
+
+        auto new_num_received = resolve_num_received(index, subgroup_settings.num_received_offset + sender_rank);
+        // NULL Send Scheme
+        // only if I am a sender in the subgroup and the subgroup is not in UNORDERED mode
+        if(subgroup_settings.sender_rank >= 0 && subgroup_settings.mode != Mode::UNORDERED) {
+            if(subgroup_settings.sender_rank < (int)sender_rank) {
+                while(future_message_indices[subgroup_num] <= new_num_received) {
+                    get_buffer_and_send_auto_null(subgroup_num);
+                }
+            } else if(subgroup_settings.sender_rank > (int)sender_rank) {
+                while(future_message_indices[subgroup_num] < new_num_received) {
+                    get_buffer_and_send_auto_null(subgroup_num);
+                }
+            }
+        }
+
+        // deliver immediately if in UNORDERED mode
+        if(subgroup_settings.mode == Mode::UNORDERED) {
+            // issue stability upcalls for the recently sequenced messages
+            for(int i = sst->num_received[member_index][subgroup_settings.num_received_offset + sender_rank] + 1;
+                i <= new_num_received; ++i) {
+                message_id_t seq_num = i * num_shard_senders + sender_rank;
+                if(!locally_stable_sst_messages[subgroup_num].empty()
+                   && locally_stable_sst_messages[subgroup_num].front_key() == seq_num) {
+                    auto& msg = locally_stable_sst_messages[subgroup_num].front();
+                    char* buf = const_cast<char*>(msg.buf);
+                    header* h = (header*)(buf);
+                    // no delivery callback for a NULL message
+                    if(msg.size > h->header_size && callbacks.global_stability_callback) {
+                        callbacks.global_stability_callback(subgroup_num, msg.sender_id,
+                                                            msg.index,
+                                                            {{buf + h->header_size, msg.size - h->header_size}},
+                                                            persistent::INVALID_VERSION);
                     }
-                    subgroup_to_rdmc_group[subgroup_num] = rdmc_group_num_offset;
-                    rdmc_group_num_offset++;
+                    if(node_id == members[member_index]) {
+                        pending_message_timestamps[subgroup_num].erase(msg.index);
+                    }
+                    locally_stable_sst_messages[subgroup_num].pop_front();
                 } else {
-                    if(!rdmc::create_group(
-                               rdmc_group_num_offset, rotated_shard_members, subgroup_settings.profile.block_size, subgroup_settings.profile.rdmc_send_algorithm,
-                               [this, subgroup_num, node_id](size_t length) {
-                                   std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
-                                   assert(!free_message_buffers[subgroup_num].empty());
-                                   //Create a Message struct to receive the data into.
-                                   RDMCMessage msg;
-                                   msg.sender_id = node_id;
-                                   // The length variable is not the exact size of the msg,
-                                   // but it is the nearest multiple of the block size greater then the size
-                                   // so we will set the size in the receive handler
-                                   msg.message_buffer = std::move(free_message_buffers[subgroup_num].back());
-                                   free_message_buffers[subgroup_num].pop_back();
-
-                                   rdmc::receive_destination ret{msg.message_buffer.mr, 0};
-                                   current_receives[{subgroup_num, node_id}] = std::move(msg);
-
-                                   assert(ret.mr->buffer != nullptr);
-                                   return ret;
-                               },
-                               rdmc_receive_handler, [](std::optional<uint32_t>) {})) {
-                        return false;
+                    assert(!locally_stable_rdmc_messages[subgroup_num].empty());
+                    assert(locally_stable_rdmc_messages[subgroup_num].front_key() == seq_num);
+                    auto& msg = locally_stable_rdmc_messages[subgroup_num].front();
+                    char* buf = msg.message_buffer.buffer.get();
+                    header* h = (header*)(buf);
+                    // no delivery for a NULL message
+                    if(msg.size > h->header_size && callbacks.global_stability_callback) {
+                        callbacks.global_stability_callback(subgroup_num, msg.sender_id,
+                                                            msg.index,
+                                                            {{buf + h->header_size, msg.size - h->header_size}},
+                                                            persistent::INVALID_VERSION);
                     }
-                    rdmc_group_num_offset++;
+                    free_message_buffers[subgroup_num].push_back(std::move(msg.message_buffer));
+                    if(node_id == members[member_index]) {
+                        pending_message_timestamps[subgroup_num].erase(msg.index);
+                    }
+                    locally_stable_rdmc_messages[subgroup_num].pop_front();
                 }
             }
         }
+        if(new_num_received > sst->num_received[member_index][subgroup_settings.num_received_offset + sender_rank]) {
+            sst->num_received[member_index][subgroup_settings.num_received_offset + sender_rank] = new_num_received;
+            // std::atomic_signal_fence(std::memory_order_acq_rel);
+            auto* min_ptr = std::min_element(&sst->num_received[member_index][subgroup_settings.num_received_offset],
+                                             &sst->num_received[member_index][subgroup_settings.num_received_offset + num_shard_senders]);
+            uint min_index = std::distance(&sst->num_received[member_index][subgroup_settings.num_received_offset], min_ptr);
+            auto new_seq_num = (*min_ptr + 1) * num_shard_senders + min_index - 1;
+            if(static_cast<message_id_t>(new_seq_num) > sst->seq_num[member_index][subgroup_num]) {
+                dbg_default_trace("Updating seq_num for subgroup {} to {}", subgroup_num, new_seq_num);
+                sst->seq_num[member_index][subgroup_num] = new_seq_num;
+                sst->put(shard_sst_indices,
+                         sst->seq_num, subgroup_num);
+            }
+            sst->put(shard_sst_indices,
+                     sst->num_received,
+                     subgroup_settings.num_received_offset + sender_rank);
+        }
+    };
+    // Capture rdmc_receive_handler by copy! The reference to it won't be valid after this function returns!
+    auto receive_handler_plus_notify =
+            [this, rdmc_receive_handler](char* data, size_t size) {
+                rdmc_receive_handler(data, size);
+                // signal background writer thread
+                wake_sender_thread();
+            };
+
+    if(node_id == members[member_index]) {
+        // In a group in which this node is the sender, only self-receives happen
+        return {[](size_t length) -> rdmc::receive_destination {
+                    assert_always(false);
+                    return {nullptr, 0};
+                },
+                receive_handler_plus_notify};
+    }
+    return {[this, subgroup_num, node_id](size_t length) {
+                std::lock_guard<std::recursive_mutex> lock(subgroup_locks[subgroup_num].mtx);
+                assert(!free_message_buffers[subgroup_num].empty());
+                //Create a Message struct to receive the data into.
+                RDMCMessage msg;
+                msg.sender_id = node_id;
+                // The length variable is not the exact size of the msg,
+                // but it is the nearest multiple of the block size greater then the size
+                // so we will set the size in the receive handler
+                msg.message_buffer = std::move(free_message_buffers[subgroup_num].back());
+                free_message_buffers[subgroup_num].pop_back();
+
+                rdmc::receive_destination ret{msg.message_buffer.mr, 0};
+                current_receives[subgroup_num][node_id] = std::move(msg);
+
+                assert(ret.mr->buffer != nullptr);
+                return ret;
+            },
+            rdmc_receive_handler};
+}
+
+void MulticastGroup::take_over_rdmc_groups(MulticastGroup& old_group, bool keep) {
+    for(auto& p : old_group.rdmc_groups) {
+        const subgroup_id_t subgroup_num = p.first.first;
+        const node_id_t sender_id = p.first.second;
+        RDMCGroup& rdmc_group = p.second;
+        auto settings_it = subgroup_settings_map.find(subgroup_num);
+        // A group can be kept only if its messages are received into buffers
+        // of the same size, and sent along the same schedule
+        bool same_shard = keep && settings_it != subgroup_settings_map.end();
+        if(same_shard) {
+            const SubgroupSettings& settings = settings_it->second;
+            const SubgroupSettings& old_settings = old_group.subgroup_settings_map.at(subgroup_num);
+            same_shard = settings.members == old_settings.members
+                         && settings.senders == old_settings.senders
+                         && settings.profile.max_msg_size == old_settings.profile.max_msg_size
+                         && settings.profile.sst_max_msg_size == old_settings.profile.sst_max_msg_size
+                         && settings.profile.block_size == old_settings.profile.block_size
+                         && settings.profile.rdmc_send_algorithm == old_settings.profile.rdmc_send_algorithm
+                         && settings.profile.rdmc_node_racks == old_settings.profile.rdmc_node_racks;
+        }
+        if(same_shard) {
+            const SubgroupSettings& settings = settings_it->second;
+            const uint32_t shard_rank = index_of(settings.members, sender_id);
+            uint32_t sender_rank = 0;
+            for(uint32_t rank = 0; rank < shard_rank; ++rank) {
+                if(settings.senders[rank]) {
+                    sender_rank++;
+                }
+            }
+            // Messages that complete on the group from now on belong to this
+            // view, or are ones of the previous view that the callbacks discard
+            auto rdmc_callbacks = make_rdmc_callbacks(subgroup_num, shard_rank, sender_rank, rdmc_group.generation + 1);
+            if(rdmc::rebind_group(rdmc_group.group_number, rdmc_callbacks.first, rdmc_callbacks.second)) {
+                rdmc_group.generation++;
+                rdmc_groups.emplace(p.first, std::move(rdmc_group));
+                kept_rdmc_groups_released = false;
+                continue;
+            }
+        }
+        rdmc::destroy_group(rdmc_group.group_number);
     }
-    return true;
+    old_group.rdmc_groups.clear();
 }
 
 void MulticastGroup::initialize_sst_row() {
@@ -485,7 +638,18 @@ void MulticastGroup::deliver_message(RDMCMessage& msg, const subgroup_id_t& subg
         buf += h->header_size;
         auto payload_size = msg.size - h->header_size;
         internal_callbacks.post_next_version_callback(subgroup_num, version, msg_ts_us);
-        internal_callbacks.rpc_callback(subgroup_num, msg.sender_id, version, msg_ts_us, buf, payload_size);
+        if(msg.segments.empty()) {
+            internal_callbacks.rpc_callback(subgroup_num, msg.sender_id, version, msg_ts_us, buf, payload_size,
+                                            nullptr, 0);
+        } else {
+            // A call this node sent from one segment reads its last argument there
+            assert(msg.segments.size() == 1);
+            const rdmc::segment& segment = msg.segments.front();
+            internal_callbacks.rpc_callback(subgroup_num, msg.sender_id, version, msg_ts_us, buf, payload_size,
+                                            segment.buffer, segment.length);
+            msg.segments.clear();
+            msg.segments_pin.reset();
+        }
         if(callbacks.global_stability_callback) {
             callbacks.global_stability_callback(subgroup_num, msg.sender_id, msg.index, {},
                                                 version);
@@ -511,7 +675,8 @@ void MulticastGroup::deliver_message(SSTMessage& msg, const subgroup_id_t& subgr
         buf += h->header_size;
         auto payload_size = msg.size - h->header_size;
         internal_callbacks.post_next_version_callback(subgroup_num, version, msg_ts_us);
-        internal_callbacks.rpc_callback(subgroup_num, msg.sender_id, version, msg_ts_us, buf, payload_size);
+        internal_callbacks.rpc_callback(subgroup_num, msg.sender_id, version, msg_ts_us, buf, payload_size,
+                                        nullptr, 0);
         if(callbacks.global_stability_callback) {
             callbacks.global_stability_callback(subgroup_num, msg.sender_id, msg.index, {},
                                                 version);
@@ -523,7 +688,17 @@ void MulticastGroup::deliver_message(SSTMessage& msg, const subgroup_id_t& subgr
     }
 }
 
-bool MulticastGroup::version_message(RDMCMessage& msg, const subgroup_id_t& subgroup_num,
+void MulticastGroup::gather_segments(RDMCMessage& msg) {
+    char* dest = msg.message_buffer.buffer.get() + msg.buffer_size;
+    for(const rdmc::segment& segment : msg.segments) {
+        memcpy(dest, segment.buffer, segment.length);
+        dest += segment.length;
+    }
+    msg.segments.clear();
+    msg.segments_pin.reset();
+}
+
+bool MulticastGroup::version_message(RDMCMessage& msg, const subgroup_id_t& subgroup_num, message_id_t seq_num,
                                      const persistent::version_t& version, const uint64_t& msg_timestamp) {
     char* buf = msg.message_buffer.buffer.get();
     header* h = (header*)(buf);
@@ -531,9 +706,6 @@ bool MulticastGroup::version_message(RDMCMessage& msg, const subgroup_id_t& subg
     if(msg.size == h->header_size) {
         return false;
     }
-    if(msg.sender_id == members[member_index]) {
-        pending_persistence[subgroup_num][locally_stable_rdmc_messages[subgroup_num].begin()->first] = msg_timestamp;
-    }
     // make a version for persistent<t>/volatile<t>
     uint64_t msg_ts_us = msg_timestamp / 1e3;
     if(msg_ts_us == 0) {
@@ -545,7 +717,7 @@ bool MulticastGroup::version_message(RDMCMessage& msg, const subgroup_id_t& subg
     return true;
 }
 
-bool MulticastGroup::version_message(SSTMessage& msg, const subgroup_id_t& subgroup_num,
+bool MulticastGroup::version_message(SSTMessage& msg, const subgroup_id_t& subgroup_num, message_id_t seq_num,
                                      const persistent::version_t& version, const uint64_t& msg_timestamp) {
     char* buf = const_cast<char*>(msg.buf);
     header* h = (header*)(buf);
@@ -553,9 +725,6 @@ bool MulticastGroup::version_message(SSTMessage& msg, const subgroup_id_t& subgr
     if(msg.size == h->header_size) {
         return false;
     }
-    if(msg.sender_id == members[member_index]) {
-        pending_persistence[subgroup_num][locally_stable_sst_messages[subgroup_num].begin()->first] = msg_timestamp;
-    }
     // make a version for persistent<t>/volatile<t>
     uint64_t msg_ts_us = msg_timestamp / 1e3;
     if(msg_ts_us == 0) {
@@ -573,7 +742,7 @@ void MulticastGroup::deliver_messages_upto(
     bool non_null_msgs_delivered = false;
     assert(max_indices_for_senders.size() == (size_t)num_shard_senders);
     {
-        std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
+        std::lock_guard<std::recursive_mutex> lock(subgroup_locks[subgroup_num].mtx);
         int32_t curr_seq_num = sst->delivered_num[member_index][subgroup_num];
         int32_t max_seq_num = curr_seq_num;
         for(uint sender = 0; sender < num_shard_senders; sender++) {
@@ -588,26 +757,28 @@ void MulticastGroup::deliver_messages_upto(
             if(index > max_indices_for_senders[sender_rank]) {
                 continue;
             }
-            auto rdmc_msg_ptr = locally_stable_rdmc_messages[subgroup_num].find(seq_num);
+            RDMCMessage* rdmc_msg_ptr = locally_stable_rdmc_messages[subgroup_num].find(seq_num);
             assigned_version = persistent::combine_int32s(sst->vid[member_index], seq_num);
-            if(rdmc_msg_ptr != locally_stable_rdmc_messages[subgroup_num].end()) {
-                auto& msg = rdmc_msg_ptr->second;
+            if(rdmc_msg_ptr) {
+                auto& msg = *rdmc_msg_ptr;
                 char* buf = msg.message_buffer.buffer.get();
                 uint64_t msg_ts = ((header*)buf)->timestamp;
                 //Note: deliver_message frees the RDMC buffer in msg, which is why the timestamp must be saved before calling this
                 deliver_message(msg, subgroup_num, assigned_version, msg_ts / 1000);
-                non_null_msgs_delivered |= version_message(msg, subgroup_num, assigned_version, msg_ts);
+                non_null_msgs_delivered |= version_message(msg, subgroup_num, seq_num, assigned_version, msg_ts);
                 // free the message buffer only after it version_message has been called
                 free_message_buffers[subgroup_num].push_back(std::move(msg.message_buffer));
-                locally_stable_rdmc_messages[subgroup_num].erase(rdmc_msg_ptr);
+                locally_stable_rdmc_messages[subgroup_num].erase(seq_num);
             } else {
                 dbg_default_trace("Subgroup {}, deliver_messages_upto delivering an SST message with seq_num = {}",
                                   subgroup_num, seq_num);
-                auto& msg = locally_stable_sst_messages[subgroup_num].at(seq_num);
+                SSTMessage* sst_msg_ptr = locally_stable_sst_messages[subgroup_num].find(seq_num);
+                assert(sst_msg_ptr);
+                auto& msg = *sst_msg_ptr;
                 char* buf = (char*)msg.buf;
                 uint64_t msg_ts = ((header*)buf)->timestamp;
                 deliver_message(msg, subgroup_num, assigned_version, msg_ts / 1000);
-                non_null_msgs_delivered |= version_message(msg, subgroup_num, assigned_version, msg_ts);
+                non_null_msgs_delivered |= version_message(msg, subgroup_num, seq_num, assigned_version, msg_ts);
                 locally_stable_sst_messages[subgroup_num].erase(seq_num);
             }
         }
@@ -683,7 +854,7 @@ void MulticastGroup::sst_receive_handler(subgroup_id_t subgroup_num, const Subgr
         message_id_t sequence_number = index * num_shard_senders + sender_rank;
         node_id_t node_id = subgroup_settings.members[shard_ranks_by_sender_rank.at(sender_rank)];
 
-        locally_stable_sst_messages[subgroup_num][sequence_number] = {node_id, index, size, data};
+        locally_stable_sst_messages[subgroup_num].emplace(sequence_number, SSTMessage{node_id, index, size, data, metrics::start_time()});
 
         auto new_num_received = resolve_num_received(index, subgroup_settings.num_received_offset + sender_rank);
 
@@ -706,8 +877,8 @@ void MulticastGroup::sst_receive_handler(subgroup_id_t subgroup_num, const Subgr
             for(int i = sst->num_received[member_index][subgroup_settings.num_received_offset + sender_rank] + 1; i <= new_num_received; ++i) {
                 message_id_t seq_num = i * num_shard_senders + sender_rank;
                 if(!locally_stable_sst_messages[subgroup_num].empty()
-                   && locally_stable_sst_messages[subgroup_num].begin()->first == seq_num) {
-                    auto& msg = locally_stable_sst_messages[subgroup_num].begin()->second;
+                   && locally_stable_sst_messages[subgroup_num].front_key() == seq_num) {
+                    auto& msg = locally_stable_sst_messages[subgroup_num].front();
                     char* buf = const_cast<char*>(msg.buf);
                     header* h = (header*)(buf);
                     if(msg.size > h->header_size && callbacks.global_stability_callback) {
@@ -717,14 +888,13 @@ void MulticastGroup::sst_receive_handler(subgroup_id_t subgroup_num, const Subgr
                                                             persistent::INVALID_VERSION);
                     }
                     if(node_id == members[member_index]) {
-                        pending_message_timestamps[subgroup_num].erase(h->timestamp);
+                        pending_message_timestamps[subgroup_num].erase(msg.index);
                     }
-                    locally_stable_sst_messages[subgroup_num].erase(locally_stable_sst_messages[subgroup_num].begin());
+                    locally_stable_sst_messages[subgroup_num].pop_front();
                 } else {
                     assert(!locally_stable_rdmc_messages[subgroup_num].empty());
-                    auto it2 = locally_stable_rdmc_messages[subgroup_num].begin();
-                    assert(it2->first == seq_num);
-                    auto& msg = it2->second;
+                    assert(locally_stable_rdmc_messages[subgroup_num].front_key() == seq_num);
+                    auto& msg = locally_stable_rdmc_messages[subgroup_num].front();
                     char* buf = msg.message_buffer.buffer.get();
                     header* h = (header*)(buf);
                     if(msg.size > h->header_size && callbacks.global_stability_callback) {
@@ -735,9 +905,9 @@ void MulticastGroup::sst_receive_handler(subgroup_id_t subgroup_num, const Subgr
                     }
                     free_message_buffers[subgroup_num].push_back(std::move(msg.message_buffer));
                     if(node_id == members[member_index]) {
-                        pending_message_timestamps[subgroup_num].erase(h->timestamp);
+                        pending_message_timestamps[subgroup_num].erase(msg.index);
                     }
-                    locally_stable_rdmc_messages[subgroup_num].erase(it2);
+                    locally_stable_rdmc_messages[subgroup_num].pop_front();
                 }
             }
         }
@@ -755,7 +925,7 @@ void MulticastGroup::receiver_function(subgroup_id_t subgroup_num, const Subgrou
 
     bool put_new_seq_num = false;
     {
-        std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
+        std::lock_guard<std::recursive_mutex> lock(subgroup_locks[subgroup_num].mtx);
         for(uint sender_count = 0; sender_count < num_shard_senders; ++sender_count) {
             const uint32_t sender_sst_index = node_id_to_sst_index.at(subgroup_settings.members[shard_ranks_by_sender_rank.at(sender_count)]);
             uint32_t slot;
@@ -804,8 +974,12 @@ void MulticastGroup::receiver_function(subgroup_id_t subgroup_num, const Subgrou
 void MulticastGroup::delivery_trigger(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
                                       const uint32_t num_shard_members, DerechoSST& sst) {
     bool update_sst = false;
+    // With parallel delivery, this thread only decides the delivery order and
+    // hands the messages to the subgroup's worker, which publishes delivered_num
+    auto worker_it = delivery_workers.find(subgroup_num);
+    DeliveryWorker* worker = (worker_it == delivery_workers.end()) ? nullptr : worker_it->second.get();
     {
-        std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
+        std::lock_guard<std::recursive_mutex> lock(subgroup_locks[subgroup_num].mtx);
         // compute the min of the seq_num
         message_id_t min_stable_num
                 = sst.seq_num[node_id_to_sst_index.at(subgroup_settings.members[0])][subgroup_num];
@@ -823,55 +997,184 @@ void MulticastGroup::delivery_trigger(subgroup_id_t subgroup_num, const Subgroup
             int32_t least_undelivered_rdmc_seq_num, least_undelivered_sst_seq_num;
             least_undelivered_rdmc_seq_num = least_undelivered_sst_seq_num = std::numeric_limits<int32_t>::max();
             if(!locally_stable_rdmc_messages[subgroup_num].empty()) {
-                least_undelivered_rdmc_seq_num = locally_stable_rdmc_messages[subgroup_num].begin()->first;
+                least_undelivered_rdmc_seq_num = locally_stable_rdmc_messages[subgroup_num].front_key();
             }
             if(!locally_stable_sst_messages[subgroup_num].empty()) {
-                least_undelivered_sst_seq_num = locally_stable_sst_messages[subgroup_num].begin()->first;
+                least_undelivered_sst_seq_num = locally_stable_sst_messages[subgroup_num].front_key();
             }
             if(least_undelivered_rdmc_seq_num < least_undelivered_sst_seq_num && least_undelivered_rdmc_seq_num <= min_stable_num) {
                 update_sst = true;
                 dbg_default_trace("Subgroup {}, can deliver a locally stable RDMC message: min_stable_num={} and least_undelivered_seq_num={}",
                                   subgroup_num, min_stable_num, least_undelivered_rdmc_seq_num);
-                RDMCMessage& msg = locally_stable_rdmc_messages[subgroup_num].begin()->second;
+                RDMCMessage& msg = locally_stable_rdmc_messages[subgroup_num].front();
                 char* buf = msg.message_buffer.buffer.get();
                 uint64_t msg_ts = ((header*)buf)->timestamp;
-                //Note: deliver_message frees the RDMC buffer in msg, which is why the timestamp must be saved before calling this
                 assigned_version = persistent::combine_int32s(sst.vid[member_index], least_undelivered_rdmc_seq_num);
+                const uint64_t stable_time = metrics::start_time();
+                metrics::record_since(metrics::Metric::RECEIVE_TO_STABLE_NS, subgroup_num, msg.receive_time);
+                if(worker) {
+                    worker->decided.emplace_back(PendingDelivery{least_undelivered_rdmc_seq_num, assigned_version, msg_ts,
+                                                                 stable_time, std::move(msg), std::nullopt});
+                    worker->last_decided_seq_num = least_undelivered_rdmc_seq_num;
+                    locally_stable_rdmc_messages[subgroup_num].pop_front();
+                    continue;
+                }
+                //Note: deliver_message frees the RDMC buffer in msg, which is why the timestamp must be saved before calling this
                 deliver_message(msg, subgroup_num, assigned_version, msg_ts / 1000);
-                non_null_msgs_delivered |= version_message(msg, subgroup_num, assigned_version, msg_ts);
+                metrics::record_since(metrics::Metric::STABLE_TO_DELIVER_NS, subgroup_num, stable_time);
+                non_null_msgs_delivered |= version_message(msg, subgroup_num, least_undelivered_rdmc_seq_num,
+                                                           assigned_version, msg_ts);
                 // free the message buffer only after version_message has been called
                 free_message_buffers[subgroup_num].push_back(std::move(msg.message_buffer));
                 sst.delivered_num[member_index][subgroup_num] = least_undelivered_rdmc_seq_num;
-                locally_stable_rdmc_messages[subgroup_num].erase(locally_stable_rdmc_messages[subgroup_num].begin());
+                locally_stable_rdmc_messages[subgroup_num].pop_front();
             } else if(least_undelivered_sst_seq_num < least_undelivered_rdmc_seq_num && least_undelivered_sst_seq_num <= min_stable_num) {
                 update_sst = true;
                 dbg_default_trace("Subgroup {}, can deliver a locally stable SST message: min_stable_num={} and least_undelivered_seq_num={}",
                                   subgroup_num, min_stable_num, least_undelivered_sst_seq_num);
-                SSTMessage& msg = locally_stable_sst_messages[subgroup_num].begin()->second;
+                SSTMessage& msg = locally_stable_sst_messages[subgroup_num].front();
                 char* buf = (char*)msg.buf;
                 uint64_t msg_ts = ((header*)buf)->timestamp;
                 assigned_version = persistent::combine_int32s(sst.vid[member_index], least_undelivered_sst_seq_num);
+                const uint64_t stable_time = metrics::start_time();
+                metrics::record_since(metrics::Metric::RECEIVE_TO_STABLE_NS, subgroup_num, msg.receive_time);
+                if(worker) {
+                    // the SST slot is not reused until delivered_num passes this message
+                    worker->decided.emplace_back(PendingDelivery{least_undelivered_sst_seq_num, assigned_version, msg_ts,
+                                                                 stable_time, std::nullopt, msg});
+                    worker->last_decided_seq_num = least_undelivered_sst_seq_num;
+                    locally_stable_sst_messages[subgroup_num].pop_front();
+                    continue;
+                }
                 deliver_message(msg, subgroup_num, assigned_version, msg_ts / 1000);
-                non_null_msgs_delivered |= version_message(msg, subgroup_num, assigned_version, msg_ts);
+                metrics::record_since(metrics::Metric::STABLE_TO_DELIVER_NS, subgroup_num, stable_time);
+                non_null_msgs_delivered |= version_message(msg, subgroup_num, least_undelivered_sst_seq_num,
+                                                           assigned_version, msg_ts);
                 sst.delivered_num[member_index][subgroup_num] = least_undelivered_sst_seq_num;
-                locally_stable_sst_messages[subgroup_num].erase(locally_stable_sst_messages[subgroup_num].begin());
+                locally_stable_sst_messages[subgroup_num].pop_front();
             } else {
                 break;
             }
         }
-        if(update_sst) {
+        if(update_sst && !worker) {
             // post persistence request for ordered mode.
             if(non_null_msgs_delivered) {
                 persistence_manager.post_persist_request(subgroup_num, assigned_version);
             }
         }
     }
+    if(worker) {
+        if(!worker->decided.empty()) {
+            {
+                std::lock_guard<std::mutex> queue_lock(worker->queue_mtx);
+                if(worker->queue.empty()) {
+                    worker->queue.swap(worker->decided);
+                } else {
+                    std::move(worker->decided.begin(), worker->decided.end(), std::back_inserter(worker->queue));
+                }
+            }
+            worker->decided.clear();
+            worker->queue_cv.notify_one();
+        }
+        return;
+    }
     if(update_sst) {
         sst.put(get_shard_sst_indices(subgroup_num),
                 sst.delivered_num, subgroup_num);
     }
 }
 
+void MulticastGroup::delivery_loop(subgroup_id_t subgroup_num) {
+    pthread_setname_np(pthread_self(), "delivery_worker");
+    DeliveryWorker& worker = *delivery_workers.at(subgroup_num);
+    std::vector<PendingDelivery> batch;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> queue_lock(worker.queue_mtx);
+            worker.queue_cv.wait(queue_lock, [&worker]() { return !worker.queue.empty() || worker.shutdown; });
+            if(worker.shutdown) {
+                break;
+            }
+            batch.swap(worker.queue);
+        }
+        // The upcalls run without the subgroup's lock, so receipt of further
+        // messages in this subgroup can go on while they execute. A wedge
+        // stops the loop between two messages.
+        bool non_null_msgs_delivered = false;
+        std::size_t num_delivered = 0;
+        for(; num_delivered < batch.size() && !worker.shutdown; ++num_delivered) {
+            PendingDelivery& pending = batch[num_delivered];
+            if(pending.rdmc_msg) {
+                deliver_message(*pending.rdmc_msg, subgroup_num, pending.version, pending.msg_timestamp / 1000);
+            } else {
+                deliver_message(*pending.sst_msg, subgroup_num, pending.version, pending.msg_timestamp / 1000);
+            }
+            metrics::record_since(metrics::Metric::STABLE_TO_DELIVER_NS, subgroup_num, pending.stable_time);
+            std::lock_guard<std::recursive_mutex> lock(subgroup_locks[subgroup_num].mtx);
+            if(pending.rdmc_msg) {
+                non_null_msgs_delivered |= version_message(*pending.rdmc_msg, subgroup_num, pending.seq_num,
+                                                           pending.version, pending.msg_timestamp);
+            } else {
+                non_null_msgs_delivered |= version_message(*pending.sst_msg, subgroup_num, pending.seq_num,
+                                                           pending.version, pending.msg_timestamp);
+            }
+        }
+        if(num_delivered > 0) {
+            const PendingDelivery& last_delivered = batch[num_delivered - 1];
+            {
+                std::lock_guard<std::recursive_mutex> lock(subgroup_locks[subgroup_num].mtx);
+                for(std::size_t i = 0; i < num_delivered; ++i) {
+                    if(batch[i].rdmc_msg) {
+                        free_message_buffers[subgroup_num].push_back(std::move(batch[i].rdmc_msg->message_buffer));
+                    }
+                }
+                // only now may senders reuse the buffers and SST slots of these messages
+                gmssst::set(sst->delivered_num[member_index][subgroup_num], last_delivered.seq_num);
+                if(non_null_msgs_delivered) {
+                    persistence_manager.post_persist_request(subgroup_num, last_delivered.version);
+                }
+            }
+            sst->put(get_shard_sst_indices(subgroup_num),
+                     sst->delivered_num, subgroup_num);
+        }
+        if(num_delivered < batch.size()) {
+            // Wedged: put the rest back ahead of anything queued after it
+            std::lock_guard<std::mutex> queue_lock(worker.queue_mtx);
+            worker.queue.insert(worker.queue.begin(),
+                                std::make_move_iterator(batch.begin() + num_delivered),
+                                std::make_move_iterator(batch.end()));
+        }
+        batch.clear();
+    }
+}
+
+void MulticastGroup::stop_delivery_workers() {
+    for(auto& worker_pair : delivery_workers) {
+        const subgroup_id_t subgroup_num = worker_pair.first;
+        DeliveryWorker& worker = *worker_pair.second;
+        {
+            std::lock_guard<std::mutex> queue_lock(worker.queue_mtx);
+            worker.shutdown = true;
+        }
+        worker.queue_cv.notify_one();
+        // This only waits for the upcall of the message being delivered,
+        // which has to return before any later message can be delivered.
+        if(worker.thread.joinable()) {
+            worker.thread.join();
+        }
+        // The messages the worker did not deliver are locally stable again
+        std::lock_guard<std::recursive_mutex> lock(subgroup_locks[subgroup_num].mtx);
+        for(PendingDelivery& pending : worker.queue) {
+            if(pending.rdmc_msg) {
+                locally_stable_rdmc_messages[subgroup_num].emplace(pending.seq_num, std::move(*pending.rdmc_msg));
+            } else {
+                locally_stable_sst_messages[subgroup_num].emplace(pending.seq_num, *pending.sst_msg);
+            }
+        }
+        worker.queue.clear();
+    }
+}
+
 void MulticastGroup::sst_send_trigger(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
                                       const uint32_t num_shard_members, DerechoSST& sst) {
     int32_t current_committed_index;
@@ -879,7 +1182,7 @@ void MulticastGroup::sst_send_trigger(subgroup_id_t subgroup_num, const Subgroup
     int32_t current_first_null_index;
     uint32_t current_num_nulls_queued;
     {
-        std::unique_lock<std::recursive_mutex> lock(msg_state_mtx);
+        std::unique_lock<std::recursive_mutex> lock(subgroup_locks[subgroup_num].mtx);
         to_be_sent = committed_sst_index[subgroup_num] - sst.index[member_index][subgroup_settings.index_offset];
         if(to_be_sent > 0) {
             current_committed_index = sst_multicast_group_ptrs[subgroup_num]->commit_send(to_be_sent);
@@ -907,7 +1210,7 @@ void MulticastGroup::sst_send_trigger(subgroup_id_t subgroup_num, const Subgroup
 
 void MulticastGroup::update_min_persisted_num(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
                                               uint32_t num_shard_members, DerechoSST& sst) {
-    std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
+    std::lock_guard<std::recursive_mutex> lock(subgroup_locks[subgroup_num].mtx);
     // compute the min of the persisted_num
     persistent::version_t min_persisted_num
             = sst.persisted_num[node_id_to_sst_index.at(subgroup_settings.members[0])][subgroup_num];
@@ -931,7 +1234,6 @@ void MulticastGroup::update_min_persisted_num(subgroup_id_t subgroup_num, const
 
 void MulticastGroup::update_min_verified_num(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
                                              uint32_t num_shard_members, DerechoSST& sst) {
-    //Do I need msg_state_mtx here? What does it guard?
     persistent::version_t min_verified_num
             = sst.verified_num[node_id_to_sst_index.at(subgroup_settings.members[0])][subgroup_num];
     for(uint32_t i = 1; i < num_shard_members; ++i) {
@@ -951,6 +1253,15 @@ void MulticastGroup::update_min_verified_num(subgroup_id_t subgroup_num, const S
 }
 
 void MulticastGroup::register_predicates() {
+    // Create all the delivery workers before any trigger or worker can look them up
+    for(const auto& p : subgroup_settings_map) {
+        if(p.second.mode != Mode::UNORDERED && p.second.profile.parallel_delivery) {
+            delivery_workers.emplace(p.first, std::make_unique<DeliveryWorker>());
+        }
+    }
+    for(auto& worker_pair : delivery_workers) {
+        worker_pair.second->thread = std::thread(&MulticastGroup::delivery_loop, this, worker_pair.first);
+    }
     for(const auto& p : subgroup_settings_map) {
         subgroup_id_t subgroup_num = p.first;
         const SubgroupSettings& subgroup_settings = p.second;
@@ -979,51 +1290,109 @@ void MulticastGroup::register_predicates() {
                               shard_ranks_by_sender_rank, num_shard_senders, sst,
                               sst_receive_handler_lambda);
         };
+        const std::string subgroup_suffix = "/" + std::to_string(subgroup_num);
+        //The receiver predicate compares the senders' SST index entries with this node's
+        //num_received_sst entries, and only its own trigger advances the latter
+        const sst::PredicateInput index_input{
+                static_cast<std::size_t>((char*)std::addressof(sst->index[0][subgroup_settings.index_offset]) - sst->getBaseAddress()),
+                sizeof(sst->index[0][0])};
+        const sst::PredicateInput num_received_sst_input{
+                static_cast<std::size_t>((char*)std::addressof(sst->num_received_sst[0][subgroup_settings.num_received_offset]) - sst->getBaseAddress()),
+                sizeof(sst->num_received_sst[0][0]) * num_shard_senders};
         receiver_pred_handles.emplace_back(sst->predicates.insert(receiver_pred, receiver_trig,
-                                                                  sst::PredicateType::RECURRENT));
-
-        auto sst_send_pred = [](const DerechoSST& sst) {
-            return true;
+                                                                  sst::PredicateType::RECURRENT,
+                                                                  "receiver" + subgroup_suffix,
+                                                                  {index_input, num_received_sst_input}));
+
+        //This predicate is "there are committed SST messages that have not been sent". The
+        //committed index is local state, so send() wakes the predicate after changing it
+        auto sst_send_pred = [this, subgroup_num, subgroup_settings](const DerechoSST& sst) {
+            std::lock_guard<std::recursive_mutex> lock(subgroup_locks[subgroup_num].mtx);
+            return static_cast<int32_t>(committed_sst_index[subgroup_num]) > sst.index[member_index][subgroup_settings.index_offset];
         };
         auto sst_send_trig = [this, subgroup_num, subgroup_settings, num_shard_members](DerechoSST& sst) mutable {
             sst_send_trigger(subgroup_num, subgroup_settings, num_shard_members, sst);
         };
-        receiver_pred_handles.emplace_back(sst->predicates.insert(sst_send_pred, sst_send_trig,
-                                                                  sst::PredicateType::RECURRENT));
+        sst_send_pred_handles.emplace(subgroup_num, sst->predicates.insert(sst_send_pred, sst_send_trig,
+                                                                           sst::PredicateType::RECURRENT,
+                                                                           "sst_send" + subgroup_suffix, {index_input}));
 
         if(subgroup_settings.mode != Mode::UNORDERED) {
-            auto delivery_pred = [](const DerechoSST& sst) {
+            //This predicate is "current min over seq_num is greater than the last message
+            //delivered (or, with a delivery worker, decided)". Messages become locally stable
+            //before this node's seq_num covers them, so the inputs change whenever there is
+            //something new to deliver
+            DeliveryWorker* worker = nullptr;
+            if(delivery_workers.count(subgroup_num)) {
+                worker = delivery_workers.at(subgroup_num).get();
+            }
+            auto delivery_pred = [=](const DerechoSST& sst) {
+                message_id_t last_delivered = worker ? worker->last_decided_seq_num
+                                                     : sst.delivered_num[member_index][subgroup_num];
+                for(uint32_t i = 0; i < num_shard_members; ++i) {
+                    if(sst.seq_num[node_id_to_sst_index.at(subgroup_settings.members[i])][subgroup_num] <= last_delivered) {
+                        return false;
+                    }
+                }
                 return true;
             };
             auto delivery_trig = [=](DerechoSST& sst) mutable {
                 delivery_trigger(subgroup_num, subgroup_settings, num_shard_members, sst);
             };
+            const sst::PredicateInput seq_num_input{
+                    static_cast<std::size_t>((char*)std::addressof(sst->seq_num[0][subgroup_num]) - sst->getBaseAddress()),
+                    sizeof(message_id_t)};
+            const sst::PredicateInput delivered_num_input{
+                    static_cast<std::size_t>((char*)std::addressof(sst->delivered_num[0][subgroup_num]) - sst->getBaseAddress()),
+                    sizeof(message_id_t)};
 
             delivery_pred_handles.emplace_back(sst->predicates.insert(delivery_pred, delivery_trig,
-                                                                      sst::PredicateType::RECURRENT));
-
-            //This predicate should be "current min over persisted_num is greater than the last
-            //observed minimum persisted_num," but computing the current min in the predicate is
-            //redundant with computing it in the trigger. To save time, we just make the predicate
-            //do nothing, and make the trigger both compute and update the minimum persisted_num
-            auto persistence_pred = [](const DerechoSST& sst) {
+                                                                      sst::PredicateType::RECURRENT,
+                                                                      "delivery" + subgroup_suffix,
+                                                                      {seq_num_input, delivered_num_input}));
+
+            //This predicate is "current min over persisted_num is greater than the last observed
+            //minimum persisted_num". It reads nothing but the members' persisted_num for this
+            //subgroup and state that only its trigger updates, so the SST evaluates it only when
+            //one of those entries has changed, and the trigger computes the min again
+            auto persistence_pred = [=](const DerechoSST& sst) {
+                for(uint32_t i = 0; i < num_shard_members; ++i) {
+                    if(sst.persisted_num[node_id_to_sst_index.at(subgroup_settings.members[i])][subgroup_num]
+                       <= minimum_persisted_version[subgroup_num]) {
+                        return false;
+                    }
+                }
                 return true;
             };
             auto persistence_trig = [=](DerechoSST& sst) mutable {
                 update_min_persisted_num(subgroup_num, subgroup_settings, num_shard_members, sst);
             };
+            const sst::PredicateInput persisted_num_input{
+                    static_cast<std::size_t>((char*)std::addressof(sst->persisted_num[0][subgroup_num]) - sst->getBaseAddress()),
+                    sizeof(persistent::version_t)};
 
-            persistence_pred_handles.emplace_back(sst->predicates.insert(persistence_pred, persistence_trig, sst::PredicateType::RECURRENT));
+            persistence_pred_handles.emplace_back(sst->predicates.insert(persistence_pred, persistence_trig, sst::PredicateType::RECURRENT,
+                                                                         "persistence" + subgroup_suffix, {persisted_num_input}));
 
             //In case there are persistent objects with signatures, add a similar predicate to check/update the minimum verified_num
-            auto verified_pred = [](const DerechoSST& sst) {
+            auto verified_pred = [=](const DerechoSST& sst) {
+                for(uint32_t i = 0; i < num_shard_members; ++i) {
+                    if(sst.verified_num[node_id_to_sst_index.at(subgroup_settings.members[i])][subgroup_num]
+                       <= minimum_verified_version[subgroup_num]) {
+                        return false;
+                    }
+                }
                 return true;
             };
             auto verified_trig = [=](DerechoSST& sst) {
                 update_min_verified_num(subgroup_num, subgroup_settings, num_shard_members, sst);
             };
+            const sst::PredicateInput verified_num_input{
+                    static_cast<std::size_t>((char*)std::addressof(sst->verified_num[0][subgroup_num]) - sst->getBaseAddress()),
+                    sizeof(persistent::version_t)};
 
-            persistence_pred_handles.emplace_back(sst->predicates.insert(verified_pred, verified_trig, sst::PredicateType::RECURRENT));
+            persistence_pred_handles.emplace_back(sst->predicates.insert(verified_pred, verified_trig, sst::PredicateType::RECURRENT,
+                                                                         "verified" + subgroup_suffix, {verified_num_input}));
 
             if(subgroup_settings.sender_rank >= 0) {
                 auto sender_pred = [=](const DerechoSST& sst) {
@@ -1036,11 +1405,12 @@ void MulticastGroup::register_predicates() {
                     return true;
                 };
                 auto sender_trig = [=](DerechoSST& sst) {
-                    sender_cv.notify_all();
                     next_message_to_deliver[subgroup_num]++;
+                    wake_sender_thread();
                 };
                 sender_pred_handles.emplace_back(sst->predicates.insert(sender_pred, sender_trig,
-                                                                        sst::PredicateType::RECURRENT));
+                                                                        sst::PredicateType::RECURRENT,
+                                                                        "sender" + subgroup_suffix, {delivered_num_input}));
             }
         } else {
             //This subgroup is in UNORDERED mode
@@ -1056,7 +1426,7 @@ void MulticastGroup::register_predicates() {
                     return true;
                 };
                 auto sender_trig = [this](DerechoSST& sst) {
-                    sender_cv.notify_all();
+                    wake_sender_thread();
                 };
                 sender_pred_handles.emplace_back(sst->predicates.insert(sender_pred, sender_trig,
                                                                         sst::PredicateType::RECURRENT));
@@ -1070,6 +1440,9 @@ MulticastGroup::~MulticastGroup() {
     if(timeout_thread.joinable()) {
         timeout_thread.join();
     }
+    for(const auto& p : rdmc_groups) {
+        rdmc::destroy_group(p.second.group_number);
+    }
 }
 
 void MulticastGroup::wedge() {
@@ -1077,6 +1450,7 @@ void MulticastGroup::wedge() {
     if(thread_shutdown_existing) {  // Wedge has already been called
         return;
     }
+    wedge_time = metrics::start_time();
 
     //Consume and remove all the predicate handles
     for(auto handle_iter = sender_pred_handles.begin(); handle_iter != sender_pred_handles.end();) {
@@ -1087,6 +1461,11 @@ void MulticastGroup::wedge() {
         sst->predicates.remove(*handle_iter);
         handle_iter = receiver_pred_handles.erase(handle_iter);
     }
+    for(auto& handle_pair : sst_send_pred_handles) {
+        // send() may be waking this predicate, so leave the map alone and reset the handle under its lock
+        std::lock_guard<std::recursive_mutex> lock(subgroup_locks[handle_pair.first].mtx);
+        sst->predicates.remove(handle_pair.second);
+    }
     for(auto handle_iter = delivery_pred_handles.begin(); handle_iter != delivery_pred_handles.end();) {
         sst->predicates.remove(*handle_iter);
         handle_iter = delivery_pred_handles.erase(handle_iter);
@@ -1095,17 +1474,23 @@ void MulticastGroup::wedge() {
         sst->predicates.remove(*handle_iter);
         handle_iter = persistence_pred_handles.erase(handle_iter);
     }
+    // no new messages can be decided now; finish delivering the ones that were
+    stop_delivery_workers();
 
-    for(uint i = 0; i < num_members; ++i) {
-        rdmc::destroy_group(i + rdmc_group_num_offset);
-    }
+    // The RDMC groups are left to the next view, which keeps those of the
+    // shards it does not change and destroys the others
 
-    sender_cv.notify_all();
+    wake_sender_thread();
     if(sender_thread.joinable()) {
         sender_thread.join();
     }
 }
 
+void MulticastGroup::release_kept_rdmc_groups() {
+    kept_rdmc_groups_released = true;
+    wake_sender_thread();
+}
+
 void MulticastGroup::send_loop() {
     pthread_setname_np(pthread_self(), "sender_thread");
     subgroup_id_t subgroup_to_send = 0;
@@ -1113,34 +1498,39 @@ void MulticastGroup::send_loop() {
         if(!rdmc_sst_groups_created) {
             return false;
         }
+        // Another member may not have taken over a kept group yet, and the
+        // messages of the previous view may still be sent from their buffers
+        if(!kept_rdmc_groups_released || stale_rdmc_sends[subgroup_num] > 0) {
+            return false;
+        }
         if(pending_sends[subgroup_num].empty()) {
             return false;
         }
         RDMCMessage& msg = pending_sends[subgroup_num].front();
-        const SubgroupSettings& subgroup_settings = subgroup_settings_map.at(subgroup_num);
+        const SubgroupSettings& subgroup_settings = *subgroup_settings_by_index[subgroup_num];
 
         int shard_sender_index = subgroup_settings.sender_rank;
-        std::vector<int> shard_senders = subgroup_settings.senders;
-        uint32_t num_shard_senders = get_num_senders(shard_senders);
+        uint32_t num_shard_senders = num_shard_senders_by_index[subgroup_num];
         assert(shard_sender_index >= 0);
 
-        if(sst->num_received[member_index][subgroup_settings.num_received_offset + shard_sender_index] < msg.index - 1) {
+        // Keep at most rdmc_pipeline_depth messages between rdmc::send and their local completion
+        if(sst->num_received[member_index][subgroup_settings.num_received_offset + shard_sender_index]
+           < msg.index - static_cast<int32_t>(rdmc_pipeline_depth)) {
             return false;
         }
 
-        std::vector<node_id_t> shard_members = subgroup_settings.members;
-        auto num_shard_members = shard_members.size();
-        assert(num_shard_members >= 1);
+        const std::vector<uint32_t>& shard_sst_indices = shard_sst_indices_by_index[subgroup_num];
+        assert(shard_sst_indices.size() >= 1);
         if(subgroup_settings.mode != Mode::UNORDERED) {
-            for(uint i = 0; i < num_shard_members; ++i) {
-                if(sst->delivered_num[node_id_to_sst_index.at(shard_members[i])][subgroup_num] < static_cast<message_id_t>((msg.index - subgroup_settings.profile.window_size) * num_shard_senders + shard_sender_index)) {
+            for(const uint32_t sst_index : shard_sst_indices) {
+                if(sst->delivered_num[sst_index][subgroup_num] < static_cast<message_id_t>((msg.index - subgroup_settings.profile.window_size) * num_shard_senders + shard_sender_index)) {
                     return false;
                 }
             }
         } else {
-            for(uint i = 0; i < num_shard_members; ++i) {
+            for(const uint32_t sst_index : shard_sst_indices) {
                 auto num_received_offset = subgroup_settings.num_received_offset;
-                if(sst->num_received[node_id_to_sst_index.at(shard_members[i])][num_received_offset + shard_sender_index]
+                if(sst->num_received[sst_index][num_received_offset + shard_sender_index]
                    < static_cast<int32_t>(future_message_indices[subgroup_num] - 1 - subgroup_settings.profile.window_size)) {
                     return false;
                 }
@@ -1149,41 +1539,76 @@ void MulticastGroup::send_loop() {
 
         return true;
     };
-    auto should_send = [&]() {
-        for(uint i = 1; i <= total_num_subgroups; ++i) {
+    // Each subgroup is checked and sent from with only its own lock held, so
+    // the sender thread never blocks senders and receivers in other subgroups
+    while(!thread_shutdown) {
+        const uint64_t wakeups_seen = sender_wakeups.load();
+        bool sent = false;
+        for(uint i = 1; i <= total_num_subgroups && !thread_shutdown; ++i) {
             auto subgroup_num = (subgroup_to_send + i) % total_num_subgroups;
-            if(should_send_to_subgroup(subgroup_num)) {
-                subgroup_to_send = subgroup_num;
-                return true;
+            std::unique_lock<std::recursive_mutex> lock(subgroup_locks[subgroup_num].mtx);
+            if(!should_send_to_subgroup(subgroup_num)) {
+                continue;
             }
-        }
-        return false;
-    };
-    auto should_wake = [&]() { return thread_shutdown || should_send(); };
-    std::unique_lock<std::recursive_mutex> lock(msg_state_mtx);
-    while(!thread_shutdown) {
-        sender_cv.wait(lock, should_wake);
-        if(!thread_shutdown) {
-            current_sends[subgroup_to_send] = std::move(pending_sends[subgroup_to_send].front());
+            subgroup_to_send = subgroup_num;
+            current_sends[subgroup_num].push_back(std::move(pending_sends[subgroup_num].front()));
+            pending_sends[subgroup_num].pop();
+            RDMCMessage& msg = current_sends[subgroup_num].back();
             dbg_default_trace("Calling send in subgroup {} on message {} from sender {}",
-                              subgroup_to_send, current_sends[subgroup_to_send]->index, current_sends[subgroup_to_send]->sender_id);
+                              subgroup_num, msg.index, msg.sender_id);
+            // A message sent again after a view change still has the header it was first sent with
+            header* h = (header*)msg.message_buffer.buffer.get();
+            h->index = msg.index;
+            h->generation = 0;
             // make sure there are > 1 members before issuing RDMC send
-            if(subgroup_settings_map.at(subgroup_to_send).members.size() > 1) {
-                if(!rdmc::send(subgroup_to_rdmc_group.at(subgroup_to_send),
-                               current_sends[subgroup_to_send]->message_buffer.mr, 0,
-                               current_sends[subgroup_to_send]->size)) {
+            if(subgroup_settings_by_index[subgroup_num]->members.size() > 1) {
+                const RDMCGroup& rdmc_group = rdmc_groups.at({subgroup_num, members[member_index]});
+                const uint16_t group_number = rdmc_group.group_number;
+                h->generation = rdmc_group.generation;
+                // RDMC runs the completion handler of an earlier message, which
+                // takes the subgroup lock, while holding its own group lock, so
+                // the lock must be released before calling into RDMC
+                std::shared_ptr<rdma::memory_region> message_mr = msg.message_buffer.mr;
+                const auto message_size = msg.size;
+                std::vector<rdmc::segment> segments;
+                if(!msg.segments.empty()) {
+                    // The header from the message buffer, then the application's segments
+                    segments.reserve(msg.segments.size() + 1);
+                    segments.push_back({msg.message_buffer.buffer.get(), msg.buffer_size});
+                    segments.insert(segments.end(), msg.segments.begin(), msg.segments.end());
+                }
+                lock.unlock();
+                const bool queued = segments.empty()
+                                            ? rdmc::send(group_number, message_mr, 0, message_size)
+                                            : rdmc::send(group_number, segments);
+                if(!queued) {
                     throw std::runtime_error("rdmc::send returned false");
                 }
             } else {
                 // receive the message right here
-                singleton_shard_receive_handlers.at(subgroup_to_send)(
-                        current_sends[subgroup_to_send]->message_buffer.buffer.get(), current_sends[subgroup_to_send]->size);
+                singleton_shard_receive_handlers.at(subgroup_num)(
+                        msg.message_buffer.buffer.get(), msg.size);
             }
-            pending_sends[subgroup_to_send].pop();
+            sent = true;
+            break;
+        }
+        if(!sent) {
+            // Nothing could be sent; sleep until some subgroup's state changes
+            std::unique_lock<std::mutex> lock(sender_mtx);
+            sender_cv.wait(lock, [&]() { return thread_shutdown || sender_wakeups.load() != wakeups_seen; });
         }
     }
 }
 
+void MulticastGroup::wake_sender_thread() {
+    sender_wakeups++;
+    // The sender thread checks sender_wakeups with sender_mtx held, so passing
+    // through the lock ensures it either sees the increment or is already
+    // waiting for the notification
+    { std::lock_guard<std::mutex> lock(sender_mtx); }
+    sender_cv.notify_all();
+}
+
 const uint64_t MulticastGroup::compute_global_stability_frontier(uint32_t subgroup_num) {
     uint64_t global_stability_frontier = sst->local_stability_frontier[member_index][subgroup_num];
     auto shard_sst_indices = get_shard_sst_indices(subgroup_num);
@@ -1200,28 +1625,33 @@ void MulticastGroup::check_failures_loop() {
         std::this_thread::sleep_for(std::chrono::milliseconds(sender_timeout));
         if(sst) {
             {
-                std::unique_lock<std::recursive_mutex> lock(msg_state_mtx);
                 auto current_time = get_walltime();
-                for(auto p : subgroup_settings_map) {
+                for(const auto& p : subgroup_settings_map) {
                     auto subgroup_num = p.first;
-                    auto members = p.second.members;
-                    auto sst_indices = get_shard_sst_indices(subgroup_num);
+                    std::lock_guard<std::recursive_mutex> lock(subgroup_locks[subgroup_num].mtx);
+                    const std::vector<uint32_t>& sst_indices = shard_sst_indices_by_index[subgroup_num];
                     // clean up timestamps of persisted messages
                     auto min_persisted_num = sst->persisted_num[member_index][subgroup_num];
                     for(auto i : sst_indices) {
                         persistent::version_t persisted_num_copy = sst->persisted_num[i][subgroup_num];
                         min_persisted_num = std::min(min_persisted_num, persisted_num_copy);
                     }
-                    while(!pending_persistence[subgroup_num].empty() && pending_persistence[subgroup_num].begin()->first <= min_persisted_num) {
-                        auto timestamp = pending_persistence[subgroup_num].begin()->second;
-                        pending_persistence[subgroup_num].erase(pending_persistence[subgroup_num].begin());
-                        pending_message_timestamps[subgroup_num].erase(timestamp);
+                    // this node's message with index i has sequence number i * num_senders + sender_rank
+                    const SubgroupSettings& subgroup_settings = p.second;
+                    if(subgroup_settings.mode != Mode::UNORDERED && subgroup_settings.sender_rank >= 0) {
+                        const message_id_t num_shard_senders = num_shard_senders_by_index[subgroup_num];
+                        while(!pending_message_timestamps[subgroup_num].empty()
+                              && pending_message_timestamps[subgroup_num].front_key() * num_shard_senders
+                                                 + subgroup_settings.sender_rank
+                                         <= min_persisted_num) {
+                            pending_message_timestamps[subgroup_num].pop_front();
+                        }
                     }
                     if(pending_message_timestamps[subgroup_num].empty()) {
                         sst->local_stability_frontier[member_index][subgroup_num] = current_time;
                     } else {
                         sst->local_stability_frontier[member_index][subgroup_num] = std::min(current_time,
-                                                                                             *pending_message_timestamps[subgroup_num].begin());
+                                                                                             pending_message_timestamps[subgroup_num].front());
                     }
                 }
             }
@@ -1231,7 +1661,7 @@ void MulticastGroup::check_failures_loop() {
     }
 }
 
-// we already hold the lock on msg_state_mtx when we call this
+// we already hold the subgroup's lock when we call this
 void MulticastGroup::get_buffer_and_send_auto_null(subgroup_id_t subgroup_num) {
     // short-circuits most of the normal checks because
     // we know that we received a message and are sending a null
@@ -1249,7 +1679,7 @@ void MulticastGroup::get_buffer_and_send_auto_null(subgroup_id_t subgroup_num) {
         free_message_buffers[subgroup_num].pop_back();
 
         auto current_time = get_walltime();
-        pending_message_timestamps[subgroup_num].insert(current_time);
+        pending_message_timestamps[subgroup_num].emplace(future_message_indices[subgroup_num], current_time);
 
         // Fill header
         char* buf = msg.message_buffer.buffer.get();
@@ -1260,14 +1690,14 @@ void MulticastGroup::get_buffer_and_send_auto_null(subgroup_id_t subgroup_num) {
 
         future_message_indices[subgroup_num]++;
         pending_sends[subgroup_num].push(std::move(msg));
-        sender_cv.notify_all();
+        wake_sender_thread();
     } else {
         char* buf = (char*)sst_multicast_group_ptrs[subgroup_num]->get_buffer(msg_size);
 
         assert(buf);
 
         auto current_time = get_walltime();
-        pending_message_timestamps[subgroup_num].insert(current_time);
+        pending_message_timestamps[subgroup_num].emplace(future_message_indices[subgroup_num], current_time);
 
         ((header*)buf)->header_size = sizeof(header);
         ((header*)buf)->index = future_message_indices[subgroup_num];
@@ -1277,6 +1707,7 @@ void MulticastGroup::get_buffer_and_send_auto_null(subgroup_id_t subgroup_num) {
 
         future_message_indices[subgroup_num]++;
         committed_sst_index[subgroup_num]++;
+        sst->predicates.wake(sst_send_pred_handles.at(subgroup_num));
 
         if(first_null_index[subgroup_num] < 0) {
             first_null_index[subgroup_num] = committed_sst_index[subgroup_num];
@@ -1289,33 +1720,35 @@ char* MulticastGroup::get_sendbuffer_ptr(subgroup_id_t subgroup_num,
                                          long long unsigned int payload_size,
                                          bool cooked_send) {
     long long unsigned int msg_size = payload_size + sizeof(header);
-    const SubgroupSettings& subgroup_settings = subgroup_settings_map.at(subgroup_num);
+    const SubgroupSettings* subgroup_settings_ptr = subgroup_settings_by_index.at(subgroup_num);
+    if(subgroup_settings_ptr == nullptr) {
+        throw derecho_exception("Can't send messages in subgroup " + std::to_string(subgroup_num)
+                                + " because this node is not a member of it");
+    }
+    const SubgroupSettings& subgroup_settings = *subgroup_settings_ptr;
     if(msg_size > subgroup_settings.profile.max_msg_size) {
         std::string exp_msg("Can't send messages of size larger than the maximum message size which is equal to ");
         exp_msg += std::to_string(subgroup_settings.profile.max_msg_size);
         throw derecho_exception(exp_msg);
     }
 
-    std::vector<node_id_t> shard_members = subgroup_settings.members;
-    auto num_shard_members = shard_members.size();
     // if the current node is not a sender, shard_sender_index will be -1
-    uint32_t num_shard_senders;
-    std::vector<int> shard_senders = subgroup_settings.senders;
+    const uint32_t num_shard_senders = num_shard_senders_by_index[subgroup_num];
     int shard_sender_index = subgroup_settings.sender_rank;
-    num_shard_senders = get_num_senders(shard_senders);
     assert(shard_sender_index >= 0);
 
+    const std::vector<uint32_t>& shard_sst_indices = shard_sst_indices_by_index[subgroup_num];
     if(subgroup_settings.mode != Mode::UNORDERED) {
-        for(uint i = 0; i < num_shard_members; ++i) {
-            if(sst->delivered_num[node_id_to_sst_index.at(shard_members[i])][subgroup_num]
+        for(const uint32_t sst_index : shard_sst_indices) {
+            if(sst->delivered_num[sst_index][subgroup_num]
                < static_cast<int32_t>((future_message_indices[subgroup_num] - subgroup_settings.profile.window_size) * num_shard_senders + shard_sender_index)) {
                 return nullptr;
             }
         }
     } else {
-        for(uint i = 0; i < num_shard_members; ++i) {
+        for(const uint32_t sst_index : shard_sst_indices) {
             auto num_received_offset = subgroup_settings.num_received_offset;
-            if(sst->num_received[node_id_to_sst_index.at(shard_members[i])][num_received_offset + shard_sender_index]
+            if(sst->num_received[sst_index][num_received_offset + shard_sender_index]
                < static_cast<int32_t>(future_message_indices[subgroup_num] - subgroup_settings.profile.window_size)) {
                 return nullptr;
             }
@@ -1344,7 +1777,7 @@ char* MulticastGroup::get_sendbuffer_ptr(subgroup_id_t subgroup_num,
         free_message_buffers[subgroup_num].pop_back();
 
         auto current_time = get_walltime();
-        pending_message_timestamps[subgroup_num].insert(current_time);
+        pending_message_timestamps[subgroup_num].emplace(future_message_indices[subgroup_num], current_time);
 
         // Fill header
         char* buf = msg.message_buffer.buffer.get();
@@ -1374,7 +1807,7 @@ char* MulticastGroup::get_sendbuffer_ptr(subgroup_id_t subgroup_num,
             return nullptr;
         }
         auto current_time = get_walltime();
-        pending_message_timestamps[subgroup_num].insert(current_time);
+        pending_message_timestamps[subgroup_num].emplace(future_message_indices[subgroup_num], current_time);
 
         ((header*)buf)->header_size = sizeof(header);
         ((header*)buf)->index = future_message_indices[subgroup_num];
@@ -1395,7 +1828,8 @@ bool MulticastGroup::send(subgroup_id_t subgroup_num, long long unsigned int pay
     if(!rdmc_sst_groups_created) {
         return false;
     }
-    std::unique_lock<std::recursive_mutex> lock(msg_state_mtx);
+    const uint64_t wait_start_time = metrics::start_time();
+    std::unique_lock<std::recursive_mutex> lock(subgroup_locks.at(subgroup_num).mtx);
     char* buf = get_sendbuffer_ptr(subgroup_num, payload_size, cooked_send);
     while(!buf) {
         // Don't want any deadlocks. For example, this thread cannot get a buffer because delivery is lagging
@@ -1409,6 +1843,9 @@ bool MulticastGroup::send(subgroup_id_t subgroup_num, long long unsigned int pay
         lock.lock();
         buf = get_sendbuffer_ptr(subgroup_num, payload_size, cooked_send);
     }
+    metrics::record_since(metrics::Metric::SEND_BUFFER_WAIT_NS, subgroup_num, wait_start_time);
+    metrics::record(last_transfer_medium[subgroup_num] ? metrics::Metric::RDMC_SEND_BYTES : metrics::Metric::SST_SEND_BYTES,
+                    subgroup_num, payload_size);
     // call to the user supplied message generator
     msg_generator(buf);
 
@@ -1416,17 +1853,51 @@ bool MulticastGroup::send(subgroup_id_t subgroup_num, long long unsigned int pay
         assert(next_sends[subgroup_num]);
         pending_sends[subgroup_num].push(std::move(*next_sends[subgroup_num]));
         next_sends[subgroup_num] = std::nullopt;
-        sender_cv.notify_all();
+        wake_sender_thread();
         return true;
     } else {
         committed_sst_index[subgroup_num]++;
+        sst->predicates.wake(sst_send_pred_handles.at(subgroup_num));
         pending_sst_sends[subgroup_num] = false;
         return true;
     }
 }
 
+bool MulticastGroup::send_segments(subgroup_id_t subgroup_num, long long unsigned int header_payload_size,
+                                   const std::function<void(char* buf)>& header_generator,
+                                   const std::vector<rdmc::segment>& segments,
+                                   const std::function<void()>& release, bool cooked_send) {
+    // The message keeps the pin if it goes through RDMC; otherwise dropping it calls release
+    auto pin = std::make_unique<SegmentPin>(SegmentPin{release});
+    long long unsigned int segments_size = 0;
+    for(const rdmc::segment& segment : segments) {
+        segments_size += segment.length;
+    }
+    const bool sent = send(subgroup_num, header_payload_size + segments_size, [&](char* buf) {
+        header_generator(buf);
+        if(last_transfer_medium[subgroup_num]) {
+            RDMCMessage& msg = *next_sends[subgroup_num];
+            msg.buffer_size = sizeof(header) + header_payload_size;
+            msg.segments = segments;
+            msg.segments_pin = std::move(pin);
+        } else {
+            // An SST message is small, so copy the segments into its slot
+            char* dest = buf + header_payload_size;
+            for(const rdmc::segment& segment : segments) {
+                memcpy(dest, segment.buffer, segment.length);
+                dest += segment.length;
+            }
+        }
+    }, cooked_send);
+    if(!sent) {
+        // Nothing was sent, so the segments are still the caller's
+        pin->release = nullptr;
+    }
+    return sent;
+}
+
 bool MulticastGroup::check_pending_sst_sends(subgroup_id_t subgroup_num) {
-    std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
+    std::lock_guard<std::recursive_mutex> lock(subgroup_locks[subgroup_num].mtx);
     return pending_sst_sends[subgroup_num];
 }
 
@@ -1469,8 +1940,15 @@ void MulticastGroup::debug_print() {
     }
 
     std::cout << "Printing memory usage of free_message_buffers" << std::endl;
-    for(const auto& p : free_message_buffers) {
-        std::cout << "Subgroup " << p.first << ", Number of free buffers " << p.second.size() << std::endl;
+    for(const auto& p : subgroup_settings_map) {
+        std::cout << "Subgroup " << p.first << ", Number of free buffers " << free_message_buffers[p.first].size() << std::endl;
+    }
+
+    std::cout << "Printing predicate statistics (name, evaluations, skipped, fired, evaluation ns, trigger ns)" << std::endl;
+    for(const sst::PredicateStats& stats : sst->predicates.get_stats()) {
+        std::cout << (stats.name.empty() ? "<unnamed>" : stats.name) << " " << stats.num_evaluations << " "
+                  << stats.num_skipped << " " << stats.num_fired << " "
+                  << stats.evaluation_ns << " " << stats.trigger_ns << std::endl;
     }
 }
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <sstream>
@@ -12,8 +13,11 @@ namespace sst {
 P2PConnectionManager::P2PConnectionManager(const P2PParams params)
         : my_node_id(params.my_node_id),
           p2p_connections(derecho::getConfUInt32(CONF_DERECHO_MAX_NODE_ID)),
-          active_p2p_connections(new char[derecho::getConfUInt32(CONF_DERECHO_MAX_NODE_ID)]),
-          failure_upcall(params.failure_upcall) {
+          active_nodes(std::make_shared<const std::vector<node_id_t>>()),
+          probe_cursor(0),
+          failure_upcall(params.failure_upcall),
+          doorbell_rung(false),
+          idle_wait(min_idle_wait) {
     // HARD-CODED. Adding another request type will break this
 
     request_params.window_sizes[P2P_REPLY] = params.p2p_window_size;
@@ -23,10 +27,6 @@ P2PConnectionManager::P2PConnectionManager(const P2PParams params)
     request_params.max_msg_sizes[P2P_REQUEST] = params.max_p2p_request_size;
     request_params.max_msg_sizes[RPC_REPLY] = params.max_rpc_reply_size;
 
-    for(uint32_t i = 0; i < derecho::getConfUInt32(CONF_DERECHO_MAX_NODE_ID); ++i) {
-        active_p2p_connections[i] = false;
-    }
-
     p2p_buf_size = 0;
     for(uint8_t i = 0; i < num_request_types; ++i) {
         request_params.offsets[i] = p2p_buf_size;
@@ -35,7 +35,10 @@ P2PConnectionManager::P2PConnectionManager(const P2PParams params)
     p2p_buf_size += sizeof(bool);
 
     p2p_connections[my_node_id].second = std::make_unique<P2PConnection>(my_node_id, my_node_id, p2p_buf_size, request_params);
-    active_p2p_connections[my_node_id] = true;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        publish_active_nodes({my_node_id});
+    }
 
     // external client doesn't need failure checking
     if(!params.is_external) {
@@ -45,26 +48,40 @@ P2PConnectionManager::P2PConnectionManager(const P2PParams params)
 
 P2PConnectionManager::~P2PConnectionManager() {
     shutdown_failures_thread();
-    //plain C array must be deleted
-    delete[] active_p2p_connections;
+}
+
+void P2PConnectionManager::publish_active_nodes(std::vector<node_id_t>&& node_ids) {
+    std::sort(node_ids.begin(), node_ids.end());
+    node_ids.erase(std::unique(node_ids.begin(), node_ids.end()), node_ids.end());
+    std::atomic_store(&active_nodes, std::shared_ptr<const std::vector<node_id_t>>(
+                                             std::make_shared<std::vector<node_id_t>>(std::move(node_ids))));
 }
 
 void P2PConnectionManager::add_connections(const std::vector<node_id_t>& node_ids) {
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    std::vector<node_id_t> new_active_nodes(*std::atomic_load(&active_nodes));
     for(const node_id_t remote_id : node_ids) {
         std::lock_guard<std::mutex> connection_lock(p2p_connections[remote_id].first);
         if(!p2p_connections[remote_id].second) {
             p2p_connections[remote_id].second = std::make_unique<P2PConnection>(my_node_id, remote_id, p2p_buf_size, request_params);
-            active_p2p_connections[remote_id] = true;
+            new_active_nodes.push_back(remote_id);
         }
     }
+    publish_active_nodes(std::move(new_active_nodes));
+    ring_doorbell();
 }
 
 void P2PConnectionManager::remove_connections(const std::vector<node_id_t>& node_ids) {
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    std::vector<node_id_t> new_active_nodes(*std::atomic_load(&active_nodes));
     for(const node_id_t remote_id : node_ids) {
         std::lock_guard<std::mutex> connection_lock(p2p_connections[remote_id].first);
         p2p_connections[remote_id].second = nullptr;
-        active_p2p_connections[remote_id] = false;
+        new_active_nodes.erase(std::remove(new_active_nodes.begin(), new_active_nodes.end(), remote_id),
+                               new_active_nodes.end());
     }
+    publish_active_nodes(std::move(new_active_nodes));
+    ring_doorbell();
 }
 
 bool P2PConnectionManager::contains_node(const node_id_t node_id) {
@@ -94,12 +111,14 @@ void P2PConnectionManager::update_incoming_seq_num(node_id_t node_id) {
 
 // check if there's a new request from any node
 std::optional<std::pair<node_id_t, char*>> P2PConnectionManager::probe_all() {
-    for(node_id_t node_id = 0; node_id < p2p_connections.size(); ++node_id) {
-        //Check the hint before locking the mutex. If it's false, don't bother.
-        if(!active_p2p_connections[node_id]) continue;
+    const auto nodes = std::atomic_load(&active_nodes);
+    const std::size_t num_nodes = nodes->size();
+    for(std::size_t i = 0; i < num_nodes; ++i) {
+        const std::size_t pos = (probe_cursor + i) % num_nodes;
+        const node_id_t node_id = (*nodes)[pos];
 
         std::lock_guard<std::mutex> connection_lock(p2p_connections[node_id].first);
-        //In case the hint was wrong, check for an empty connection
+        //The snapshot may be stale, so check for an empty connection
         if(!p2p_connections[node_id].second) continue;
 
         auto buf = p2p_connections[node_id].second->probe();
@@ -107,18 +126,39 @@ std::optional<std::pair<node_id_t, char*>> P2PConnectionManager::probe_all() {
         // Please note that populate_header() put payload_size(size_t) at the beginning of buffer.
         // If we only test buf[0], it will fall in the wrong path if the least significant byte of the payload size is
         // zero.
+        if(buf) {
+            idle_wait = min_idle_wait;
+        }
         if(buf && reinterpret_cast<size_t*>(buf)[0]) {
+            probe_cursor = pos + 1;
             return std::pair<node_id_t, char*>(node_id, buf);
         } else if(buf) {
             // this means that we have a null reply
             // we don't need to process it, but we still want to increment the seq num
             p2p_connections[node_id].second->update_incoming_seq_num();
+            probe_cursor = pos + 1;
             return std::pair<node_id_t, char*>(INVALID_NODE_ID, nullptr);
         }
     }
     return {};
 }
 
+void P2PConnectionManager::ring_doorbell() {
+    {
+        std::lock_guard<std::mutex> lock(doorbell_mutex);
+        doorbell_rung = true;
+    }
+    doorbell_cv.notify_one();
+}
+
+bool P2PConnectionManager::wait_for_work() {
+    std::unique_lock<std::mutex> lock(doorbell_mutex);
+    bool rung = doorbell_cv.wait_for(lock, idle_wait, [this]() { return doorbell_rung; });
+    doorbell_rung = false;
+    idle_wait = std::min(idle_wait * 2, max_idle_wait);
+    return rung;
+}
+
 char* P2PConnectionManager::get_sendbuffer_ptr(node_id_t node_id, REQUEST_TYPE type) {
     std::lock_guard<std::mutex> connection_lock(p2p_connections[node_id].first);
     if(p2p_connections[node_id].second) {
@@ -129,10 +169,16 @@ char* P2PConnectionManager::get_sendbuffer_ptr(node_id_t node_id, REQUEST_TYPE t
 }
 
 void P2PConnectionManager::send(node_id_t node_id) {
-    std::lock_guard<std::mutex> connection_lock(p2p_connections[node_id].first);
-    p2p_connections[node_id].second->send();
-    if(node_id != my_node_id && p2p_connections[node_id].second) {
-        p2p_connections[node_id].second->num_rdma_writes++;
+    {
+        std::lock_guard<std::mutex> connection_lock(p2p_connections[node_id].first);
+        p2p_connections[node_id].second->send();
+        if(node_id != my_node_id && p2p_connections[node_id].second) {
+            p2p_connections[node_id].second->num_rdma_writes++;
+        }
+    }
+    // a message to this node was just copied into the local buffer
+    if(node_id == my_node_id) {
+        ring_doorbell();
     }
 }
 
@@ -141,9 +187,8 @@ void P2PConnectionManager::check_failures_loop() {
 
     // using CONF_DERECHO_HEARTBEAT_MS from derecho.cfg
     uint32_t heartbeat_ms = derecho::getConfUInt32(CONF_DERECHO_HEARTBEAT_MS);
-    const auto tid = std::this_thread::get_id();
     // get id first
-    uint32_t ce_idx = util::polling_data.get_index(tid);
+    uint32_t ce_idx = util::polling_data.get_index();
 
     uint16_t tick_count = 0;
     const uint16_t one_second_count = 1000 / heartbeat_ms;
@@ -152,16 +197,15 @@ void P2PConnectionManager::check_failures_loop() {
         tick_count++;
         std::unordered_set<node_id_t> posted_write_to;
 
-        util::polling_data.set_waiting(tid);
+        util::polling_data.set_waiting();
 #ifdef USE_VERBS_API
         std::map<uint32_t, verbs_sender_ctxt> sctxt;
 #else
         std::map<uint32_t, lf_sender_ctxt> sctxt;
 #endif
 
-        for(node_id_t node_id = 0; node_id < p2p_connections.size(); ++node_id) {
-            if(!active_p2p_connections[node_id]) continue;
-
+        const auto nodes = std::atomic_load(&active_nodes);
+        for(const node_id_t node_id : *nodes) {
             std::lock_guard<std::mutex> connection_lock(p2p_connections[node_id].first);
 
             if(!p2p_connections[node_id].second) continue;
@@ -189,28 +233,13 @@ void P2PConnectionManager::check_failures_loop() {
 
         /** Completion Queue poll timeout in millisec */
         const unsigned int MAX_POLL_CQ_TIMEOUT = derecho::getConfUInt32(CONF_DERECHO_SST_POLL_CQ_TIMEOUT_MS);
-        unsigned long start_time_msec;
-        unsigned long cur_time_msec;
-        struct timeval cur_time;
-
         // wait for completion for a while before giving up of doing it ..
-        gettimeofday(&cur_time, NULL);
-        start_time_msec = (cur_time.tv_sec * 1000) + (cur_time.tv_usec / 1000);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(MAX_POLL_CQ_TIMEOUT);
 
         for(unsigned int i = 0; i < posted_write_to.size(); i++) {
-            std::optional<std::pair<int32_t, int32_t>> ce;
-            while(true) {
-                // check if polling result is available
-                ce = util::polling_data.get_completion_entry(tid);
-                if(ce) {
-                    break;
-                }
-                gettimeofday(&cur_time, NULL);
-                cur_time_msec = (cur_time.tv_sec * 1000) + (cur_time.tv_usec / 1000);
-                if((cur_time_msec - start_time_msec) >= MAX_POLL_CQ_TIMEOUT) {
-                    tick_count += MAX_POLL_CQ_TIMEOUT;
-                    break;
-                }
+            std::optional<std::pair<int32_t, int32_t>> ce = util::polling_data.wait_for_completion_entry(deadline);
+            if(!ce) {
+                tick_count += MAX_POLL_CQ_TIMEOUT;
             }
             // if waiting for a completion entry timed out
             if(!ce) {
@@ -233,7 +262,7 @@ void P2PConnectionManager::check_failures_loop() {
                 failed_node_indexes.push_back(remote_id);
             }
         }
-        util::polling_data.reset_waiting(tid);
+        util::polling_data.reset_waiting();
 
         for(auto nid : failed_node_indexes) {
             dbg_default_debug("p2p_connection_manager detected failure/timeout on node {}", nid);
@@ -251,17 +280,8 @@ void P2PConnectionManager::check_failures_loop() {
 }
 
 void P2PConnectionManager::filter_to(const std::vector<node_id_t>& live_nodes_list) {
-    std::vector<node_id_t> prev_nodes_list;
-    for(node_id_t node_id = 0; node_id < p2p_connections.size(); ++node_id) {
-        //Check the hint before acquiring the lock
-        if(!active_p2p_connections[node_id]) continue;
-
-        std::lock_guard<std::mutex> connection_lock(p2p_connections[node_id].first);
-        //Check again to ensure the connection is non-null
-        if(p2p_connections[node_id].second) {
-            prev_nodes_list.push_back(node_id);
-        }
-    }
+    // active_nodes is sorted, as set_difference requires
+    std::vector<node_id_t> prev_nodes_list(*std::atomic_load(&active_nodes));
 
     std::vector<node_id_t> departed;
     std::set_difference(prev_nodes_list.begin(), prev_nodes_list.end(),
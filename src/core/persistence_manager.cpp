@@ -3,10 +3,14 @@
  *
  * @date Jun 20, 2017
  */
+#include <derecho/conf/conf.hpp>
 #include <derecho/core/detail/persistence_manager.hpp>
 #include <derecho/core/detail/view_manager.hpp>
 #include <derecho/openssl/signature.hpp>
 
+#include <algorithm>
+#include <set>
+
 namespace derecho {
 
 PersistenceManager::PersistenceManager(
@@ -14,6 +18,7 @@ PersistenceManager::PersistenceManager(
         bool any_signed_objects,
         const persistence_callback_t& user_persistence_callback)
         : thread_shutdown(false),
+          group_commit(getConfBoolean(CONF_PERS_GROUP_COMMIT)),
           signature_size(0),
           persistence_callbacks{user_persistence_callback},
           objects_by_subgroup_id(objects_map) {
@@ -65,14 +70,28 @@ void PersistenceManager::start() {
                 continue;
             }
 
-            ThreadRequest request = persistence_request_queue.front();
-            persistence_request_queue.pop();
-            prq_lock.clear(std::memory_order_release);  // release lock
+            if(group_commit.load(std::memory_order_relaxed)) {
+                // take every pending request, then consume the semaphore posts
+                // that belong to the extra ones so they don't cause empty wakeups
+                std::queue<ThreadRequest> requests;
+                requests.swap(persistence_request_queue);
+                prq_lock.clear(std::memory_order_release);  // release lock
+                for(std::size_t i = 1; i < requests.size(); i++) {
+                    if(sem_trywait(&persistence_request_sem) != 0) {
+                        break;
+                    }
+                }
+                handle_request_batch(requests);
+            } else {
+                ThreadRequest request = persistence_request_queue.front();
+                persistence_request_queue.pop();
+                prq_lock.clear(std::memory_order_release);  // release lock
 
-            if(request.operation == RequestType::PERSIST) {
-                handle_persist_request(request.subgroup_id, request.version);
-            } else if(request.operation == RequestType::VERIFY) {
-                handle_verify_request(request.subgroup_id, request.version);
+                if(request.operation == RequestType::PERSIST) {
+                    handle_persist_request(request.subgroup_id, request.version, request.post_time);
+                } else if(request.operation == RequestType::VERIFY) {
+                    handle_verify_request(request.subgroup_id, request.version, request.post_time);
+                }
             }
             if(this->thread_shutdown) {
                 while(prq_lock.test_and_set(std::memory_order_acquire))  // acquire lock
@@ -84,10 +103,75 @@ void PersistenceManager::start() {
                 prq_lock.clear(std::memory_order_release);  // release lock
             }
         } while(true);
+        stop_flush_workers();
     }};
 }
 
-void PersistenceManager::handle_persist_request(subgroup_id_t subgroup_id, persistent::version_t version) {
+void PersistenceManager::set_group_commit(bool enable) {
+    group_commit = enable;
+}
+
+void PersistenceManager::run_flush_jobs(std::unique_lock<std::mutex>& lock) {
+    while(flush_jobs && next_flush_job < flush_jobs->size()) {
+        FlushJob& job = (*flush_jobs)[next_flush_job++];
+        lock.unlock();
+        try {
+            job.persisted_version = persist_subgroup(job.subgroup_id, job.requested_version,
+                                                     job.signature.data(), job.object_has_signature);
+            job.persisted = true;
+        } catch(uint64_t exp) {
+            dbg_default_debug("exception on persist():subgroup={},ver={},exp={}.", job.subgroup_id, job.requested_version, exp);
+            std::cout << "exception on persistent:subgroup=" << job.subgroup_id << ",ver=" << job.requested_version << "exception=0x" << std::hex << exp << std::endl;
+        }
+        lock.lock();
+        if(--flush_jobs_remaining == 0) {
+            flush_done_cv.notify_all();
+        }
+    }
+}
+
+void PersistenceManager::flush_worker_loop() {
+    pthread_setname_np(pthread_self(), "persist_flush");
+    std::unique_lock<std::mutex> lock(flush_mutex);
+    while(true) {
+        flush_cv.wait(lock, [this]() {
+            return flush_shutdown || (flush_jobs && next_flush_job < flush_jobs->size());
+        });
+        if(flush_shutdown) {
+            return;
+        }
+        run_flush_jobs(lock);
+    }
+}
+
+void PersistenceManager::stop_flush_workers() {
+    {
+        std::lock_guard<std::mutex> lock(flush_mutex);
+        flush_shutdown = true;
+    }
+    flush_cv.notify_all();
+    for(auto& worker : flush_workers) {
+        worker.join();
+    }
+    flush_workers.clear();
+}
+
+persistent::version_t PersistenceManager::persist_subgroup(subgroup_id_t subgroup_id,
+                                                           persistent::version_t version,
+                                                           unsigned char* signature,
+                                                           bool& object_has_signature) {
+    object_has_signature = false;
+    auto search = objects_by_subgroup_id.find(subgroup_id);
+    if(search == objects_by_subgroup_id.end()) {
+        return version;
+    }
+    object_has_signature = search->second->is_signed();
+    //The version actually persisted might be greater than the requested version
+    return search->second->persist(version, signature);
+}
+
+void PersistenceManager::handle_persist_request(subgroup_id_t subgroup_id, persistent::version_t version,
+                                                uint64_t post_time) {
     //If a previous request already persisted a later version (due to batching), don't do anything
     if(last_persisted_version[subgroup_id] >= version) {
         return;
@@ -101,12 +185,7 @@ void PersistenceManager::handle_persist_request(subgroup_id_t subgroup_id, persi
         unsigned char signature[signature_size];
 
         bool object_has_signature = false;
-        auto search = objects_by_subgroup_id.find(subgroup_id);
-        if(search != objects_by_subgroup_id.end()) {
-            object_has_signature = search->second->is_signed();
-            //Update persisted_version to the version actually persisted, which might be greater than the requested version
-            persisted_version = search->second->persist(version, signature);
-        }
+        persisted_version = persist_subgroup(subgroup_id, version, signature, object_has_signature);
         // Call the local persistence callbacks before updating the SST
         // (as soon as the SST is updated, the global persistence callback may fire)
         for(auto& persistence_callback : persistence_callbacks) {
@@ -130,13 +209,135 @@ void PersistenceManager::handle_persist_request(subgroup_id_t subgroup_id, persi
                        Vc.gmsSST->persisted_num,
                        subgroup_id);
         last_persisted_version[subgroup_id] = persisted_version;
+        metrics::record_since(metrics::Metric::DELIVER_TO_PERSIST_NS, subgroup_id, post_time);
     } catch(uint64_t exp) {
         dbg_default_debug("exception on persist():subgroup={},ver={},exp={}.", subgroup_id, version, exp);
         std::cout << "exception on persistent:subgroup=" << subgroup_id << ",ver=" << version << "exception=0x" << std::hex << exp << std::endl;
     }
 }
 
-void PersistenceManager::handle_verify_request(subgroup_id_t subgroup_id, persistent::version_t version) {
+void PersistenceManager::handle_request_batch(std::queue<ThreadRequest>& requests) {
+    // keep only the highest requested version per subgroup
+    std::map<subgroup_id_t, persistent::version_t> persist_versions;
+    std::map<subgroup_id_t, persistent::version_t> verify_versions;
+    // the post time of the earliest of the merged requests, for the metrics
+    std::map<std::pair<RequestType, subgroup_id_t>, uint64_t> post_times;
+    while(!requests.empty()) {
+        const ThreadRequest& request = requests.front();
+        auto& versions = (request.operation == RequestType::PERSIST) ? persist_versions : verify_versions;
+        auto existing = versions.find(request.subgroup_id);
+        if(existing == versions.end()) {
+            versions.emplace(request.subgroup_id, request.version);
+            post_times[{request.operation, request.subgroup_id}] = request.post_time;
+        } else {
+            existing->second = std::max(existing->second, request.version);
+        }
+        requests.pop();
+    }
+    for(auto it = persist_versions.begin(); it != persist_versions.end();) {
+        if(last_persisted_version[it->first] >= it->second) {
+            it = persist_versions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if(!persist_versions.empty()) {
+        std::vector<FlushJob> results;
+        results.reserve(persist_versions.size());
+        for(const auto& [subgroup_id, version] : persist_versions) {
+            results.push_back(FlushJob{subgroup_id, version, version, false, false,
+                                       std::vector<unsigned char>(signature_size)});
+        }
+        if(flush_workers.empty()) {
+            const std::size_t num_workers = std::min<std::size_t>(last_persisted_version.size(),
+                                                                  std::max(1u, std::thread::hardware_concurrency()))
+                                            - 1;
+            for(std::size_t i = 0; i < num_workers; i++) {
+                flush_workers.emplace_back(&PersistenceManager::flush_worker_loop, this);
+            }
+        }
+        // Each subgroup has its own Replicated object and PersistentRegistry, so
+        // their logs can be flushed concurrently. This thread takes jobs too.
+        {
+            std::unique_lock<std::mutex> lock(flush_mutex);
+            flush_jobs = &results;
+            next_flush_job = 0;
+            flush_jobs_remaining = results.size();
+            if(results.size() > 1) {
+                flush_cv.notify_all();
+            }
+            run_flush_jobs(lock);
+            flush_done_cv.wait(lock, [this]() { return flush_jobs_remaining == 0; });
+            flush_jobs = nullptr;
+        }
+        // Call the local persistence callbacks before updating the SST
+        for(std::size_t i = 0; i < results.size(); i++) {
+            if(!results[i].persisted) {
+                continue;
+            }
+            for(auto& persistence_callback : persistence_callbacks) {
+                if(persistence_callback) {
+                    persistence_callback(results[i].subgroup_id, results[i].persisted_version);
+                }
+            }
+        }
+        // Publish all the new signatures and persisted versions under one View lock,
+        // with a single write to each of the SST fields
+        SharedLockedReference<View> view_and_lock = view_manager->get_current_view();
+        View& Vc = view_and_lock.get();
+        const uint32_t my_index = Vc.gmsSST->get_local_index();
+        std::set<uint32_t> receiver_set;
+        subgroup_id_t first_subgroup = std::numeric_limits<subgroup_id_t>::max();
+        subgroup_id_t last_subgroup = 0;
+        bool any_signature = false;
+        for(std::size_t i = 0; i < results.size(); i++) {
+            if(!results[i].persisted) {
+                continue;
+            }
+            FlushJob& result = results[i];
+            if(result.object_has_signature) {
+                gmssst::set(&(Vc.gmsSST->signatures[my_index][result.subgroup_id * signature_size]),
+                            result.signature.data(), signature_size);
+                any_signature = true;
+            }
+            gmssst::set(Vc.gmsSST->persisted_num[my_index][result.subgroup_id], result.persisted_version);
+            last_persisted_version[result.subgroup_id] = result.persisted_version;
+            for(uint32_t rank : Vc.multicast_group->get_shard_sst_indices(result.subgroup_id)) {
+                receiver_set.insert(rank);
+            }
+            first_subgroup = std::min(first_subgroup, result.subgroup_id);
+            last_subgroup = std::max(last_subgroup, result.subgroup_id);
+        }
+        if(!receiver_set.empty()) {
+            // Subgroups between the ones in the batch are written with their
+            // current local values, which is harmless.
+            const std::vector<uint32_t> receivers(receiver_set.begin(), receiver_set.end());
+            const std::size_t num_subgroups = last_subgroup - first_subgroup + 1;
+            if(any_signature) {
+                Vc.gmsSST->put(receivers,
+                               (char*)(&Vc.gmsSST->signatures[0][first_subgroup * signature_size]) - Vc.gmsSST->getBaseAddress(),
+                               num_subgroups * signature_size);
+            }
+            Vc.gmsSST->put(receivers,
+                           (char*)(&Vc.gmsSST->persisted_num[0][first_subgroup]) - Vc.gmsSST->getBaseAddress(),
+                           num_subgroups * sizeof(Vc.gmsSST->persisted_num[0][0]));
+        }
+        for(std::size_t i = 0; i < results.size(); i++) {
+            if(results[i].persisted) {
+                metrics::record_since(metrics::Metric::DELIVER_TO_PERSIST_NS, results[i].subgroup_id,
+                                      post_times[{RequestType::PERSIST, results[i].subgroup_id}]);
+            }
+        }
+    }
+
+    for(const auto& [subgroup_id, version] : verify_versions) {
+        handle_verify_request(subgroup_id, version, post_times[{RequestType::VERIFY, subgroup_id}]);
+    }
+}
+
+void PersistenceManager::handle_verify_request(subgroup_id_t subgroup_id, persistent::version_t version,
+                                               uint64_t post_time) {
     auto search = objects_by_subgroup_id.find(subgroup_id);
     if(search != objects_by_subgroup_id.end()) {
         ReplicatedObject* subgroup_object = search->second;
@@ -175,6 +376,7 @@ void PersistenceManager::handle_verify_request(subgroup_id_t subgroup_id, persis
         if(minimum_verified_version != std::numeric_limits<persistent::version_t>::max()) {
             gmssst::set(Vc.gmsSST->verified_num[Vc.gmsSST->get_local_index()][subgroup_id], minimum_verified_version);
             Vc.gmsSST->put(shard_member_ranks, Vc.gmsSST->verified_num, subgroup_id);
+            metrics::record_since(metrics::Metric::PERSIST_TO_VERIFY_NS, subgroup_id, post_time);
         }
     }
 }
@@ -184,8 +386,10 @@ void PersistenceManager::post_persist_request(const subgroup_id_t& subgroup_id,
     // request enqueue
     while(prq_lock.test_and_set(std::memory_order_acquire))  // acquire lock
         ;                                                    // spin
-    persistence_request_queue.push({RequestType::PERSIST, subgroup_id, version});
+    persistence_request_queue.push({RequestType::PERSIST, subgroup_id, version, metrics::start_time()});
+    const std::size_t queue_depth = persistence_request_queue.size();
     prq_lock.clear(std::memory_order_release);  // release lock
+    metrics::record(metrics::Metric::PERSISTENCE_QUEUE_DEPTH, metrics::NO_SUBGROUP, queue_depth);
     // post semaphore
     sem_post(&persistence_request_sem);
 }
@@ -197,8 +401,10 @@ void PersistenceManager::post_verify_request(const subgroup_id_t& subgroup_id, c
     }
     while(prq_lock.test_and_set(std::memory_order_acquire))  // acquire lock
         ;                                                    // spin
-    persistence_request_queue.push({RequestType::VERIFY, subgroup_id, version});
+    persistence_request_queue.push({RequestType::VERIFY, subgroup_id, version, metrics::start_time()});
+    const std::size_t queue_depth = persistence_request_queue.size();
     prq_lock.clear(std::memory_order_release);  // release lock
+    metrics::record(metrics::Metric::PERSISTENCE_QUEUE_DEPTH, metrics::NO_SUBGROUP, queue_depth);
     sem_post(&persistence_request_sem);
 }
 
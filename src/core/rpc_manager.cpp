@@ -9,6 +9,7 @@
 
 #include <derecho/core/detail/rpc_manager.hpp>
 #include <derecho/core/detail/view_manager.hpp>
+#include <derecho/utils/metrics.hpp>
 
 namespace derecho {
 
@@ -81,7 +82,8 @@ void RPCManager::start_listening() {
 
 std::exception_ptr RPCManager::receive_message(
         const Opcode& indx, const node_id_t& received_from, char const* const buf,
-        std::size_t payload_size, const std::function<char*(int)>& out_alloc) {
+        std::size_t payload_size, const std::function<char*(int)>& out_alloc,
+        const trailing_bytes& trailing) {
     using namespace remote_invocation_utilities;
     assert(payload_size);
     auto receiver_function_entry = receivers->find(indx);
@@ -93,7 +95,7 @@ std::exception_ptr RPCManager::receive_message(
     }
     std::size_t reply_header_size = header_space();
     recv_ret reply_return = receiver_function_entry->second(
-            &rdv, received_from, buf,
+            &rdv, received_from, buf, trailing,
             [&out_alloc, &reply_header_size](std::size_t size) {
                 return out_alloc(size + reply_header_size) + reply_header_size;
             });
@@ -108,7 +110,8 @@ std::exception_ptr RPCManager::receive_message(
 }
 
 std::exception_ptr RPCManager::parse_and_receive(char* buf, std::size_t size,
-                                                 const std::function<char*(int)>& out_alloc) {
+                                                 const std::function<char*(int)>& out_alloc,
+                                                 const trailing_bytes& trailing) {
     using namespace remote_invocation_utilities;
     assert(size >= header_space());
     std::size_t payload_size = size;
@@ -117,17 +120,19 @@ std::exception_ptr RPCManager::parse_and_receive(char* buf, std::size_t size,
     uint32_t flags;
     retrieve_header(&rdv, buf, payload_size, indx, received_from, flags);
     return receive_message(indx, received_from, buf + header_space(),
-                           payload_size, out_alloc);
+                           payload_size, out_alloc, trailing);
 }
 
 void RPCManager::rpc_message_handler(subgroup_id_t subgroup_id, node_id_t sender_id,
                                      persistent::version_t version, uint64_t timestamp,
-                                     char* msg_buf, uint32_t buffer_size) {
+                                     char* msg_buf, uint32_t buffer_size,
+                                     const trailing_bytes& trailing) {
     // WARNING: This assumes the current view doesn't change during execution!
     // (It accesses curr_view without a lock).
 
     // set the thread local rpc_handler context
     _in_rpc_handler = true;
+    const uint64_t handler_start_time = metrics::start_time();
 
     //Use the reply-buffer allocation lambda to detect whether parse_and_receive generated a reply
     size_t reply_size = 0;
@@ -143,7 +148,8 @@ void RPCManager::rpc_message_handler(subgroup_id_t subgroup_id, node_id_t sender
                               // the reply size is too large - not part of the design to handle it
                               return nullptr;
                           }
-                      });
+                      },
+                      trailing);
     if(sender_id == nid) {
         //This is a self-receive of an RPC message I sent, so I have a reply-map that needs fulfilling
         const uint32_t my_shard = view_manager.unsafe_get_current_view().my_subgroups.at(subgroup_id);
@@ -177,6 +183,7 @@ void RPCManager::rpc_message_handler(subgroup_id_t subgroup_id, node_id_t sender
         //Otherwise, the only thing to do is send the reply (if there was one)
         connections->send(sender_id);
     }
+    metrics::record_since(metrics::Metric::RPC_HANDLER_NS, subgroup_id, handler_start_time);
 
     // clear the thread local rpc_handler context
     _in_rpc_handler = false;
@@ -439,6 +446,7 @@ void RPCManager::p2p_receive_loop() {
     pthread_setname_np(pthread_self(), "rpc_listener_thread");
 
     uint64_t max_payload_size = getConfUInt64(CONF_SUBGROUP_DEFAULT_MAX_PAYLOAD_SIZE);
+    const uint64_t busy_wait_before_sleep_ms = getConfUInt64(CONF_DERECHO_P2P_LOOP_BUSY_WAIT_BEFORE_SLEEP_MS);
     // set the thread local rpc_handler context
     _in_rpc_handler = true;
 
@@ -479,9 +487,9 @@ void RPCManager::p2p_receive_loop() {
             // check if the system has been inactive for enough time to induce sleep
             double time_elapsed_in_ms = (cur_time.tv_sec - last_time.tv_sec) * 1e3
                                         + (cur_time.tv_nsec - last_time.tv_nsec) / 1e6;
-            if(time_elapsed_in_ms > 1) {
-                using namespace std::chrono_literals;
-                std::this_thread::sleep_for(1ms);
+            if(time_elapsed_in_ms > busy_wait_before_sleep_ms) {
+                // woken up early by local requests and connection changes
+                connections->wait_for_work();
             }
         }
     }
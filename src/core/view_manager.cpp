@@ -5,6 +5,8 @@
  */
 
 #include <arpa/inet.h>
+#include <chrono>
+#include <future>
 #include <tuple>
 
 #include <derecho/core/derecho_exception.hpp>
@@ -17,6 +19,7 @@
 
 #include <derecho/persistent/Persistent.hpp>
 #include <derecho/utils/logger.hpp>
+#include <derecho/utils/metrics.hpp>
 
 #include <mutils/macro_utils.hpp>
 
@@ -471,6 +474,7 @@ void ViewManager::send_logs() {
     /* If we're in total restart mode, prior_view_shard_leaders is equal
      * to restart_state->restart_shard_leaders */
     node_id_t my_id = getConfUInt32(CONF_DERECHO_LOCAL_ID);
+    std::map<node_id_t, std::vector<subgroup_id_t>> subgroups_by_receiver;
     for(subgroup_id_t subgroup_id = 0; subgroup_id < prior_view_shard_leaders.size(); ++subgroup_id) {
         for(uint32_t shard = 0; shard < prior_view_shard_leaders[subgroup_id].size(); ++shard) {
             if(my_id == prior_view_shard_leaders[subgroup_id][shard]) {
@@ -478,12 +482,13 @@ void ViewManager::send_logs() {
                 //Send object data to all shard members, since they will all be in receive_objects()
                 for(node_id_t shard_member : restart_view.subgroup_shard_views[subgroup_id][shard].members) {
                     if(shard_member != my_id) {
-                        send_subgroup_object(subgroup_id, shard_member);
+                        subgroups_by_receiver[shard_member].emplace_back(subgroup_id);
                     }
                 }
             }
         }
     }
+    send_subgroup_objects(subgroups_by_receiver);
 }
 
 void ViewManager::setup_initial_tcp_connections(const View& initial_view, const node_id_t my_id) {
@@ -1364,6 +1369,7 @@ void ViewManager::finish_view_change(DerechoSST& gmsSST) {
     gmsSST.predicates.remove(leader_proposed_handle);
 
     const node_id_t my_id = curr_view->members[curr_view->my_rank];
+    const uint64_t wedge_time = curr_view->multicast_group->get_wedge_time();
 
     //Send the new view from the leader to non-leaders in the old view using the TCP sockets
     if(active_leader) {
@@ -1487,6 +1493,8 @@ void ViewManager::finish_view_change(DerechoSST& gmsSST) {
     // New members can now proceed to view_manager.finish_setup(), which will call put() and sync()
     next_view->gmsSST->push_row_except_slots();
     next_view->gmsSST->sync_with_members();
+    // Every member has now taken over the RDMC groups it kept from the last view
+    next_view->multicast_group->release_kept_rdmc_groups();
     {
         lock_guard_t old_views_lock(old_views_mutex);
         old_views.push(std::move(curr_view));
@@ -1518,6 +1526,7 @@ void ViewManager::finish_view_change(DerechoSST& gmsSST) {
     }
 
     curr_view->gmsSST->start_predicate_evaluation();
+    metrics::record_since(metrics::Metric::VIEW_CHANGE_NS, metrics::NO_SUBGROUP, wedge_time);
     view_change_cv.notify_all();
     dbg_default_debug("Done with view change to view {}", curr_view->vid);
 }
@@ -1553,6 +1562,12 @@ void ViewManager::transition_multicast_group(
     const auto num_subgroups = next_view->subgroup_shard_views.size();
     const std::size_t signature_size = persistence_manager.get_signature_size();
 
+    // The SST is built again rather than grown in place. Its rows are one
+    // array indexed by rank, and the length of a row depends on the number of
+    // senders and the slot sizes of the view's subgroups, so a departure or a
+    // change of the subgroups moves the columns of every row. Each row is also
+    // exchanged with the other members by its address in the array, which
+    // growing the array for a joiner would move.
     next_view->gmsSST = std::make_shared<DerechoSST>(
             sst::SSTParams(
                     next_view->members, next_view->members[next_view->my_rank],
@@ -1706,6 +1721,7 @@ void ViewManager::send_view(const View& new_view, tcp::socket& client_socket) {
 
 void ViewManager::send_objects_to_new_members(const vector_int64_2d& old_shard_leaders) {
     node_id_t my_id = next_view->members[next_view->my_rank];
+    std::map<node_id_t, std::vector<subgroup_id_t>> subgroups_by_receiver;
     for(subgroup_id_t subgroup_id = 0; subgroup_id < old_shard_leaders.size(); ++subgroup_id) {
         for(uint32_t shard = 0; shard < old_shard_leaders[subgroup_id].size(); ++shard) {
             //if I was the leader of the shard in the old view...
@@ -1713,33 +1729,69 @@ void ViewManager::send_objects_to_new_members(const vector_int64_2d& old_shard_l
                 //send its object state to the new members
                 for(node_id_t shard_joiner : next_view->subgroup_shard_views[subgroup_id][shard].joined) {
                     if(shard_joiner != my_id) {
-                        send_subgroup_object(subgroup_id, shard_joiner);
+                        subgroups_by_receiver[shard_joiner].emplace_back(subgroup_id);
                     }
                 }
             }
         }
     }
+    send_subgroup_objects(subgroups_by_receiver);
+}
+
+void ViewManager::send_subgroup_objects(const std::map<node_id_t, std::vector<subgroup_id_t>>& subgroups_by_receiver) {
+    if(subgroups_by_receiver.size() == 1) {
+        for(subgroup_id_t subgroup_id : subgroups_by_receiver.begin()->second) {
+            send_subgroup_object(subgroup_id, subgroups_by_receiver.begin()->first);
+        }
+        return;
+    }
+    //Each receiver has its own TCP socket, so the transfers to different nodes can overlap
+    std::vector<std::future<void>> transfers;
+    for(const auto& [receiver_id, subgroup_ids] : subgroups_by_receiver) {
+        transfers.emplace_back(std::async(std::launch::async, [this, receiver_id = receiver_id, &subgroup_ids = subgroup_ids]() {
+            pthread_setname_np(pthread_self(), "state_xfer");
+            for(subgroup_id_t subgroup_id : subgroup_ids) {
+                send_subgroup_object(subgroup_id, receiver_id);
+            }
+        }));
+    }
+    //Wait for all of them, then report the first failure
+    for(auto& transfer : transfers) {
+        transfer.wait();
+    }
+    for(auto& transfer : transfers) {
+        transfer.get();
+    }
 }
 
 /* Note for the future: Since this "send" requires first receiving the log tail length,
- * it's really a blocking receive-then-send. Since all nodes call send_subgroup_object
- * before initialize_subgroup_objects, there's a small chance of a deadlock: node A could
+ * it's really a blocking receive-then-send. Since all nodes send their objects before
+ * initialize_subgroup_objects, there's a small chance of a deadlock: node A could
  * be attempting to send an object to node B at the same time as B is attempting to send a
  * different object to A, and neither node will be able to send the log tail length that
- * the other one is waiting on. */
+ * the other one is waiting on. Sending to different nodes on separate threads does not
+ * change this, since each node waits for all its sends before it starts receiving. */
 void ViewManager::send_subgroup_object(subgroup_id_t subgroup_id, node_id_t new_node_id) {
     LockedReference<std::unique_lock<std::mutex>, tcp::socket> joiner_socket = tcp_sockets.get_socket(new_node_id);
     assert(subgroup_objects.find(subgroup_id) != subgroup_objects.end());
     ReplicatedObject* subgroup_object = subgroup_objects.at(subgroup_id);
+    persistent::version_t persistent_log_length = 0;
     if(subgroup_object->is_persistent()) {
         //First, read the log tail length sent by the joining node
-        persistent::version_t persistent_log_length = 0;
         joiner_socket.get().read(persistent_log_length);
-        persistent::PersistentRegistry::setEarliestVersionToSerialize(persistent_log_length);
         dbg_default_debug("Got log tail length {}", persistent_log_length);
+        //The object is sent without its log tails, which follow it in chunks
+        persistent::PersistentRegistry::setEarliestVersionToSerialize(persistent::LOG_TAIL_OMITTED);
     }
     dbg_default_debug("Sending Replicated Object state for subgroup {} to node {}", subgroup_id, new_node_id);
+    auto start_time = std::chrono::steady_clock::now();
     subgroup_object->send_object(joiner_socket.get());
+    if(subgroup_object->is_persistent()) {
+        persistent::PersistentRegistry::resetEarliestVersionToSerialize();
+        subgroup_object->send_log_tails(joiner_socket.get(), persistent_log_length);
+    }
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+    dbg_default_debug("Sent Replicated Object state for subgroup {} to node {} in {} ms", subgroup_id, new_node_id, elapsed_us / 1000.0);
 }
 
 void ViewManager::update_tcp_connections() {
@@ -1887,6 +1939,10 @@ std::map<subgroup_id_t, uint64_t> ViewManager::get_max_payload_sizes() {
     return max_payload_sizes;
 }
 
+uint64_t ViewManager::get_max_payload_size(subgroup_id_t subgroup_id) const {
+    return max_payload_sizes.at(subgroup_id);
+}
+
 std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>
 ViewManager::make_member_ips_and_ports_map(const View& view, const PortType port) {
     std::map<node_id_t, std::pair<ip_addr_t, uint16_t>> member_ips_and_ports_map;
@@ -21,6 +21,16 @@ std::size_t bytes_size(const std::string& b) {
     return b.length() + 1;
 }
 
+std::size_t to_bytes(const std::string_view& b, char* v) {
+    memcpy(v, b.data(), b.length());
+    v[b.length()] = '\0';
+    return b.length() + 1;
+}
+
+std::size_t bytes_size(const std::string_view& b) {
+    return b.length() + 1;
+}
+
 #ifdef MUTILS_DEBUG
 void ensure_registered(ByteRepresentable& b, DeserializationManager& dm) {
     b.ensure_registered(dm);
@@ -47,6 +57,12 @@ void post_object(const std::function<void(char const* const, std::size_t)>& f, c
     f(str.c_str(), str.length() + 1);
 }
 
+void post_object(const std::function<void(char const* const, std::size_t)>& f, const std::string_view& str) {
+    const char terminator = '\0';
+    f(str.data(), str.length());
+    f(&terminator, 1);
+}
+
 std::size_t to_bytes_v(char*) {
     return 0;
 }
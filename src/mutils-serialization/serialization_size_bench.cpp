@@ -0,0 +1,109 @@
+/**
+ * @file serialization_size_bench.cpp
+ *
+ * Measures the cost of marshalling a nested RPC argument, a
+ * std::map<std::string, std::vector<Blob>>, the way an ordered_send does it.
+ * It used to size the arguments twice, once for the message size and once
+ * more in RemoteInvoker::send, before serializing them; now it sizes them once
+ * and serializes them in a single pass. Both are timed, along with bytes_size
+ * and to_bytes alone. The old path is timed with a copy of the old to_bytes,
+ * which sized the container again before serializing it.
+ *
+ * USAGE: serialization_size_bench [num_keys] [blobs_per_key] [blob_size] [iterations]
+ */
+#include "SerializationMacros.hpp"
+#include "SerializationSupport.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace mutils;
+
+struct Blob : public ByteRepresentable {
+    uint64_t id;
+    std::vector<char> bytes;
+
+    Blob(uint64_t id, const std::vector<char>& bytes) : id(id), bytes(bytes) {}
+
+    DEFAULT_SERIALIZATION_SUPPORT(Blob, id, bytes);
+};
+
+using argument_t = std::map<std::string, std::vector<Blob>>;
+
+/**
+ * The to_bytes for std::map as it was before it returned the number of bytes
+ * it wrote: it called bytes_size on the whole map, nested containers
+ * included, before serializing it.
+ */
+template <typename K, typename V>
+std::size_t old_to_bytes(const std::map<K, V>& m, char* buffer) {
+    std::size_t index = 0;
+    std::size_t size = bytes_size(m);
+    post_object(post_to_buffer(index, buffer), m);
+    return size;
+}
+
+template <typename F>
+double time_ns(int iterations, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; ++i) {
+        f();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    const int num_keys = argc > 1 ? std::stoi(argv[1]) : 64;
+    const int blobs_per_key = argc > 2 ? std::stoi(argv[2]) : 16;
+    const int blob_size = argc > 3 ? std::stoi(argv[3]) : 64;
+    const int iterations = argc > 4 ? std::stoi(argv[4]) : 1000;
+
+    argument_t argument;
+    for(int k = 0; k < num_keys; ++k) {
+        auto& blobs = argument["key" + std::to_string(k)];
+        for(int b = 0; b < blobs_per_key; ++b) {
+            blobs.emplace_back(b, std::vector<char>(blob_size, 'a' + b % 26));
+        }
+    }
+    const std::size_t size = bytes_size(argument);
+    std::vector<char> buffer(size);
+    std::size_t sink = 0;
+
+    const double size_ns = time_ns(iterations, [&]() { sink += bytes_size(argument); });
+    const double to_bytes_ns = time_ns(iterations, [&]() { sink += to_bytes(argument, buffer.data()); });
+    const double old_to_bytes_ns = time_ns(iterations, [&]() { sink += old_to_bytes(argument, buffer.data()); });
+    // the size for the message, the size again in RemoteInvoker::send, then the
+    // arguments with the old to_bytes, which sized them once more
+    const double two_pass_ns = time_ns(iterations, [&]() {
+        std::size_t message_size = bytes_size(argument);
+        std::size_t send_size = bytes_size(argument);
+        sink += message_size + send_size + old_to_bytes(argument, buffer.data());
+    });
+    // the size computed once by ordered_send and handed down to the send
+    const double one_pass_ns = time_ns(iterations, [&]() {
+        std::size_t message_size = bytes_size(argument);
+        sink += message_size + to_bytes(argument, buffer.data());
+    });
+
+    DeserializationManager dsm{{}};
+    auto copy = from_bytes<argument_t>(&dsm, buffer.data());
+    if(copy->size() != argument.size() || bytes_size(*copy) != size) {
+        std::cerr << "Round trip failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "argument: " << num_keys << " keys x " << blobs_per_key << " blobs x "
+              << blob_size << " bytes = " << size << " serialized bytes" << std::endl;
+    std::cout << "bytes_size:                  " << size_ns << " ns" << std::endl;
+    std::cout << "to_bytes:                    " << to_bytes_ns << " ns" << std::endl;
+    std::cout << "old to_bytes:                " << old_to_bytes_ns << " ns" << std::endl;
+    std::cout << "sized twice, then serialized: " << two_pass_ns << " ns" << std::endl;
+    std::cout << "sized once, then serialized:  " << one_pass_ns << " ns" << std::endl;
+    // keeps the measured calls from being optimized away
+    return sink == 0 ? 2 : 0;
+}
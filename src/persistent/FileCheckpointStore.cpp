@@ -0,0 +1,236 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/persistent/detail/FileCheckpointStore.hpp>
+#include <derecho/persistent/detail/FilePersistLog.hpp>
+#include <derecho/persistent/detail/util.hpp>
+#include <errno.h>
+#include <fcntl.h>
+#include <iterator>
+#include <mutex>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace persistent {
+
+/////////////////////////
+// internal structures //
+/////////////////////////
+
+// FNV-1a is enough to detect a torn checkpoint; it is not meant to be secure.
+static uint64_t checkpoint_checksum(const char* buf, uint64_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(uint64_t i = 0; i < size; i++) {
+        hash ^= static_cast<uint8_t>(buf[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static void pwrite_fully(int fd, const void* buf, uint64_t size, uint64_t ofst) {
+    const char* p = static_cast<const char*>(buf);
+    while(size > 0) {
+        ssize_t nWrite = pwrite(fd, p, size, ofst);
+        if(nWrite < 0) {
+            if(errno == EINTR) continue;
+            throw PERSIST_EXP_WRITE_FILE(errno);
+        }
+        p += nWrite;
+        ofst += nWrite;
+        size -= nWrite;
+    }
+}
+
+static bool pread_fully(int fd, void* buf, uint64_t size, uint64_t ofst) {
+    char* p = static_cast<char*>(buf);
+    while(size > 0) {
+        ssize_t nRead = pread(fd, p, size, ofst);
+        if(nRead < 0) {
+            if(errno == EINTR) continue;
+            throw PERSIST_EXP_READ_FILE(errno);
+        }
+        if(nRead == 0) {
+            return false;
+        }
+        p += nRead;
+        ofst += nRead;
+        size -= nRead;
+    }
+    return true;
+}
+
+////////////////////////
+// visible to outside //
+////////////////////////
+
+FileCheckpointStore::FileCheckpointStore(const string& name, const string& dataPath)
+        : m_sName(name),
+          m_sCheckpointFile(dataPath + "/" + name + "." + CKPT_FILE_SUFFIX),
+          m_iFileDesc(-1),
+          m_iFileSize(0) {
+    checkOrCreateDir(dataPath);
+    if(derecho::getConfBoolean(CONF_PERS_RESET) && checkRegularFile(m_sCheckpointFile)) {
+        if(unlink(m_sCheckpointFile.c_str()) != 0) {
+            dbg_default_error("{0} reset failed to remove the file:{1}", m_sName, m_sCheckpointFile);
+            throw PERSIST_EXP_REMOVE_FILE(errno);
+        }
+    }
+    load();
+}
+
+FileCheckpointStore::~FileCheckpointStore() noexcept(true) {
+    if(m_iFileDesc != -1) {
+        close(m_iFileDesc);
+    }
+}
+
+void FileCheckpointStore::load() {
+    dbg_default_trace("{0}:load checkpoints...begin", m_sName);
+    m_iFileDesc = open(m_sCheckpointFile.c_str(), O_RDWR | O_CREAT, S_IWUSR | S_IRUSR | S_IRGRP | S_IWGRP | S_IROTH);
+    if(m_iFileDesc == -1) {
+        throw PERSIST_EXP_OPEN_FILE(errno);
+    }
+    struct stat sb;
+    if(fstat(m_iFileDesc, &sb) != 0) {
+        throw PERSIST_EXP_READ_FILE(errno);
+    }
+    const uint64_t file_size = static_cast<uint64_t>(sb.st_size);
+    uint64_t ofst = 0;
+    while(ofst + sizeof(CheckpointHeader) <= file_size) {
+        CheckpointHeader header;
+        if(!pread_fully(m_iFileDesc, &header, sizeof(header), ofst)) {
+            break;
+        }
+        if(header.magic != CKPT_MAGIC || ofst + sizeof(header) + header.size > file_size) {
+            dbg_default_warn("{0}: dropping a torn checkpoint at offset {1}.", m_sName, ofst);
+            break;
+        }
+        m_index[header.idx] = checkpoint_entry{header.ver, ofst, header.size, header.checksum};
+        ofst += sizeof(header) + header.size;
+    }
+    m_iFileSize = ofst;
+    if(m_iFileSize != file_size && ftruncate(m_iFileDesc, m_iFileSize) != 0) {
+        throw PERSIST_EXP_TRUNCATE_FILE(errno);
+    }
+    dbg_default_trace("{0}:load checkpoints...done, {1} checkpoints found.", m_sName, m_index.size());
+}
+
+void FileCheckpointStore::write(int64_t idx, version_t ver, uint64_t size, const std::function<void(char*)>& writer) {
+    std::vector<char> buf(sizeof(CheckpointHeader) + size);
+    writer(buf.data() + sizeof(CheckpointHeader));
+    CheckpointHeader* header = reinterpret_cast<CheckpointHeader*>(buf.data());
+    header->magic = CKPT_MAGIC;
+    header->idx = idx;
+    header->ver = ver;
+    header->size = size;
+    header->checksum = checkpoint_checksum(buf.data() + sizeof(CheckpointHeader), size);
+
+    std::unique_lock<std::shared_mutex> lck(m_mutex);
+    if(!m_index.empty() && m_index.rbegin()->first >= idx) {
+        dbg_default_warn("{0}: skip checkpoint at index {1}, which is not after the latest checkpoint at {2}.",
+                         m_sName, idx, m_index.rbegin()->first);
+        return;
+    }
+    pwrite_fully(m_iFileDesc, buf.data(), buf.size(), m_iFileSize);
+    m_index[idx] = checkpoint_entry{ver, m_iFileSize, size, header->checksum};
+    m_iFileSize += buf.size();
+    dbg_default_debug("{0}: checkpoint written at index {1}, version {2}, {3} bytes.", m_sName, idx, ver, size);
+}
+
+int64_t FileCheckpointStore::load(int64_t lower_idx, int64_t upper_idx,
+                                  const std::function<bool(int64_t, version_t)>& validator,
+                                  std::vector<char>& buf) const {
+    std::shared_lock<std::shared_mutex> lck(m_mutex);
+    auto itr = m_index.upper_bound(upper_idx);
+    while(itr != m_index.begin()) {
+        itr--;
+        if(itr->first < lower_idx) {
+            break;
+        }
+        if(!validator(itr->first, itr->second.ver)) {
+            dbg_default_debug("{0}: checkpoint at index {1} does not match the log, skip it.", m_sName, itr->first);
+            continue;
+        }
+        buf.resize(itr->second.size);
+        if(!pread_fully(m_iFileDesc, buf.data(), itr->second.size, itr->second.ofst + sizeof(CheckpointHeader))
+           || checkpoint_checksum(buf.data(), itr->second.size) != itr->second.checksum) {
+            dbg_default_warn("{0}: checkpoint at index {1} is corrupted, skip it.", m_sName, itr->first);
+            continue;
+        }
+        return itr->first;
+    }
+    return INVALID_INDEX;
+}
+
+void FileCheckpointStore::truncate(int64_t idx) {
+    std::unique_lock<std::shared_mutex> lck(m_mutex);
+    auto itr = m_index.upper_bound(idx);
+    if(itr == m_index.end()) {
+        return;
+    }
+    m_iFileSize = itr->second.ofst;
+    m_index.erase(itr, m_index.end());
+    if(ftruncate(m_iFileDesc, m_iFileSize) != 0) {
+        throw PERSIST_EXP_TRUNCATE_FILE(errno);
+    }
+    dbg_default_trace("{0}: checkpoints truncated after index {1}.", m_sName, idx);
+}
+
+void FileCheckpointStore::trim(int64_t idx) {
+    std::unique_lock<std::shared_mutex> lck(m_mutex);
+    // the newest checkpoint before idx holds the state the remaining deltas
+    // apply to, so it is kept along with everything after it.
+    auto itr = m_index.lower_bound(idx);
+    if(itr == m_index.begin() || std::prev(itr) == m_index.begin()) {
+        return;
+    }
+    compact(std::prev(itr)->first);
+}
+
+void FileCheckpointStore::compact(int64_t idx) {
+    // STEP 1: copy the remaining checkpoints to a swap file
+    const string swpFile = m_sCheckpointFile + "." + SWAP_FILE_SUFFIX;
+    int fd = open(swpFile.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IWUSR | S_IRUSR | S_IRGRP | S_IWGRP | S_IROTH);
+    if(fd == -1) {
+        throw PERSIST_EXP_OPEN_FILE(errno);
+    }
+    std::map<int64_t, checkpoint_entry> new_index;
+    uint64_t new_size = 0;
+    std::vector<char> buf;
+    try {
+        for(auto itr = m_index.lower_bound(idx); itr != m_index.end(); itr++) {
+            buf.resize(sizeof(CheckpointHeader) + itr->second.size);
+            if(!pread_fully(m_iFileDesc, buf.data(), buf.size(), itr->second.ofst)) {
+                break;
+            }
+            pwrite_fully(fd, buf.data(), buf.size(), new_size);
+            new_index[itr->first] = checkpoint_entry{itr->second.ver, new_size, itr->second.size, itr->second.checksum};
+            new_size += buf.size();
+        }
+    } catch(uint64_t e) {
+        close(fd);
+        throw e;
+    }
+    // STEP 2: atomically replace the checkpoint file
+    if(rename(swpFile.c_str(), m_sCheckpointFile.c_str()) != 0) {
+        close(fd);
+        throw PERSIST_EXP_RENAME_FILE(errno);
+    }
+    close(m_iFileDesc);
+    m_iFileDesc = fd;
+    m_iFileSize = new_size;
+    m_index.swap(new_index);
+    dbg_default_trace("{0}: checkpoints before index {1} are trimmed, {2} left.", m_sName, idx, m_index.size());
+}
+
+int64_t FileCheckpointStore::getLatestCheckpointIndex() const {
+    std::shared_lock<std::shared_mutex> lck(m_mutex);
+    return m_index.empty() ? INVALID_INDEX : m_index.rbegin()->first;
+}
+
+std::size_t FileCheckpointStore::getNumOfCheckpoints() const {
+    std::shared_lock<std::shared_mutex> lck(m_mutex);
+    return m_index.size();
+}
+}  // namespace persistent
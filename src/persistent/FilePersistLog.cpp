@@ -10,6 +10,7 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <vector>
 
 #if __GNUC__ > 7
 #include <filesystem>
@@ -42,13 +43,16 @@ FilePersistLog::FilePersistLog(const string& name, const string& dataPath, bool
           m_iLogFileDesc(-1),
           m_iDataFileDesc(-1),
           m_pLog(MAP_FAILED),
-          m_pData(MAP_FAILED) {
+          m_pData(MAP_FAILED),
+          m_iReservedOfst(-1),
+          m_iReservedSize(0) {
     if(pthread_rwlock_init(&this->m_rwlock, NULL) != 0) {
         throw PERSIST_EXP_RWLOCK_INIT(errno);
     }
     if(pthread_mutex_init(&this->m_perslock, NULL) != 0) {
         throw PERSIST_EXP_MUTEX_INIT(errno);
     }
+    this->hidx.reserve(m_iMaxLogEntry);
     dbg_default_trace("{0} constructor: before load()", name);
     if(derecho::getConfBoolean(CONF_PERS_RESET)) {
         reset();
@@ -132,6 +136,7 @@ void FilePersistLog::load() {
         m_currMetaHeader.fields.head = 0ll;
         m_currMetaHeader.fields.tail = 0ll;
         m_currMetaHeader.fields.ver = INVALID_VERSION;
+        m_currMetaHeader.fields.flags = META_FLAG_VALID | (signature_size > 0 ? META_FLAG_SIGNATURES : 0);
         m_persMetaHeader.fields.head = INVALID_INDEX;
         m_persMetaHeader.fields.tail = INVALID_INDEX;
         m_persMetaHeader.fields.ver = INVALID_VERSION;
@@ -164,14 +169,27 @@ void FilePersistLog::load() {
             }
             close(fd);
             m_currMetaHeader = m_persMetaHeader;
-            // update mhlc index
-            for(int64_t idx = m_currMetaHeader.fields.head; idx < m_currMetaHeader.fields.tail; idx++) {
-                struct hlc_index_entry _ent;
-                _ent.hlc.m_rtc_us = LOG_ENTRY_AT(idx)->fields.hlc_r;
-                _ent.hlc.m_logic = LOG_ENTRY_AT(idx)->fields.hlc_l;
-                _ent.log_idx = idx;
-                this->hidx.insert(_ent);
+            // the next persist() records the flags of a log created before they existed
+            m_currMetaHeader.fields.flags = META_FLAG_VALID | (signature_size > 0 ? META_FLAG_SIGNATURES : 0);
+            // update mhlc index: the live entries are at most two contiguous
+            // runs of the log array, which are scanned without the modulo.
+            std::vector<hlc_index_entry> entries(NUM_USED_SLOTS);
+            int64_t idx = m_currMetaHeader.fields.head;
+            std::size_t pos = 0;
+            const int64_t max_entries = static_cast<int64_t>(MAX_LOG_ENTRY);
+            while(idx < m_currMetaHeader.fields.tail) {
+                const LogEntry* run = LOG_ENTRY_AT(idx);
+                const int64_t run_length = std::min(m_currMetaHeader.fields.tail - idx,
+                                                    max_entries - (idx % max_entries));
+                for(int64_t i = 0; i < run_length; i++) {
+                    entries[pos + i].rtc_us = run[i].fields.hlc_r;
+                    entries[pos + i].logic = run[i].fields.hlc_l;
+                    entries[pos + i].log_idx = idx + i;
+                }
+                idx += run_length;
+                pos += run_length;
             }
+            this->hidx.rebuild(entries);
         } catch(uint64_t e) {
             FPL_PERS_UNLOCK;
             FPL_UNLOCK;
@@ -211,24 +229,28 @@ FilePersistLog::~FilePersistLog() noexcept(true) {
     }
 }
 
-inline void FilePersistLog::do_append_validation(const uint64_t size, const int64_t ver) {
+inline void FilePersistLog::do_space_validation(const uint64_t size) {
     if(NUM_FREE_SLOTS < 1) {
         dbg_default_error("{0}-append exception no free slots in log! NUM_FREE_SLOTS={1}",
                           this->m_sName, NUM_FREE_SLOTS);
         dbg_default_flush();
         FPL_UNLOCK;
-        std::cerr << "PERSIST_EXP_NOSPACE_LOG: FREESLOT=" << NUM_FREE_SLOTS << ",version=" << ver << std::endl;
+        std::cerr << "PERSIST_EXP_NOSPACE_LOG: FREESLOT=" << NUM_FREE_SLOTS << std::endl;
         throw PERSIST_EXP_NOSPACE_LOG;
     }
-    if(NUM_FREE_BYTES < (signature_size + size)) {
-        dbg_default_error("{0}-append exception no space for data: NUM_FREE_BYTES={1}, size={2}, signature_size={3}",
-                          this->m_sName, NUM_FREE_BYTES, size, signature_size);
+    if(NUM_FREE_BYTES < (signature_size + digest_size + size)) {
+        dbg_default_error("{0}-append exception no space for data: NUM_FREE_BYTES={1}, size={2}, signature_size={3}, digest_size={4}",
+                          this->m_sName, NUM_FREE_BYTES, size, signature_size, digest_size);
         dbg_default_flush();
         FPL_UNLOCK;
         std::cerr << "PERSIST_EXP_NOSPACE_DATA: FREE:" << NUM_FREE_BYTES << ",size=" << size
-                  << ",signature_size=" << signature_size << std::endl;
+                  << ",signature_size=" << signature_size << ",digest_size=" << digest_size << std::endl;
         throw PERSIST_EXP_NOSPACE_DATA;
     }
+}
+
+inline void FilePersistLog::do_append_validation(const uint64_t size, const int64_t ver) {
+    do_space_validation(size);
     if((CURR_LOG_IDX != INVALID_INDEX) && (m_currMetaHeader.fields.ver >= ver)) {
         int64_t cver = m_currMetaHeader.fields.ver;
         dbg_default_error("{0}-append version already exists! cur_ver:{1} new_ver:{2}", this->m_sName,
@@ -240,30 +262,20 @@ inline void FilePersistLog::do_append_validation(const uint64_t size, const int6
     }
 }
 
-void FilePersistLog::append(const void* pdat, uint64_t size, version_t ver, const HLC& mhlc) {
-    dbg_default_trace("{0} append event ({1},{2})", this->m_sName, mhlc.m_rtc_us, mhlc.m_logic);
-    FPL_RDLOCK;
-
-    do_append_validation(size, ver);
-
-    FPL_UNLOCK;
-    dbg_default_trace("{0} append:validate check1 Finished.", this->m_sName);
-
-    FPL_WRLOCK;
-    do_append_validation(size, ver);
-    dbg_default_trace("{0} append:validate check2 Finished.", this->m_sName);
-
-    // copy data
-    // we reserve the first 'signature_size' bytes at the beginning of NEXT_DATA.
-    memcpy(reinterpret_cast<void*>(reinterpret_cast<uint64_t>(NEXT_DATA) + signature_size), pdat, size);
-    dbg_default_trace("{0} append:data ({1} bytes) is copied to log.", this->m_sName, size);
+inline void FilePersistLog::do_append_entry(const uint64_t size, const version_t ver, const HLC& mhlc, const uint64_t ref_dist) {
+    // With batched signatures, the 'digest_size' bytes after the signature are
+    // cleared, because only the last version of a batch gets a signature.
+    if(digest_size > 0) {
+        memset(NEXT_DATA, 0, signature_size + digest_size);
+    }
 
     // fill the log entry
     NEXT_LOG_ENTRY->fields.ver = ver;
-    NEXT_LOG_ENTRY->fields.sdlen = signature_size + size;
+    NEXT_LOG_ENTRY->fields.sdlen = signature_size + digest_size + size;
     NEXT_LOG_ENTRY->fields.ofst = NEXT_DATA_OFST;
     NEXT_LOG_ENTRY->fields.hlc_r = mhlc.m_rtc_us;
     NEXT_LOG_ENTRY->fields.hlc_l = mhlc.m_logic;
+    NEXT_LOG_ENTRY->fields.ref_dist = ref_dist;
     /* No Sync required here.
     if (msync(ALIGN_TO_PAGE(NEXT_LOG_ENTRY),
         sizeof(LogEntry) + (((uint64_t)NEXT_LOG_ENTRY) % PAGE_SIZE),MS_SYNC) != 0) {
@@ -273,7 +285,7 @@ void FilePersistLog::append(const void* pdat, uint64_t size, version_t ver, cons
     */
 
     // update meta header
-    this->hidx.insert(hlc_index_entry{mhlc, m_currMetaHeader.fields.tail});
+    this->hidx.insert(mhlc.m_rtc_us, mhlc.m_logic, m_currMetaHeader.fields.tail);
     m_currMetaHeader.fields.tail++;
     m_currMetaHeader.fields.ver = ver;
     dbg_default_trace("{0} append:log entry and meta data are updated.", this->m_sName);
@@ -285,9 +297,109 @@ void FilePersistLog::append(const void* pdat, uint64_t size, version_t ver, cons
     */
     dbg_default_debug("{0} append a log ver:{1} hlc:({2},{3})", this->m_sName,
                       ver, mhlc.m_rtc_us, mhlc.m_logic);
+}
+
+void FilePersistLog::append(const void* pdat, uint64_t size, version_t ver, const HLC& mhlc) {
+    dbg_default_trace("{0} append event ({1},{2})", this->m_sName, mhlc.m_rtc_us, mhlc.m_logic);
+    FPL_RDLOCK;
+
+    do_append_validation(size, ver);
+
+    FPL_UNLOCK;
+    dbg_default_trace("{0} append:validate check1 Finished.", this->m_sName);
+
+    FPL_WRLOCK;
+    do_append_validation(size, ver);
+    dbg_default_trace("{0} append:validate check2 Finished.", this->m_sName);
+
+    // copy data
+    // we reserve the first 'signature_size' bytes at the beginning of NEXT_DATA,
+    // followed by 'digest_size' bytes with batched signatures.
+    memcpy(reinterpret_cast<void*>(reinterpret_cast<uint64_t>(NEXT_DATA) + signature_size + digest_size), pdat, size);
+    dbg_default_trace("{0} append:data ({1} bytes) is copied to log.", this->m_sName, size);
+
+    do_append_entry(size, ver, mhlc);
+    // an append also consumes the space of any outstanding reservation
+    m_iReservedOfst = -1;
+    FPL_UNLOCK;
+}
+
+char* FilePersistLog::reserve(uint64_t size) {
+    dbg_default_trace("{0} reserve {1} bytes", this->m_sName, size);
+    FPL_RDLOCK;
+    do_space_validation(size);
+    // The data ring is mapped twice back to back, so the reserved bytes are
+    // contiguous in memory even if they wrap around the end of the data file.
+    m_iReservedOfst = NEXT_DATA_OFST;
+    m_iReservedSize = size;
+    char* buf = reinterpret_cast<char*>(NEXT_DATA) + signature_size + digest_size;
+    FPL_UNLOCK;
+    return buf;
+}
+
+inline void FilePersistLog::do_reservation_validation(const version_t ver) {
+    if(m_iReservedOfst < 0) {
+        dbg_default_error("{0}-commit exception: no reservation for ver:{1}", this->m_sName, ver);
+        FPL_UNLOCK;
+        throw PERSIST_EXP_NO_RESERVATION;
+    }
+}
+
+inline void FilePersistLog::do_commit(const version_t ver, const HLC& mhlc) {
+    do_append_validation(m_iReservedSize, ver);
+    if(static_cast<uint64_t>(m_iReservedOfst) != NEXT_DATA_OFST) {
+        // The log was trimmed to empty or truncated after reserve(). Nothing
+        // but the writer writes to the free space, so the data is still where
+        // it was reserved; move it to the new end of the log. The two ranges
+        // may alias each other through the double mapping, so go through a
+        // temporary copy. This is rare.
+        const uint64_t prefix = signature_size + digest_size;
+        std::vector<char> data(m_iReservedSize);
+        memcpy(data.data(), reinterpret_cast<char*>(this->m_pData) + (m_iReservedOfst + prefix) % MAX_DATA_SIZE,
+               m_iReservedSize);
+        memcpy(reinterpret_cast<char*>(NEXT_DATA) + prefix, data.data(), m_iReservedSize);
+    }
+    do_append_entry(m_iReservedSize, ver, mhlc);
+    m_iReservedOfst = -1;
+}
+
+void FilePersistLog::commit(version_t ver, const HLC& mhlc) {
+    dbg_default_trace("{0} commit event ({1},{2})", this->m_sName, mhlc.m_rtc_us, mhlc.m_logic);
+    FPL_WRLOCK;
+    do_reservation_validation(ver);
+    do_commit(ver, mhlc);
     FPL_UNLOCK;
 }
 
+bool FilePersistLog::commitIfChanged(version_t ver, const HLC& mhlc) {
+    dbg_default_trace("{0} commitIfChanged event ({1},{2})", this->m_sName, mhlc.m_rtc_us, mhlc.m_logic);
+    FPL_WRLOCK;
+    do_reservation_validation(ver);
+    // If the log was trimmed to empty or truncated after reserve(), just log the data.
+    if(CURR_LOG_IDX != INVALID_INDEX && static_cast<uint64_t>(m_iReservedOfst) == NEXT_DATA_OFST) {
+        const int64_t curr_idx = CURR_LOG_IDX;
+        const LogEntry* pdata_entry = LOG_DATA_ENTRY_AT(curr_idx);
+        const uint64_t ref_dist = LOG_ENTRY_AT(curr_idx)->fields.ref_dist + 1;
+        if(ref_dist <= MAX_REF_DIST
+           && pdata_entry->fields.sdlen - signature_size - digest_size == m_iReservedSize
+           && memcmp(LOG_ENTRY_DATA(pdata_entry),
+                     reinterpret_cast<char*>(NEXT_DATA) + signature_size + digest_size,
+                     m_iReservedSize)
+                      == 0) {
+            do_append_validation(0, ver);
+            // refer directly to the entry holding the data, so there are no chains
+            do_append_entry(0, ver, mhlc, ref_dist);
+            m_iReservedOfst = -1;
+            FPL_UNLOCK;
+            dbg_default_trace("{0} commitIfChanged: ver:{1} has the data of ver:{2}", this->m_sName, ver, pdata_entry->fields.ver);
+            return false;
+        }
+    }
+    do_commit(ver, mhlc);
+    FPL_UNLOCK;
+    return true;
+}
+
 void FilePersistLog::advanceVersion(version_t ver) {
     FPL_WRLOCK;
     if(m_currMetaHeader.fields.ver < ver) {
@@ -423,6 +535,60 @@ bool FilePersistLog::getSignature(version_t version, unsigned char* signature, v
     return false;
 }
 
+void FilePersistLog::addDigest(version_t version,
+                               const unsigned char* digest,
+                               version_t signed_ver) {
+    if(digest_size == 0) {
+        return;
+    }
+    LogEntry* ple = nullptr;
+
+    FPL_RDLOCK;
+
+    int64_t l_idx = binarySearch<int64_t>(
+            [&](const LogEntry* ple) {
+                return ple->fields.ver;
+            },
+            version,
+            m_currMetaHeader.fields.head,
+            m_currMetaHeader.fields.tail);
+    ple = (l_idx == -1) ? nullptr : LOG_ENTRY_AT(l_idx);
+    FPL_UNLOCK;
+
+    if(ple != nullptr && ple->fields.ver == version) {
+        memcpy(LOG_ENTRY_DIGEST(ple), digest, digest_size);
+
+        ple->fields.signed_ver = signed_ver;
+    }
+}
+
+bool FilePersistLog::getDigest(version_t version, unsigned char* digest, version_t& signed_ver) {
+    if(digest_size == 0) {
+        return false;
+    }
+    LogEntry* ple = nullptr;
+
+    FPL_RDLOCK;
+
+    int64_t l_idx = binarySearch<int64_t>(
+            [&](const LogEntry* ple) {
+                return ple->fields.ver;
+            },
+            version,
+            m_currMetaHeader.fields.head,
+            m_currMetaHeader.fields.tail);
+    ple = (l_idx == -1) ? nullptr : LOG_ENTRY_AT(l_idx);
+
+    FPL_UNLOCK;
+
+    if(ple != nullptr && ple->fields.ver == version) {
+        memcpy(digest, LOG_ENTRY_DIGEST(ple), digest_size);
+        signed_ver = ple->fields.signed_ver;
+        return true;
+    }
+    return false;
+}
+
 int64_t FilePersistLog::getLength() {
     FPL_RDLOCK;
     int64_t len = NUM_USED_SLOTS;
@@ -517,7 +683,7 @@ const void* FilePersistLog::getEntryByIndex(int64_t eidx) {
                       (LOG_ENTRY_AT(ridx))->fields.hlc_r,
                       (LOG_ENTRY_AT(ridx))->fields.hlc_l);
 
-    return LOG_ENTRY_DATA(LOG_ENTRY_AT(ridx));
+    return LOG_ENTRY_DATA(LOG_DATA_ENTRY_AT(ridx));
 }
 
 const void* FilePersistLog::getEntry(version_t ver, bool exact) {
@@ -546,19 +712,17 @@ const void* FilePersistLog::getEntry(version_t ver, bool exact) {
 
     dbg_default_trace("{0} getEntry at ({1},{2})", this->m_sName, ple->fields.hlc_r, ple->fields.hlc_l);
 
-    return LOG_ENTRY_DATA(ple);
+    return LOG_ENTRY_DATA(LOG_DATA_ENTRY_AT(l_idx));
 }
 
 int64_t FilePersistLog::getHLCIndex(const HLC& rhlc) {
-    FPL_RDLOCK;
+    // the index supports lookups concurrent with append, so no lock is needed
     dbg_default_trace("getHLCIndex for hlc({0},{1})", rhlc.m_rtc_us, rhlc.m_logic);
-    struct hlc_index_entry skey(rhlc, 0);
-    auto key = this->hidx.upper_bound(skey);
-    FPL_UNLOCK;
+    int64_t idx = this->hidx.lookup(rhlc.m_rtc_us, rhlc.m_logic);
 
-    if(key != this->hidx.begin() && this->hidx.size() > 0) {
-        dbg_default_trace("getHLCIndex returns: hlc:({0},{1}),idx:{2}", key->hlc.m_rtc_us, key->hlc.m_logic, key->log_idx);
-        return key->log_idx;
+    if(idx != INVALID_INDEX) {
+        dbg_default_trace("getHLCIndex returns: idx:{0}", idx);
+        return idx;
     }
 
     // no object exists before the requested timestamp.
@@ -570,27 +734,14 @@ int64_t FilePersistLog::getHLCIndex(const HLC& rhlc) {
 
 const void* FilePersistLog::getEntry(const HLC& rhlc) {
     LogEntry* ple = nullptr;
-    //    unsigned __int128 key = ((((unsigned __int128)rhlc.m_rtc_us)<<64) | rhlc.m_logic);
-
-    FPL_RDLOCK;
 
     dbg_default_trace("getEntry for hlc({0},{1})", rhlc.m_rtc_us, rhlc.m_logic);
-    struct hlc_index_entry skey(rhlc, 0);
-    auto key = this->hidx.upper_bound(skey);
-    FPL_UNLOCK;
-
-#ifndef NDEBUG
+    int64_t idx = this->hidx.lookup(rhlc.m_rtc_us, rhlc.m_logic);
     dbg_default_trace("hidx.size = {}", this->hidx.size());
-    if(key == this->hidx.end())
-        dbg_default_trace("found upper bound = hidx.end()");
-    else
-        dbg_default_trace("found upper bound = hlc({},{}),idx{}", key->hlc.m_rtc_us, key->hlc.m_logic, key->log_idx);
-#endif  //NDEBUG
 
-    if(key != this->hidx.begin() && this->hidx.size() > 0) {
-        key--;
-        ple = LOG_ENTRY_AT(key->log_idx);
-        dbg_default_trace("getEntry returns: hlc:({0},{1}),idx:{2}", key->hlc.m_rtc_us, key->hlc.m_logic, key->log_idx);
+    if(idx != INVALID_INDEX) {
+        ple = LOG_ENTRY_AT(idx);
+        dbg_default_trace("getEntry returns: hlc:({0},{1}),idx:{2}", ple->fields.hlc_r, ple->fields.hlc_l, idx);
     }
 
     // no object exists before the requested timestamp.
@@ -600,7 +751,7 @@ const void* FilePersistLog::getEntry(const HLC& rhlc) {
 
     dbg_default_trace("{0} getEntry at ({1},{2})", this->m_sName, ple->fields.hlc_r, ple->fields.hlc_l);
 
-    return LOG_ENTRY_DATA(ple);
+    return LOG_ENTRY_DATA(LOG_DATA_ENTRY_AT(idx));
 }
 
 void FilePersistLog::processEntryAtVersion(version_t ver,
@@ -622,10 +773,18 @@ void FilePersistLog::processEntryAtVersion(version_t ver,
     FPL_UNLOCK;
 
     if(ple != nullptr && ple->fields.ver == ver) {
-        func(LOG_ENTRY_DATA(ple), static_cast<size_t>(ple->fields.sdlen - this->signature_size));
+        const LogEntry* pdata_entry = LOG_DATA_ENTRY_AT(l_idx);
+        func(LOG_ENTRY_DATA(pdata_entry), static_cast<size_t>(pdata_entry->fields.sdlen - this->signature_size - this->digest_size));
     }
 }
 
+int64_t FilePersistLog::do_trim_head(const int64_t idx) {
+    if(idx >= m_currMetaHeader.fields.tail) {
+        return idx;
+    }
+    return idx - LOG_ENTRY_AT(idx)->fields.ref_dist;
+}
+
 // trim by index
 void FilePersistLog::trimByIndex(int64_t idx) {
     dbg_default_trace("{0} trim at index: {1}", this->m_sName, idx);
@@ -645,7 +804,7 @@ void FilePersistLog::trimByIndex(int64_t idx) {
         FPL_PERS_UNLOCK;
         return;
     }
-    m_currMetaHeader.fields.head = idx + 1;
+    m_currMetaHeader.fields.head = do_trim_head(idx + 1);
     try {
         //What version number should be supplied to persist in this case?
         // CAUTION:
@@ -658,8 +817,8 @@ void FilePersistLog::trimByIndex(int64_t idx) {
         FPL_PERS_UNLOCK;
         throw e;
     }
-    //TODO: remove entry from index...this is tricky because HLC
-    // order does not agree with index order.
+    // HLC order and index order do not agree, so this scans the whole index.
+    this->hidx.retain(m_currMetaHeader.fields.head, m_currMetaHeader.fields.tail);
     FPL_UNLOCK;
     FPL_PERS_UNLOCK;
     // throw PERSIST_EXP_UNIMPLEMENTED;
@@ -763,12 +922,15 @@ int64_t FilePersistLog::getMinimumIndexBeyondVersion(version_t ver) {
 // 2) size_t writeLogEntryToByteArray(const LogEntry * ple, char * ba);
 // 3) size_t postLogEntry(const std::function<void (char const *const, std::size_t)> f, const LogEntry *ple);
 // 4) size_t mergeLogEntryFromByteArray(const char * ba);
+// An entry referring to the data of an entry before the first one sent carries
+// a copy of that data instead, so the receiver can always resolve the entries.
 size_t FilePersistLog::bytes_size(version_t ver) {
     size_t bsize = (sizeof(int64_t) + sizeof(int64_t));
     int64_t idx = this->getMinimumIndexBeyondVersion(ver);
     if(idx != INVALID_INDEX) {
+        const int64_t first_idx = idx;
         while(idx < m_currMetaHeader.fields.tail) {
-            bsize += byteSizeOfLogEntry(LOG_ENTRY_AT(idx));
+            bsize += byteSizeOfLogEntry(LOG_ENTRY_AT(idx), inlinedDataEntry(idx, first_idx));
             idx++;
         }
     }
@@ -779,7 +941,7 @@ size_t FilePersistLog::to_bytes(char* buf, version_t ver) {
     int64_t idx = this->getMinimumIndexBeyondVersion(ver);
     size_t ofst = 0;
     // latest_version
-    int64_t latest_version = this->getLatestVersion();
+    int64_t latest_version = (ver == LOG_TAIL_OMITTED) ? INVALID_VERSION : this->getLatestVersion();
     *(int64_t*)(buf + ofst) = latest_version;
     ofst += sizeof(int64_t);
     // nr_log_entry
@@ -787,8 +949,9 @@ size_t FilePersistLog::to_bytes(char* buf, version_t ver) {
     ofst += sizeof(int64_t);
     // log_entries
     if(idx != INVALID_INDEX) {
+        const int64_t first_idx = idx;
         while(idx < m_currMetaHeader.fields.tail) {
-            ofst += writeLogEntryToByteArray(LOG_ENTRY_AT(idx), buf + ofst);
+            ofst += writeLogEntryToByteArray(LOG_ENTRY_AT(idx), buf + ofst, inlinedDataEntry(idx, first_idx));
             idx++;
         }
     }
@@ -799,15 +962,16 @@ void FilePersistLog::post_object(const std::function<void(char const* const, std
                                  version_t ver) {
     int64_t idx = this->getMinimumIndexBeyondVersion(ver);
     // latest_version
-    int64_t latest_version = this->getLatestVersion();
+    int64_t latest_version = (ver == LOG_TAIL_OMITTED) ? INVALID_VERSION : this->getLatestVersion();
     f((char*)&latest_version, sizeof(int64_t));
     // nr_log_entry
     int64_t nr_log_entry = (idx == INVALID_INDEX) ? 0 : (m_currMetaHeader.fields.tail - idx);
     f((char*)&nr_log_entry, sizeof(int64_t));
     // log_entries
     if(idx != INVALID_INDEX) {
+        const int64_t first_idx = idx;
         while(idx < m_currMetaHeader.fields.tail) {
-            postLogEntry(f, LOG_ENTRY_AT(idx));
+            postLogEntry(f, LOG_ENTRY_AT(idx), inlinedDataEntry(idx, first_idx));
             idx++;
         }
     }
@@ -826,14 +990,50 @@ void FilePersistLog::applyLogTail(char const* v) {
         ofst += mergeLogEntryFromByteArray(v + ofst);
     }
     // update the latest version.
-    m_currMetaHeader.fields.ver = latest_version;
+    if(latest_version != INVALID_VERSION) {
+        m_currMetaHeader.fields.ver = latest_version;
+    }
+}
+
+void FilePersistLog::applyLogTail(const std::function<void(char*, std::size_t)>& read_bytes) {
+    // latest_version
+    int64_t latest_version;
+    read_bytes(reinterpret_cast<char*>(&latest_version), sizeof(int64_t));
+    // nr_log_entry
+    int64_t nr_log_entry;
+    read_bytes(reinterpret_cast<char*>(&nr_log_entry), sizeof(int64_t));
+    // log_entries, each read into the same buffer
+    std::vector<char> entry(sizeof(LogEntry));
+    while(nr_log_entry--) {
+        read_bytes(entry.data(), sizeof(LogEntry));
+        const uint64_t sdlen = reinterpret_cast<const LogEntry*>(entry.data())->fields.sdlen;
+        entry.resize(sizeof(LogEntry) + sdlen);
+        read_bytes(entry.data() + sizeof(LogEntry), sdlen);
+        mergeLogEntryFromByteArray(entry.data());
+    }
+    // update the latest version.
+    if(latest_version != INVALID_VERSION) {
+        m_currMetaHeader.fields.ver = latest_version;
+    }
 }
 
-size_t FilePersistLog::byteSizeOfLogEntry(const LogEntry* ple) {
-    return sizeof(LogEntry) + ple->fields.sdlen;
+const LogEntry* FilePersistLog::inlinedDataEntry(int64_t idx, int64_t first_idx) {
+    const LogEntry* ple = LOG_ENTRY_AT(idx);
+    if(ple->fields.ref_dist == 0 || idx - static_cast<int64_t>(ple->fields.ref_dist) >= first_idx) {
+        return nullptr;
+    }
+    return LOG_DATA_ENTRY_AT(idx);
+}
+
+size_t FilePersistLog::byteSizeOfLogEntry(const LogEntry* ple, const LogEntry* pdata_entry) {
+    size_t size = sizeof(LogEntry) + ple->fields.sdlen;
+    if(pdata_entry != nullptr) {
+        size += pdata_entry->fields.sdlen - signature_size - digest_size;
+    }
+    return size;
 }
 
-size_t FilePersistLog::writeLogEntryToByteArray(const LogEntry* ple, char* ba) {
+size_t FilePersistLog::writeLogEntryToByteArray(const LogEntry* ple, char* ba, const LogEntry* pdata_entry) {
     size_t nr_written = 0;
     memcpy(ba, ple, sizeof(LogEntry));
     nr_written += sizeof(LogEntry);
@@ -841,17 +1041,38 @@ size_t FilePersistLog::writeLogEntryToByteArray(const LogEntry* ple, char* ba) {
         memcpy((void*)(ba + nr_written), (void*)LOG_ENTRY_SIGNATURE(ple), ple->fields.sdlen);
         nr_written += ple->fields.sdlen;
     }
+    if(pdata_entry != nullptr) {
+        const uint64_t data_size = pdata_entry->fields.sdlen - signature_size - digest_size;
+        LogEntry* pcopy = reinterpret_cast<LogEntry*>(ba);
+        pcopy->fields.sdlen += data_size;
+        pcopy->fields.ref_dist = 0;
+        memcpy((void*)(ba + nr_written), LOG_ENTRY_DATA(pdata_entry), data_size);
+        nr_written += data_size;
+    }
     return nr_written;
 }
 
-size_t FilePersistLog::postLogEntry(const std::function<void(char const* const, std::size_t)>& f, const LogEntry* ple) {
+size_t FilePersistLog::postLogEntry(const std::function<void(char const* const, std::size_t)>& f,
+                                    const LogEntry* ple, const LogEntry* pdata_entry) {
     size_t nr_written = 0;
-    f((const char*)ple, sizeof(LogEntry));
+    if(pdata_entry != nullptr) {
+        LogEntry copy = *ple;
+        copy.fields.sdlen += pdata_entry->fields.sdlen - signature_size - digest_size;
+        copy.fields.ref_dist = 0;
+        f((const char*)&copy, sizeof(LogEntry));
+    } else {
+        f((const char*)ple, sizeof(LogEntry));
+    }
     nr_written += sizeof(LogEntry);
     if(ple->fields.sdlen > 0) {
         f((const char*)LOG_ENTRY_SIGNATURE(ple), ple->fields.sdlen);
         nr_written += ple->fields.sdlen;
     }
+    if(pdata_entry != nullptr) {
+        const uint64_t data_size = pdata_entry->fields.sdlen - signature_size - digest_size;
+        f((const char*)LOG_ENTRY_DATA(pdata_entry), data_size);
+        nr_written += data_size;
+    }
     return nr_written;
 }
 
@@ -868,15 +1089,39 @@ size_t FilePersistLog::mergeLogEntryFromByteArray(const char* ba) {
         dbg_default_trace("{0} failed to merge log entry, we don't empty log entry.", __func__);
         throw PERSIST_EXP_NOSPACE_LOG;
     }
-    if(NUM_FREE_BYTES < cple->fields.sdlen) {
-        dbg_default_trace("{0} failed to merge log entry, we need {1} bytes data space, but we have only {2} bytes.", __func__, cple->fields.sdlen, NUM_FREE_BYTES);
+    // 2) an entry referring to earlier data refers to the same entry here,
+    // since both logs have an entry for every version before it.
+    uint64_t ref_dist = cple->fields.ref_dist;
+    const LogEntry* pdata_entry = nullptr;
+    if(ref_dist > 0) {
+        const int64_t ref_idx = m_currMetaHeader.fields.tail - static_cast<int64_t>(ref_dist);
+        if(ref_idx < m_currMetaHeader.fields.head) {
+            dbg_default_error("{0} failed to merge log entry version {1}, its data at index {2} is not in the log.",
+                              __func__, cple->fields.ver, ref_idx);
+            throw PERSIST_EXP_INV_ENTRY_IDX(ref_idx);
+        }
+        ref_dist += LOG_ENTRY_AT(ref_idx)->fields.ref_dist;
+        // too far back to refer to here, so the entry gets a copy of the data
+        if(ref_dist > MAX_REF_DIST) {
+            pdata_entry = LOG_ENTRY_AT(m_currMetaHeader.fields.tail - static_cast<int64_t>(ref_dist));
+        }
+    }
+    const uint64_t data_size = (pdata_entry == nullptr) ? 0 : pdata_entry->fields.sdlen - signature_size - digest_size;
+    if(NUM_FREE_BYTES < cple->fields.sdlen + data_size) {
+        dbg_default_trace("{0} failed to merge log entry, we need {1} bytes data space, but we have only {2} bytes.", __func__, cple->fields.sdlen + data_size, NUM_FREE_BYTES);
         throw PERSIST_EXP_NOSPACE_DATA;
     }
-    // 2) merge it!
+    // 3) merge it!
     memcpy(NEXT_DATA, (const void*)(ba + sizeof(LogEntry)), cple->fields.sdlen);
+    if(pdata_entry != nullptr) {
+        memcpy(reinterpret_cast<char*>(NEXT_DATA) + cple->fields.sdlen, LOG_ENTRY_DATA(pdata_entry), data_size);
+        ref_dist = 0;
+    }
     memcpy(NEXT_LOG_ENTRY, cple, sizeof(LogEntry));
     NEXT_LOG_ENTRY->fields.ofst = NEXT_DATA_OFST;
-    this->hidx.insert(hlc_index_entry{HLC{cple->fields.hlc_r, cple->fields.hlc_l}, m_currMetaHeader.fields.tail});
+    NEXT_LOG_ENTRY->fields.sdlen = cple->fields.sdlen + data_size;
+    NEXT_LOG_ENTRY->fields.ref_dist = ref_dist;
+    this->hidx.insert(cple->fields.hlc_r, cple->fields.hlc_l, m_currMetaHeader.fields.tail);
     m_currMetaHeader.fields.tail++;
     m_currMetaHeader.fields.ver = cple->fields.ver;
     dbg_default_trace("{0} merge log:log entry and meta data are updated.", __func__);
@@ -966,6 +1211,8 @@ void FilePersistLog::truncate(version_t ver) {
     }
     if(m_currMetaHeader.fields.ver > ver)
         m_currMetaHeader.fields.ver = ver;
+    // the truncated indexes will be reused by later entries
+    this->hidx.retain(m_currMetaHeader.fields.head, m_currMetaHeader.fields.tail);
     // STEP 3: update PERSISTENT STATE
     FPL_PERS_LOCK;
     try {
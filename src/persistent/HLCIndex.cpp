@@ -0,0 +1,202 @@
+#include <derecho/persistent/detail/HLCIndex.hpp>
+#include <derecho/persistent/detail/PersistLog.hpp>
+
+#include <algorithm>
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace persistent {
+
+HLCIndex::HLCIndex() noexcept(true)
+        : m_pSlots(nullptr),
+          m_iCapacity(0),
+          m_iSize(0),
+          m_iSeq(0) {
+}
+
+HLCIndex::~HLCIndex() noexcept(true) {
+    if(m_pSlots != nullptr) {
+        munmap(m_pSlots, m_iCapacity * sizeof(Slot));
+    }
+}
+
+void HLCIndex::reserve(std::size_t capacity) {
+    if(m_pSlots != nullptr || capacity == 0) {
+        return;
+    }
+    // The pages are only backed by memory once an entry is written to them.
+    void* addr = mmap(nullptr, capacity * sizeof(Slot), PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(addr == MAP_FAILED) {
+        throw PERSIST_EXP_MMAP_FILE(errno);
+    }
+    m_pSlots = static_cast<Slot*>(addr);
+    m_iCapacity = capacity;
+}
+
+std::size_t HLCIndex::upper_bound(uint64_t rtc_us, uint64_t logic, std::size_t n) const {
+    std::size_t lo = 0, hi = n;
+    while(lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        if(less(rtc_us, logic,
+                m_pSlots[mid].rtc_us.load(std::memory_order_relaxed),
+                m_pSlots[mid].logic.load(std::memory_order_relaxed))) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+void HLCIndex::store(std::size_t pos, uint64_t rtc_us, uint64_t logic, int64_t log_idx) {
+    m_pSlots[pos].rtc_us.store(rtc_us, std::memory_order_relaxed);
+    m_pSlots[pos].logic.store(logic, std::memory_order_relaxed);
+    m_pSlots[pos].log_idx.store(log_idx, std::memory_order_relaxed);
+}
+
+void HLCIndex::begin_write() {
+    m_iSeq.store(m_iSeq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void HLCIndex::end_write() {
+    m_iSeq.store(m_iSeq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void HLCIndex::release_pages_after(std::size_t n) {
+    const std::size_t page_size = sysconf(_SC_PAGESIZE);
+    const std::size_t start = ((n * sizeof(Slot) + page_size - 1) / page_size) * page_size;
+    const std::size_t end = ((m_iCapacity * sizeof(Slot)) / page_size) * page_size;
+    if(start < end) {
+        // Lookups that raced with the update may still read these slots; they
+        // see zeroes and retry because the sequence number changed.
+        madvise(reinterpret_cast<char*>(m_pSlots) + start, end - start, MADV_DONTNEED);
+    }
+}
+
+bool HLCIndex::insert(uint64_t rtc_us, uint64_t logic, int64_t log_idx) {
+    const std::size_t n = m_iSize.load(std::memory_order_relaxed);
+    if(n == m_iCapacity) {
+        throw PERSIST_EXP_NOSPACE_LOG;
+    }
+    const std::size_t pos = upper_bound(rtc_us, logic, n);
+    if(pos > 0
+       && m_pSlots[pos - 1].rtc_us.load(std::memory_order_relaxed) == rtc_us
+       && m_pSlots[pos - 1].logic.load(std::memory_order_relaxed) == logic) {
+        return false;
+    }
+    if(pos == n) {
+        // in order: the new slot is invisible to lookups until the size is published
+        store(n, rtc_us, logic, log_idx);
+        m_iSize.store(n + 1, std::memory_order_release);
+        return true;
+    }
+    // out of order: shift the later entries, which are usually few
+    begin_write();
+    for(std::size_t i = n; i > pos; i--) {
+        store(i,
+              m_pSlots[i - 1].rtc_us.load(std::memory_order_relaxed),
+              m_pSlots[i - 1].logic.load(std::memory_order_relaxed),
+              m_pSlots[i - 1].log_idx.load(std::memory_order_relaxed));
+    }
+    store(pos, rtc_us, logic, log_idx);
+    m_iSize.store(n + 1, std::memory_order_relaxed);
+    end_write();
+    return true;
+}
+
+void HLCIndex::retain(int64_t min_idx, int64_t max_idx) {
+    const std::size_t n = m_iSize.load(std::memory_order_relaxed);
+    std::size_t first_dropped = 0;
+    while(first_dropped < n) {
+        int64_t idx = m_pSlots[first_dropped].log_idx.load(std::memory_order_relaxed);
+        if(idx < min_idx || idx >= max_idx) {
+            break;
+        }
+        first_dropped++;
+    }
+    if(first_dropped == n) {
+        return;
+    }
+    begin_write();
+    std::size_t kept = first_dropped;
+    for(std::size_t i = first_dropped + 1; i < n; i++) {
+        int64_t idx = m_pSlots[i].log_idx.load(std::memory_order_relaxed);
+        if(idx >= min_idx && idx < max_idx) {
+            store(kept++,
+                  m_pSlots[i].rtc_us.load(std::memory_order_relaxed),
+                  m_pSlots[i].logic.load(std::memory_order_relaxed),
+                  idx);
+        }
+    }
+    m_iSize.store(kept, std::memory_order_relaxed);
+    end_write();
+    release_pages_after(kept);
+}
+
+void HLCIndex::rebuild(std::vector<hlc_index_entry>& entries) {
+    auto entry_less = [](const hlc_index_entry& e1, const hlc_index_entry& e2) {
+        return less(e1.rtc_us, e1.logic, e2.rtc_us, e2.logic);
+    };
+    if(!std::is_sorted(entries.begin(), entries.end(), entry_less)) {
+        // stable, so that the first of several entries with the same timestamp is kept
+        std::stable_sort(entries.begin(), entries.end(), entry_less);
+    }
+    entries.erase(std::unique(entries.begin(), entries.end(),
+                              [](const hlc_index_entry& e1, const hlc_index_entry& e2) {
+                                  return e1.rtc_us == e2.rtc_us && e1.logic == e2.logic;
+                              }),
+                  entries.end());
+    if(entries.size() > m_iCapacity) {
+        throw PERSIST_EXP_NOSPACE_LOG;
+    }
+    begin_write();
+    for(std::size_t i = 0; i < entries.size(); i++) {
+        store(i, entries[i].rtc_us, entries[i].logic, entries[i].log_idx);
+    }
+    m_iSize.store(entries.size(), std::memory_order_relaxed);
+    end_write();
+    release_pages_after(entries.size());
+}
+
+int64_t HLCIndex::lookup(uint64_t rtc_us, uint64_t logic) const {
+    while(true) {
+        const uint64_t seq_before = m_iSeq.load(std::memory_order_acquire);
+        if(seq_before & 1) {
+            continue;
+        }
+        const std::size_t n = m_iSize.load(std::memory_order_acquire);
+        const std::size_t pos = upper_bound(rtc_us, logic, std::min(n, m_iCapacity));
+        const int64_t log_idx = (pos == 0) ? INVALID_INDEX
+                                           : m_pSlots[pos - 1].log_idx.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(m_iSeq.load(std::memory_order_relaxed) == seq_before) {
+            return log_idx;
+        }
+    }
+}
+
+std::vector<hlc_index_entry> HLCIndex::snapshot() const {
+    std::vector<hlc_index_entry> entries;
+    while(true) {
+        const uint64_t seq_before = m_iSeq.load(std::memory_order_acquire);
+        if(seq_before & 1) {
+            continue;
+        }
+        const std::size_t n = std::min(m_iSize.load(std::memory_order_acquire), m_iCapacity);
+        entries.resize(n);
+        for(std::size_t i = 0; i < n; i++) {
+            entries[i] = hlc_index_entry{m_pSlots[i].rtc_us.load(std::memory_order_relaxed),
+                                         m_pSlots[i].logic.load(std::memory_order_relaxed),
+                                         m_pSlots[i].log_idx.load(std::memory_order_relaxed)};
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(m_iSeq.load(std::memory_order_relaxed) == seq_before) {
+            return entries;
+        }
+    }
+}
+
+}  // namespace persistent
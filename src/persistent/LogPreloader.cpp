@@ -0,0 +1,238 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/persistent/detail/FilePersistLog.hpp>
+#include <derecho/persistent/detail/LogPreloader.hpp>
+#include <derecho/persistent/Persistent.hpp>
+#include <derecho/persistent/detail/SegmentedPersistLog.hpp>
+#include <derecho/persistent/detail/util.hpp>
+#include <derecho/utils/logger.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <dirent.h>
+#include <exception>
+#include <fcntl.h>
+#include <functional>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+
+namespace persistent {
+
+std::mutex LogPreloader::preloaded_logs_mutex;
+std::map<std::string, LogPreloader::PreloadedLog> LogPreloader::preloaded_logs;
+std::vector<LogPreloader::LoadReport> LogPreloader::load_reports;
+std::atomic<bool> LogPreloader::deferring_restores{false};
+std::vector<std::pair<PersistentRegistry*, std::string>> LogPreloader::deferred_restores;
+
+// run task(0) ... task(count - 1) on up to PERS/load_threads threads, including this one
+static std::size_t runOnPool(std::size_t count, const std::function<void(std::size_t)>& task) {
+    std::size_t num_threads = derecho::getConfUInt32(CONF_PERS_LOAD_THREADS);
+    if(num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::min(num_threads, count);
+    std::atomic<std::size_t> next_task{0};
+    auto run_tasks = [&]() {
+        std::size_t i;
+        while((i = next_task++) < count) {
+            task(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    for(std::size_t t = 1; t < num_threads; t++) {
+        threads.emplace_back(run_tasks);
+    }
+    run_tasks();
+    for(auto& thread : threads) {
+        thread.join();
+    }
+    return num_threads;
+}
+
+// read the flags in the meta header of a log, 0 if it cannot be read
+static uint64_t readMetaFlags(const std::string& meta_file) {
+    MetaHeader header;
+    int fd = open(meta_file.c_str(), O_RDONLY);
+    if(fd == -1) {
+        return 0;
+    }
+    ssize_t nRead = read(fd, &header, sizeof(header));
+    close(fd);
+    return nRead == sizeof(header) ? header.fields.flags : 0;
+}
+
+std::size_t LogPreloader::preload(const std::vector<std::string>& prefixes) {
+    // STEP 1: find the logs, by their meta files
+    std::vector<std::pair<std::string, bool>> logs;
+    DIR* dir = opendir(getPersFilePath().c_str());
+    if(dir == NULL) {
+        // no log has been created yet.
+        return 0;
+    }
+    const std::string suffix = "." META_FILE_SUFFIX;
+    struct dirent* dent;
+    while((dent = readdir(dir)) != NULL) {
+        const std::string file_name(dent->d_name);
+        if(file_name.length() <= suffix.length()
+           || file_name.compare(file_name.length() - suffix.length(), suffix.length(), suffix) != 0) {
+            continue;
+        }
+        for(const auto& prefix : prefixes) {
+            // the name of a log is its subgroup prefix, a '-' and the rest
+            if(file_name.length() > prefix.length() && file_name[prefix.length()] == '-'
+               && file_name.compare(0, prefix.length(), prefix) == 0) {
+                const std::string log_name = file_name.substr(0, file_name.length() - suffix.length());
+                const uint64_t flags = readMetaFlags(getPersFilePath() + "/" + file_name);
+                if(flags & META_FLAG_VALID) {
+                    logs.emplace_back(log_name, (flags & META_FLAG_SIGNATURES) != 0);
+                } else {
+                    dbg_default_debug("LogPreloader: log {} does not record its signature setting", log_name);
+                }
+                break;
+            }
+        }
+    }
+    closedir(dir);
+    if(logs.empty()) {
+        return 0;
+    }
+
+    // STEP 2: load them on a thread pool
+    const bool segmented = derecho::getConfUInt64(CONF_PERS_SEGMENT_SIZE) > 0;
+    std::vector<std::unique_ptr<PersistLog>> loaded(logs.size());
+    std::vector<LoadReport> reports(logs.size());
+    auto load_log = [&](std::size_t i) {
+        const auto start_time = std::chrono::steady_clock::now();
+        try {
+            if(segmented) {
+                loaded[i] = std::make_unique<SegmentedPersistLog>(logs[i].first, logs[i].second);
+            } else {
+                loaded[i] = std::make_unique<FilePersistLog>(logs[i].first, logs[i].second);
+            }
+            // fault in the latest state, which the owner deserializes first
+            const int64_t latest_index = loaded[i]->getLatestIndex();
+            if(latest_index != INVALID_INDEX) {
+                loaded[i]->processEntryAtVersion(
+                        loaded[i]->getLatestVersion(),
+                        [](const void* pdata, std::size_t size) {
+                            const volatile char* bytes = static_cast<const volatile char*>(pdata);
+                            for(std::size_t ofst = 0; ofst < size; ofst += getpagesize()) {
+                                (void)bytes[ofst];
+                            }
+                        });
+            }
+        } catch(uint64_t e) {
+            dbg_default_warn("LogPreloader failed to load log {}, exception:{:x}", logs[i].first, e);
+            loaded[i].reset();
+            return;
+        }
+        reports[i] = {logs[i].first, loaded[i]->getLength(),
+                      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count()};
+    };
+    const auto start_time = std::chrono::steady_clock::now();
+    const std::size_t num_threads = runOnPool(logs.size(), load_log);
+    const double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+
+    // STEP 3: keep them for their owners
+    std::size_t num_loaded = 0;
+    std::lock_guard<std::mutex> lock(preloaded_logs_mutex);
+    load_reports.clear();
+    for(std::size_t i = 0; i < logs.size(); i++) {
+        if(!loaded[i]) {
+            continue;
+        }
+        dbg_default_info("LogPreloader loaded log {} ({} entries) in {} ms",
+                         reports[i].name, reports[i].num_entries, reports[i].load_ms);
+        preloaded_logs[logs[i].first] = {logs[i].second, std::move(loaded[i])};
+        load_reports.emplace_back(std::move(reports[i]));
+        num_loaded++;
+    }
+    dbg_default_info("LogPreloader loaded {} logs with {} threads in {} ms", num_loaded, num_threads, total_ms);
+    return num_loaded;
+}
+
+std::unique_ptr<PersistLog> LogPreloader::take(const std::string& name, bool enable_signatures) {
+    std::lock_guard<std::mutex> lock(preloaded_logs_mutex);
+    auto it = preloaded_logs.find(name);
+    if(it == preloaded_logs.end()) {
+        return nullptr;
+    }
+    std::unique_ptr<PersistLog> log;
+    if(it->second.enable_signatures == enable_signatures) {
+        log = std::move(it->second.log);
+    } else {
+        // the signature size is fixed when a log is constructed
+        dbg_default_debug("LogPreloader: log {} was preloaded with a different signature setting", name);
+    }
+    preloaded_logs.erase(it);
+    return log;
+}
+
+void LogPreloader::clear() {
+    std::lock_guard<std::mutex> lock(preloaded_logs_mutex);
+    preloaded_logs.clear();
+}
+
+std::vector<LogPreloader::LoadReport> LogPreloader::getLoadReports() {
+    std::lock_guard<std::mutex> lock(preloaded_logs_mutex);
+    return load_reports;
+}
+
+void LogPreloader::deferRestores(bool defer) {
+    deferring_restores = defer;
+}
+
+bool LogPreloader::isDeferringRestores() {
+    return deferring_restores;
+}
+
+void LogPreloader::addDeferredRestore(PersistentRegistry* registry, const std::string& name) {
+    std::lock_guard<std::mutex> lock(preloaded_logs_mutex);
+    deferred_restores.emplace_back(registry, name);
+}
+
+void LogPreloader::cancelDeferredRestore(PersistentRegistry* registry, const std::string& name) {
+    std::lock_guard<std::mutex> lock(preloaded_logs_mutex);
+    deferred_restores.erase(std::remove(deferred_restores.begin(), deferred_restores.end(),
+                                        std::make_pair(registry, name)),
+                            deferred_restores.end());
+}
+
+void LogPreloader::finishRestores() {
+    std::vector<PersistentObject*> objects;
+    {
+        std::lock_guard<std::mutex> lock(preloaded_logs_mutex);
+        // the objects may have moved since they were recorded; the registry knows where they are now
+        for(const auto& restore : deferred_restores) {
+            PersistentObject* object = restore.first->getPersistent(restore.second);
+            if(object != nullptr) {
+                objects.push_back(object);
+            }
+        }
+        deferred_restores.clear();
+    }
+    if(objects.empty()) {
+        return;
+    }
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    const auto start_time = std::chrono::steady_clock::now();
+    const std::size_t num_threads = runOnPool(objects.size(), [&](std::size_t i) {
+        try {
+            objects[i]->finishRestore();
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if(!error) {
+                error = std::current_exception();
+            }
+        }
+    });
+    dbg_default_info("LogPreloader restored {} objects with {} threads in {} ms", objects.size(), num_threads,
+                     std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count());
+    if(error) {
+        std::rethrow_exception(error);
+    }
+}
+
+}  // namespace persistent
@@ -1,3 +1,4 @@
+#include <derecho/openssl/hash.hpp>
 #include <derecho/openssl/signature.hpp>
 #include <derecho/persistent/detail/PersistLog.hpp>
 #include <derecho/persistent/detail/util.hpp>
@@ -9,7 +10,10 @@ PersistLog::PersistLog(const std::string& name, bool enable_signatures) noexcept
         : m_sName(name),
           signature_size(enable_signatures
                                  ? openssl::EnvelopeKey::from_pem_private(derecho::getConfString(CONF_PERS_PRIVATE_KEY_FILE)).get_max_size()
-                                 : 0) {
+                                 : 0),
+          digest_size((enable_signatures && derecho::getConfBoolean(CONF_PERS_BATCH_SIGNATURES))
+                              ? openssl::Hasher(openssl::DigestAlgorithm::SHA256).get_hash_size()
+                              : 0) {
 }
 
 PersistLog::~PersistLog() noexcept(true) {
@@ -18,8 +22,8 @@ PersistLog::~PersistLog() noexcept(true) {
 #ifndef NDEBUG
 void PersistLog::dump_hidx() {
     dbg_default_trace("number of entry in hidx:{}.log_len={}.", hidx.size(), getLength());
-    for(auto itr = hidx.cbegin(); itr != hidx.cend(); itr++) {
-        dbg_default_trace("hlc({0},{1})->idx({2})", itr->hlc.m_rtc_us, itr->hlc.m_logic, itr->log_idx);
+    for(const auto& entry : hidx.snapshot()) {
+        dbg_default_trace("hlc({0},{1})->idx({2})", entry.rtc_us, entry.logic, entry.log_idx);
     }
 }
 #endif  //DERECHO_DEBUG
@@ -53,7 +53,23 @@ void PersistentRegistry::initializeLastSignature(version_t version,
     }
 }
 
+void PersistentRegistry::initializeLastDigest(version_t version,
+                                              const unsigned char* digest, std::size_t digest_size) {
+    if(digest_size != m_lastDigest.size()) {
+        //The "genesis digest" is all zeroes, like the genesis signature
+        m_lastDigest.assign(digest_size, 0);
+    }
+    //initializeLastSignature() has already moved m_lastSignedVersion to the latest version
+    if(digest_size > 0 && version != INVALID_VERSION && version == m_lastSignedVersion) {
+        memcpy(m_lastDigest.data(), digest, digest_size);
+    }
+}
+
 void PersistentRegistry::sign(version_t latest_version, openssl::Signer& signer, unsigned char* signature_buffer) {
+    if(!m_lastDigest.empty()) {
+        signBatch(latest_version, signer, signature_buffer);
+        return;
+    }
     for(version_t version = m_lastSignedVersion + 1; version <= latest_version; ++version) {
         signer.init();
         std::size_t bytes_signed = 0;
@@ -77,6 +93,45 @@ void PersistentRegistry::sign(version_t latest_version, openssl::Signer& signer,
     }
 }
 
+void PersistentRegistry::signBatch(version_t latest_version, openssl::Signer& signer, unsigned char* signature_buffer) {
+    const std::size_t digest_size = m_lastDigest.size();
+    openssl::Hasher hasher(openssl::DigestAlgorithm::SHA256);
+    //The versions in this batch, each with the previous version in the chain, and their digests
+    std::vector<std::pair<version_t, version_t>> batch_versions;
+    std::vector<unsigned char> batch_digests;
+    for(version_t version = m_lastSignedVersion + 1; version <= latest_version; ++version) {
+        hasher.init();
+        std::size_t bytes_hashed = 0;
+        for(auto& field : m_registry) {
+            bytes_hashed += field.second->updateHash(version, hasher);
+        }
+        if(bytes_hashed == 0) {
+            //If this version did not exist in any field, there's nothing to hash
+            continue;
+        }
+        hasher.add_bytes(m_lastDigest.data(), digest_size);
+        hasher.finalize(m_lastDigest.data());
+        batch_versions.emplace_back(version, m_lastSignedVersion);
+        batch_digests.insert(batch_digests.end(), m_lastDigest.begin(), m_lastDigest.end());
+        m_lastSignedVersion = version;
+    }
+    if(batch_versions.empty()) {
+        return;
+    }
+    //One signature over the digest of the last version covers the whole batch
+    signer.init();
+    signer.add_bytes(m_lastDigest.data(), digest_size);
+    signer.finalize(signature_buffer);
+    dbg_default_debug("PersistentRegistry: Adding signature on version {} to a batch of {} versions", m_lastSignedVersion, batch_versions.size());
+    for(std::size_t i = 0; i < batch_versions.size(); ++i) {
+        for(auto& field : m_registry) {
+            field.second->addSignature(batch_versions[i].first, signature_buffer, batch_versions[i].second);
+            field.second->addDigest(batch_versions[i].first, &batch_digests[i * digest_size], m_lastSignedVersion);
+        }
+    }
+    memcpy(m_lastSignature.data(), signature_buffer, m_lastSignature.size());
+}
+
 bool PersistentRegistry::getSignature(version_t version, unsigned char* signature_buffer) {
     version_t previous_signed_version;
     for(auto& field : m_registry) {
@@ -92,6 +147,9 @@ bool PersistentRegistry::verify(version_t version, openssl::Verifier& verifier,
     if(m_registry.empty()) {
         return true;
     }
+    if(!m_lastDigest.empty()) {
+        return verifyBatch(version, verifier, signature);
+    }
     dbg_default_debug("PersistentRegistry: Verifying signature on version {}", version);
     verifier.init();
     for(auto& field : m_registry) {
@@ -120,6 +178,55 @@ bool PersistentRegistry::verify(version_t version, openssl::Verifier& verifier,
     return verifier.finalize(signature, signature_size);
 }
 
+bool PersistentRegistry::verifyBatch(version_t version, openssl::Verifier& verifier, const unsigned char* signature) {
+    dbg_default_debug("PersistentRegistry: Verifying batched signature on version {}", version);
+    const std::size_t signature_size = verifier.get_max_signature_size();
+    const std::size_t digest_size = m_lastDigest.size();
+    unsigned char local_sig[signature_size];
+    std::vector<unsigned char> digest(digest_size, 0);
+    version_t prev_version = INVALID_VERSION;
+    version_t signed_version = INVALID_VERSION;
+    bool found = false;
+    //Find a field that has this version, and start from the digest of the previous version in the chain
+    for(auto& field : m_registry) {
+        if(field.second->getSignature(version, local_sig, prev_version)
+           && field.second->getDigest(version, digest.data(), signed_version)) {
+            if(prev_version == INVALID_VERSION) {
+                std::fill(digest.begin(), digest.end(), 0);
+            } else {
+                version_t dummy;
+                field.second->getDigest(prev_version, digest.data(), dummy);
+            }
+            found = true;
+            break;
+        }
+    }
+    if(!found) {
+        return false;
+    }
+    //A signature taken from this log for a version inside a batch signs the last version of the batch
+    version_t last_version = version;
+    if(signed_version > version && memcmp(local_sig, signature, signature_size) == 0) {
+        last_version = signed_version;
+    }
+    openssl::Hasher hasher(openssl::DigestAlgorithm::SHA256);
+    for(version_t cur_version = version; cur_version <= last_version; ++cur_version) {
+        hasher.init();
+        std::size_t bytes_hashed = 0;
+        for(auto& field : m_registry) {
+            bytes_hashed += field.second->updateHash(cur_version, hasher);
+        }
+        if(bytes_hashed == 0) {
+            continue;
+        }
+        hasher.add_bytes(digest.data(), digest_size);
+        hasher.finalize(digest.data());
+    }
+    verifier.init();
+    verifier.add_bytes(digest.data(), digest_size);
+    return verifier.finalize(signature, signature_size);
+}
+
 void PersistentRegistry::persist(version_t latest_version) {
     for(auto& entry : m_registry) {
         entry.second->persist(latest_version);
@@ -180,6 +287,43 @@ void PersistentRegistry::unregisterPersistent(const std::string& obj_name) {
     // this->_registry.erase(std::hash<std::string>{}(obj_name));
 }
 
+std::size_t PersistentRegistry::getLogTailsSize(version_t ver) {
+    std::size_t size = sizeof(std::size_t);
+    for(auto& entry : m_registry) {
+        size += sizeof(entry.first) + entry.second->logTailSize(ver);
+    }
+    return size;
+}
+
+void PersistentRegistry::postLogTails(version_t ver, const std::function<void(char const* const, std::size_t)>& f) {
+    const std::size_t num_fields = m_registry.size();
+    f(reinterpret_cast<const char*>(&num_fields), sizeof(num_fields));
+    for(auto& entry : m_registry) {
+        f(reinterpret_cast<const char*>(&entry.first), sizeof(entry.first));
+        entry.second->postLogTail(f, ver);
+    }
+}
+
+void PersistentRegistry::applyLogTails(const std::function<void(char*, std::size_t)>& read_bytes) {
+    std::size_t num_fields;
+    read_bytes(reinterpret_cast<char*>(&num_fields), sizeof(num_fields));
+    while(num_fields--) {
+        std::size_t key;
+        read_bytes(reinterpret_cast<char*>(&key), sizeof(key));
+        auto search = m_registry.find(key);
+        if(search == m_registry.end()) {
+            dbg_default_error("PersistentRegistry: No Persistent field has the name hash {} of a received log tail", key);
+            throw PERSIST_EXP_INV_OBJNAME;
+        }
+        search->second->applyLogTail(read_bytes);
+    }
+}
+
+PersistentObject* PersistentRegistry::getPersistent(const std::string& obj_name) {
+    auto search = this->m_registry.find(std::hash<std::string>{}(obj_name));
+    return search == this->m_registry.end() ? nullptr : search->second;
+}
+
 void PersistentRegistry::updateTemporalFrontierProvider(ITemporalQueryFrontierProvider* tqfp) {
     this->m_temporalQueryFrontierProvider = tqfp;
 }
@@ -0,0 +1,1434 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/persistent/detail/SegmentedPersistLog.hpp>
+#include <derecho/persistent/detail/util.hpp>
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#ifdef HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#if __GNUC__ > 7
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#include <experimental/filesystem>
+namespace fs = std::experimental::filesystem;
+#endif
+
+using namespace std;
+
+namespace persistent {
+
+/////////////////////////
+// internal structures //
+/////////////////////////
+
+// read exactly len bytes at offset ofst of a file
+static void preadFully(int fd, void* buf, size_t len, off_t ofst) {
+    size_t nread = 0;
+    while(nread < len) {
+        ssize_t ret = pread(fd, static_cast<char*>(buf) + nread, len - nread, ofst + nread);
+        if(ret <= 0) {
+            throw PERSIST_EXP_READ_FILE(errno);
+        }
+        nread += ret;
+    }
+}
+
+// the segment files of a log in a directory, by segment number
+static vector<pair<uint64_t, string>> listSegmentFiles(const string& dataPath, const string& name) {
+    vector<pair<uint64_t, string>> files;
+    const string prefix = name + ".";
+    const string suffix = "." SEGMENT_FILE_SUFFIX;
+    if(!fs::exists(dataPath)) {
+        return files;
+    }
+    for(const auto& dent : fs::directory_iterator(dataPath)) {
+        const string fname = dent.path().filename().string();
+        if(fname.size() <= prefix.size() + suffix.size()
+           || fname.compare(0, prefix.size(), prefix) != 0
+           || fname.compare(fname.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        const string number = fname.substr(prefix.size(), fname.size() - prefix.size() - suffix.size());
+        if(number.find_first_not_of("0123456789") != string::npos) {
+            continue;
+        }
+        files.emplace_back(stoull(number), dent.path().string());
+    }
+    sort(files.begin(), files.end());
+    return files;
+}
+
+static uint64_t roundUpToPage(uint64_t size) {
+    const uint64_t page_size = getpagesize();
+    return (size + page_size - 1) / page_size * page_size;
+}
+
+////////////////////////
+// visible to outside //
+////////////////////////
+
+SegmentedPersistLog::SegmentedPersistLog(const string& name, const string& dataPath, bool enableSignatures)
+        : PersistLog(name, enableSignatures),
+          m_sDataPath(dataPath),
+          m_sMetaFile(dataPath + "/" + name + "." + META_FILE_SUFFIX),
+          m_sColdPath(derecho::getConfString(CONF_PERS_COLD_PATH)),
+          m_iSegmentSize(roundUpToPage(derecho::getConfUInt64(CONF_PERS_SEGMENT_SIZE) > 0
+                                               ? derecho::getConfUInt64(CONF_PERS_SEGMENT_SIZE)
+                                               : DEFAULT_SEGMENT_SIZE)),
+          m_iSegmentEntries(std::max(derecho::getConfUInt64(CONF_PERS_SEGMENT_LOG_ENTRY), (uint64_t)1)),
+          m_iMaxLogEntry(derecho::getConfUInt64(CONF_PERS_MAX_LOG_ENTRY)),
+          m_bCompressCold(derecho::getConfBoolean(CONF_PERS_COMPRESS_COLD_SEGMENTS)),
+          m_iMaxMappedSegments(derecho::getConfUInt64(CONF_PERS_MAX_MAPPED_SEGMENTS)),
+          m_iNumMapped(0),
+          m_iMapClock(0),
+          m_iNextSegmentNumber(0),
+          m_iReservedOfst(-1),
+          m_iReservedSize(0) {
+    if(pthread_rwlock_init(&this->m_rwlock, NULL) != 0) {
+        throw PERSIST_EXP_RWLOCK_INIT(errno);
+    }
+    if(pthread_mutex_init(&this->m_perslock, NULL) != 0) {
+        throw PERSIST_EXP_MUTEX_INIT(errno);
+    }
+#ifndef HAS_ZLIB
+    if(m_bCompressCold) {
+        dbg_default_warn("{0}: built without zlib, segments moved to {1} will not be compressed.",
+                         name, m_sColdPath);
+    }
+#endif
+    this->hidx.reserve(m_iMaxLogEntry);
+    dbg_default_trace("{0} constructor: before load()", name);
+    if(derecho::getConfBoolean(CONF_PERS_RESET)) {
+        reset();
+    }
+    load();
+    dbg_default_trace("{0} constructor: after load()", name);
+}
+
+void SegmentedPersistLog::reset() {
+    dbg_default_trace("{0} reset state...begin", this->m_sName);
+    if(fs::exists(this->m_sMetaFile)) {
+        if(!fs::remove(this->m_sMetaFile)) {
+            dbg_default_error("{0} reset failed to remove the file:{1}", this->m_sName, this->m_sMetaFile);
+            throw PERSIST_EXP_REMOVE_FILE(errno);
+        }
+    }
+    for(const auto& segment_file : listSegmentFiles(this->m_sDataPath, this->m_sName)) {
+        if(!fs::remove(segment_file.second)) {
+            dbg_default_error("{0} reset failed to remove the file:{1}", this->m_sName, segment_file.second);
+            throw PERSIST_EXP_REMOVE_FILE(errno);
+        }
+    }
+    dbg_default_trace("{0} reset state...done", this->m_sName);
+}
+
+void SegmentedPersistLog::load() {
+    dbg_default_trace("{0}:load state...begin", this->m_sName);
+    const auto start_time = std::chrono::steady_clock::now();
+    // STEP 0: check if data path exists
+    checkOrCreateDir(this->m_sDataPath);
+    // STEP 1: load or initialize the meta header
+    bool bCreate = checkOrCreateFileWithSize(this->m_sMetaFile, META_SIZE);
+    FPL_WRLOCK;
+    FPL_PERS_LOCK;
+    try {
+        if(bCreate) {
+            m_currMetaHeader.fields.head = 0ll;
+            m_currMetaHeader.fields.tail = 0ll;
+            m_currMetaHeader.fields.ver = INVALID_VERSION;
+            m_currMetaHeader.fields.flags = META_FLAG_VALID | (signature_size > 0 ? META_FLAG_SIGNATURES : 0);
+            persistMetaHeaderAtomically(&m_currMetaHeader);
+            dbg_default_info("{0}:new header initialized.", this->m_sName);
+        } else {
+            int fd = open(this->m_sMetaFile.c_str(), O_RDONLY);
+            if(fd == -1) {
+                throw PERSIST_EXP_OPEN_FILE(errno);
+            }
+            ssize_t nRead = read(fd, (void*)&m_persMetaHeader, sizeof(MetaHeader));
+            close(fd);
+            if(nRead != sizeof(MetaHeader)) {
+                throw PERSIST_EXP_READ_FILE(errno);
+            }
+            m_currMetaHeader = m_persMetaHeader;
+            // the next persist() records the flags of a log created before they existed
+            m_currMetaHeader.fields.flags = META_FLAG_VALID | (signature_size > 0 ? META_FLAG_SIGNATURES : 0);
+        }
+        const int64_t head = m_currMetaHeader.fields.head;
+        const int64_t tail = m_currMetaHeader.fields.tail;
+        // STEP 2: read the segment headers. Segments starting at or after the
+        // tail were left behind by a truncation or an unpersisted append.
+        for(const auto& segment_file : listSegmentFiles(this->m_sDataPath, this->m_sName)) {
+            m_iNextSegmentNumber = std::max(m_iNextSegmentNumber, segment_file.first + 1);
+            SegmentHeader header;
+            int fd = open(segment_file.second.c_str(), O_RDONLY);
+            if(fd == -1) {
+                throw PERSIST_EXP_OPEN_FILE(errno);
+            }
+            try {
+                preadFully(fd, &header, sizeof(header.fields), 0);
+            } catch(uint64_t e) {
+                close(fd);
+                throw e;
+            }
+            close(fd);
+            if(header.fields.magic != SEGMENT_MAGIC) {
+                dbg_default_error("{0}:{1} is not a log segment.", this->m_sName, segment_file.second);
+                throw PERSIST_EXP_INV_FILE;
+            }
+            if(header.fields.first_index >= tail) {
+                dbg_default_debug("{0}:removing segment {1}, which is past the tail {2}.", this->m_sName, segment_file.second, tail);
+                fs::remove(segment_file.second);
+                continue;
+            }
+            auto seg = std::make_unique<Segment>();
+            seg->number = segment_file.first;
+            seg->file = segment_file.second;
+            seg->first_index = header.fields.first_index;
+            seg->first_version = INVALID_VERSION;
+            seg->entry_capacity = header.fields.entry_capacity;
+            seg->data_capacity = header.fields.data_capacity;
+            seg->fd = -1;
+            seg->base = nullptr;
+            seg->writable = false;
+            m_segments.emplace_back(std::move(seg));
+        }
+        // STEP 3: finish archiving the segments whose entries were all trimmed
+        for(const auto& file : detachTrimmedSegments()) {
+            archiveSegment(file);
+        }
+        if(tail > head && (m_segments.empty() || m_segments.front()->first_index > head)) {
+            dbg_default_error("{0}:the segment holding log index {1} is missing.", this->m_sName, head);
+            throw PERSIST_EXP_INV_FILE;
+        }
+        // STEP 4: rebuild the hlc index; the segments are read in parallel.
+        std::vector<hlc_index_entry> entries(tail - head);
+        std::atomic<std::size_t> next_segment{0};
+        std::atomic<uint64_t> error{0};
+        auto index_segments = [&]() {
+            std::size_t i;
+            while((i = next_segment++) < m_segments.size() && error == 0) {
+                Segment* seg = m_segments[i].get();
+                const int64_t end = (i + 1 < m_segments.size()) ? std::min(m_segments[i + 1]->first_index, tail) : tail;
+                if(end <= seg->first_index) {
+                    continue;
+                }
+                // the first entry may have been trimmed, but its version locates the segment
+                const int64_t begin = seg->first_index;
+                const int64_t live_begin = std::max(begin, head);
+                std::vector<LogEntry> seg_entries(end - begin);
+                int fd = open(seg->file.c_str(), O_RDONLY);
+                if(fd == -1) {
+                    error = PERSIST_EXP_OPEN_FILE(errno);
+                    return;
+                }
+                try {
+                    preadFully(fd, seg_entries.data(), seg_entries.size() * sizeof(LogEntry), SEGMENT_HEADER_SIZE);
+                } catch(uint64_t e) {
+                    error = e;
+                }
+                close(fd);
+                if(error != 0) {
+                    return;
+                }
+                seg->first_version = seg_entries[0].fields.ver;
+                for(int64_t idx = live_begin; idx < end; idx++) {
+                    const LogEntry& entry = seg_entries[idx - begin];
+                    entries[idx - head] = {entry.fields.hlc_r, entry.fields.hlc_l, idx};
+                }
+            }
+        };
+        const std::size_t num_threads = std::max<std::size_t>(
+                1, std::min<std::size_t>(m_segments.size(), std::thread::hardware_concurrency()));
+        std::vector<std::thread> threads;
+        for(std::size_t t = 1; t < num_threads; t++) {
+            threads.emplace_back(index_segments);
+        }
+        index_segments();
+        for(auto& thread : threads) {
+            thread.join();
+        }
+        if(error != 0) {
+            throw error.load();
+        }
+        this->hidx.rebuild(entries);
+        // STEP 5: map the last segment for appending
+        if(!m_segments.empty()) {
+            Segment* seg = m_segments.back().get();
+            seg->fd = open(seg->file.c_str(), O_RDWR);
+            if(seg->fd == -1) {
+                throw PERSIST_EXP_OPEN_FILE(errno);
+            }
+            void* base = mmap(NULL, seg->file_size(), PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+            if(base == MAP_FAILED) {
+                dbg_default_error("{0}:map segment {1} failed.", this->m_sName, seg->file);
+                throw PERSIST_EXP_MMAP_FILE(errno);
+            }
+            seg->base = static_cast<uint8_t*>(base);
+            seg->writable = true;
+        }
+    } catch(uint64_t e) {
+        FPL_PERS_UNLOCK;
+        FPL_UNLOCK;
+        throw e;
+    }
+    FPL_PERS_UNLOCK;
+    FPL_UNLOCK;
+    dbg_default_info("{0}:loaded {1} log entries in {2} segments in {3} ms.", this->m_sName,
+                     m_currMetaHeader.fields.tail - m_currMetaHeader.fields.head, m_segments.size(),
+                     std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count());
+}
+
+SegmentedPersistLog::~SegmentedPersistLog() noexcept(true) {
+    pthread_rwlock_destroy(&this->m_rwlock);
+    pthread_mutex_destroy(&this->m_perslock);
+    for(const auto& [base, size] : m_retiredMappings) {
+        munmap(base, size);
+    }
+    for(auto& seg : m_segments) {
+        if(seg->base != nullptr) {
+            munmap(seg->base, seg->file_size());
+        }
+        if(seg->fd != -1) {
+            close(seg->fd);
+        }
+    }
+}
+
+SegmentedPersistLog::Segment* SegmentedPersistLog::segmentOf(int64_t idx) {
+    auto it = std::upper_bound(m_segments.begin(), m_segments.end(), idx,
+                               [](int64_t idx, const std::unique_ptr<Segment>& seg) {
+                                   return idx < seg->first_index;
+                               });
+    assert(it != m_segments.begin());
+    return (--it)->get();
+}
+
+void SegmentedPersistLog::mapSegment(Segment* seg) {
+    seg->last_used.store(++m_iMapClock, std::memory_order_relaxed);
+    if(seg->base.load(std::memory_order_acquire) != nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mapLock);
+    if(seg->base.load(std::memory_order_acquire) != nullptr) {
+        return;
+    }
+    int fd = open(seg->file.c_str(), O_RDONLY);
+    if(fd == -1) {
+        throw PERSIST_EXP_OPEN_FILE(errno);
+    }
+    void* base = mmap(NULL, seg->file_size(), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED) {
+        dbg_default_error("{0}:map segment {1} failed.", this->m_sName, seg->file);
+        throw PERSIST_EXP_MMAP_FILE(errno);
+    }
+    seg->base.store(static_cast<uint8_t*>(base), std::memory_order_release);
+    m_iNumMapped++;
+}
+
+void SegmentedPersistLog::unmapSegment(Segment* seg) {
+    uint8_t* base = seg->base.exchange(nullptr);
+    if(base != nullptr) {
+        m_iNumMapped--;
+        // A reader that begins after this sees no mapping and maps the segment again
+        std::lock_guard<std::mutex> lock(m_mapLock);
+        if(m_iReaders == 0) {
+            munmap(base, seg->file_size());
+        } else {
+            m_retiredMappings.emplace_back(base, seg->file_size());
+        }
+    }
+}
+
+void SegmentedPersistLog::beginRead() {
+    m_iReaders++;
+}
+
+void SegmentedPersistLog::endRead() {
+    if(--m_iReaders > 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mapLock);
+    // no reader can reach a retired mapping, so none that began since uses them
+    if(m_iReaders == 0) {
+        for(const auto& [base, size] : m_retiredMappings) {
+            munmap(base, size);
+        }
+        m_retiredMappings.clear();
+    }
+}
+
+void SegmentedPersistLog::unmapColdSegments() {
+    if(m_iMaxMappedSegments == 0 || m_iNumMapped <= m_iMaxMappedSegments) {
+        return;
+    }
+    std::vector<Segment*> mapped;
+    for(auto& seg : m_segments) {
+        if(!seg->writable && seg->base.load(std::memory_order_relaxed) != nullptr) {
+            mapped.push_back(seg.get());
+        }
+    }
+    if(mapped.size() <= m_iMaxMappedSegments) {
+        return;
+    }
+    const std::size_t num_to_unmap = mapped.size() - m_iMaxMappedSegments;
+    std::nth_element(mapped.begin(), mapped.begin() + num_to_unmap, mapped.end(),
+                     [](const Segment* a, const Segment* b) {
+                         return a->last_used.load(std::memory_order_relaxed) < b->last_used.load(std::memory_order_relaxed);
+                     });
+    for(std::size_t i = 0; i < num_to_unmap; i++) {
+        unmapSegment(mapped[i]);
+    }
+    dbg_default_debug("{0}:unmapped {1} segments that were not read recently.", this->m_sName, num_to_unmap);
+}
+
+LogEntry* SegmentedPersistLog::entryAt(int64_t idx, Segment** pseg) {
+    Segment* seg = segmentOf(idx);
+    mapSegment(seg);
+    if(pseg != nullptr) {
+        *pseg = seg;
+    }
+    return seg->entries() + (idx - seg->first_index);
+}
+
+void* SegmentedPersistLog::dataAt(int64_t idx) {
+    Segment* seg;
+    const LogEntry* ple = entryAt(idx - entryAt(idx)->fields.ref_dist, &seg);
+    return seg->data() + ple->fields.ofst + signature_size + digest_size;
+}
+
+uint8_t* SegmentedPersistLog::signatureAt(int64_t idx, Segment** pseg) {
+    Segment* seg;
+    const LogEntry* ple = entryAt(idx, &seg);
+    if(pseg != nullptr) {
+        *pseg = seg;
+    }
+    return seg->data() + ple->fields.ofst;
+}
+
+uint64_t SegmentedPersistLog::dataSizeAt(int64_t idx) {
+    const LogEntry* ple = entryAt(idx - entryAt(idx)->fields.ref_dist);
+    return ple->fields.sdlen - signature_size - digest_size;
+}
+
+void SegmentedPersistLog::writeToSegment(Segment* seg, void* dst, const void* src, std::size_t len) {
+    if(seg->writable) {
+        memcpy(dst, src, len);
+        return;
+    }
+    // a sealed segment is mapped read-only; the page cache makes the write visible through the mapping
+    int fd = open(seg->file.c_str(), O_WRONLY);
+    if(fd == -1) {
+        throw PERSIST_EXP_OPEN_FILE(errno);
+    }
+    ssize_t nWrite = pwrite(fd, src, len, static_cast<uint8_t*>(dst) - seg->base.load());
+    close(fd);
+    if(nWrite != static_cast<ssize_t>(len)) {
+        throw PERSIST_EXP_WRITE_FILE(errno);
+    }
+}
+
+int64_t SegmentedPersistLog::searchVersion(version_t ver) {
+    const int64_t head = m_currMetaHeader.fields.head;
+    const int64_t tail = m_currMetaHeader.fields.tail;
+    if(tail <= head) {
+        return INVALID_INDEX;
+    }
+    // the segments holding entries, located by the versions of their first entries
+    auto seg_end = std::lower_bound(m_segments.begin(), m_segments.end(), tail,
+                                    [](const std::unique_ptr<Segment>& seg, int64_t tail) {
+                                        return seg->first_index < tail;
+                                    });
+    auto seg_it = std::upper_bound(m_segments.begin(), seg_end, ver,
+                                   [](version_t ver, const std::unique_ptr<Segment>& seg) {
+                                       return ver < seg->first_version;
+                                   });
+    if(seg_it == m_segments.begin()) {
+        return INVALID_INDEX;
+    }
+    const int64_t end = (seg_it == seg_end) ? tail : (*seg_it)->first_index;
+    Segment* seg = (--seg_it)->get();
+    mapSegment(seg);
+    const LogEntry* seg_entries = seg->entries() - seg->first_index;
+    int64_t lo = std::max(head, seg->first_index);
+    if(seg_entries[lo].fields.ver > ver) {
+        return INVALID_INDEX;
+    }
+    // the latest entry in [lo, end) whose version is at most ver
+    int64_t hi = end - 1;
+    while(lo < hi) {
+        const int64_t pivot = lo + (hi - lo + 1) / 2;
+        if(seg_entries[pivot].fields.ver <= ver) {
+            lo = pivot;
+        } else {
+            hi = pivot - 1;
+        }
+    }
+    return lo;
+}
+
+uint64_t SegmentedPersistLog::nextDataOfst() {
+    const Segment* seg = m_segments.back().get();
+    if(m_currMetaHeader.fields.tail <= seg->first_index) {
+        return 0;
+    }
+    const LogEntry* ple = seg->entries() + (m_currMetaHeader.fields.tail - 1 - seg->first_index);
+    return ple->fields.ofst + ple->fields.sdlen;
+}
+
+void SegmentedPersistLog::ensureSpace(uint64_t size) {
+    const uint64_t sdlen = signature_size + digest_size + size;
+    if(!m_segments.empty()) {
+        const Segment* seg = m_segments.back().get();
+        if(static_cast<uint64_t>(m_currMetaHeader.fields.tail - seg->first_index) < seg->entry_capacity
+           && nextDataOfst() + sdlen <= seg->data_capacity) {
+            return;
+        }
+    }
+    startSegment(sdlen);
+}
+
+void SegmentedPersistLog::startSegment(uint64_t data_size) {
+    // a reservation in the segment being replaced is lost
+    m_iReservedOfst = -1;
+    if(!m_segments.empty()) {
+        Segment* prev = m_segments.back().get();
+        if(prev->first_index >= m_currMetaHeader.fields.tail) {
+            // nothing was appended to it, but the entry does not fit: replace it
+            munmap(prev->base, prev->file_size());
+            close(prev->fd);
+            fs::remove(prev->file);
+            m_segments.pop_back();
+        } else {
+            sealSegment(prev);
+        }
+    }
+    auto seg = std::make_unique<Segment>();
+    seg->number = m_iNextSegmentNumber++;
+    seg->file = m_sDataPath + "/" + m_sName + "." + std::to_string(seg->number) + "." + SEGMENT_FILE_SUFFIX;
+    seg->first_index = m_currMetaHeader.fields.tail;
+    seg->first_version = INVALID_VERSION;
+    seg->entry_capacity = m_iSegmentEntries;
+    seg->data_capacity = std::max(m_iSegmentSize, roundUpToPage(data_size));
+    seg->fd = open(seg->file.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IWUSR | S_IRUSR | S_IRGRP | S_IWGRP | S_IROTH);
+    if(seg->fd == -1) {
+        throw PERSIST_EXP_CREATE_FILE(errno);
+    }
+    // the file is sparse, so the space it takes grows with the data
+    if(ftruncate(seg->fd, seg->file_size()) != 0) {
+        close(seg->fd);
+        throw PERSIST_EXP_TRUNCATE_FILE(errno);
+    }
+    SegmentHeader header;
+    memset(&header, 0, sizeof(header));
+    header.fields.magic = SEGMENT_MAGIC;
+    header.fields.first_index = seg->first_index;
+    header.fields.entry_capacity = seg->entry_capacity;
+    header.fields.data_capacity = seg->data_capacity;
+    if(pwrite(seg->fd, &header, sizeof(header), 0) != sizeof(header)) {
+        close(seg->fd);
+        throw PERSIST_EXP_WRITE_FILE(errno);
+    }
+    void* base = mmap(NULL, seg->file_size(), PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+    if(base == MAP_FAILED) {
+        close(seg->fd);
+        dbg_default_error("{0}:map segment {1} failed.", this->m_sName, seg->file);
+        throw PERSIST_EXP_MMAP_FILE(errno);
+    }
+    seg->base = static_cast<uint8_t*>(base);
+    seg->writable = true;
+    dbg_default_debug("{0}:started segment {1} at log index {2}.", this->m_sName, seg->file, seg->first_index);
+    m_segments.emplace_back(std::move(seg));
+}
+
+void SegmentedPersistLog::sealSegment(Segment* seg) {
+    if(!seg->writable) {
+        return;
+    }
+    // later persist() calls only flush the last segment
+    if(fdatasync(seg->fd) != 0) {
+        throw PERSIST_EXP_MSYNC(errno);
+    }
+    // readers may hold pointers into the mapping, so it stays, read-only
+    if(mprotect(seg->base, seg->file_size(), PROT_READ) != 0) {
+        throw PERSIST_EXP_MMAP_FILE(errno);
+    }
+    close(seg->fd);
+    seg->fd = -1;
+    seg->writable = false;
+    m_iNumMapped++;
+}
+
+std::vector<std::string> SegmentedPersistLog::detachTrimmedSegments() {
+    std::vector<std::string> files;
+    while(m_segments.size() > 1 && m_segments[1]->first_index <= m_currMetaHeader.fields.head) {
+        Segment* seg = m_segments.front().get();
+        unmapSegment(seg);
+        if(seg->fd != -1) {
+            close(seg->fd);
+        }
+        files.push_back(seg->file);
+        m_segments.pop_front();
+    }
+    return files;
+}
+
+void SegmentedPersistLog::archiveSegment(const std::string& file) {
+    // A failure leaves the segment where it is, and the next load() retries.
+    try {
+        if(m_sColdPath.empty()) {
+            fs::remove(file);
+            return;
+        }
+        checkOrCreateDir(m_sColdPath);
+        const std::string cold_file = m_sColdPath + "/" + fs::path(file).filename().string();
+#ifdef HAS_ZLIB
+        if(m_bCompressCold) {
+            int fd = open(file.c_str(), O_RDONLY);
+            if(fd == -1) {
+                throw PERSIST_EXP_OPEN_FILE(errno);
+            }
+            gzFile gz = gzopen((cold_file + ".gz").c_str(), "wb");
+            if(gz == NULL) {
+                close(fd);
+                throw PERSIST_EXP_CREATE_FILE(errno);
+            }
+            std::vector<char> buf(1 << 20);
+            ssize_t nRead;
+            bool ok = true;
+            while(ok && (nRead = read(fd, buf.data(), buf.size())) > 0) {
+                ok = (gzwrite(gz, buf.data(), nRead) == nRead);
+            }
+            close(fd);
+            if(gzclose(gz) != Z_OK || !ok || nRead < 0) {
+                fs::remove(cold_file + ".gz");
+                throw PERSIST_EXP_WRITE_FILE(errno);
+            }
+            fs::remove(file);
+            dbg_default_debug("{0}:archived segment {1} to {2}.gz", this->m_sName, file, cold_file);
+            return;
+        }
+#endif
+        if(rename(file.c_str(), cold_file.c_str()) != 0) {
+            if(errno != EXDEV) {
+                throw PERSIST_EXP_RENAME_FILE(errno);
+            }
+            // the cold directory is on another file system
+            fs::copy_file(file, cold_file, fs::copy_options::overwrite_existing);
+            fs::remove(file);
+        }
+        dbg_default_debug("{0}:archived segment {1} to {2}", this->m_sName, file, cold_file);
+    } catch(uint64_t e) {
+        dbg_default_error("{0}:failed to archive segment {1}, exception:{2:x}", this->m_sName, file, e);
+    } catch(const fs::filesystem_error& e) {
+        dbg_default_error("{0}:failed to archive segment {1}: {2}", this->m_sName, file, e.what());
+    }
+}
+
+inline void SegmentedPersistLog::do_append_validation(const uint64_t size, const int64_t ver) {
+    if(static_cast<uint64_t>(numUsedSlots()) >= m_iMaxLogEntry) {
+        dbg_default_error("{0}-append exception no free slots in log! NUM_USED_SLOTS={1}",
+                          this->m_sName, numUsedSlots());
+        dbg_default_flush();
+        FPL_UNLOCK;
+        throw PERSIST_EXP_NOSPACE_LOG;
+    }
+    if((currLogIdx() != INVALID_INDEX) && (m_currMetaHeader.fields.ver >= ver)) {
+        int64_t cver = m_currMetaHeader.fields.ver;
+        dbg_default_error("{0}-append version already exists! cur_ver:{1} new_ver:{2}", this->m_sName,
+                          (int64_t)cver, (int64_t)ver);
+        dbg_default_flush();
+        FPL_UNLOCK;
+        throw PERSIST_EXP_INV_VERSION;
+    }
+}
+
+inline void SegmentedPersistLog::do_append_entry(const uint64_t size, const version_t ver, const HLC& mhlc, const uint64_t ref_dist) {
+    Segment* seg = m_segments.back().get();
+    const uint64_t ofst = nextDataOfst();
+    // With batched signatures, the 'digest_size' bytes after the signature are
+    // cleared, because only the last version of a batch gets a signature.
+    if(digest_size > 0) {
+        memset(seg->data() + ofst, 0, signature_size + digest_size);
+    }
+    LogEntry* ple = seg->entries() + (m_currMetaHeader.fields.tail - seg->first_index);
+    ple->fields.ver = ver;
+    ple->fields.sdlen = signature_size + digest_size + size;
+    ple->fields.ofst = ofst;
+    ple->fields.hlc_r = mhlc.m_rtc_us;
+    ple->fields.hlc_l = mhlc.m_logic;
+    ple->fields.ref_dist = ref_dist;
+    if(m_currMetaHeader.fields.tail == seg->first_index) {
+        seg->first_version = ver;
+    }
+
+    // update meta header
+    this->hidx.insert(mhlc.m_rtc_us, mhlc.m_logic, m_currMetaHeader.fields.tail);
+    m_currMetaHeader.fields.tail++;
+    m_currMetaHeader.fields.ver = ver;
+    unmapColdSegments();
+    dbg_default_debug("{0} append a log ver:{1} hlc:({2},{3})", this->m_sName,
+                      ver, mhlc.m_rtc_us, mhlc.m_logic);
+}
+
+void SegmentedPersistLog::append(const void* pdat, uint64_t size, version_t ver, const HLC& mhlc) {
+    dbg_default_trace("{0} append event ({1},{2})", this->m_sName, mhlc.m_rtc_us, mhlc.m_logic);
+    FPL_WRLOCK;
+    do_append_validation(size, ver);
+    try {
+        ensureSpace(size);
+    } catch(uint64_t e) {
+        FPL_UNLOCK;
+        throw e;
+    }
+    memcpy(m_segments.back()->data() + nextDataOfst() + signature_size + digest_size, pdat, size);
+    do_append_entry(size, ver, mhlc);
+    // an append also consumes the space of any outstanding reservation
+    m_iReservedOfst = -1;
+    FPL_UNLOCK;
+}
+
+char* SegmentedPersistLog::reserve(uint64_t size) {
+    dbg_default_trace("{0} reserve {1} bytes", this->m_sName, size);
+    // starting a segment changes the list of segments, so this takes the write lock
+    FPL_WRLOCK;
+    if(static_cast<uint64_t>(numUsedSlots()) >= m_iMaxLogEntry) {
+        FPL_UNLOCK;
+        throw PERSIST_EXP_NOSPACE_LOG;
+    }
+    try {
+        ensureSpace(size);
+    } catch(uint64_t e) {
+        FPL_UNLOCK;
+        throw e;
+    }
+    m_iReservedOfst = nextDataOfst();
+    m_iReservedSize = size;
+    char* buf = reinterpret_cast<char*>(m_segments.back()->data()) + m_iReservedOfst + signature_size + digest_size;
+    FPL_UNLOCK;
+    return buf;
+}
+
+inline void SegmentedPersistLog::do_reservation_validation(const version_t ver) {
+    if(m_iReservedOfst < 0) {
+        dbg_default_error("{0}-commit exception: no reservation for ver:{1}", this->m_sName, ver);
+        FPL_UNLOCK;
+        throw PERSIST_EXP_NO_RESERVATION;
+    }
+}
+
+inline void SegmentedPersistLog::do_commit(const version_t ver, const HLC& mhlc) {
+    do_append_validation(m_iReservedSize, ver);
+    const uint64_t next_ofst = nextDataOfst();
+    if(static_cast<uint64_t>(m_iReservedOfst) != next_ofst) {
+        // The log was truncated after reserve(), which leaves the data where
+        // it was reserved, past the new end of the last segment.
+        const uint64_t prefix = signature_size + digest_size;
+        uint8_t* data = m_segments.back()->data();
+        memmove(data + next_ofst + prefix, data + m_iReservedOfst + prefix, m_iReservedSize);
+    }
+    do_append_entry(m_iReservedSize, ver, mhlc);
+    m_iReservedOfst = -1;
+}
+
+void SegmentedPersistLog::commit(version_t ver, const HLC& mhlc) {
+    dbg_default_trace("{0} commit event ({1},{2})", this->m_sName, mhlc.m_rtc_us, mhlc.m_logic);
+    FPL_WRLOCK;
+    do_reservation_validation(ver);
+    do_commit(ver, mhlc);
+    FPL_UNLOCK;
+}
+
+bool SegmentedPersistLog::commitIfChanged(version_t ver, const HLC& mhlc) {
+    dbg_default_trace("{0} commitIfChanged event ({1},{2})", this->m_sName, mhlc.m_rtc_us, mhlc.m_logic);
+    FPL_WRLOCK;
+    do_reservation_validation(ver);
+    // If the log was truncated after reserve(), just log the data.
+    if(currLogIdx() != INVALID_INDEX && static_cast<uint64_t>(m_iReservedOfst) == nextDataOfst()) {
+        const int64_t curr_idx = currLogIdx();
+        const uint64_t ref_dist = entryAt(curr_idx)->fields.ref_dist + 1;
+        if(ref_dist <= MAX_REF_DIST
+           && dataSizeAt(curr_idx) == m_iReservedSize
+           && memcmp(dataAt(curr_idx),
+                     m_segments.back()->data() + m_iReservedOfst + signature_size + digest_size,
+                     m_iReservedSize)
+                      == 0) {
+            do_append_validation(0, ver);
+            try {
+                // the new entry only needs room for its signature, possibly in a new segment
+                ensureSpace(0);
+            } catch(uint64_t e) {
+                FPL_UNLOCK;
+                throw e;
+            }
+            // refer directly to the entry holding the data, so there are no chains
+            do_append_entry(0, ver, mhlc, ref_dist);
+            m_iReservedOfst = -1;
+            FPL_UNLOCK;
+            dbg_default_trace("{0} commitIfChanged: ver:{1} has the data of the previous version", this->m_sName, ver);
+            return false;
+        }
+    }
+    do_commit(ver, mhlc);
+    FPL_UNLOCK;
+    return true;
+}
+
+void SegmentedPersistLog::advanceVersion(version_t ver) {
+    FPL_WRLOCK;
+    if(m_currMetaHeader.fields.ver < ver) {
+        m_currMetaHeader.fields.ver = ver;
+    } else {
+        FPL_UNLOCK;
+        throw PERSIST_EXP_INV_VERSION;
+    }
+    FPL_UNLOCK;
+}
+
+version_t SegmentedPersistLog::persist(version_t ver, bool preLocked) {
+    int64_t ver_ret = INVALID_VERSION;
+    if(!preLocked) {
+        FPL_PERS_LOCK;
+        FPL_RDLOCK;
+    }
+
+    if(m_currMetaHeader == m_persMetaHeader) {
+        if(currLogIdx() != INVALID_INDEX) {
+            ver_ret = m_currMetaHeader.fields.ver;
+        }
+        if(!preLocked) {
+            FPL_UNLOCK;
+            FPL_PERS_UNLOCK;
+        }
+        return ver_ret;
+    }
+
+    dbg_default_trace("{0} flush data,log,and meta.", this->m_sName);
+    // shadow the current state; the entries before the last segment were
+    // flushed when their segments were sealed.
+    MetaHeader shadow_header = m_currMetaHeader;
+    int flush_fd = -1;
+    if(!m_segments.empty() && m_segments.back()->writable) {
+        // the segment may be sealed and closed while it is flushed
+        flush_fd = dup(m_segments.back()->fd);
+    }
+    if(numUsedSlots() > 0) {
+        ver_ret = m_currMetaHeader.fields.ver;
+    }
+    if(!preLocked) {
+        FPL_UNLOCK;
+    }
+    try {
+        if(flush_fd != -1) {
+            const int ret = fdatasync(flush_fd);
+            close(flush_fd);
+            if(ret != 0) {
+                throw PERSIST_EXP_MSYNC(errno);
+            }
+        }
+        this->persistMetaHeaderAtomically(&shadow_header);
+    } catch(uint64_t e) {
+        if(!preLocked) {
+            FPL_PERS_UNLOCK;
+        }
+        throw e;
+    }
+    dbg_default_trace("{0} flush data,log,and meta...done.", this->m_sName);
+
+    if(!preLocked) {
+        FPL_PERS_UNLOCK;
+    }
+    return ver_ret;
+}
+
+void SegmentedPersistLog::addSignature(version_t version,
+                                       const unsigned char* signature,
+                                       version_t prev_signed_ver) {
+    if(signature_size == 0) {
+        return;
+    }
+    FPL_RDLOCK;
+    try {
+        int64_t l_idx = searchVersion(version);
+        Segment* seg;
+        if(l_idx != INVALID_INDEX && entryAt(l_idx, &seg)->fields.ver == version) {
+            writeToSegment(seg, signatureAt(l_idx), signature, signature_size);
+            writeToSegment(seg, &entryAt(l_idx)->fields.prev_signed_ver, &prev_signed_ver, sizeof(prev_signed_ver));
+        }
+    } catch(uint64_t e) {
+        FPL_UNLOCK;
+        throw e;
+    }
+    FPL_UNLOCK;
+}
+
+bool SegmentedPersistLog::getSignature(version_t version, unsigned char* signature, version_t& previous_signed_version) {
+    if(signature_size == 0) {
+        return false;
+    }
+    bool found = false;
+    FPL_RDLOCK;
+    int64_t l_idx = searchVersion(version);
+    if(l_idx != INVALID_INDEX && entryAt(l_idx)->fields.ver == version) {
+        memcpy(signature, signatureAt(l_idx), signature_size);
+        previous_signed_version = entryAt(l_idx)->fields.prev_signed_ver;
+        found = true;
+    }
+    FPL_UNLOCK;
+    return found;
+}
+
+void SegmentedPersistLog::addDigest(version_t version,
+                                    const unsigned char* digest,
+                                    version_t signed_ver) {
+    if(digest_size == 0) {
+        return;
+    }
+    FPL_RDLOCK;
+    try {
+        int64_t l_idx = searchVersion(version);
+        Segment* seg;
+        if(l_idx != INVALID_INDEX && entryAt(l_idx, &seg)->fields.ver == version) {
+            writeToSegment(seg, signatureAt(l_idx) + signature_size, digest, digest_size);
+            writeToSegment(seg, &entryAt(l_idx)->fields.signed_ver, &signed_ver, sizeof(signed_ver));
+        }
+    } catch(uint64_t e) {
+        FPL_UNLOCK;
+        throw e;
+    }
+    FPL_UNLOCK;
+}
+
+bool SegmentedPersistLog::getDigest(version_t version, unsigned char* digest, version_t& signed_ver) {
+    if(digest_size == 0) {
+        return false;
+    }
+    bool found = false;
+    FPL_RDLOCK;
+    int64_t l_idx = searchVersion(version);
+    if(l_idx != INVALID_INDEX && entryAt(l_idx)->fields.ver == version) {
+        memcpy(digest, signatureAt(l_idx) + signature_size, digest_size);
+        signed_ver = entryAt(l_idx)->fields.signed_ver;
+        found = true;
+    }
+    FPL_UNLOCK;
+    return found;
+}
+
+int64_t SegmentedPersistLog::getLength() {
+    FPL_RDLOCK;
+    int64_t len = numUsedSlots();
+    FPL_UNLOCK;
+    return len;
+}
+
+int64_t SegmentedPersistLog::getEarliestIndex() {
+    FPL_RDLOCK;
+    int64_t idx = (numUsedSlots() == 0) ? INVALID_INDEX : m_currMetaHeader.fields.head;
+    FPL_UNLOCK;
+    return idx;
+}
+
+int64_t SegmentedPersistLog::getLatestIndex() {
+    FPL_RDLOCK;
+    int64_t idx = currLogIdx();
+    FPL_UNLOCK;
+    return idx;
+}
+
+version_t SegmentedPersistLog::getEarliestVersion() {
+    FPL_RDLOCK;
+    version_t ver = (numUsedSlots() == 0) ? INVALID_VERSION : entryAt(m_currMetaHeader.fields.head)->fields.ver;
+    FPL_UNLOCK;
+    return ver;
+}
+
+version_t SegmentedPersistLog::getLatestVersion() {
+    FPL_RDLOCK;
+    int64_t idx = currLogIdx();
+    version_t ver = (idx == INVALID_INDEX) ? INVALID_VERSION : entryAt(idx)->fields.ver;
+    FPL_UNLOCK;
+    return ver;
+}
+
+version_t SegmentedPersistLog::getLastPersistedVersion() {
+    FPL_PERS_LOCK;
+    version_t last_persisted = m_persMetaHeader.fields.ver;
+    FPL_PERS_UNLOCK;
+    return last_persisted;
+}
+
+int64_t SegmentedPersistLog::getVersionIndex(version_t ver, bool exact) {
+    FPL_RDLOCK;
+    int64_t l_idx = searchVersion(ver);
+    if((l_idx != INVALID_INDEX) && exact && (entryAt(l_idx)->fields.ver != ver)) {
+        l_idx = INVALID_INDEX;
+    }
+    FPL_UNLOCK;
+    dbg_default_trace("{0} getVersionIndex({1}) at index {2}", this->m_sName, ver, l_idx);
+    return l_idx;
+}
+
+const void* SegmentedPersistLog::getEntryByIndex(int64_t eidx) {
+    FPL_RDLOCK;
+    int64_t ridx = (eidx < 0) ? (m_currMetaHeader.fields.tail + eidx) : eidx;
+    if(m_currMetaHeader.fields.tail <= ridx || ridx < m_currMetaHeader.fields.head) {
+        FPL_UNLOCK;
+        throw PERSIST_EXP_INV_ENTRY_IDX(eidx);
+    }
+    const void* pdata = dataAt(ridx);
+    FPL_UNLOCK;
+    return pdata;
+}
+
+const void* SegmentedPersistLog::getEntry(version_t ver, bool exact) {
+    const void* pdata = nullptr;
+    FPL_RDLOCK;
+    int64_t l_idx = searchVersion(ver);
+    // no object exists before the requested version.
+    if(l_idx != INVALID_INDEX && (!exact || entryAt(l_idx)->fields.ver == ver)) {
+        pdata = dataAt(l_idx);
+    }
+    FPL_UNLOCK;
+    return pdata;
+}
+
+int64_t SegmentedPersistLog::getHLCIndex(const HLC& rhlc) {
+    // the index supports lookups concurrent with append, so no lock is needed
+    return this->hidx.lookup(rhlc.m_rtc_us, rhlc.m_logic);
+}
+
+const void* SegmentedPersistLog::getEntry(const HLC& rhlc) {
+    const void* pdata = nullptr;
+    FPL_RDLOCK;
+    int64_t idx = this->hidx.lookup(rhlc.m_rtc_us, rhlc.m_logic);
+    if(idx != INVALID_INDEX && idx >= m_currMetaHeader.fields.head && idx < m_currMetaHeader.fields.tail) {
+        pdata = dataAt(idx);
+    }
+    FPL_UNLOCK;
+    return pdata;
+}
+
+void SegmentedPersistLog::processEntryAtVersion(version_t ver,
+                                                const std::function<void(const void*, std::size_t)>& func) {
+    const void* pdata = nullptr;
+    std::size_t size = 0;
+    ReadGuard read_guard(*this);
+    FPL_RDLOCK;
+    int64_t l_idx = searchVersion(ver);
+    if(l_idx != INVALID_INDEX && entryAt(l_idx)->fields.ver == ver) {
+        pdata = dataAt(l_idx);
+        size = dataSizeAt(l_idx);
+    }
+    FPL_UNLOCK;
+    if(pdata != nullptr) {
+        func(pdata, size);
+    }
+}
+
+int64_t SegmentedPersistLog::do_trim_head(const int64_t idx) {
+    if(idx >= m_currMetaHeader.fields.tail) {
+        return idx;
+    }
+    return idx - entryAt(idx)->fields.ref_dist;
+}
+
+std::vector<std::string> SegmentedPersistLog::do_trim(int64_t idx) {
+    m_currMetaHeader.fields.head = do_trim_head(idx + 1);
+    persist(m_currMetaHeader.fields.ver, true);
+    // HLC order and index order do not agree, so this scans the whole index.
+    this->hidx.retain(m_currMetaHeader.fields.head, m_currMetaHeader.fields.tail);
+    // the meta header is persisted, so the segments behind the head can go
+    std::vector<std::string> files = detachTrimmedSegments();
+    // trim(version) may have mapped segments to search for the version
+    unmapColdSegments();
+    return files;
+}
+
+void SegmentedPersistLog::trimByIndex(int64_t idx) {
+    dbg_default_trace("{0} trim at index: {1}", this->m_sName, idx);
+    std::vector<std::string> trimmed_segments;
+    FPL_PERS_LOCK;
+    FPL_WRLOCK;
+    if(idx >= m_currMetaHeader.fields.head && idx < m_currMetaHeader.fields.tail) {
+        try {
+            trimmed_segments = do_trim(idx);
+        } catch(uint64_t e) {
+            FPL_UNLOCK;
+            FPL_PERS_UNLOCK;
+            throw e;
+        }
+    }
+    FPL_UNLOCK;
+    FPL_PERS_UNLOCK;
+    for(const auto& file : trimmed_segments) {
+        archiveSegment(file);
+    }
+    dbg_default_trace("{0} trim at index: {1}...done", this->m_sName, idx);
+}
+
+void SegmentedPersistLog::trim(version_t ver) {
+    dbg_default_trace("{0} trim at version: {1}", this->m_sName, ver);
+    std::vector<std::string> trimmed_segments;
+    FPL_PERS_LOCK;
+    FPL_WRLOCK;
+    try {
+        int64_t idx = searchVersion(ver);
+        if(idx != INVALID_INDEX) {
+            trimmed_segments = do_trim(idx);
+        }
+    } catch(uint64_t e) {
+        FPL_UNLOCK;
+        FPL_PERS_UNLOCK;
+        throw e;
+    }
+    FPL_UNLOCK;
+    FPL_PERS_UNLOCK;
+    for(const auto& file : trimmed_segments) {
+        archiveSegment(file);
+    }
+    dbg_default_trace("{0} trim at version: {1}...done", this->m_sName, ver);
+}
+
+void SegmentedPersistLog::trim(const HLC& hlc) {
+    //TODO: This is hard because HLC order does not agree with index order.
+    throw PERSIST_EXP_UNIMPLEMENTED;
+}
+
+void SegmentedPersistLog::truncate(version_t ver) {
+    dbg_default_trace("{0} truncate at version: {1}.", this->m_sName, ver);
+    FPL_WRLOCK;
+    int64_t l_idx = searchVersion(ver);
+    // TODO: this may not be safe in case the log has been trimmed beyond 'ver' !!!
+    const int64_t new_tail = (l_idx == INVALID_INDEX) ? m_currMetaHeader.fields.head : l_idx + 1;
+    m_currMetaHeader.fields.tail = new_tail;
+    if(m_currMetaHeader.fields.ver > ver) {
+        m_currMetaHeader.fields.ver = ver;
+    }
+    // the truncated indexes will be reused by later entries
+    this->hidx.retain(m_currMetaHeader.fields.head, m_currMetaHeader.fields.tail);
+    FPL_PERS_LOCK;
+    try {
+        persistMetaHeaderAtomically(&m_currMetaHeader);
+        // Only now can the segments past the new tail go; load() drops the
+        // ones left behind by a crash. The last segment is kept, since it may
+        // hold a reservation, and restarts at the new tail if it is empty.
+        while(m_segments.size() > 1 && m_segments[m_segments.size() - 2]->first_index >= new_tail) {
+            auto it = m_segments.end() - 2;
+            unmapSegment(it->get());
+            fs::remove((*it)->file);
+            m_segments.erase(it);
+        }
+        if(!m_segments.empty() && m_segments.back()->first_index > new_tail) {
+            Segment* seg = m_segments.back().get();
+            seg->first_index = new_tail;
+            seg->first_version = INVALID_VERSION;
+            reinterpret_cast<SegmentHeader*>(seg->base.load())->fields.first_index = new_tail;
+            if(msync(seg->base, SEGMENT_HEADER_SIZE, MS_SYNC) != 0) {
+                throw PERSIST_EXP_MSYNC(errno);
+            }
+        }
+    } catch(uint64_t e) {
+        FPL_PERS_UNLOCK;
+        FPL_UNLOCK;
+        throw e;
+    }
+    FPL_PERS_UNLOCK;
+    FPL_UNLOCK;
+    dbg_default_trace("{0} truncate at version: {1}....done", this->m_sName, ver);
+}
+
+std::size_t SegmentedPersistLog::getNumSegments() {
+    FPL_RDLOCK;
+    std::size_t num_segments = m_segments.size();
+    FPL_UNLOCK;
+    return num_segments;
+}
+
+void SegmentedPersistLog::persistMetaHeaderAtomically(MetaHeader* pShadowHeader) {
+    // STEP 1: get file name
+    const string swpFile = this->m_sMetaFile + "." + SWAP_FILE_SUFFIX;
+
+    // STEP 2: write current meta header to swap file
+    int fd = open(swpFile.c_str(), O_RDWR | O_CREAT, S_IWUSR | S_IRUSR | S_IRGRP | S_IWGRP | S_IROTH);
+    if(fd == -1) {
+        throw PERSIST_EXP_OPEN_FILE(errno);
+    }
+    ssize_t nWrite = write(fd, pShadowHeader, sizeof(MetaHeader));
+    close(fd);
+    if(nWrite != sizeof(MetaHeader)) {
+        throw PERSIST_EXP_WRITE_FILE(errno);
+    }
+
+    // STEP 3: atomically update the meta file
+    if(rename(swpFile.c_str(), this->m_sMetaFile.c_str()) != 0) {
+        throw PERSIST_EXP_RENAME_FILE(errno);
+    }
+
+    // STEP 4: update the persisted header in memory
+    m_persMetaHeader = *pShadowHeader;
+}
+
+int64_t SegmentedPersistLog::getMinimumIndexBeyondVersion(version_t ver) {
+    if(numUsedSlots() == 0) {
+        return INVALID_INDEX;
+    }
+    if(ver == INVALID_VERSION) {
+        // return the earliest log we have.
+        return m_currMetaHeader.fields.head;
+    }
+    int64_t l_idx = searchVersion(ver);
+    if(l_idx == INVALID_INDEX) {
+        // the requested version is earlier than the earliest available log
+        return m_currMetaHeader.fields.head;
+    } else if((l_idx + 1) == m_currMetaHeader.fields.tail) {
+        // ver is the latest version or in the future
+        return INVALID_INDEX;
+    }
+    return l_idx + 1;
+}
+
+// The serialized format is the one of FilePersistLog:
+// [latest_version(int64_t)][nr_log_entry(int64_t)][log_enty1][log_entry2]...
+// An entry referring to the data of an entry before the first one sent carries
+// a copy of that data instead, so the receiver can always resolve the entries.
+size_t SegmentedPersistLog::bytes_size(version_t ver) {
+    size_t bsize = (sizeof(int64_t) + sizeof(int64_t));
+    FPL_RDLOCK;
+    int64_t idx = this->getMinimumIndexBeyondVersion(ver);
+    if(idx != INVALID_INDEX) {
+        const int64_t first_idx = idx;
+        while(idx < m_currMetaHeader.fields.tail) {
+            bsize += byteSizeOfLogEntry(idx, inlinedDataIndex(idx, first_idx));
+            idx++;
+        }
+    }
+    FPL_UNLOCK;
+    return bsize;
+}
+
+size_t SegmentedPersistLog::to_bytes(char* buf, version_t ver) {
+    size_t ofst = 0;
+    FPL_RDLOCK;
+    int64_t idx = this->getMinimumIndexBeyondVersion(ver);
+    // latest_version
+    *(int64_t*)(buf + ofst) = (currLogIdx() == INVALID_INDEX || ver == LOG_TAIL_OMITTED) ? INVALID_VERSION : entryAt(currLogIdx())->fields.ver;
+    ofst += sizeof(int64_t);
+    // nr_log_entry
+    *(int64_t*)(buf + ofst) = (idx == INVALID_INDEX) ? 0 : (m_currMetaHeader.fields.tail - idx);
+    ofst += sizeof(int64_t);
+    // log_entries
+    if(idx != INVALID_INDEX) {
+        const int64_t first_idx = idx;
+        while(idx < m_currMetaHeader.fields.tail) {
+            ofst += writeLogEntryToByteArray(idx, buf + ofst, inlinedDataIndex(idx, first_idx));
+            idx++;
+        }
+    }
+    FPL_UNLOCK;
+    return ofst;
+}
+
+void SegmentedPersistLog::post_object(const std::function<void(char const* const, std::size_t)>& f,
+                                      version_t ver) {
+    FPL_RDLOCK;
+    int64_t idx = this->getMinimumIndexBeyondVersion(ver);
+    // latest_version
+    int64_t latest_version = (currLogIdx() == INVALID_INDEX || ver == LOG_TAIL_OMITTED) ? INVALID_VERSION : entryAt(currLogIdx())->fields.ver;
+    f((char*)&latest_version, sizeof(int64_t));
+    // nr_log_entry
+    int64_t nr_log_entry = (idx == INVALID_INDEX) ? 0 : (m_currMetaHeader.fields.tail - idx);
+    f((char*)&nr_log_entry, sizeof(int64_t));
+    // log_entries
+    if(idx != INVALID_INDEX) {
+        const int64_t first_idx = idx;
+        while(idx < m_currMetaHeader.fields.tail) {
+            postLogEntry(f, idx, inlinedDataIndex(idx, first_idx));
+            idx++;
+        }
+    }
+    FPL_UNLOCK;
+}
+
+void SegmentedPersistLog::applyLogTail(char const* v) {
+    size_t ofst = 0;
+    // latest_version
+    int64_t latest_version = *(const int64_t*)(v + ofst);
+    ofst += sizeof(int64_t);
+    // nr_log_entry
+    int64_t nr_log_entry = *(const int64_t*)(v + ofst);
+    ofst += sizeof(int64_t);
+    FPL_WRLOCK;
+    try {
+        // log_entries
+        while(nr_log_entry--) {
+            ofst += mergeLogEntryFromByteArray(v + ofst);
+        }
+    } catch(uint64_t e) {
+        FPL_UNLOCK;
+        throw e;
+    }
+    // update the latest version.
+    if(latest_version != INVALID_VERSION) {
+        m_currMetaHeader.fields.ver = latest_version;
+    }
+    FPL_UNLOCK;
+}
+
+void SegmentedPersistLog::applyLogTail(const std::function<void(char*, std::size_t)>& read_bytes) {
+    // latest_version
+    int64_t latest_version;
+    read_bytes(reinterpret_cast<char*>(&latest_version), sizeof(int64_t));
+    // nr_log_entry
+    int64_t nr_log_entry;
+    read_bytes(reinterpret_cast<char*>(&nr_log_entry), sizeof(int64_t));
+    // log_entries, each read into the same buffer; the lock is only held while
+    // an entry is merged, not while the next one is read
+    std::vector<char> entry(sizeof(LogEntry));
+    while(nr_log_entry--) {
+        read_bytes(entry.data(), sizeof(LogEntry));
+        const uint64_t sdlen = reinterpret_cast<const LogEntry*>(entry.data())->fields.sdlen;
+        entry.resize(sizeof(LogEntry) + sdlen);
+        read_bytes(entry.data() + sizeof(LogEntry), sdlen);
+        FPL_WRLOCK;
+        try {
+            mergeLogEntryFromByteArray(entry.data());
+        } catch(uint64_t e) {
+            FPL_UNLOCK;
+            throw e;
+        }
+        FPL_UNLOCK;
+    }
+    // update the latest version.
+    if(latest_version != INVALID_VERSION) {
+        FPL_WRLOCK;
+        m_currMetaHeader.fields.ver = latest_version;
+        FPL_UNLOCK;
+    }
+}
+
+int64_t SegmentedPersistLog::inlinedDataIndex(int64_t idx, int64_t first_idx) {
+    const LogEntry* ple = entryAt(idx);
+    if(ple->fields.ref_dist == 0 || idx - static_cast<int64_t>(ple->fields.ref_dist) >= first_idx) {
+        return INVALID_INDEX;
+    }
+    return idx - ple->fields.ref_dist;
+}
+
+size_t SegmentedPersistLog::byteSizeOfLogEntry(int64_t idx, int64_t data_idx) {
+    size_t size = sizeof(LogEntry) + entryAt(idx)->fields.sdlen;
+    if(data_idx != INVALID_INDEX) {
+        size += dataSizeAt(data_idx);
+    }
+    return size;
+}
+
+size_t SegmentedPersistLog::writeLogEntryToByteArray(int64_t idx, char* ba, int64_t data_idx) {
+    const LogEntry* ple = entryAt(idx);
+    size_t nr_written = 0;
+    memcpy(ba, ple, sizeof(LogEntry));
+    nr_written += sizeof(LogEntry);
+    if(ple->fields.sdlen > 0) {
+        memcpy((void*)(ba + nr_written), signatureAt(idx), ple->fields.sdlen);
+        nr_written += ple->fields.sdlen;
+    }
+    if(data_idx != INVALID_INDEX) {
+        const uint64_t data_size = dataSizeAt(data_idx);
+        LogEntry* pcopy = reinterpret_cast<LogEntry*>(ba);
+        pcopy->fields.sdlen += data_size;
+        pcopy->fields.ref_dist = 0;
+        memcpy((void*)(ba + nr_written), dataAt(data_idx), data_size);
+        nr_written += data_size;
+    }
+    return nr_written;
+}
+
+size_t SegmentedPersistLog::postLogEntry(const std::function<void(char const* const, std::size_t)>& f,
+                                         int64_t idx, int64_t data_idx) {
+    const LogEntry* ple = entryAt(idx);
+    size_t nr_written = 0;
+    if(data_idx != INVALID_INDEX) {
+        LogEntry copy = *ple;
+        copy.fields.sdlen += dataSizeAt(data_idx);
+        copy.fields.ref_dist = 0;
+        f((const char*)&copy, sizeof(LogEntry));
+    } else {
+        f((const char*)ple, sizeof(LogEntry));
+    }
+    nr_written += sizeof(LogEntry);
+    if(ple->fields.sdlen > 0) {
+        f((const char*)signatureAt(idx), ple->fields.sdlen);
+        nr_written += ple->fields.sdlen;
+    }
+    if(data_idx != INVALID_INDEX) {
+        const uint64_t data_size = dataSizeAt(data_idx);
+        f((const char*)dataAt(data_idx), data_size);
+        nr_written += data_size;
+    }
+    return nr_written;
+}
+
+size_t SegmentedPersistLog::mergeLogEntryFromByteArray(const char* ba) {
+    const LogEntry* cple = (const LogEntry*)ba;
+    // valid check
+    // 0) version grows monotonically.
+    if(cple->fields.ver <= m_currMetaHeader.fields.ver) {
+        dbg_default_trace("{0} skip log entry version {1}, we are at {2}.", __func__, cple->fields.ver, m_currMetaHeader.fields.ver);
+        return cple->fields.sdlen + sizeof(LogEntry);
+    }
+    // 1) do we have space to merge it?
+    if(static_cast<uint64_t>(numUsedSlots()) >= m_iMaxLogEntry) {
+        dbg_default_trace("{0} failed to merge log entry, we don't empty log entry.", __func__);
+        throw PERSIST_EXP_NOSPACE_LOG;
+    }
+    // 2) an entry referring to earlier data refers to the same entry here,
+    // since both logs have an entry for every version before it.
+    uint64_t ref_dist = cple->fields.ref_dist;
+    if(ref_dist > 0) {
+        const int64_t ref_idx = m_currMetaHeader.fields.tail - static_cast<int64_t>(ref_dist);
+        if(ref_idx < m_currMetaHeader.fields.head) {
+            dbg_default_error("{0} failed to merge log entry version {1}, its data at index {2} is not in the log.",
+                              __func__, cple->fields.ver, ref_idx);
+            throw PERSIST_EXP_INV_ENTRY_IDX(ref_idx);
+        }
+        ref_dist += entryAt(ref_idx)->fields.ref_dist;
+    }
+    // too far back to refer to here, so the entry gets a copy of the data
+    const int64_t data_idx = (ref_dist > MAX_REF_DIST) ? m_currMetaHeader.fields.tail - static_cast<int64_t>(ref_dist) : INVALID_INDEX;
+    const uint64_t data_size = (data_idx == INVALID_INDEX) ? 0 : dataSizeAt(data_idx);
+    // 3) merge it!
+    ensureSpace(cple->fields.sdlen - signature_size - digest_size + data_size);
+    Segment* seg = m_segments.back().get();
+    const uint64_t ofst = nextDataOfst();
+    memcpy(seg->data() + ofst, (const void*)(ba + sizeof(LogEntry)), cple->fields.sdlen);
+    if(data_idx != INVALID_INDEX) {
+        memcpy(seg->data() + ofst + cple->fields.sdlen, dataAt(data_idx), data_size);
+        ref_dist = 0;
+    }
+    LogEntry* ple = seg->entries() + (m_currMetaHeader.fields.tail - seg->first_index);
+    memcpy(ple, cple, sizeof(LogEntry));
+    ple->fields.ofst = ofst;
+    ple->fields.sdlen = cple->fields.sdlen + data_size;
+    ple->fields.ref_dist = ref_dist;
+    if(m_currMetaHeader.fields.tail == seg->first_index) {
+        seg->first_version = cple->fields.ver;
+    }
+    this->hidx.insert(cple->fields.hlc_r, cple->fields.hlc_l, m_currMetaHeader.fields.tail);
+    m_currMetaHeader.fields.tail++;
+    m_currMetaHeader.fields.ver = cple->fields.ver;
+    dbg_default_trace("{0} merge log:log entry and meta data are updated.", __func__);
+    return cple->fields.sdlen + sizeof(LogEntry);
+}
+}  // namespace persistent
@@ -4,12 +4,17 @@
 #include <derecho/openssl/signature.hpp>
 #include <derecho/persistent/detail/util.hpp>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <set>
 #include <signal.h>
 #include <spdlog/spdlog.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <thread>
 #include <time.h>
+#include <unistd.h>
 #include <iomanip>
 
 using namespace persistent;
@@ -140,6 +145,10 @@ printhelp() {
     cout << "\tnologsave <int-value>" << endl;
     cout << "\tnologload" << endl;
     cout << "\teval <file|mem> <datasize> <num> [batch]" << endl;
+    cout << "\teval-append [datasize] [num]" << endl;
+    cout << "\tdirty-tracking [datasize] [num] [period]" << endl;
+    cout << "\tsegmented [datasize] [num]" << endl;
+    cout << "\tdeferred-restore [num-objects] [num-deltas]" << endl;
     cout << "\tlogtail-set <value> <version>" << endl;
     cout << "\tlogtail-list" << endl;
     cout << "\tlogtail-serialize [since-ver]" << endl;
@@ -150,6 +159,8 @@ printhelp() {
     cout << "\tdelta-sub <op> <version>" << endl;
     cout << "\tdelta-getbyidx <index>" << endl;
     cout << "\tdelta-getbyver <version>" << endl;
+    cout << "\tdelta-lookup <max-log-length> [num-lookups]" << endl;
+    cout << "\thlc-index <num-entries> [num-lookups] [num-senders]" << endl;
     cout << "NOTICE: test can crash if <datasize> is too large(>8MB).\n"
          << "This is probably due to the stack size is limited. Try \n"
          << "  \"ulimit -s unlimited\"\n"
@@ -235,6 +246,526 @@ static void eval_write(std::size_t osize, int nops, bool batch) {
     cout << "latency:\t" << lat_us << " microseconds" << endl;
 }
 
+// Compare the two ways to log a whole object: serializing it into a heap
+// buffer that append() copies into the log, which is what Persistent<T>::set
+// used to do, and serializing it in place with reserve()/commit().
+static void eval_append(std::size_t osize, int nops) {
+    auto writeMe = std::make_unique<VariableBytes>();
+    writeMe->data_len = osize;
+    memset(writeMe->buf, 'a', osize);
+    struct timespec ts, te;
+
+    FilePersistLog copy_log("EvalAppendCopy", false);
+    int64_t ver = copy_log.getLatestVersion();
+    ver = (ver == INVALID_VERSION) ? 0 : ver + 1;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    for(int i = 0; i < nops; i++) {
+        auto size = mutils::bytes_size(*writeMe);
+        char* buf = new char[size];
+        bzero(buf, size);
+        mutils::to_bytes(*writeMe, buf);
+        copy_log.append(buf, size, ver++, HLC{});
+        delete[] buf;
+    }
+    clock_gettime(CLOCK_REALTIME, &te);
+    copy_log.persist(ver - 1);
+    double copy_nsec = (te.tv_sec - ts.tv_sec) * 1e9 + te.tv_nsec - ts.tv_nsec;
+
+    Persistent<VariableBytes> pvar([]() { return std::make_unique<VariableBytes>(); }, "EvalAppendInPlace", nullptr);
+    ver = pvar.getLatestVersion();
+    ver = (ver == INVALID_VERSION) ? 0 : ver + 1;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    for(int i = 0; i < nops; i++) {
+        pvar.set(*writeMe, ver++);
+    }
+    clock_gettime(CLOCK_REALTIME, &te);
+    pvar.persist(ver - 1);
+    double in_place_nsec = (te.tv_sec - ts.tv_sec) * 1e9 + te.tv_nsec - ts.tv_nsec;
+
+    cout << "APPEND TEST(size=" << osize << " byte, ops=" << nops << ")" << endl;
+    cout << "method\tthroughput(MB/s)\tlatency(us)" << endl;
+    cout << "copy\t" << (double)osize * nops / copy_nsec * 1000 << "\t" << copy_nsec / nops / 1000 << endl;
+    cout << "in-place\t" << (double)osize * nops / in_place_nsec * 1000 << "\t" << in_place_nsec / nops / 1000 << endl;
+}
+
+// Check that versions logged with commitIfChanged(), where the data changes
+// every 'period' versions, read back the data of the version that last changed
+// it, after trimming and after applying the log tail to another log too.
+static bool check_versions(PersistLog& log, version_t from, version_t to, version_t first_ver,
+                           std::size_t osize, int period) {
+    for(version_t ver = from; ver <= to; ver++) {
+        const char* pdat = static_cast<const char*>(log.getEntry(ver, true));
+        const char expected = 'a' + ((ver - first_ver) / period) % 26;
+        if(pdat == nullptr) {
+            cout << log.m_sName << ": version " << ver << " is missing" << endl;
+            return false;
+        }
+        for(std::size_t i = 0; i < osize; i++) {
+            if(pdat[i] != expected) {
+                cout << log.m_sName << ": version " << ver << " has '" << pdat[i]
+                     << "' at byte " << i << ", expected '" << expected << "'" << endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Apply the log tail of a log to another one the way state transfer does,
+// reading it from a stream in the pieces post_object() posts it in.
+static void apply_streamed_log_tail(PersistLog& log, PersistLog& tail_log, version_t since_ver) {
+    std::vector<char> stream;
+    log.post_object([&stream](char const* const bytes, std::size_t size) {
+        stream.insert(stream.end(), bytes, bytes + size);
+    },
+                    since_ver);
+    std::size_t ofst = 0;
+    tail_log.applyLogTail([&stream, &ofst](char* buf, std::size_t size) {
+        memcpy(buf, stream.data() + ofst, size);
+        ofst += size;
+    });
+}
+
+static void test_dirty_tracking(std::size_t osize, int nops, int period) {
+    FilePersistLog log("DirtyTrackingTest", false);
+    FilePersistLog tail_log("DirtyTrackingLogTail", false);
+    FilePersistLog streamed_tail_log("DirtyTrackingStreamedLogTail", false);
+    version_t first_ver = std::max(log.getLatestVersion(), tail_log.getLatestVersion()) + 1;
+    version_t last_ver = first_ver + nops - 1;
+    int num_logged = 0;
+    struct timespec ts, te;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    for(version_t ver = first_ver; ver <= last_ver; ver++) {
+        char* buf = log.reserve(osize);
+        memset(buf, 'a' + ((ver - first_ver) / period) % 26, osize);
+        if(log.commitIfChanged(ver, HLC{})) {
+            num_logged++;
+        }
+    }
+    clock_gettime(CLOCK_REALTIME, &te);
+    log.persist(last_ver);
+    double nsec = (te.tv_sec - ts.tv_sec) * 1e9 + te.tv_nsec - ts.tv_nsec;
+
+    // A version is logged when its data changes, or when the entry holding its data is too far back
+    const uint64_t max_ref_dist = std::min<uint64_t>(MAX_LOG_REF_DIST, derecho::getConfUInt64(CONF_PERS_MAX_LOG_ENTRY) / 4);
+    int expected_logged = 0;
+    uint64_t ref_dist = 0;
+    for(int i = 0; i < nops; i++) {
+        if(i % period == 0 || ref_dist == max_ref_dist) {
+            expected_logged++;
+            ref_dist = 0;
+        } else {
+            ref_dist++;
+        }
+    }
+
+    cout << "DIRTY TRACKING TEST(size=" << osize << " byte, ops=" << nops << ", period=" << period << ")" << endl;
+    cout << "versions logged:\t" << num_logged << " of " << nops << endl;
+    cout << "latency:\t" << nsec / nops / 1000 << " microseconds" << endl;
+    if(num_logged != expected_logged) {
+        cout << "FAILED: expected " << expected_logged << " versions to be logged" << endl;
+        return;
+    }
+    if(!check_versions(log, first_ver, last_ver, first_ver, osize, period)) {
+        cout << "FAILED: read after append" << endl;
+        return;
+    }
+
+    // Trim in the middle of a run of unchanged versions; the data they refer to must stay.
+    version_t trim_ver = first_ver + nops / 2;
+    log.trim(trim_ver);
+    if(log.getEarliestVersion() > trim_ver + 1
+       || !check_versions(log, trim_ver + 1, last_ver, first_ver, osize, period)) {
+        cout << "FAILED: read after trim(" << trim_ver << ")" << endl;
+        return;
+    }
+
+    // The tail starts in the middle of a run too, so its first entry carries the data.
+    version_t since_ver = std::max(tail_log.getLatestVersion(), first_ver + nops * 3 / 4);
+    std::size_t tail_size = log.bytes_size(since_ver);
+    std::vector<char> tail(tail_size);
+    log.to_bytes(tail.data(), since_ver);
+    tail_log.applyLogTail(tail.data());
+    tail_log.persist(last_ver);
+    if(!check_versions(tail_log, since_ver + 1, last_ver, first_ver, osize, period)) {
+        cout << "FAILED: read after applying the log tail since version " << since_ver << endl;
+        return;
+    }
+    since_ver = std::max(streamed_tail_log.getLatestVersion(), first_ver + nops * 3 / 4);
+    apply_streamed_log_tail(log, streamed_tail_log, since_ver);
+    streamed_tail_log.persist(last_ver);
+    if(!check_versions(streamed_tail_log, since_ver + 1, last_ver, first_ver, osize, period)) {
+        cout << "FAILED: read after applying the streamed log tail since version " << since_ver << endl;
+        return;
+    }
+
+    // Trimming a log whose data never changes must free all but the last few entries.
+    FilePersistLog unchanged_log("DirtyTrackingUnchanged", false);
+    version_t unchanged_first_ver = unchanged_log.getLatestVersion() + 1;
+    version_t unchanged_last_ver = unchanged_first_ver + nops - 1;
+    for(version_t ver = unchanged_first_ver; ver <= unchanged_last_ver; ver++) {
+        char* buf = unchanged_log.reserve(osize);
+        memset(buf, 'a', osize);
+        unchanged_log.commitIfChanged(ver, HLC{});
+    }
+    unchanged_log.persist(unchanged_last_ver);
+    unchanged_log.trim(unchanged_last_ver - 1);
+    if(static_cast<uint64_t>(unchanged_log.getLength()) > max_ref_dist + 1
+       || !check_versions(unchanged_log, unchanged_last_ver, unchanged_last_ver, unchanged_first_ver, osize, nops)) {
+        cout << "FAILED: trim(" << unchanged_last_ver - 1 << ") of " << nops << " unchanged versions kept "
+             << unchanged_log.getLength() << " entries, at most " << max_ref_dist + 1 << " expected" << endl;
+        return;
+    }
+    cout << "PASSED" << endl;
+}
+
+// Check that every version in [from, to] of a log filled by test_segmented() is there.
+static bool check_segmented(PersistLog& log, version_t from, version_t to, version_t first_ver, std::size_t osize) {
+    for(version_t ver = from; ver <= to; ver++) {
+        const char* pdat = static_cast<const char*>(log.getEntry(ver, true));
+        const char expected = 'a' + (ver - first_ver) % 26;
+        if(pdat == nullptr || pdat[0] != expected || pdat[osize - 1] != expected) {
+            cout << log.m_sName << ": version " << ver << " is missing or wrong" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Append enough entries to a SegmentedPersistLog to fill several segments
+// (PERS/segment_log_entry sets the entries per segment), then read them back
+// after trimming, truncating, applying the log tail and reloading the log.
+static void test_segmented(std::size_t osize, int nops) {
+    std::vector<char> buf(osize);
+    version_t first_ver;
+    version_t last_ver;
+    struct timespec ts, te;
+    {
+        SegmentedPersistLog log("SegmentedTest", false);
+        SegmentedPersistLog tail_log("SegmentedLogTail", false);
+        SegmentedPersistLog streamed_tail_log("SegmentedStreamedLogTail", false);
+        first_ver = std::max(log.getLatestVersion(), tail_log.getLatestVersion()) + 1;
+        last_ver = first_ver + nops - 1;
+
+        clock_gettime(CLOCK_REALTIME, &ts);
+        for(version_t ver = first_ver; ver <= last_ver; ver++) {
+            memset(buf.data(), 'a' + (ver - first_ver) % 26, osize);
+            log.append(buf.data(), osize, ver, HLC{});
+        }
+        log.persist(last_ver);
+        clock_gettime(CLOCK_REALTIME, &te);
+        double nsec = (te.tv_sec - ts.tv_sec) * 1e9 + te.tv_nsec - ts.tv_nsec;
+        cout << "SEGMENTED LOG TEST(size=" << osize << " byte, ops=" << nops << ")" << endl;
+        cout << "append throughput:	" << (double)osize * nops / nsec * 1000 << " MB/s" << endl;
+        cout << "segments:	" << log.getNumSegments() << endl;
+        if(!check_segmented(log, first_ver, last_ver, first_ver, osize)) {
+            cout << "FAILED: read after append" << endl;
+            return;
+        }
+
+        // the segments before the one holding the new earliest entry go to the cold path
+        std::size_t num_segments = log.getNumSegments();
+        version_t trim_ver = first_ver + nops / 2;
+        log.trim(trim_ver);
+        cout << "segments after trim(" << trim_ver << "):	" << log.getNumSegments() << endl;
+        if(log.getEarliestVersion() != trim_ver + 1 || log.getNumSegments() > num_segments
+           || !check_segmented(log, trim_ver + 1, last_ver, first_ver, osize)) {
+            cout << "FAILED: read after trim(" << trim_ver << ")" << endl;
+            return;
+        }
+
+        // truncate into an earlier segment, then append over the truncated versions
+        version_t truncate_ver = last_ver - nops / 4;
+        log.truncate(truncate_ver);
+        if(log.getLatestVersion() != truncate_ver) {
+            cout << "FAILED: the latest version after truncate(" << truncate_ver << ") is " << log.getLatestVersion() << endl;
+            return;
+        }
+        for(version_t ver = truncate_ver + 1; ver <= last_ver; ver++) {
+            memset(buf.data(), 'a' + (ver - first_ver) % 26, osize);
+            log.append(buf.data(), osize, ver, HLC{});
+        }
+        log.persist(last_ver);
+        if(!check_segmented(log, trim_ver + 1, last_ver, first_ver, osize)) {
+            cout << "FAILED: read after truncate(" << truncate_ver << ")" << endl;
+            return;
+        }
+
+        version_t since_ver = std::max(tail_log.getLatestVersion(), trim_ver);
+        std::vector<char> tail(log.bytes_size(since_ver));
+        log.to_bytes(tail.data(), since_ver);
+        tail_log.applyLogTail(tail.data());
+        tail_log.persist(last_ver);
+        if(!check_segmented(tail_log, since_ver + 1, last_ver, first_ver, osize)) {
+            cout << "FAILED: read after applying the log tail since version " << since_ver << endl;
+            return;
+        }
+        since_ver = std::max(streamed_tail_log.getLatestVersion(), trim_ver);
+        apply_streamed_log_tail(log, streamed_tail_log, since_ver);
+        streamed_tail_log.persist(last_ver);
+        if(!check_segmented(streamed_tail_log, since_ver + 1, last_ver, first_ver, osize)) {
+            cout << "FAILED: read after applying the streamed log tail since version " << since_ver << endl;
+            return;
+        }
+    }
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    SegmentedPersistLog log("SegmentedTest", false);
+    clock_gettime(CLOCK_REALTIME, &te);
+    cout << "reload:	" << ((te.tv_sec - ts.tv_sec) * 1e9 + te.tv_nsec - ts.tv_nsec) / 1e6 << " ms" << endl;
+    if(log.getLatestVersion() != last_ver
+       || !check_segmented(log, log.getEarliestVersion(), last_ver, first_ver, osize)) {
+        cout << "FAILED: read after reload" << endl;
+        return;
+    }
+
+    // reading the log mapped every segment; the next append unmaps the least recently read ones
+    const uint64_t max_mapped = derecho::getConfUInt64(CONF_PERS_MAX_MAPPED_SEGMENTS);
+    memset(buf.data(), 'a' + (last_ver + 1 - first_ver) % 26, osize);
+    log.append(buf.data(), osize, last_ver + 1, HLC{});
+    cout << "mapped segments:	" << log.getNumMappedSegments() << endl;
+    if((max_mapped > 0 && log.getNumMappedSegments() > max_mapped)
+       || !check_segmented(log, log.getEarliestVersion(), last_ver + 1, first_ver, osize)) {
+        cout << "FAILED: read after unmapping segments" << endl;
+        return;
+    }
+
+    // appends unmap the segments a concurrent reader maps, but not while it reads them
+    std::atomic<bool> appending{true};
+    std::atomic<bool> read_failed{false};
+    const version_t earliest_ver = log.getEarliestVersion();
+    std::thread reader([&]() {
+        for(version_t ver = earliest_ver; appending; ver = (ver < last_ver) ? ver + 1 : earliest_ver) {
+            PersistLog::ReadGuard read_guard(log);
+            const char* pdat = static_cast<const char*>(log.getEntry(ver, true));
+            const char expected = 'a' + (ver - first_ver) % 26;
+            if(pdat == nullptr || std::count(pdat, pdat + osize, expected) != static_cast<long>(osize)) {
+                read_failed = true;
+            }
+        }
+    });
+    const version_t appended_ver = last_ver + nops / 10;
+    for(version_t ver = last_ver + 2; ver <= appended_ver; ver++) {
+        memset(buf.data(), 'a' + (ver - first_ver) % 26, osize);
+        log.append(buf.data(), osize, ver, HLC{});
+    }
+    appending = false;
+    reader.join();
+    if(read_failed) {
+        cout << "FAILED: read while appending" << endl;
+        return;
+    }
+    cout << "PASSED" << endl;
+}
+
+// Restore delta objects the way a Group does when it restarts: preload their
+// logs, construct them with the restore deferred, and replay the deltas of all
+// of them on the preloader's thread pool.
+static void test_deferred_restore(int nobjs, int nops) {
+    PersistentRegistry pr(nullptr, typeid(ReplicatedT), 456, 0);
+    const std::string prefix = pr.getSubgroupPrefix();
+    auto make_objects = [&]() {
+        std::vector<Persistent<IntegerWithDelta>> objects;
+        // moving the objects while they wait for their restore moves their registration
+        for(int i = 0; i < nobjs; i++) {
+            objects.emplace_back([]() { return std::make_unique<IntegerWithDelta>(); },
+                                 (prefix + "-DeferredRestore" + std::to_string(i)).c_str(), &pr);
+        }
+        return objects;
+    };
+    std::vector<int> expected;
+    {
+        std::vector<Persistent<IntegerWithDelta>> objects = make_objects();
+        for(int i = 0; i < nobjs; i++) {
+            const version_t first_ver = objects[i].getLatestVersion() + 1;
+            for(version_t ver = first_ver; ver < first_ver + nops; ver++) {
+                (*objects[i]).add(i + 1);
+                objects[i].version(ver);
+            }
+            objects[i].persist(first_ver + nops - 1);
+            expected.push_back((*objects[i]).value);
+        }
+    }
+
+    cout << "DEFERRED RESTORE TEST(objects=" << nobjs << ", deltas=" << nops << ")" << endl;
+    cout << "preloaded logs:	" << LogPreloader::preload({prefix}) << endl;
+    LogPreloader::deferRestores(true);
+    std::vector<Persistent<IntegerWithDelta>> objects = make_objects();
+    LogPreloader::deferRestores(false);
+    // reading an object before finishRestores() restores it on the spot
+    if((*objects[0]).value != expected[0]) {
+        cout << "FAILED: object 0 read before finishRestores() is " << (*objects[0]).value << endl;
+        return;
+    }
+    // readers on other threads race finishRestores() to restore the other objects
+    std::atomic<bool> read_failed{false};
+    std::vector<std::thread> readers;
+    for(int t = 0; t < 4; t++) {
+        readers.emplace_back([&]() {
+            for(int i = 1; i < nobjs; i++) {
+                const Persistent<IntegerWithDelta>& object = objects[i];
+                if(object.getConstRef().value != expected[i]) {
+                    read_failed = true;
+                }
+            }
+        });
+    }
+    LogPreloader::finishRestores();
+    for(auto& reader : readers) {
+        reader.join();
+    }
+    if(read_failed) {
+        cout << "FAILED: an object read during finishRestores() has the wrong value" << endl;
+        return;
+    }
+    for(int i = 0; i < nobjs; i++) {
+        if((*objects[i]).value != expected[i]) {
+            cout << "FAILED: object " << i << " is " << (*objects[i]).value << " instead of " << expected[i] << endl;
+            return;
+        }
+    }
+    cout << "PASSED" << endl;
+}
+
+// Measure the latency of reconstructing historical states of a delta object as the log grows.
+// The checkpoint policy comes from PERS/delta_checkpoint_interval and PERS/delta_checkpoint_bytes;
+// run it once with and once without checkpoints to compare.
+static void eval_delta_lookup(int64_t max_len, int nlookups) {
+    Persistent<IntegerWithDelta, ST_MEM> dvar([]() { return std::make_unique<IntegerWithDelta>(); }, "DeltaLookupEval");
+    int64_t ver = 0;
+    int64_t len = 0;
+    struct timespec ts, te;
+    srand(time(nullptr));
+
+    cout << "DELTA LOOKUP TEST(checkpoint_interval=" << derecho::getConfUInt64(CONF_PERS_DELTA_CHECKPOINT_INTERVAL)
+         << ", checkpoint_bytes=" << derecho::getConfUInt64(CONF_PERS_DELTA_CHECKPOINT_BYTES)
+         << ", lookups=" << nlookups << ")" << endl;
+    cout << "log_length\tlatest(us)\trandom(us)" << endl;
+    for(int64_t target = 1024; target <= max_len; target <<= 1) {
+        while(len < target) {
+            (*dvar).add(1);
+            dvar.version(ver++);
+            len++;
+        }
+        dvar.persist(ver - 1);
+        const int64_t earliest = dvar.getEarliestIndex();
+        // the latest state
+        clock_gettime(CLOCK_REALTIME, &ts);
+        for(int i = 0; i < nlookups; i++) {
+            if(dvar.getByIndex(earliest + len - 1)->value != len) {
+                cerr << "wrong value at index " << (earliest + len - 1) << endl;
+                return;
+            }
+        }
+        clock_gettime(CLOCK_REALTIME, &te);
+        double latest_us = ((te.tv_sec - ts.tv_sec) * 1e9 + te.tv_nsec - ts.tv_nsec) / nlookups / 1e3;
+        // random historical states
+        clock_gettime(CLOCK_REALTIME, &ts);
+        for(int i = 0; i < nlookups; i++) {
+            int64_t offset = rand() % len;
+            if(dvar.getByIndex(earliest + offset)->value != offset + 1) {
+                cerr << "wrong value at index " << (earliest + offset) << endl;
+                return;
+            }
+        }
+        clock_gettime(CLOCK_REALTIME, &te);
+        double random_us = ((te.tv_sec - ts.tv_sec) * 1e9 + te.tv_nsec - ts.tv_nsec) / nlookups / 1e3;
+        cout << len << "\t" << latest_us << "\t" << random_us << endl;
+    }
+}
+
+// resident set size of this process in bytes
+static int64_t get_rss_bytes() {
+    long pages = 0, resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if(statm == nullptr) {
+        return 0;
+    }
+    if(fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(statm);
+    return static_cast<int64_t>(resident) * sysconf(_SC_PAGESIZE);
+}
+
+// Compare the memory footprint and lookup latency of the HLC index with the
+// std::set<HLC-holding entry> it replaced. Timestamps come from num_senders
+// senders whose clocks are a few microseconds apart, so appends arrive slightly
+// out of order, as they do in a subgroup with several senders.
+static void eval_hlc_index(int64_t num_entries, int nlookups, int num_senders) {
+    struct legacy_entry {
+        HLC hlc;
+        int64_t log_idx;
+    };
+    struct legacy_comp {
+        bool operator()(const legacy_entry& e1, const legacy_entry& e2) const {
+            return e1.hlc < e2.hlc;
+        }
+    };
+    std::vector<std::pair<uint64_t, uint64_t>> stamps(num_entries);
+    for(int64_t i = 0; i < num_entries; i++) {
+        stamps[i] = {static_cast<uint64_t>(i / num_senders) * 10 + (i % num_senders) * 7, 0};
+    }
+    srand(time(nullptr));
+    std::vector<int64_t> probes(nlookups);
+    for(int i = 0; i < nlookups; i++) {
+        probes[i] = rand() % num_entries;
+    }
+    struct timespec ts, te;
+    cout << "HLC INDEX TEST(entries=" << num_entries << ", lookups=" << nlookups
+         << ", senders=" << num_senders << ")" << endl;
+    cout << "index\tinsert(ns)\trss(bytes/entry)\tlookup(ns)" << endl;
+    std::vector<int64_t> legacy_results(nlookups);
+    {
+        int64_t rss_before = get_rss_bytes();
+        std::set<legacy_entry, legacy_comp> legacy;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        for(int64_t i = 0; i < num_entries; i++) {
+            legacy.insert(legacy_entry{HLC{stamps[i].first, stamps[i].second}, i});
+        }
+        clock_gettime(CLOCK_REALTIME, &te);
+        double insert_ns = ((te.tv_sec - ts.tv_sec) * 1e9 + te.tv_nsec - ts.tv_nsec) / num_entries;
+        double rss_per_entry = (double)(get_rss_bytes() - rss_before) / num_entries;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        for(int i = 0; i < nlookups; i++) {
+            HLC key{stamps[probes[i]].first, stamps[probes[i]].second};
+            auto it = legacy.upper_bound(legacy_entry{key, 0});
+            legacy_results[i] = (it == legacy.begin()) ? INVALID_INDEX : std::prev(it)->log_idx;
+        }
+        clock_gettime(CLOCK_REALTIME, &te);
+        double lookup_ns = ((te.tv_sec - ts.tv_sec) * 1e9 + te.tv_nsec - ts.tv_nsec) / nlookups;
+        cout << "std::set\t" << insert_ns << "\t" << rss_per_entry << "\t" << lookup_ns << endl;
+    }
+    {
+        int64_t rss_before = get_rss_bytes();
+        HLCIndex index;
+        index.reserve(num_entries);
+        clock_gettime(CLOCK_REALTIME, &ts);
+        for(int64_t i = 0; i < num_entries; i++) {
+            index.insert(stamps[i].first, stamps[i].second, i);
+        }
+        clock_gettime(CLOCK_REALTIME, &te);
+        double insert_ns = ((te.tv_sec - ts.tv_sec) * 1e9 + te.tv_nsec - ts.tv_nsec) / num_entries;
+        double rss_per_entry = (double)(get_rss_bytes() - rss_before) / num_entries;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        for(int i = 0; i < nlookups; i++) {
+            index.lookup(stamps[probes[i]].first, stamps[probes[i]].second);
+        }
+        clock_gettime(CLOCK_REALTIME, &te);
+        double lookup_ns = ((te.tv_sec - ts.tv_sec) * 1e9 + te.tv_nsec - ts.tv_nsec) / nlookups;
+        cout << "HLCIndex\t" << insert_ns << "\t" << rss_per_entry << "\t" << lookup_ns << endl;
+        for(int i = 0; i < nlookups; i++) {
+            int64_t idx = index.lookup(stamps[probes[i]].first, stamps[probes[i]].second);
+            if(idx != legacy_results[i]) {
+                cerr << "lookup mismatch for entry " << probes[i] << ": " << idx
+                     << " != " << legacy_results[i] << endl;
+                return;
+            }
+        }
+    }
+}
+
 int main(int argc, char** argv) {
     spdlog::set_level(spdlog::level::trace);
 
@@ -487,6 +1018,27 @@ int main(int argc, char** argv) {
             } else {
                 cout << "unknown storage type:" << argv[2] << endl;
             }
+        } else if(strcmp(argv[1], "eval-append") == 0) {
+            // eval-append [osize] [nops], 1MB objects by default
+            std::size_t osize = (argc >= 3) ? std::stoull(argv[2]) : (1ull << 20);
+            int nops = (argc >= 4) ? std::stoi(argv[3]) : 1000;
+            eval_append(osize, nops);
+        } else if(strcmp(argv[1], "dirty-tracking") == 0) {
+            // dirty-tracking [osize] [nops] [period], 64KB objects changing every 4th version by default
+            std::size_t osize = (argc >= 3) ? std::stoull(argv[2]) : (1ull << 16);
+            int nops = (argc >= 4) ? std::stoi(argv[3]) : 1000;
+            int period = (argc >= 5) ? std::stoi(argv[4]) : 4;
+            test_dirty_tracking(osize, nops, period);
+        } else if(strcmp(argv[1], "segmented") == 0) {
+            // segmented [osize] [nops], 64B objects by default, which span several segments
+            std::size_t osize = (argc >= 3) ? std::stoull(argv[2]) : 64;
+            int nops = (argc >= 4) ? std::stoi(argv[3]) : 200000;
+            test_segmented(osize, nops);
+        } else if(strcmp(argv[1], "deferred-restore") == 0) {
+            // deferred-restore [nobjs] [nops], 16 objects of 1000 deltas by default
+            int nobjs = (argc >= 3) ? std::stoi(argv[2]) : 16;
+            int nops = (argc >= 4) ? std::stoi(argv[3]) : 1000;
+            test_deferred_restore(nobjs, nops);
         } else if(strcmp(argv[1], "delta-add") == 0) {
             int op = std::stoi(argv[2]);
             int64_t ver = (int64_t)atoi(argv[3]);
@@ -512,6 +1064,15 @@ int main(int argc, char** argv) {
             cout << "dx[ver:" << version << "] = " << dx[version]->value << endl;
             cout << "dx.delta[ver:" << version << "] = " << *dx.template getDelta<int>(version) << "\t- by copy" << endl;
             dx.template getDelta<int>(version, [version](const int& x){ cout << "dx.delta[ver:" << version << "] = " << x << "\t- by lambda" << std::endl;});
+        } else if(strcmp(argv[1], "delta-lookup") == 0) {
+            int64_t max_len = std::stoll(argv[2]);
+            int nlookups = (argc >= 4) ? std::stoi(argv[3]) : 100;
+            eval_delta_lookup(max_len, nlookups);
+        } else if(strcmp(argv[1], "hlc-index") == 0) {
+            int64_t num_entries = std::stoll(argv[2]);
+            int nlookups = (argc >= 4) ? std::stoi(argv[3]) : 1000000;
+            int num_senders = (argc >= 5) ? std::stoi(argv[4]) : 4;
+            eval_hlc_index(num_entries, nlookups, num_senders);
         } else {
             cout << "unknown command: " << argv[1] << endl;
             printhelp();
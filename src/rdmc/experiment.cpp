@@ -51,7 +51,7 @@ uint16_t next_group_number;
 send_stats measure_partially_concurrent_multicast(
         size_t size, size_t block_size, uint32_t group_size, uint32_t num_senders,
         size_t iterations, rdmc::send_algorithm type = rdmc::BINOMIAL_SEND,
-        bool use_cv = true) {
+        bool use_cv = true, const map<uint32_t, uint32_t> &node_racks = {}) {
     if(node_rank >= group_size) {
         // Each iteration involves two barriers: one at the start and one at the
         // end.
@@ -97,7 +97,8 @@ send_stats measure_partially_concurrent_multicast(
                 [group_number = base_group_number + i](std::optional<uint32_t>) {
                     LOG_EVENT(group_number, -1, -1, "send_failed");
                     CHECK(false);
-                }));
+                },
+                node_racks));
     }
 
     vector<double> rates;
@@ -161,9 +162,230 @@ send_stats measure_partially_concurrent_multicast(
 send_stats measure_multicast(size_t size, size_t block_size,
                              uint32_t group_size, size_t iterations,
                              rdmc::send_algorithm type = rdmc::BINOMIAL_SEND,
-                             bool use_cv = true) {
+                             bool use_cv = true,
+                             const map<uint32_t, uint32_t> &node_racks = {}) {
     return measure_partially_concurrent_multicast(size, block_size, group_size,
-                                                  1, iterations, type, use_cv);
+                                                  1, iterations, type, use_cv,
+                                                  node_racks);
+}
+
+// Measures the bandwidth of num_messages messages that the root passes to
+// rdmc::send back to back, so that RDMC pipelines them, against sending each
+// message only after the previous one has completed.
+send_stats measure_pipelined_multicast(size_t size, size_t block_size,
+                                       uint32_t group_size, size_t num_messages,
+                                       size_t iterations, bool pipelined,
+                                       rdmc::send_algorithm type = rdmc::BINOMIAL_SEND) {
+    if(node_rank >= group_size) {
+        for(size_t i = 0; i < iterations * 2; i++) {
+            universal_barrier_group->barrier_wait();
+        }
+
+        return send_stats();
+    }
+
+    std::mutex send_mutex;
+    std::condition_variable send_done_cv;
+    atomic<uint64_t> end_time;
+    atomic<uint64_t> end_ptime;
+
+    size_t num_blocks = (size - 1) / block_size + 1;
+    size_t buffer_size = num_blocks * block_size;
+    auto mr = make_shared<memory_region>(buffer_size * num_messages);
+    char *buffer = mr->buffer;
+
+    uint16_t group_number = next_group_number;
+    atomic<size_t> messages_received;
+    size_t next_receive = 0;
+
+    vector<uint32_t> members;
+    for(uint32_t j = 0; j < group_size; j++) {
+        members.push_back(j);
+    }
+    CHECK(rdmc::create_group(
+            group_number, members, block_size, type,
+            [&mr, &next_receive, buffer_size, num_messages](size_t length) -> rdmc::receive_destination {
+                return {mr, buffer_size * (next_receive++ % num_messages)};
+            },
+            [&](char *data, size_t) {
+                if(++messages_received == num_messages) {
+                    universal_barrier_group->barrier_wait();
+                    end_ptime = get_process_time();
+                    end_time = get_time();
+                }
+                unique_lock<mutex> lk(send_mutex);
+                send_done_cv.notify_all();
+            },
+            [group_number](std::optional<uint32_t>) {
+                LOG_EVENT(group_number, -1, -1, "send_failed");
+                CHECK(false);
+            }));
+
+    vector<double> rates;
+    vector<double> times;
+    vector<double> cpu_usages;
+
+    for(size_t i = 0; i < iterations; i++) {
+        messages_received = 0;
+        end_time = 0;
+        end_ptime = 0;
+
+        if(node_rank == 0) {
+            for(size_t j = 0; j < buffer_size * num_messages; j += 256)
+                buffer[j] = (rand() >> 5) % 256;
+        }
+
+        universal_barrier_group->barrier_wait();
+
+        uint64_t start_ptime = get_process_time();
+        uint64_t start_time = get_time();
+
+        if(node_rank == 0) {
+            for(size_t m = 0; m < num_messages; m++) {
+                if(!pipelined) {
+                    unique_lock<mutex> lk(send_mutex);
+                    send_done_cv.wait(lk, [&] { return messages_received == m; });
+                }
+                CHECK(rdmc::send(group_number, mr, buffer_size * m, size));
+            }
+        }
+
+        {
+            unique_lock<mutex> lk(send_mutex);
+            send_done_cv.wait(lk, [&] { return end_time != 0; });
+        }
+
+        uint64_t time_diff = end_time - start_time;
+        uint64_t ptime_diff = end_ptime - start_ptime;
+        rates.push_back(8.0 * size * num_messages / time_diff);
+        times.push_back(1.0e-6 * time_diff);
+        cpu_usages.push_back((double)ptime_diff / time_diff);
+    }
+
+    rdmc::destroy_group(group_number);
+
+    send_stats s;
+    s.size = size;
+    s.block_size = block_size;
+    s.group_size = group_size;
+    s.iterations = iterations;
+
+    s.time.mean = compute_mean(times);
+    s.time.stddev = compute_stddev(times);
+    s.bandwidth.mean = compute_mean(rates);
+    s.bandwidth.stddev = compute_stddev(rates);
+    s.cpu_usage.mean = compute_mean(cpu_usages);
+    s.cpu_usage.stddev = compute_stddev(cpu_usages);
+    return s;
+}
+
+// Measures the bandwidth of messages made of a small header and a large
+// payload in the root's own memory, either sent with the scatter-gather
+// rdmc::send, or first copied into one registered buffer as a sender without
+// it would do. The time of the copy counts.
+send_stats measure_scatter_gather_multicast(size_t size, size_t block_size,
+                                            uint32_t group_size, size_t iterations,
+                                            bool scatter_gather,
+                                            rdmc::send_algorithm type = rdmc::BINOMIAL_SEND) {
+    if(node_rank >= group_size) {
+        for(size_t i = 0; i < iterations * 2; i++) {
+            universal_barrier_group->barrier_wait();
+        }
+
+        return send_stats();
+    }
+
+    std::mutex send_mutex;
+    std::condition_variable send_done_cv;
+    atomic<uint64_t> end_time;
+    atomic<uint64_t> end_ptime;
+
+    const size_t header_size = 64;
+    char header[header_size] = {};
+    unique_ptr<char[]> payload(new char[size - header_size]);
+    // Registered once, like an application buffer that is sent from repeatedly
+    rdmc::register_memory(payload.get(), size - header_size);
+    auto mr = make_shared<memory_region>(size);
+
+    uint16_t group_number = next_group_number;
+    vector<uint32_t> members;
+    for(uint32_t j = 0; j < group_size; j++) {
+        members.push_back(j);
+    }
+    CHECK(rdmc::create_group(
+            group_number, members, block_size, type,
+            [&mr](size_t length) -> rdmc::receive_destination {
+                return {mr, 0};
+            },
+            [&](char *data, size_t) {
+                universal_barrier_group->barrier_wait();
+                end_ptime = get_process_time();
+                end_time = get_time();
+                unique_lock<mutex> lk(send_mutex);
+                send_done_cv.notify_all();
+            },
+            [group_number](std::optional<uint32_t>) {
+                LOG_EVENT(group_number, -1, -1, "send_failed");
+                CHECK(false);
+            }));
+
+    vector<double> rates;
+    vector<double> times;
+    vector<double> cpu_usages;
+
+    for(size_t i = 0; i < iterations; i++) {
+        end_time = 0;
+        end_ptime = 0;
+
+        if(node_rank == 0) {
+            for(size_t j = 0; j < size - header_size; j += 256)
+                payload[j] = (rand() >> 5) % 256;
+        }
+
+        universal_barrier_group->barrier_wait();
+
+        uint64_t start_ptime = get_process_time();
+        uint64_t start_time = get_time();
+
+        if(node_rank == 0) {
+            if(scatter_gather) {
+                CHECK(rdmc::send(group_number, {{header, header_size},
+                                                {payload.get(), size - header_size}}));
+            } else {
+                memcpy(mr->buffer, header, header_size);
+                memcpy(mr->buffer + header_size, payload.get(), size - header_size);
+                CHECK(rdmc::send(group_number, mr, 0, size));
+            }
+        }
+
+        {
+            unique_lock<mutex> lk(send_mutex);
+            send_done_cv.wait(lk, [&] { return end_time != 0; });
+        }
+
+        uint64_t time_diff = end_time - start_time;
+        uint64_t ptime_diff = end_ptime - start_ptime;
+        rates.push_back(8.0 * size / time_diff);
+        times.push_back(1.0e-6 * time_diff);
+        cpu_usages.push_back((double)ptime_diff / time_diff);
+    }
+
+    rdmc::destroy_group(group_number);
+    rdmc::deregister_memory(payload.get());
+
+    send_stats s;
+    s.size = size;
+    s.block_size = block_size;
+    s.group_size = group_size;
+    s.iterations = iterations;
+
+    s.time.mean = compute_mean(times);
+    s.time.stddev = compute_stddev(times);
+    s.bandwidth.mean = compute_mean(rates);
+    s.bandwidth.stddev = compute_stddev(rates);
+    s.cpu_usage.mean = compute_mean(cpu_usages);
+    s.cpu_usage.stddev = compute_stddev(cpu_usages);
+    return s;
 }
 
 void blocksize_v_bandwidth(uint16_t gsize) {
@@ -315,6 +537,64 @@ void bandwidth_group_size() {
     puts("");
     fflush(stdout);
 }
+void pipelined_bandwidth() {
+    puts("=========================================================");
+    puts("=         Pipelined vs. One-at-a-time Bandwidth         =");
+    puts("=========================================================");
+    puts("Message Size, Pipelined, One-at-a-time, Pstddev, Ostddev");
+    fflush(stdout);
+
+    for(size_t size = 64 << 10; size <= 1 << 20; size *= 2) {
+        auto bp = measure_pipelined_multicast(size, 64 << 10, num_nodes, 64, 16, true);
+        auto bo = measure_pipelined_multicast(size, 64 << 10, num_nodes, 64, 16, false);
+        printf("%lu, %f, %f, %f, %f\n", size, bp.bandwidth.mean, bo.bandwidth.mean,
+               bp.bandwidth.stddev, bo.bandwidth.stddev);
+        fflush(stdout);
+    }
+    puts("");
+    fflush(stdout);
+}
+void scatter_gather_bandwidth() {
+    puts("=========================================================");
+    puts("=          Scatter-gather vs. Copied Bandwidth          =");
+    puts("=========================================================");
+    puts("Message Size, Scatter-gather, Copied, Sstddev, Cstddev");
+    fflush(stdout);
+
+    for(size_t size = 1 << 20; size <= 256 << 20; size *= 4) {
+        auto bs = measure_scatter_gather_multicast(size, 1 << 20, num_nodes, 16, true);
+        auto bc = measure_scatter_gather_multicast(size, 1 << 20, num_nodes, 16, false);
+        printf("%lu, %f, %f, %f, %f\n", size, bs.bandwidth.mean, bc.bandwidth.mean,
+               bs.bandwidth.stddev, bc.bandwidth.stddev);
+        fflush(stdout);
+    }
+    puts("");
+    fflush(stdout);
+}
+void hybrid_bandwidth(uint32_t num_racks) {
+    puts("=========================================================");
+    puts("=              Hybrid vs. Binomial Bandwidth            =");
+    puts("=========================================================");
+    printf("Nodes are split into %u racks of consecutive ranks\n", num_racks);
+    puts("Message Size, Hybrid, Binomial, Hstddev, Bstddev");
+    fflush(stdout);
+
+    map<uint32_t, uint32_t> node_racks;
+    for(uint32_t i = 0; i < num_nodes; i++) {
+        node_racks[i] = i * num_racks / num_nodes;
+    }
+    for(size_t size = 1 << 20; size <= 64 << 20; size *= 4) {
+        auto bh = measure_multicast(size, 1 << 20, num_nodes, 16,
+                                    rdmc::HYBRID_SEND, true, node_racks);
+        auto bb = measure_multicast(size, 1 << 20, num_nodes, 16,
+                                    rdmc::BINOMIAL_SEND);
+        printf("%lu, %f, %f, %f, %f\n", size, bh.bandwidth.mean, bb.bandwidth.mean,
+               bh.bandwidth.stddev, bb.bandwidth.stddev);
+        fflush(stdout);
+    }
+    puts("");
+    fflush(stdout);
+}
 void concurrent_bandwidth_group_size() {
     puts("=========================================================");
     puts("=         Concurrent Bandwidth vs. Group Size           =");
@@ -734,6 +1014,12 @@ int main(int argc, char *argv[]) {
         latency_group_size();
     } else if(strcmp(argv[1], "smallsend") == 0) {
         // small_send_latency_group_size();
+    } else if(strcmp(argv[1], "hybrid") == 0) {
+        hybrid_bandwidth(argc >= 3 ? atoi(argv[2]) : 2);
+    } else if(strcmp(argv[1], "pipeline") == 0) {
+        pipelined_bandwidth();
+    } else if(strcmp(argv[1], "scatter_gather") == 0) {
+        scatter_gather_bandwidth();
     } else if(strcmp(argv[1], "concurrent") == 0) {
         concurrent_bandwidth_group_size();
     } else if(strcmp(argv[1], "active_senders") == 0) {
@@ -36,6 +36,11 @@ group::group(uint16_t _group_number, size_t _block_size,
           completion_callback(callback),
           incoming_message_upcall(upcall) {}
 group::~group() { unique_lock<mutex> lock(monitor); }
+void group::rebind(incoming_message_callback_t upcall, completion_callback_t callback) {
+    unique_lock<mutex> lock(monitor);
+    incoming_message_upcall = std::move(upcall);
+    completion_callback = std::move(callback);
+}
 
 void polling_group::initialize_message_types() {
     auto find_group = [](uint16_t group_number) {
@@ -278,17 +283,110 @@ void polling_group::send_message(shared_ptr<memory_region> message_mr, size_t of
     if(length == 0) throw rdmc::invalid_args();
     if(offset + length > message_mr->size) throw rdmc::invalid_args();
     if(member_index > 0) throw rdmc::nonroot_sender();
+    if((length - 1) / block_size + 1 > std::numeric_limits<uint16_t>::max())
+        throw rdmc::invalid_args();
+
+    // A message in progress is followed by the queued ones, in order
+    if(mr || !queued_sends.empty()) {
+        LOG_EVENT(group_number, message_number, -1, "queued_message");
+        queued_sends.push(outgoing_message{std::move(message_mr), offset, length});
+        return;
+    }
+    start_message(std::move(message_mr), offset, length);
+}
+void polling_group::send_message(vector<message_segment> segments) {
+    LOG_EVENT(group_number, -1, -1, "send()");
+
+    unique_lock<mutex> lock(monitor);
+
+    size_t length = 0;
+    for(const auto& segment : segments) {
+        if(segment.mr && segment.buffer + segment.length > segment.mr->buffer + segment.mr->size)
+            throw rdmc::invalid_args();
+        length += segment.length;
+    }
+    if(length == 0) throw rdmc::invalid_args();
+    if(member_index > 0) throw rdmc::nonroot_sender();
+    if((length - 1) / block_size + 1 > std::numeric_limits<uint16_t>::max())
+        throw rdmc::invalid_args();
+
+    if(mr || !queued_sends.empty()) {
+        LOG_EVENT(group_number, message_number, -1, "queued_message");
+        queued_sends.push(outgoing_message{nullptr, 0, length, std::move(segments)});
+        return;
+    }
+    start_message(std::move(segments));
+}
+void polling_group::start_message(vector<message_segment> segments) {
+    message_segments = std::move(segments);
+    message_size = 0;
+    for(const auto& segment : message_segments) {
+        message_size += segment.length;
+    }
+    num_blocks = (message_size - 1) / block_size + 1;
+
+    // Send each block from the registered segment that contains it, if any
+    block_sources.assign(num_blocks, {nullptr, 0});
+    vector<size_t> staged_blocks;
+    size_t segment_index = 0;
+    size_t segment_start = 0;  // offset of the segment in the message
+    size_t first_block_segment = 0;
+    for(size_t block = 0; block < num_blocks; ++block) {
+        size_t block_start = block * block_size;
+        size_t nbytes = min(block_size, message_size - block_start);
+        while(segment_start + message_segments[segment_index].length <= block_start) {
+            segment_start += message_segments[segment_index++].length;
+        }
+        if(block == 0) {
+            first_block_segment = segment_index;
+        }
+        const message_segment& segment = message_segments[segment_index];
+        if(segment.mr && block_start + nbytes <= segment_start + segment.length) {
+            block_sources[block] = {segment.mr.get(),
+                                    (segment.buffer - segment.mr->buffer) + (block_start - segment_start)};
+        } else {
+            staged_blocks.push_back(block);
+        }
+    }
+
+    // Copy the other blocks into the staging buffer. The previous message has
+    // finished sending, so none of its blocks are still being read from it.
+    if(!staged_blocks.empty()) {
+        if(!staging_mr || staging_mr->size < staged_blocks.size() * block_size) {
+            staging_mr = make_shared<memory_region>(staged_blocks.size() * block_size);
+        }
+        for(size_t i = 0; i < staged_blocks.size(); ++i) {
+            size_t block_start = staged_blocks[i] * block_size;
+            size_t block_end = min(block_start + block_size, message_size);
+            char* dest = staging_mr->buffer + i * block_size;
+            size_t segment_start = 0;
+            for(const auto& segment : message_segments) {
+                size_t segment_end = segment_start + segment.length;
+                size_t copy_start = max(block_start, segment_start);
+                size_t copy_end = min(block_end, segment_end);
+                if(copy_start < copy_end) {
+                    memcpy(dest + (copy_start - block_start),
+                           segment.buffer + (copy_start - segment_start), copy_end - copy_start);
+                }
+                segment_start = segment_end;
+            }
+            block_sources[staged_blocks[i]] = {staging_mr.get(), i * block_size};
+        }
+    }
 
-    // Queueing sends is not supported
-    if(receive_step > 0) throw rdmc::group_busy();
-    if(send_step > 0) throw rdmc::group_busy();
+    // mr marks the message as in progress, and keeps the region of its first block alive
+    mr = block_sources[0].first == staging_mr.get() ? staging_mr : message_segments[first_block_segment].mr;
+    mr_offset = block_sources[0].second;
+    LOG_EVENT(group_number, message_number, -1, "send_message");
 
-    mr = message_mr;
+    send_next_block();
+}
+void polling_group::start_message(shared_ptr<memory_region> message_mr,
+                                  size_t offset, size_t length) {
+    mr = std::move(message_mr);
     mr_offset = offset;
     message_size = length;
     num_blocks = (message_size - 1) / block_size + 1;
-    if(num_blocks > std::numeric_limits<uint16_t>::max())
-        throw rdmc::invalid_args();
     // printf("message_size = %lu, block_size = %lu, num_blocks = %lu\n",
     //        message_size, block_size, num_blocks);
     LOG_EVENT(group_number, message_number, -1, "send_message");
@@ -340,6 +438,13 @@ void polling_group::send_next_block() {
                                    form_tag(group_number, target),
                                    form_immediate(num_blocks, block_number),
                                    message_types.data_block));
+    } else if(!block_sources.empty()) {
+        size_t nbytes = min(block_size, message_size - block_number * block_size);
+        CHECK(it->second.post_send(*block_sources[block_number].first,
+                                   block_sources[block_number].second, nbytes,
+                                   form_tag(group_number, target),
+                                   form_immediate(num_blocks, block_number),
+                                   message_types.data_block));
     } else {
         size_t offset = block_number * block_size;
         size_t nbytes = min(block_size, message_size - offset);
@@ -376,7 +481,13 @@ void polling_group::complete_message() {
         LOG_EVENT(group_number, message_number, *first_block_number,
                   "finished_remap_first_block");
     }
-    completion_callback(mr->buffer + mr_offset, message_size);
+    if(message_segments.empty()) {
+        completion_callback(mr->buffer + mr_offset, message_size);
+    } else {
+        completion_callback(message_segments.front().buffer, message_size);
+        message_segments.clear();
+        block_sources.clear();
+    }
 
     ++message_number;
     sending = false;
@@ -404,6 +515,17 @@ void polling_group::complete_message() {
         // cout << "Issued Ready For Block DDDDDDD (target = " <<
         // transfer->target
         //      << ")" << endl;
+    } else if(!queued_sends.empty()) {
+        // The receivers that still have blocks of the previous message to
+        // forward only announce they are ready for the next one once they
+        // are done, so its blocks cannot overtake those of the previous one
+        outgoing_message next = std::move(queued_sends.front());
+        queued_sends.pop();
+        if(next.segments.empty()) {
+            start_message(std::move(next.mr), next.offset, next.length);
+        } else {
+            start_message(std::move(next.segments));
+        }
     }
 }
 void polling_group::post_recv(schedule::block_transfer transfer) {
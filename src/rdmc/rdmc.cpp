@@ -13,6 +13,7 @@
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -34,6 +35,10 @@ atomic<bool> shutdown_flag;
 map<uint16_t, shared_ptr<group>> groups;
 mutex groups_lock;
 
+// buffers registered with register_memory, by start address
+map<char*, shared_ptr<memory_region>> registered_regions;
+mutex registered_regions_lock;
+
   bool initialize(const map<uint32_t, std::pair<ip_addr_t, uint16_t>>& ip_addrs_and_ports, uint32_t _node_rank) {
     if(shutdown_flag) return false;
 
@@ -61,7 +66,8 @@ bool create_group(uint16_t group_number, std::vector<uint32_t> members,
                   size_t block_size, send_algorithm algorithm,
                   incoming_message_callback_t incoming_upcall,
                   completion_callback_t callback,
-                  failure_callback_t failure_callback) {
+                  failure_callback_t failure_callback,
+                  const map<uint32_t, uint32_t>& node_racks) {
     if(shutdown_flag) return false;
 
     schedule* send_schedule;
@@ -74,6 +80,15 @@ bool create_group(uint16_t group_number, std::vector<uint32_t> members,
         send_schedule = new chain_schedule(members.size(), member_index);
     } else if(algorithm == TREE_SEND) {
         send_schedule = new tree_schedule(members.size(), member_index);
+    } else if(algorithm == HYBRID_SEND) {
+        vector<uint32_t> member_racks(members.size());
+        for(size_t i = 0; i < members.size(); ++i) {
+            auto it = node_racks.find(members[i]);
+            // Give an unlisted member a rack no listed member can be in
+            member_racks[i] = it != node_racks.end() ? it->second
+                                                     : numeric_limits<uint32_t>::max() - i;
+        }
+        send_schedule = new hybrid_schedule(members.size(), member_index, member_racks);
     } else {
         puts("Unsupported group type?!");
         fflush(stdout);
@@ -88,6 +103,22 @@ bool create_group(uint16_t group_number, std::vector<uint32_t> members,
     return p.second;
 }
 
+bool rebind_group(uint16_t group_number,
+                  incoming_message_callback_t incoming_upcall,
+                  completion_callback_t callback) {
+    if(shutdown_flag) return false;
+
+    shared_ptr<group> g;
+    {
+        unique_lock<mutex> lock(groups_lock);
+        auto it = groups.find(group_number);
+        if(it == groups.end()) return false;
+        g = it->second;
+    }
+    LOG_EVENT(group_number, -1, -1, "rebind_group");
+    g->rebind(std::move(incoming_upcall), std::move(callback));
+    return true;
+}
 void destroy_group(uint16_t group_number) {
     if(shutdown_flag) return;
 
@@ -118,6 +149,51 @@ bool send(uint16_t group_number, shared_ptr<memory_region> mr, size_t offset,
     g->send_message(mr, offset, length);
     return true;
 }
+bool send(uint16_t group_number, const vector<segment>& segments) {
+    if(shutdown_flag) return false;
+
+    shared_ptr<group> g;
+    {
+        unique_lock<mutex> lock(groups_lock);
+        auto it = groups.find(group_number);
+        if(it == groups.end()) return false;
+        g = it->second;
+    }
+    // Find the registered region containing each segment, if any
+    vector<message_segment> message_segments;
+    message_segments.reserve(segments.size());
+    {
+        unique_lock<mutex> lock(registered_regions_lock);
+        for(const segment& s : segments) {
+            shared_ptr<memory_region> segment_mr;
+            auto it = registered_regions.upper_bound(s.buffer);
+            if(it != registered_regions.begin()) {
+                --it;
+                if(s.buffer + s.length <= it->second->buffer + it->second->size) {
+                    segment_mr = it->second;
+                }
+            }
+            message_segments.push_back(message_segment{s.buffer, s.length, std::move(segment_mr)});
+        }
+    }
+    LOG_EVENT(group_number, -1, -1, "preparing_to_send_message");
+    g->send_message(std::move(message_segments));
+    return true;
+}
+shared_ptr<memory_region> register_memory(char* buffer, size_t size) {
+    unique_lock<mutex> lock(registered_regions_lock);
+    auto it = registered_regions.find(buffer);
+    if(it != registered_regions.end() && it->second->size >= size) {
+        return it->second;
+    }
+    auto mr = make_shared<memory_region>(buffer, size);
+    registered_regions[buffer] = mr;
+    return mr;
+}
+void deregister_memory(char* buffer) {
+    unique_lock<mutex> lock(registered_regions_lock);
+    registered_regions.erase(buffer);
+}
 // void query_addresses(std::map<uint32_t, std::string>& addresses,
 //                      uint32_t& node_rank) {
 //     query_peer_addresses(addresses, node_rank);
@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <climits>
+#include <map>
 
 using std::min;
 using std::optional;
@@ -491,3 +492,120 @@ optional<schedule::block_transfer> binomial_schedule::get_first_block(size_t num
 
     return transfer;
 }
+
+hybrid_schedule::hybrid_schedule(uint32_t members, uint32_t index,
+                                 const vector<uint32_t>& member_racks)
+        : schedule(members, index) {
+    assert_always(member_racks.size() == num_members);
+    // Iterating in member order numbers the racks by their leaders
+    std::map<uint32_t, uint32_t> rack_numbers;
+    for(uint32_t i = 0; i < num_members; i++) {
+        auto rack = rack_numbers.emplace(member_racks[i], rack_members.size());
+        if(rack.second) {
+            rack_members.emplace_back();
+        }
+        if(i == member_index) {
+            my_rack = rack.first->second;
+            my_position = rack_members[my_rack].size();
+        }
+        rack_members[rack.first->second].push_back(i);
+    }
+
+    max_rack_size = 0;
+    for(const auto& rack : rack_members) {
+        max_rack_size = std::max(max_rack_size, rack.size());
+    }
+    if(rack_members.size() > 1) {
+        leader_schedule = std::make_unique<binomial_schedule>(rack_members.size(), my_rack);
+    }
+}
+size_t hybrid_schedule::get_leader_steps(size_t num_blocks) const {
+    // With a single rack, the sender feeds its chain one block per step
+    return leader_schedule ? leader_schedule->get_total_steps(num_blocks) : num_blocks;
+}
+optional<size_t> hybrid_schedule::get_forwarded_block(size_t num_blocks, size_t step) const {
+    // The block that this rack's leader sends down the chain on the given step.
+    // That is the block it received on the previous (binomial) step, or for
+    // the sender, the blocks in order.
+    size_t stride = leader_schedule ? 2 : 1;
+    if(step % stride != stride - 1) return std::nullopt;
+
+    size_t leader_step = step / stride;
+    if(leader_step >= get_leader_steps(num_blocks)) return std::nullopt;
+    if(my_rack == 0) {
+        if(leader_step >= num_blocks) return std::nullopt;
+        return leader_step;
+    }
+    auto transfer = leader_schedule->get_incoming_transfer(num_blocks, leader_step);
+    if(!transfer) return std::nullopt;
+    return transfer->block_number;
+}
+vector<uint32_t> hybrid_schedule::get_connections() const {
+    const vector<uint32_t>& rack = rack_members[my_rack];
+    vector<uint32_t> ret;
+    if(my_position == 0 && leader_schedule) {
+        for(uint32_t leader : leader_schedule->get_connections()) {
+            ret.push_back(rack_members[leader][0]);
+        }
+    }
+    if(my_position > 0) {
+        ret.push_back(rack[my_position - 1]);
+    }
+    if(my_position + 1 < rack.size()) {
+        ret.push_back(rack[my_position + 1]);
+    }
+    return ret;
+}
+size_t hybrid_schedule::get_total_steps(size_t num_blocks) const {
+    // The last block is forwarded down a chain on step stride * leader_steps - 1
+    // at the latest, and then needs a step per hop
+    size_t stride = leader_schedule ? 2 : 1;
+    if(max_rack_size == 1) return stride * get_leader_steps(num_blocks) - 1;
+    return stride * get_leader_steps(num_blocks) + max_rack_size - 2;
+}
+optional<schedule::block_transfer> hybrid_schedule::get_outgoing_transfer(size_t num_blocks, size_t step) const {
+    if(step >= get_total_steps(num_blocks)) return std::nullopt;
+
+    const vector<uint32_t>& rack = rack_members[my_rack];
+    if(my_position + 1 < rack.size() && step >= my_position) {
+        auto block = get_forwarded_block(num_blocks, step - my_position);
+        if(block) return block_transfer{rack[my_position + 1], *block};
+    }
+    if(my_position == 0 && leader_schedule && step % 2 == 0
+       && step / 2 < leader_schedule->get_total_steps(num_blocks)) {
+        auto transfer = leader_schedule->get_outgoing_transfer(num_blocks, step / 2);
+        if(transfer) return block_transfer{rack_members[transfer->target][0], transfer->block_number};
+    }
+    return std::nullopt;
+}
+optional<schedule::block_transfer> hybrid_schedule::get_incoming_transfer(size_t num_blocks, size_t step) const {
+    if(step >= get_total_steps(num_blocks)) return std::nullopt;
+
+    const vector<uint32_t>& rack = rack_members[my_rack];
+    if(my_position > 0) {
+        if(step + 1 < my_position) return std::nullopt;
+        auto block = get_forwarded_block(num_blocks, step + 1 - my_position);
+        if(!block) return std::nullopt;
+        return block_transfer{rack[my_position - 1], *block};
+    }
+    if(my_rack > 0 && step % 2 == 0 && step / 2 < leader_schedule->get_total_steps(num_blocks)) {
+        auto transfer = leader_schedule->get_incoming_transfer(num_blocks, step / 2);
+        if(transfer) return block_transfer{rack_members[transfer->target][0], transfer->block_number};
+    }
+    return std::nullopt;
+}
+optional<schedule::block_transfer> hybrid_schedule::get_first_block(size_t num_blocks) const {
+    if(member_index == 0) return std::nullopt;
+
+    // Like binomial_schedule, this does not depend on num_blocks except for
+    // the block number, which the caller caps at num_blocks - 1
+    const vector<uint32_t>& rack = rack_members[my_rack];
+    if(my_rack == 0) {
+        return block_transfer{rack[my_position - 1], 0};
+    }
+    auto transfer = leader_schedule->get_first_block(num_blocks);
+    if(my_position == 0) {
+        return block_transfer{rack_members[transfer->target][0], transfer->block_number};
+    }
+    return block_transfer{rack[my_position - 1], transfer->block_number};
+}
@@ -1,68 +1,164 @@
-#include <iostream>
-#include <numeric>
-#include <functional>
+#include <ctime>
+#include <linux/futex.h>
+#include <stdexcept>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include <derecho/sst/detail/poll_utils.hpp>
+#include <derecho/utils/logger.hpp>
 
 namespace sst {
 namespace util {
 
-//std::vector<std::list<std::pair<int32_t, int32_t>>> PollingData::completion_entries;
-//std::map<std::thread::id, uint32_t> PollingData::tid_to_index;
-//std::vector<bool> PollingData::if_waiting;
-//std::condition_variable PollingData::poll_cv;
-//std::mutex PollingData::poll_mutex;
-
 //Single global instance, defined here
 PollingData polling_data;
 
-bool PollingData::check_waiting() {
-    return std::accumulate(if_waiting.begin(), if_waiting.end(), false, [](bool a, bool b) { return a || b; });
+/**
+ * Holds the mailbox of a thread, and gives it back when the thread exits so
+ * that threads started at every view change do not use up the mailboxes.
+ */
+struct MailboxLease {
+    PollingData* owner = nullptr;
+    uint32_t index = 0;
+    ~MailboxLease() {
+        if(owner != nullptr) {
+            owner->release_index(index);
+        }
+    }
+};
+
+static thread_local MailboxLease mailbox_lease;
+
+uint32_t PollingData::acquire_index() {
+    std::lock_guard<std::mutex> lk(registration_mutex);
+    uint32_t index;
+    if(!free_indices.empty()) {
+        index = free_indices.back();
+        free_indices.pop_back();
+    } else {
+        if(mailbox_storage.size() == MAX_MAILBOXES) {
+            throw std::runtime_error("More than " + std::to_string(MAX_MAILBOXES)
+                                     + " threads are waiting for SST completions");
+        }
+        index = mailbox_storage.size();
+        mailbox_storage.emplace_back(std::make_unique<CompletionMailbox>());
+        mailboxes[index].store(mailbox_storage.back().get(), std::memory_order_release);
+    }
+    // drop the entries left by the previous owner
+    CompletionMailbox& mailbox = *mailbox_storage[index];
+    mailbox.head.store(mailbox.tail.load(std::memory_order_acquire), std::memory_order_release);
+    return index;
+}
+
+void PollingData::release_index(uint32_t index) {
+    CompletionMailbox& mailbox = *mailboxes[index].load(std::memory_order_acquire);
+    if(mailbox.waiting.exchange(false)) {
+        num_waiting--;
+    }
+    std::lock_guard<std::mutex> lk(registration_mutex);
+    free_indices.push_back(index);
+}
+
+PollingData::CompletionMailbox& PollingData::my_mailbox() {
+    return *mailboxes[get_index()].load(std::memory_order_acquire);
+}
+
+uint32_t PollingData::get_index() {
+    if(mailbox_lease.owner != this) {
+        mailbox_lease.index = acquire_index();
+        mailbox_lease.owner = this;
+    }
+    return mailbox_lease.index;
 }
 
 void PollingData::insert_completion_entry(uint32_t index, std::pair<int32_t, int32_t> ce) {
-    std::lock_guard<std::mutex> lk(poll_mutex);
-    completion_entries[index].push_back(ce);
+    CompletionMailbox* mailbox = (index < MAX_MAILBOXES) ? mailboxes[index].load(std::memory_order_acquire) : nullptr;
+    if(mailbox == nullptr) {
+        dbg_default_warn("Dropping a completion entry for unknown mailbox {}", index);
+        return;
+    }
+    const uint32_t tail = mailbox->tail.load(std::memory_order_relaxed);
+    if(tail - mailbox->head.load(std::memory_order_acquire) == MAILBOX_CAPACITY) {
+        dbg_default_warn("Dropping a completion entry for mailbox {}, which is full", index);
+        return;
+    }
+    mailbox->entries[tail % MAILBOX_CAPACITY] = ce;
+    mailbox->tail.store(tail + 1, std::memory_order_release);
+    // Pairs with the fence in wait_for_completion_entry(): either the owner
+    // sees the new entry before it sleeps, or this sees that it sleeps.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(mailbox->sleeping.load(std::memory_order_relaxed) == 1 && mailbox->sleeping.exchange(0) == 1) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&mailbox->sleeping), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
 }
 
-std::optional<std::pair<int32_t, int32_t>> PollingData::get_completion_entry(const std::thread::id id) {
-    std::lock_guard<std::mutex> lk(poll_mutex);
-    auto index = tid_to_index[id];
-    if(completion_entries[index].empty()) {
+std::optional<std::pair<int32_t, int32_t>> PollingData::take_entry(CompletionMailbox& mailbox) {
+    const uint32_t head = mailbox.head.load(std::memory_order_relaxed);
+    if(head == mailbox.tail.load(std::memory_order_acquire)) {
         return {};
     }
-    auto ce = completion_entries[index].front();
-    completion_entries[index].pop_front();
+    auto ce = mailbox.entries[head % MAILBOX_CAPACITY];
+    mailbox.head.store(head + 1, std::memory_order_release);
     return ce;
 }
 
-uint32_t PollingData::get_index(const std::thread::id id) {
-    std::lock_guard<std::mutex> lk(poll_mutex);
-    if(tid_to_index.find(id) == tid_to_index.end()) {
-        completion_entries.push_back(std::list<std::pair<int32_t, int32_t>>());
-        tid_to_index[id] = completion_entries.size() - 1;
-        if_waiting.push_back(false);
+std::optional<std::pair<int32_t, int32_t>> PollingData::get_completion_entry() {
+    return take_entry(my_mailbox());
+}
+
+std::optional<std::pair<int32_t, int32_t>> PollingData::wait_for_completion_entry(
+        const std::chrono::steady_clock::time_point& deadline) {
+    CompletionMailbox& mailbox = my_mailbox();
+    for(uint32_t spins = 0; spins < SPIN_COUNT; spins++) {
+        auto ce = take_entry(mailbox);
+        if(ce) {
+            return ce;
+        }
+    }
+    while(true) {
+        auto ce = take_entry(mailbox);
+        if(ce) {
+            return ce;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if(now >= deadline) {
+            return {};
+        }
+        mailbox.sleeping.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(mailbox.head.load(std::memory_order_relaxed) != mailbox.tail.load(std::memory_order_acquire)) {
+            mailbox.sleeping.store(0, std::memory_order_relaxed);
+            continue;
+        }
+        const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count();
+        struct timespec timeout;
+        timeout.tv_sec = remaining / 1000000000;
+        timeout.tv_nsec = remaining % 1000000000;
+        // returns right away if the polling thread has already cleared the flag
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&mailbox.sleeping), FUTEX_WAIT_PRIVATE, 1, &timeout, nullptr, 0);
+        mailbox.sleeping.store(0, std::memory_order_relaxed);
     }
-    return tid_to_index[id];
 }
 
-void PollingData::set_waiting(const std::thread::id id) {
-    std::lock_guard<std::mutex> lk(poll_mutex);
-    auto index = tid_to_index[id];
-    if_waiting[index] = true;
-    poll_cv.notify_all();
+void PollingData::set_waiting() {
+    CompletionMailbox& mailbox = my_mailbox();
+    if(!mailbox.waiting.exchange(true) && num_waiting++ == 0) {
+        std::lock_guard<std::mutex> lk(poll_mutex);
+        poll_cv.notify_all();
+    }
 }
 
-void PollingData::reset_waiting(const std::thread::id id) {
-    std::lock_guard<std::mutex> lk(poll_mutex);
-    auto index = tid_to_index[id];
-    if_waiting[index] = false;
+void PollingData::reset_waiting() {
+    CompletionMailbox& mailbox = my_mailbox();
+    if(mailbox.waiting.exchange(false)) {
+        num_waiting--;
+    }
 }
 
 void PollingData::wait_for_requests() {
     std::unique_lock<std::mutex> lk(poll_mutex);
-    // poll_cv.wait(lk, check_waiting);
-    poll_cv.wait(lk, std::bind(&PollingData::check_waiting, this));
+    poll_cv.wait(lk, [this]() { return num_waiting > 0; });
 }
 }  // namespace util
 }  // namespace sst
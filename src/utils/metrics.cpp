@@ -0,0 +1,416 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/utils/logger.hpp>
+#include <derecho/utils/metrics.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace derecho {
+namespace metrics {
+
+namespace detail {
+std::atomic<bool> metrics_enabled{false};
+}
+
+namespace {
+
+// the tracked subgroups, the overflow slot and the slot of NO_SUBGROUP
+constexpr uint32_t NUM_SLOTS = MAX_TRACKED_SUBGROUPS + 2;
+constexpr uint32_t NUM_METRICS = static_cast<uint32_t>(Metric::NUM_METRICS);
+
+/**
+ * The samples of one metric in one subgroup recorded by one thread. Only the
+ * owning thread writes it, so the fields are atomic only to be read by
+ * snapshot() while they are being written.
+ */
+struct Histogram {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets{};
+
+    void add(uint64_t value) {
+        uint32_t bucket = (value == 0) ? 0 : std::min<uint32_t>(64 - __builtin_clzll(value), NUM_BUCKETS - 1);
+        buckets[bucket].store(buckets[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        if(value > max.load(std::memory_order_relaxed)) {
+            max.store(value, std::memory_order_relaxed);
+        }
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void clear() {
+        for(auto& bucket : buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        sum.store(0, std::memory_order_relaxed);
+        max.store(0, std::memory_order_relaxed);
+        count.store(0, std::memory_order_relaxed);
+    }
+
+    void merge_into(Summary& summary) const {
+        summary.count += count.load(std::memory_order_relaxed);
+        summary.sum += sum.load(std::memory_order_relaxed);
+        summary.max = std::max(summary.max, max.load(std::memory_order_relaxed));
+        for(uint32_t i = 0; i < NUM_BUCKETS; i++) {
+            summary.buckets[i] += buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+};
+
+/** The histograms of one thread, each allocated by the thread when it first records it. */
+struct ThreadMetrics {
+    std::array<std::array<std::atomic<Histogram*>, NUM_SLOTS>, NUM_METRICS> histograms{};
+
+    ~ThreadMetrics() {
+        for(auto& slots : histograms) {
+            for(auto& slot : slots) {
+                delete slot.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+uint32_t slot_of(uint32_t subgroup) {
+    if(subgroup == NO_SUBGROUP) {
+        return MAX_TRACKED_SUBGROUPS + 1;
+    }
+    return std::min(subgroup, MAX_TRACKED_SUBGROUPS);
+}
+
+uint32_t subgroup_of(uint32_t slot) {
+    return slot == MAX_TRACKED_SUBGROUPS + 1 ? NO_SUBGROUP : slot;
+}
+
+struct Registry {
+    // guards everything below
+    std::mutex mutex;
+    // the histograms of the running threads
+    std::vector<std::shared_ptr<ThreadMetrics>> threads;
+    // the samples of the threads that have exited, by metric and slot
+    std::map<std::pair<uint32_t, uint32_t>, Summary> retired;
+    export_callback_t export_callback;
+    // the number of initialize() calls not yet undone by shutdown()
+    uint32_t num_users = 0;
+    std::thread exporter;
+    bool exporter_shutdown = false;
+    std::condition_variable exporter_cv;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+Summary empty_summary(uint32_t metric, uint32_t slot) {
+    Summary summary{static_cast<Metric>(metric), subgroup_of(slot), 0, 0, 0, {}};
+    summary.buckets.fill(0);
+    return summary;
+}
+
+/** Folds the samples of a thread into Registry::retired when the thread exits. */
+struct ThreadHandle {
+    std::shared_ptr<ThreadMetrics> metrics;
+
+    ThreadMetrics* get() {
+        if(!metrics) {
+            metrics = std::make_shared<ThreadMetrics>();
+            Registry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            reg.threads.push_back(metrics);
+        }
+        return metrics.get();
+    }
+
+    ~ThreadHandle() {
+        if(!metrics) {
+            return;
+        }
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for(uint32_t metric = 0; metric < NUM_METRICS; metric++) {
+            for(uint32_t slot = 0; slot < NUM_SLOTS; slot++) {
+                Histogram* histogram = metrics->histograms[metric][slot].load(std::memory_order_relaxed);
+                if(histogram == nullptr) {
+                    continue;
+                }
+                auto retired = reg.retired.try_emplace({metric, slot}, empty_summary(metric, slot)).first;
+                histogram->merge_into(retired->second);
+            }
+        }
+        reg.threads.erase(std::find(reg.threads.begin(), reg.threads.end(), metrics));
+    }
+};
+
+thread_local ThreadHandle this_thread_metrics;
+
+void write_file(const std::string& file, const std::string& text) {
+    // write a temporary file and rename it, so readers never see a partial snapshot
+    const std::string tmp_file = file + ".tmp";
+    {
+        std::ofstream out(tmp_file, std::ios::trunc);
+        if(!out) {
+            dbg_default_warn("metrics: cannot write {}", tmp_file);
+            return;
+        }
+        out << text;
+    }
+    if(std::rename(tmp_file.c_str(), file.c_str()) != 0) {
+        dbg_default_warn("metrics: cannot rename {} to {}", tmp_file, file);
+    }
+}
+
+int open_socket(const std::string& path) {
+    struct sockaddr_un addr = {};
+    if(path.length() >= sizeof(addr.sun_path)) {
+        dbg_default_warn("metrics: socket path {} is too long", path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) {
+        dbg_default_warn("metrics: cannot create a socket, errno={}", errno);
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    path.copy(addr.sun_path, path.length());
+    unlink(path.c_str());
+    if(bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        dbg_default_warn("metrics: cannot listen on {}, errno={}", path, errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void serve_connection(int listen_fd) {
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if(fd < 0) {
+        return;
+    }
+    const std::string text = to_string(snapshot());
+    std::size_t sent = 0;
+    while(sent < text.length()) {
+        ssize_t n = send(fd, text.data() + sent, text.length() - sent, MSG_NOSIGNAL);
+        if(n <= 0) {
+            break;
+        }
+        sent += n;
+    }
+    close(fd);
+}
+
+void exporter_loop() {
+    pthread_setname_np(pthread_self(), "metrics");
+    Registry& reg = registry();
+    const std::string file = getConfString(CONF_DERECHO_METRICS_FILE);
+    const std::string socket_path = getConfString(CONF_DERECHO_METRICS_SOCKET);
+    const auto interval = std::chrono::milliseconds(std::max<uint32_t>(1, getConfUInt32(CONF_DERECHO_METRICS_INTERVAL_MS)));
+    int listen_fd = socket_path.empty() ? -1 : open_socket(socket_path);
+    auto next_export = std::chrono::steady_clock::now() + interval;
+    std::unique_lock<std::mutex> lock(reg.mutex);
+    while(!reg.exporter_shutdown) {
+        if(listen_fd >= 0) {
+            // wake up often enough to notice a shutdown while waiting for connections
+            auto timeout = std::min(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                            next_export - std::chrono::steady_clock::now()),
+                                    std::chrono::milliseconds(100));
+            lock.unlock();
+            struct pollfd pfd = {listen_fd, POLLIN, 0};
+            if(poll(&pfd, 1, std::max<int>(0, timeout.count())) > 0) {
+                serve_connection(listen_fd);
+            }
+            lock.lock();
+        } else {
+            reg.exporter_cv.wait_until(lock, next_export, [&reg]() { return reg.exporter_shutdown; });
+        }
+        if(reg.exporter_shutdown || std::chrono::steady_clock::now() < next_export) {
+            continue;
+        }
+        next_export += interval;
+        export_callback_t callback = reg.export_callback;
+        lock.unlock();
+        std::vector<Summary> summaries = snapshot();
+        if(callback) {
+            callback(summaries);
+        }
+        if(!file.empty()) {
+            write_file(file, to_string(summaries));
+        }
+        lock.lock();
+    }
+    lock.unlock();
+    if(listen_fd >= 0) {
+        close(listen_fd);
+        unlink(socket_path.c_str());
+    }
+}
+
+}  // namespace
+
+void detail::record(Metric metric, uint32_t subgroup, uint64_t value) {
+    std::atomic<Histogram*>& slot = this_thread_metrics.get()->histograms[static_cast<uint32_t>(metric)][slot_of(subgroup)];
+    Histogram* histogram = slot.load(std::memory_order_relaxed);
+    if(histogram == nullptr) {
+        histogram = new Histogram();
+        slot.store(histogram, std::memory_order_release);
+    }
+    histogram->add(value);
+}
+
+uint64_t Summary::percentile(double p) const {
+    if(count == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p / 100.0 * count + 0.5));
+    uint64_t seen = 0;
+    for(uint32_t i = 0; i < NUM_BUCKETS; i++) {
+        seen += buckets[i];
+        if(seen >= rank) {
+            const uint64_t upper_bound = (i == 0) ? 0 : (i == NUM_BUCKETS - 1 ? UINT64_MAX : (1ull << i) - 1);
+            return std::min(upper_bound, max);
+        }
+    }
+    return max;
+}
+
+void set_enabled(bool enable) {
+    detail::metrics_enabled.store(enable, std::memory_order_relaxed);
+}
+
+std::vector<Summary> snapshot() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    std::map<std::pair<uint32_t, uint32_t>, Summary> merged = reg.retired;
+    for(const auto& thread : reg.threads) {
+        for(uint32_t metric = 0; metric < NUM_METRICS; metric++) {
+            for(uint32_t slot = 0; slot < NUM_SLOTS; slot++) {
+                const Histogram* histogram = thread->histograms[metric][slot].load(std::memory_order_acquire);
+                if(histogram == nullptr) {
+                    continue;
+                }
+                auto summary = merged.try_emplace({metric, slot}, empty_summary(metric, slot)).first;
+                histogram->merge_into(summary->second);
+            }
+        }
+    }
+    std::vector<Summary> summaries;
+    for(auto& entry : merged) {
+        if(entry.second.count > 0) {
+            summaries.push_back(entry.second);
+        }
+    }
+    return summaries;
+}
+
+void reset() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.retired.clear();
+    // a sample being recorded concurrently may survive the reset in part
+    for(const auto& thread : reg.threads) {
+        for(auto& slots : thread->histograms) {
+            for(auto& slot : slots) {
+                Histogram* histogram = slot.load(std::memory_order_acquire);
+                if(histogram != nullptr) {
+                    histogram->clear();
+                }
+            }
+        }
+    }
+}
+
+void set_export_callback(const export_callback_t& callback) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.export_callback = callback;
+}
+
+const char* metric_name(Metric metric) {
+    switch(metric) {
+        case Metric::SEND_BUFFER_WAIT_NS:
+            return "send_buffer_wait_ns";
+        case Metric::SST_SEND_BYTES:
+            return "sst_send_bytes";
+        case Metric::RDMC_SEND_BYTES:
+            return "rdmc_send_bytes";
+        case Metric::RECEIVE_TO_STABLE_NS:
+            return "receive_to_stable_ns";
+        case Metric::STABLE_TO_DELIVER_NS:
+            return "stable_to_deliver_ns";
+        case Metric::DELIVER_TO_PERSIST_NS:
+            return "deliver_to_persist_ns";
+        case Metric::PERSIST_TO_VERIFY_NS:
+            return "persist_to_verify_ns";
+        case Metric::PREDICATE_LOOP_NS:
+            return "predicate_loop_ns";
+        case Metric::PERSISTENCE_QUEUE_DEPTH:
+            return "persistence_queue_depth";
+        case Metric::RPC_HANDLER_NS:
+            return "rpc_handler_ns";
+        case Metric::VIEW_CHANGE_NS:
+            return "view_change_ns";
+        default:
+            return "unknown";
+    }
+}
+
+std::string to_string(const std::vector<Summary>& summaries) {
+    std::ostringstream out;
+    for(const Summary& summary : summaries) {
+        out << metric_name(summary.metric) << " ";
+        if(summary.subgroup == NO_SUBGROUP) {
+            out << "-";
+        } else {
+            out << summary.subgroup;
+        }
+        out << " count=" << summary.count << " mean=" << static_cast<uint64_t>(summary.mean())
+            << " p50=" << summary.percentile(50) << " p99=" << summary.percentile(99)
+            << " max=" << summary.max << "\n";
+    }
+    return out.str();
+}
+
+void initialize() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    if(reg.num_users++ > 0 || !getConfBoolean(CONF_DERECHO_ENABLE_METRICS)) {
+        return;
+    }
+    set_enabled(true);
+    reg.exporter_shutdown = false;
+    reg.exporter = std::thread(exporter_loop);
+}
+
+void shutdown() {
+    Registry& reg = registry();
+    std::thread exporter;
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        if(reg.num_users == 0 || --reg.num_users > 0) {
+            return;
+        }
+        // with no Group left, nothing should keep paying for the recording
+        set_enabled(false);
+        reg.exporter_shutdown = true;
+        exporter = std::move(reg.exporter);
+    }
+    reg.exporter_cv.notify_all();
+    if(exporter.joinable()) {
+        exporter.join();
+    }
+}
+
+}  // namespace metrics
+}  // namespace derecho